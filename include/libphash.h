@@ -60,6 +60,9 @@ typedef enum {
     PH_ERR_INVALID_ARGUMENT = -3,
     PH_ERR_NOT_IMPLEMENTED = -4,
     PH_ERR_EMPTY_IMAGE = -5,
+    PH_ERR_NO_COLOR = -6, ///< Color data was not kept (see PH_LOAD_GRAY_ONLY).
+    PH_ERR_IO = -7,       ///< A file, socket or memory-mapping operation failed.
+    PH_ERR_FULL = -8,     ///< No free slot until completions are collected.
 } ph_error_t;
 
 // --- Types ---
@@ -82,8 +85,111 @@ typedef struct {
     uint8_t reserved[7];               ///< Padding for 64-bit alignment.
 } ph_digest_t;
 
+/**
+ * @brief Algorithm selector bits, combinable into a mask.
+ */
+typedef enum {
+    PH_ALGO_AHASH = 1 << 0,
+    PH_ALGO_DHASH = 1 << 1,
+    PH_ALGO_PHASH = 1 << 2,
+    PH_ALGO_WHASH = 1 << 3,
+    PH_ALGO_MHASH = 1 << 4,
+    PH_ALGO_BMH = 1 << 5,
+    PH_ALGO_COLOR = 1 << 6,
+    PH_ALGO_RADIAL = 1 << 7,
+} ph_algo_t;
+
+/** Mask selecting every algorithm. */
+#define PH_ALGO_ALL 0xFFu
+
+/**
+ * @brief Results of several algorithms computed for one image.
+ *
+ * @note Flat and FFI-safe, like ph_digest_t. Only fields whose PH_ALGO_* bit
+ * is set in 'mask' are valid.
+ */
+typedef struct {
+    uint32_t mask;     ///< PH_ALGO_* bits holding valid results.
+    uint32_t reserved; ///< Padding for 64-bit alignment.
+    uint64_t ahash;
+    uint64_t dhash;
+    uint64_t phash;
+    uint64_t whash;
+    uint64_t mhash;
+    ph_digest_t bmh;
+    ph_digest_t color;
+    ph_digest_t radial;
+} ph_hashes_t;
+
+/**
+ * @brief Where the image of the last load came from.
+ */
+typedef enum {
+    PH_SOURCE_NONE = 0,      ///< Nothing loaded.
+    PH_SOURCE_DECODED = 1,   ///< The image was fully decoded.
+    PH_SOURCE_CACHE = 2,     ///< Results were found in the attached result cache.
+    PH_SOURCE_THUMBNAIL = 3, ///< The embedded thumbnail was decoded (PH_LOAD_EXIF_THUMBNAIL).
+    PH_SOURCE_PIXELS = 4,    ///< Raw pixels were given to ph_load_from_pixels().
+} ph_load_source_t;
+
+/**
+ * @brief Options for decoding, see ph_context_set_load_flags().
+ */
+typedef enum {
+    PH_LOAD_DEFAULT = 0,
+    /** Decode luminance only, one byte per pixel. JPEG skips chroma upsampling
+     *  and color conversion. ph_compute_color_hash() returns PH_ERR_NO_COLOR. */
+    PH_LOAD_GRAY_ONLY = 1 << 0,
+    /** Decode the JPEG thumbnail embedded in the EXIF (or JFXX) header
+     *  instead of the full image, when it is at least the minimum resolution
+     *  (32x32 if none is set) and has the same aspect ratio. Otherwise the
+     *  image is decoded as usual; ph_get_load_source() tells which happened.
+     *  Hashes of a thumbnail can differ slightly from the full decode's. */
+    PH_LOAD_EXIF_THUMBNAIL = 1 << 1,
+} ph_load_flags_t;
+
+/**
+ * @brief Opaque persistent table of previously computed hashes.
+ */
+typedef struct ph_cache ph_cache_t;
+
+/**
+ * @brief Result cache counters, accumulated since the table was created.
+ */
+typedef struct {
+    uint64_t capacity;   ///< Maximum number of entries.
+    uint64_t entries;    ///< Entries currently stored.
+    uint64_t hits;       ///< Loads answered without decoding.
+    uint64_t misses;     ///< Loads that had to decode.
+    uint64_t insertions; ///< Entries written for new images.
+    uint64_t evictions;  ///< Entries displaced to make room.
+} ph_cache_stats_t;
+
 // --- Lifecycle & Configuration ---
 
+/**
+ * @brief Memory allocation hooks.
+ *
+ * Blocks must be aligned like malloc()'s. realloc_fn receives the current
+ * size of the block (0 when ptr is NULL), so an arena can implement it as
+ * allocate-and-copy; free_fn may do nothing for arenas reset wholesale.
+ */
+typedef struct {
+    void *(*malloc_fn)(void *user_data, size_t size);
+    void *(*realloc_fn)(void *user_data, void *ptr, size_t old_size, size_t new_size);
+    void (*free_fn)(void *user_data, void *ptr);
+    void *user_data; ///< Passed to every hook.
+} ph_allocator_t;
+
+/**
+ * @brief Replaces the allocator used for all library memory, including the
+ * buffers of the bundled image decoder. NULL restores malloc/free.
+ *
+ * @warning Not thread-safe. Call before any other library function, while
+ * no object allocated with the previous allocator is alive.
+ */
+PH_API PH_NODISCARD ph_error_t ph_set_allocator(const ph_allocator_t *allocator);
+
 /**
  * @brief Returns the library version string (e.g., "1.2.0").
  */
@@ -112,6 +218,85 @@ PH_API void ph_free(ph_context_t *ctx);
  */
 PH_API void ph_context_set_gamma(ph_context_t *ctx, float gamma);
 
+/**
+ * @brief Sets the smallest image size the hashes still need.
+ *
+ * Decoder backends that support it (see ph_decoder_t::decode_scaled) may then
+ * decode at a reduced scale, as long as the result is at least
+ * min_width x min_height. Results can differ slightly from a full-resolution
+ * decode. Default is 0 x 0 (always decode at full resolution).
+ */
+PH_API void ph_context_set_min_resolution(ph_context_t *ctx, int min_width, int min_height);
+
+/**
+ * @brief Sets the PH_LOAD_* flags applied by subsequent loads.
+ *
+ * With PH_LOAD_GRAY_ONLY the decoded plane doubles as the grayscale buffer
+ * shared by the hashes, so no color copy is kept. Luma from the decoder can
+ * differ by a level or so from the RGB conversion, and so can the hashes.
+ */
+PH_API void ph_context_set_load_flags(ph_context_t *ctx, uint32_t flags);
+
+/**
+ * @brief Allocates the context's image memory (decoder output and scratch,
+ * grayscale plane, pyramid) with 'allocator' instead of the global one.
+ * NULL reverts to the global allocator.
+ *
+ * The current image and the buffers kept for reuse are released first. The
+ * hooks are copied; user_data must stay valid while the context uses them.
+ */
+PH_API PH_NODISCARD ph_error_t ph_context_set_allocator(ph_context_t *ctx,
+                                                        const ph_allocator_t *allocator);
+
+/**
+ * @brief Releases the loaded image and every buffer the context keeps for
+ * reuse, leaving the settings untouched.
+ *
+ * After this nothing in the context refers to memory from its allocator,
+ * e.g. a per-request arena can be reset before the next load.
+ */
+PH_API void ph_context_trim(ph_context_t *ctx);
+
+// --- Context Pool ---
+
+/**
+ * @brief Opaque thread-safe pool of reusable contexts.
+ *
+ * Intended for callers that would otherwise create a context per request.
+ * Acquire and release are lock-free. Released contexts keep their grown
+ * buffers and return to a per-thread shard, so a thread usually gets back
+ * the context it used last.
+ */
+typedef struct ph_context_pool ph_context_pool_t;
+
+/**
+ * @brief Creates a pool keeping at most 'max_idle' released contexts.
+ */
+PH_API PH_NODISCARD ph_error_t ph_context_pool_create(size_t max_idle,
+                                                      ph_context_pool_t **out_pool);
+
+/**
+ * @brief Frees the pool and its idle contexts. Contexts still acquired must
+ * be released first (or freed with ph_free()).
+ */
+PH_API void ph_context_pool_destroy(ph_context_pool_t *pool);
+
+/**
+ * @brief Takes an idle context, or creates one if none is available.
+ * The context has default settings and no image loaded.
+ */
+PH_API PH_NODISCARD ph_error_t ph_context_pool_acquire(ph_context_pool_t *pool,
+                                                       ph_context_t **out_ctx);
+
+/**
+ * @brief Returns a context to the pool.
+ *
+ * The image is released and the settings (gamma, cache, minimum resolution,
+ * load flags) are reset. If max_idle contexts are already waiting, the
+ * context is freed instead.
+ */
+PH_API void ph_context_pool_release(ph_context_pool_t *pool, ph_context_t *ctx);
+
 // --- Loading ---
 
 /**
@@ -130,14 +315,179 @@ PH_API PH_NODISCARD ph_error_t ph_load_from_file(ph_context_t *ctx, const char *
 PH_API PH_NODISCARD ph_error_t ph_load_from_memory(ph_context_t *ctx, const uint8_t *buffer,
                                                    size_t length);
 
+/**
+ * @brief Hashes raw pixels in place, without decoding or copying.
+ *
+ * The pixels are borrowed: they must stay valid and unchanged until the
+ * next load, ph_context_trim() or ph_free(). Hashing only reads them; a
+ * one-channel image serves as its own grayscale plane.
+ *
+ * @param pixels Interleaved 8-bit samples, row-major, no row padding.
+ * @param channels 1 (gray), 2 (gray+alpha), 3 (RGB) or 4 (RGBA).
+ */
+PH_API PH_NODISCARD ph_error_t ph_load_from_pixels(ph_context_t *ctx, const uint8_t *pixels,
+                                                   int width, int height, int channels);
+
+/**
+ * @brief Reports how the image of the last load was obtained.
+ */
+PH_API ph_load_source_t ph_get_load_source(const ph_context_t *ctx);
+
+/**
+ * @brief Image dimensions read from the file header.
+ */
+typedef struct {
+    int width;    ///< Width in pixels.
+    int height;   ///< Height in pixels.
+    int channels; ///< Channels as stored (1 gray, 2 gray+alpha, 3 RGB, 4 RGBA).
+} ph_image_info_t;
+
+/**
+ * @brief Reads the dimensions of an encoded image without decoding it.
+ *
+ * Only the header is parsed, so the cost does not depend on the image size.
+ * A full decode needs about width * height * channels bytes.
+ * @return PH_ERR_DECODE_FAILED if the format is not recognized.
+ */
+PH_API PH_NODISCARD ph_error_t ph_probe(const uint8_t *buffer, size_t length,
+                                        ph_image_info_t *out_info);
+
+/**
+ * @brief ph_probe() for a file. Reads no further than the header.
+ */
+PH_API PH_NODISCARD ph_error_t ph_probe_file(const char *filepath, ph_image_info_t *out_info);
+
+// --- Result Cache ---
+
+/**
+ * @brief Opens (or creates) a result cache.
+ *
+ * Entries are keyed by a content fingerprint of in-memory images, or by
+ * device+inode+size+mtime for files, and hold every hash computed for that
+ * image. The table has a fixed capacity; when full, entries are evicted with
+ * a CLOCK (second chance) policy.
+ *
+ * A file-backed table is memory-mapped and survives restarts. An existing
+ * table created with a different capacity is discarded. A table may be shared
+ * by contexts in different threads, but not by several processes.
+ *
+ * @param path Backing file, or NULL for a process-local table.
+ * @param capacity Maximum number of entries (rounded up internally).
+ * @param[out] out_cache Pointer to the opened cache.
+ */
+PH_API PH_NODISCARD ph_error_t ph_cache_open(const char *path, size_t capacity,
+                                             ph_cache_t **out_cache);
+
+/**
+ * @brief Flushes and closes the cache. Detach it from contexts first.
+ * Safe to pass NULL.
+ */
+PH_API void ph_cache_close(ph_cache_t *cache);
+
+/**
+ * @brief Reads the cache counters.
+ */
+PH_API void ph_cache_get_stats(ph_cache_t *cache, ph_cache_stats_t *out_stats);
+
+/**
+ * @brief Attaches a result cache to the context (NULL detaches).
+ *
+ * While attached, ph_load_from_file() and ph_load_from_memory() look the
+ * image up first. On a hit no decoding happens: the ph_compute_* functions
+ * return the stored results, and only an algorithm missing from the entry
+ * triggers a decode. Width and height are not known after a hit.
+ */
+PH_API void ph_context_set_cache(ph_context_t *ctx, ph_cache_t *cache);
+
 // --- uint64_t Hash Algorithms ---
 
 PH_API PH_NODISCARD ph_error_t ph_compute_ahash(ph_context_t *ctx, uint64_t *out_hash);
 PH_API PH_NODISCARD ph_error_t ph_compute_dhash(ph_context_t *ctx, uint64_t *out_hash);
 PH_API PH_NODISCARD ph_error_t ph_compute_phash(ph_context_t *ctx, uint64_t *out_hash);
+
+/**
+ * @brief The eight orientations of the dihedral group, as indexes into the
+ * output of ph_compute_phash_dihedral().
+ */
+typedef enum {
+    PH_ORIENT_IDENTITY = 0,
+    PH_ORIENT_ROT90 = 1,  ///< Rotated 90 degrees clockwise.
+    PH_ORIENT_ROT180 = 2, ///< Rotated 180 degrees.
+    PH_ORIENT_ROT270 = 3, ///< Rotated 270 degrees clockwise.
+    PH_ORIENT_FLIP_H = 4, ///< Mirrored left-right.
+    PH_ORIENT_FLIP_V = 5, ///< Mirrored top-bottom.
+    PH_ORIENT_TRANSPOSE = 6,
+    PH_ORIENT_TRANSVERSE = 7, ///< Transposed along the anti-diagonal.
+} ph_phash_orientation_t;
+
+/**
+ * @brief Computes the pHash of the image in all eight orientations.
+ *
+ * out_hashes[o] is the pHash the image would have after transformation o
+ * (see ph_phash_orientation_t). All eight come from a single DCT: mirroring
+ * only flips the sign of odd coefficients and transposing transposes them,
+ * so the cost is about that of ph_compute_phash(). out_hashes[0] equals
+ * ph_compute_phash().
+ */
+PH_API PH_NODISCARD ph_error_t ph_compute_phash_dihedral(ph_context_t *ctx,
+                                                         uint64_t out_hashes[8]);
+
+/**
+ * @brief Orientation-independent pHash: the smallest of the eight dihedral
+ * hashes. Rotated or mirrored copies of an image map to (nearly) the same
+ * value, which makes it suitable as an index key.
+ */
+PH_API PH_NODISCARD ph_error_t ph_compute_phash_canonical(ph_context_t *ctx, uint64_t *out_hash);
+
 PH_API PH_NODISCARD ph_error_t ph_compute_whash(ph_context_t *ctx, uint64_t *out_hash);
 PH_API PH_NODISCARD ph_error_t ph_compute_mhash(ph_context_t *ctx, uint64_t *out_hash);
 
+// --- Tiled Hashing ---
+
+/**
+ * @brief Hashes a grid of overlapping tiles for crop-resistant matching.
+ *
+ * The image is covered by grid x grid tiles, each sharing 'overlap' of its
+ * width and height with its neighbours. Tiles are area-averaged from a
+ * summed-area table of the gray image (built once per image), so dozens of
+ * tiles cost about as much as one full-image hash. Tile hashes are close to,
+ * but not bit-identical with, the full-image functions, which resample from
+ * the mip pyramid instead.
+ *
+ * @param algo PH_ALGO_AHASH, DHASH, PHASH, WHASH or MHASH.
+ * @param grid Tiles per side, 1..64. The image must be at least grid pixels
+ *             wide and high.
+ * @param overlap Fraction of a tile shared with the next one, 0..0.9.
+ * @param[out] out_hashes grid * grid hashes, row by row from the top left.
+ */
+PH_API PH_NODISCARD ph_error_t ph_compute_tiled(ph_context_t *ctx, ph_algo_t algo, int grid,
+                                                float overlap, uint64_t *out_hashes);
+
+// --- Batched pHash ---
+
+/**
+ * @brief pHashes of n grayscale planes already resampled to 32x32.
+ *
+ * For video frames or stored thumbnails, where the 32x32 planes exist
+ * before hashing. The DCTs of many planes run as blocked float32 matrix
+ * products against the DCT basis, several times faster than hashing one
+ * image at a time. Planes whose float32 result is too close to call are
+ * redone in double precision, so every hash equals what ph_compute_phash()
+ * computes from the same 32x32 plane.
+ *
+ * @param planes32 n planes of 1024 bytes each, row-major, back to back.
+ * @param[out] out_hashes n hashes.
+ */
+PH_API PH_NODISCARD ph_error_t ph_phash_batch(const uint8_t *planes32, size_t n,
+                                              uint64_t *out_hashes);
+
+/**
+ * @brief ph_phash_batch() split over worker threads.
+ * @param threads Worker threads. 0 selects the CPU count.
+ */
+PH_API PH_NODISCARD ph_error_t ph_phash_batch_threaded(const uint8_t *planes32, size_t n,
+                                                       int threads, uint64_t *out_hashes);
+
 // --- Digest Hash Algorithms ---
 
 /**
@@ -155,12 +505,819 @@ PH_API PH_NODISCARD ph_error_t ph_compute_color_hash(ph_context_t *ctx, ph_diges
  */
 PH_API PH_NODISCARD ph_error_t ph_compute_radial_hash(ph_context_t *ctx, ph_digest_t *out_digest);
 
+// --- Multi-Algorithm ---
+
+/**
+ * @brief Computes every algorithm selected in 'algo_mask' for the loaded image.
+ *
+ * Intermediate buffers (e.g. the grayscale cache) are shared between the
+ * algorithms. On failure, 'out' holds the results computed so far.
+ *
+ * @param ctx The context.
+ * @param algo_mask Combination of PH_ALGO_* bits.
+ * @param[out] out Receives the results; 'out->mask' lists the valid fields.
+ */
+PH_API PH_NODISCARD ph_error_t ph_compute_hashes(ph_context_t *ctx, uint32_t algo_mask,
+                                                 ph_hashes_t *out);
+
+// --- Verification Cascade ---
+
+/**
+ * @brief One stage of a verification cascade.
+ *
+ * Distances are Hamming for the uint64_t algorithms and BMH, and L2 for
+ * the color and radial digests.
+ */
+typedef struct {
+    ph_algo_t algo;        ///< A single PH_ALGO_* bit compared at this stage.
+    float max_distance;    ///< Candidates farther than this are rejected.
+    float accept_distance; ///< Candidates this close match without further
+                           ///< stages. Negative to never accept early.
+} ph_cascade_stage_t;
+
+/**
+ * @brief Matches the loaded image against stored hash records, cheapest
+ * test first.
+ *
+ * Stages run in order over the candidates still undecided, each as one
+ * batched distance pass. A stage's query hash is only computed when some
+ * undecided candidate holds a result for it, so queries screened out by an
+ * early stage never pay for the later algorithms. Candidates that pass
+ * every stage match. A candidate whose mask lacks a stage's algorithm
+ * skips that stage.
+ *
+ * @param ctx Context with the query image loaded.
+ * @param[in,out] query Optional. Results already set in query->mask are
+ *                      used as they are; on return it also holds the ones
+ *                      the cascade computed.
+ * @param candidates, n Stored records (at most UINT32_MAX).
+ * @param stages, nstages The cascade.
+ * @param[out] out_matches Capacity n; receives the indexes of the matching
+ *                         candidates in ascending order.
+ * @param[out] out_count Number of matches.
+ */
+PH_API PH_NODISCARD ph_error_t ph_query_cascade(ph_context_t *ctx, ph_hashes_t *query,
+                                               const ph_hashes_t *candidates, size_t n,
+                                               const ph_cascade_stage_t *stages,
+                                               size_t nstages, uint32_t *out_matches,
+                                               size_t *out_count);
+
+// --- Decoder Backends ---
+
+/**
+ * @brief Pixels produced by a decoder backend.
+ */
+typedef struct {
+    uint8_t *pixels; ///< Interleaved 8-bit samples, row-major, no row padding.
+    int width;       ///< Width in pixels.
+    int height;      ///< Height in pixels.
+    int channels;    ///< 3 (RGB) or 4 (RGBA). On entry, 1 if only luminance is
+                     ///< needed: the backend may then return a single channel.
+} ph_decoded_image_t;
+
+/**
+ * @brief Callbacks of an image decoder backend.
+ *
+ * ph_load_from_file() and ph_load_from_memory() offer the encoded bytes to
+ * every registered backend (most recently registered first) and fall back to
+ * the built-in stb_image decoder when none accepts them or decoding fails.
+ * Callbacks may run concurrently from several threads.
+ */
+typedef struct {
+    const char *name; ///< Unique name. Copied on registration.
+    void *user_data;  ///< Passed to every callback.
+
+    /** Returns nonzero if the backend handles this data. Required. */
+    int (*probe)(void *user_data, const uint8_t *buffer, size_t length);
+
+    /** Decodes at full resolution. Required. */
+    ph_error_t (*decode)(void *user_data, const uint8_t *buffer, size_t length,
+                         ph_decoded_image_t *out);
+
+    /** Decodes at any scale that is at least min_width x min_height.
+     *  Optional; used instead of decode() when a minimum resolution is set. */
+    ph_error_t (*decode_scaled)(void *user_data, const uint8_t *buffer, size_t length,
+                                int min_width, int min_height, ph_decoded_image_t *out);
+
+    /** Frees pixels returned by a decode callback. NULL means free(). */
+    void (*release)(void *user_data, uint8_t *pixels);
+} ph_decoder_t;
+
+/**
+ * @brief Registers a decoder backend. The struct is copied.
+ * @return PH_ERR_INVALID_ARGUMENT if a required field is missing or the name
+ *         is already registered.
+ */
+PH_API PH_NODISCARD ph_error_t ph_register_decoder(const ph_decoder_t *decoder);
+
+/**
+ * @brief Removes a backend registered under 'name'.
+ *
+ * Images already decoded by it are still released through its callbacks, so
+ * 'user_data' must outlive them.
+ */
+PH_API ph_error_t ph_unregister_decoder(const char *name);
+
+// --- Multi-Frame Images ---
+
+/**
+ * @brief Loads every frame of an animated GIF.
+ *
+ * Frames are decoded to RGBA and frame 0 is selected, so all ph_compute_*
+ * functions work on it directly. Any other format is loaded as a single
+ * frame through ph_load_from_memory().
+ *
+ * @param[out] out_frame_count Receives the number of frames (may be NULL).
+ */
+PH_API PH_NODISCARD ph_error_t ph_load_frames_from_memory(ph_context_t *ctx,
+                                                          const uint8_t *buffer, size_t length,
+                                                          int *out_frame_count);
+
+/**
+ * @brief Number of frames of the loaded image (1 for still images, 0 if none).
+ */
+PH_API int ph_frame_count(const ph_context_t *ctx);
+
+/**
+ * @brief Display duration of a frame in milliseconds (0 if unknown).
+ */
+PH_API int ph_frame_delay(const ph_context_t *ctx, int index);
+
+/**
+ * @brief Makes 'index' the frame seen by the ph_compute_* functions.
+ *
+ * Only the rows that differ from the previously selected frame are converted
+ * to grayscale again.
+ */
+PH_API PH_NODISCARD ph_error_t ph_select_frame(ph_context_t *ctx, int index);
+
+/**
+ * @brief Hashes every frame with a uint64_t algorithm.
+ *
+ * A frame identical to its predecessor reuses the previous hash. The
+ * aggregate is a per-bit majority vote weighted by frame delay (frames
+ * without a delay count as 1 ms), i.e. the hash of what is on screen most of
+ * the time. The last frame stays selected afterwards.
+ *
+ * @param algo PH_ALGO_AHASH, DHASH, PHASH, WHASH or MHASH.
+ * @param[out] out_hashes One hash per frame; may be NULL when max_hashes is 0.
+ * @param max_hashes Capacity of out_hashes. Must cover ph_frame_count() unless
+ *                   only the aggregate is requested.
+ * @param[out] out_aggregate Receives the aggregate hash (may be NULL).
+ */
+PH_API PH_NODISCARD ph_error_t ph_compute_frame_hashes(ph_context_t *ctx, ph_algo_t algo,
+                                                       uint64_t *out_hashes, size_t max_hashes,
+                                                       uint64_t *out_aggregate);
+
+// --- Asynchronous Processing ---
+
+/**
+ * @brief Opaque submission/completion queue backed by an internal worker pool.
+ *
+ * Images are read (through io_uring on Linux when available), decoded and
+ * hashed off the caller's thread. Results are collected with ph_async_poll().
+ * Submission and polling may happen from any thread.
+ */
+typedef struct ph_async_queue ph_async_queue_t;
+
+/**
+ * @brief A unit of work: either a file path or an encoded in-memory image.
+ */
+typedef struct {
+    const char *path;      ///< File to read, or NULL to use 'buffer'. Copied on submit.
+    const uint8_t *buffer; ///< Encoded image bytes. Must stay valid until completion.
+    size_t length;         ///< Size of 'buffer'.
+} ph_async_item_t;
+
+/**
+ * @brief Result of one submitted item.
+ */
+typedef struct {
+    void *user_data;    ///< Value passed to ph_async_submit().
+    ph_error_t error;   ///< PH_SUCCESS or the first error met while processing.
+    ph_hashes_t hashes; ///< Computed hashes.
+} ph_async_completion_t;
+
+/**
+ * @brief Creates an asynchronous queue.
+ * @param threads Number of decode/hash workers. 0 selects the CPU count.
+ * @param[out] out_queue Pointer to the created queue.
+ */
+PH_API PH_NODISCARD ph_error_t ph_async_create(int threads, ph_async_queue_t **out_queue);
+
+/**
+ * @brief Stops the workers and frees the queue.
+ *
+ * Items still pending are dropped without completions. Safe to pass NULL.
+ */
+PH_API void ph_async_destroy(ph_async_queue_t *queue);
+
+/**
+ * @brief Queues an image for hashing. Never blocks on I/O or decoding.
+ * @param queue The queue.
+ * @param item The image source.
+ * @param algo_mask Combination of PH_ALGO_* bits to compute.
+ * @param user_data Opaque value returned with the completion.
+ */
+PH_API PH_NODISCARD ph_error_t ph_async_submit(ph_async_queue_t *queue, const ph_async_item_t *item,
+                                               uint32_t algo_mask, void *user_data);
+
+/**
+ * @brief Retrieves finished items without blocking.
+ * @param queue The queue.
+ * @param[out] completions Array receiving up to 'max' completions.
+ * @param max Capacity of 'completions'.
+ * @return Number of completions written, or a negative ph_error_t.
+ */
+PH_API int ph_async_poll(ph_async_queue_t *queue, ph_async_completion_t *completions, size_t max);
+
+/**
+ * @brief Returns a file descriptor that becomes readable while completions
+ * are pending (an eventfd on Linux), suitable for epoll/libuv/asyncio.
+ * Do not read from or close it. Returns -1 where unsupported.
+ */
+PH_API int ph_async_fd(const ph_async_queue_t *queue);
+
+/**
+ * @brief Memory accounting of a queue, see ph_async_set_memory_budget().
+ */
+typedef struct {
+    uint64_t budget;    ///< Configured budget in bytes, 0 if unlimited.
+    uint64_t in_flight; ///< Decoded bytes charged to the items being processed.
+    uint64_t peak;      ///< Highest value of 'in_flight' so far.
+    uint64_t oversized; ///< Items larger than the whole budget, run on their own.
+} ph_async_memory_stats_t;
+
+/**
+ * @brief Caps the decoded bytes the workers hold at once.
+ *
+ * Before decoding, a worker probes the image header (see ph_probe()) and
+ * charges its pixels plus grayscale plane against the budget. Items are
+ * admitted in submission order; one that does not fit waits until enough
+ * running items finish, so the worker count can stay high for common sizes
+ * while bursts of large images are serialized.
+ *
+ * An item larger than the whole budget waits until nothing else is in
+ * flight, then decodes alone on a reduced path: luminance only unless
+ * PH_ALGO_COLOR was requested, at the smallest scale the decoder supports
+ * that keeps 256 pixels per side. Its hashes can differ slightly from a
+ * full decode's. Images the probe does not recognize are not charged.
+ *
+ * @param max_decoded_bytes The budget; 0 (the default) disables admission control.
+ */
+PH_API PH_NODISCARD ph_error_t ph_async_set_memory_budget(ph_async_queue_t *queue,
+                                                          size_t max_decoded_bytes);
+
+/**
+ * @brief Reads the queue's memory accounting.
+ */
+PH_API PH_NODISCARD ph_error_t ph_async_get_memory_stats(ph_async_queue_t *queue,
+                                                         ph_async_memory_stats_t *out_stats);
+
+// --- Clustering ---
+
+/**
+ * @brief Groups hashes into near-duplicate clusters.
+ *
+ * Two hashes belong to the same cluster when they are connected by a chain
+ * of pairs with Hamming distance <= max_dist (single linkage). The bits are
+ * split into m blocks; hashes within max_dist agree exactly on m - max_dist
+ * of them, so only hashes sharing such a block combination are compared.
+ * Cost grows quickly with max_dist: small radii scale to hundreds of millions
+ * of hashes. Memory is linear in n.
+ *
+ * @param hashes Input hashes.
+ * @param n Number of hashes (at most UINT32_MAX).
+ * @param max_dist Maximum Hamming distance of a direct link.
+ * @param threads Worker threads for pair verification. 0 selects the CPU count.
+ * @param[out] out_labels n cluster labels, dense and numbered in order of
+ *                        first appearance (the first hash is in cluster 0).
+ */
+PH_API PH_NODISCARD ph_error_t ph_cluster_u64(const uint64_t *hashes, size_t n, int max_dist,
+                                              int threads, uint32_t *out_labels);
+
+/**
+ * @brief ph_cluster_u64() for digests, using ph_hamming_distance_digest().
+ * All digests must have the same size.
+ */
+PH_API PH_NODISCARD ph_error_t ph_cluster_digest(const ph_digest_t *digests, size_t n,
+                                                 int max_dist, int threads, uint32_t *out_labels);
+
+// --- Pair Joins ---
+
+/**
+ * @brief A pair of indexes (into A and B) found within the join threshold.
+ */
+typedef struct {
+    uint32_t a;     ///< Index into the first set.
+    uint32_t b;     ///< Index into the second set.
+    float distance; ///< Hamming or L2 distance of the pair.
+} ph_pair_t;
+
+/**
+ * @brief Receives a batch of matching pairs from a join.
+ *
+ * Calls are serialized but may come from any worker thread, in no particular
+ * order. The array is only valid during the call.
+ *
+ * @return 0 to continue, nonzero to stop the join early.
+ */
+typedef int (*ph_pair_callback_t)(const ph_pair_t *pairs, size_t count, void *user_data);
+
+/**
+ * @brief Reports every pair (i, j) with ph_hamming_distance(a[i], b[j]) <= max_dist.
+ *
+ * The sets are compared tile by tile so that B stays cache resident, and
+ * results stream out in batches: memory use does not depend on the number
+ * of matches. Passing the same array as A and B (with na == nb) performs a
+ * self-join that reports each unordered pair once, with a < b.
+ *
+ * @param a, na First set (at most UINT32_MAX hashes).
+ * @param b, nb Second set (at most UINT32_MAX hashes).
+ * @param max_dist Maximum Hamming distance of a reported pair.
+ * @param threads Worker threads. 0 selects the CPU count.
+ * @param callback Receives the pairs.
+ * @param user_data Passed to the callback.
+ */
+PH_API PH_NODISCARD ph_error_t ph_pairs_within_u64(const uint64_t *a, size_t na,
+                                                   const uint64_t *b, size_t nb, int max_dist,
+                                                   int threads, ph_pair_callback_t callback,
+                                                   void *user_data);
+
+/**
+ * @brief ph_pairs_within_u64() for digests, using ph_hamming_distance_digest().
+ * All digests of both sets must have the same size.
+ */
+PH_API PH_NODISCARD ph_error_t ph_pairs_within_digest(const ph_digest_t *a, size_t na,
+                                                      const ph_digest_t *b, size_t nb,
+                                                      int max_dist, int threads,
+                                                      ph_pair_callback_t callback,
+                                                      void *user_data);
+
+/**
+ * @brief ph_pairs_within_u64() for digests, using ph_l2_distance().
+ * All digests of both sets must have the same size.
+ */
+PH_API PH_NODISCARD ph_error_t ph_pairs_within_l2(const ph_digest_t *a, size_t na,
+                                                  const ph_digest_t *b, size_t nb,
+                                                  double max_dist, int threads,
+                                                  ph_pair_callback_t callback, void *user_data);
+
+// --- Digest Scans ---
+
+/**
+ * @brief Opaque set of equally sized digests, packed as contiguous rows.
+ *
+ * A row takes exactly the digest size (40 bytes for a radial digest instead
+ * of the 72 of a ph_digest_t), which is what the scan kernels stream over.
+ */
+typedef struct ph_digest_set ph_digest_set_t;
+
+/**
+ * @brief One result of a scan.
+ */
+typedef struct {
+    uint32_t index; ///< Position of the digest in the set.
+    float distance; ///< L2 or SAD distance to the query.
+} ph_match_t;
+
+/**
+ * @brief Creates an empty set of digests of 'digest_size' bytes
+ * (1..PH_DIGEST_MAX_BYTES).
+ */
+PH_API PH_NODISCARD ph_error_t ph_digest_set_create(int digest_size, ph_digest_set_t **out_set);
+
+PH_API void ph_digest_set_free(ph_digest_set_t *set);
+
+/**
+ * @brief Appends n digests. Their size must match the set's, and a set holds
+ * at most UINT32_MAX digests.
+ */
+PH_API PH_NODISCARD ph_error_t ph_digest_set_add(ph_digest_set_t *set, const ph_digest_t *digests,
+                                                 size_t n);
+
+/** @brief Number of digests in the set. */
+PH_API size_t ph_digest_set_count(const ph_digest_set_t *set);
+
+/** @brief Copies digest 'index' back out of the set. */
+PH_API PH_NODISCARD ph_error_t ph_digest_set_get(const ph_digest_set_t *set, size_t index,
+                                                 ph_digest_t *out_digest);
+
+/**
+ * @brief Finds every digest within an L2 distance of the query.
+ *
+ * Distances are computed on bytes with integer SIMD kernels and match
+ * ph_l2_distance() exactly.
+ *
+ * @param[out] out_matches Receives the first max_matches matches in index
+ *                         order (may be NULL when max_matches is 0).
+ * @param[out] out_count Total number of matches, which may exceed
+ *                       max_matches.
+ */
+PH_API PH_NODISCARD ph_error_t ph_l2_scan(const ph_digest_t *query, const ph_digest_set_t *set,
+                                          double max_dist, ph_match_t *out_matches,
+                                          size_t max_matches, size_t *out_count);
+
+/**
+ * @brief The k digests nearest to the query by L2 distance, nearest first
+ * (ties by index). *out_count is min(k, set size).
+ */
+PH_API PH_NODISCARD ph_error_t ph_l2_topk(const ph_digest_t *query, const ph_digest_set_t *set,
+                                          size_t k, ph_match_t *out_matches, size_t *out_count);
+
+/** @brief ph_l2_scan() with the sum of absolute byte differences. */
+PH_API PH_NODISCARD ph_error_t ph_sad_scan(const ph_digest_t *query, const ph_digest_set_t *set,
+                                           double max_dist, ph_match_t *out_matches,
+                                           size_t max_matches, size_t *out_count);
+
+/** @brief ph_l2_topk() with the sum of absolute byte differences. */
+PH_API PH_NODISCARD ph_error_t ph_sad_topk(const ph_digest_t *query, const ph_digest_set_t *set,
+                                           size_t k, ph_match_t *out_matches, size_t *out_count);
+
+// --- Query Daemon ---
+
+/**
+ * @brief Writes a hash store: the file format phashd memory-maps.
+ *
+ * The store is a 16-byte header followed by the hashes as native-endian
+ * uint64_t, so it can be mapped and scanned in place. An existing file is
+ * replaced.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_store_write(const char *path, const uint64_t *hashes,
+                                                   size_t count);
+
+/**
+ * @brief Opaque query daemon serving one hash store over a Unix socket.
+ *
+ * Every process that connects shares the single read-only mapping of the
+ * store. Queries that arrive together, from one client or many, are
+ * answered by one pass over the store. Linux only.
+ */
+typedef struct ph_hashd ph_hashd_t;
+
+/**
+ * @brief Maps 'store_path' and listens on 'socket_path'.
+ *
+ * A stale socket left at 'socket_path' by a daemon that exited is
+ * replaced; the socket is removed again by ph_hashd_free(). Returns
+ * PH_ERR_IO when the store cannot be mapped, when 'socket_path' is taken by
+ * anything else (another file, or a socket a daemon still listens on) or
+ * the socket cannot be bound, PH_ERR_DECODE_FAILED when it is not a hash store
+ * or holds more than UINT32_MAX hashes (results carry 32-bit indexes), and
+ * PH_ERR_NOT_IMPLEMENTED outside Linux.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hashd_create(const char *store_path, const char *socket_path,
+                                               ph_hashd_t **out_daemon);
+
+/**
+ * @brief Serves queries on the calling thread until ph_hashd_stop().
+ */
+PH_API PH_NODISCARD ph_error_t ph_hashd_run(ph_hashd_t *daemon);
+
+/**
+ * @brief Makes ph_hashd_run() return. Safe from any thread and from signal
+ * handlers.
+ */
+PH_API void ph_hashd_stop(ph_hashd_t *daemon);
+
+/** @brief Closes all connections, unmaps the store and frees the daemon. */
+PH_API void ph_hashd_free(ph_hashd_t *daemon);
+
+/**
+ * @brief Opaque connection to a phashd daemon. A client is not thread-safe;
+ * use one per thread.
+ */
+typedef struct ph_hashd_client ph_hashd_client_t;
+
+/** @brief Connects to the daemon listening on 'socket_path'. */
+PH_API PH_NODISCARD ph_error_t ph_hashd_connect(const char *socket_path,
+                                                ph_hashd_client_t **out_client);
+
+/** @brief Closes the connection. Safe to pass NULL. */
+PH_API void ph_hashd_disconnect(ph_hashd_client_t *client);
+
+/** @brief Largest max_per_query / k accepted by the query functions. */
+#define PH_HASHD_MAX_RESULTS 4096
+
+/**
+ * @brief Finds the stored hashes within Hamming distance 'radius' of each
+ * of n queries, in one round trip per batch.
+ *
+ * @param[out] out_matches n * max_per_query slots; query i's first
+ *                         max_per_query matches (in store order) start at
+ *                         out_matches[i * max_per_query].
+ * @param[out] out_counts n totals, which may exceed max_per_query.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hashd_radius(ph_hashd_client_t *client,
+                                               const uint64_t *queries, size_t n, int radius,
+                                               ph_match_t *out_matches, size_t max_per_query,
+                                               size_t *out_counts);
+
+/**
+ * @brief The k stored hashes nearest to each of n queries by Hamming
+ * distance, nearest first (ties by index).
+ *
+ * @param[out] out_matches n * k slots; query i's start at out_matches[i * k].
+ * @param[out] out_counts n counts, each min(k, store size).
+ */
+PH_API PH_NODISCARD ph_error_t ph_hashd_knn(ph_hashd_client_t *client, const uint64_t *queries,
+                                            size_t n, size_t k, ph_match_t *out_matches,
+                                            size_t *out_counts);
+
+// --- Concurrent Hash Index ---
+
+/**
+ * @brief Opaque index of uint64_t hashes that can be queried and grown at
+ * the same time from any number of threads.
+ *
+ * Queries never lock: they follow bucket lists that inserts only ever
+ * prepend to, and entries are never moved or freed before the index is.
+ * Inserts are serialised with each other.
+ */
+typedef struct ph_hash_index ph_hash_index_t;
+
+PH_API PH_NODISCARD ph_error_t ph_hash_index_create(ph_hash_index_t **out_index);
+
+/** @brief Frees the index. No other thread may still be using it. */
+PH_API void ph_hash_index_free(ph_hash_index_t *index);
+
+/** @brief Number of hashes inserted so far. */
+PH_API size_t ph_hash_index_count(const ph_hash_index_t *index);
+
+/**
+ * @brief Adds a hash unconditionally.
+ * @param[out] out_id Optional; receives the hash's id (its insertion rank).
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_index_insert(ph_hash_index_t *index, uint64_t hash,
+                                                    uint32_t *out_id);
+
+/**
+ * @brief Finds the stored hashes within Hamming distance 'radius' (0..64).
+ *
+ * Hashes inserted while the query runs may or may not be reported.
+ *
+ * @param[out] out_matches Receives up to max_matches matches, in no
+ *                         particular order (index is the hash's id).
+ * @param[out] out_count Total number of matches, which may exceed
+ *                       max_matches.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_index_query(const ph_hash_index_t *index, uint64_t hash,
+                                                   int radius, ph_match_t *out_matches,
+                                                   size_t max_matches, size_t *out_count);
+
+/**
+ * @brief Atomic "seen something like this? otherwise remember it".
+ *
+ * If a stored hash lies within 'radius', *out_id is the nearest one's id
+ * (lowest id on ties) and nothing is inserted. Otherwise the hash is
+ * inserted and *out_id is its new id. Of several threads racing to insert
+ * hashes within 'radius' of each other, exactly one inserts.
+ *
+ * @param[out] out_inserted 1 when the hash was inserted, 0 otherwise.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_index_find_or_insert(ph_hash_index_t *index,
+                                                            uint64_t hash, int radius,
+                                                            uint32_t *out_id, int *out_inserted);
+
+// --- Compressed Hash Set ---
+
+/**
+ * @brief Opaque read-only set of uint64_t hashes, Elias-Fano coded.
+ *
+ * For n spread-out hashes the set takes about (66 - log2(n)) / 8 bytes per
+ * hash: under 5 bytes each at a billion, against 8 for a plain array. It
+ * answers exact membership and Hamming radius queries. Queries may run
+ * from any number of threads.
+ */
+typedef struct ph_hash_set ph_hash_set_t;
+
+/**
+ * @brief Builds the set of the distinct values of 'hashes'.
+ *
+ * 'hashes' is sorted in place (so a billion-entry input needs no second
+ * copy) and may be freed once this returns.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_set_build(uint64_t *hashes, size_t n,
+                                                 ph_hash_set_t **out_set);
+
+PH_API void ph_hash_set_free(ph_hash_set_t *set);
+
+/** @brief Number of distinct hashes in the set. */
+PH_API size_t ph_hash_set_count(const ph_hash_set_t *set);
+
+/** @brief Bytes of memory held by the set. */
+PH_API size_t ph_hash_set_memory_usage(const ph_hash_set_t *set);
+
+/** @brief 1 if 'hash' is in the set, 0 otherwise. */
+PH_API int ph_hash_set_contains(const ph_hash_set_t *set, uint64_t hash);
+
+/**
+ * @brief Finds the hashes within Hamming distance 'radius' (0..64).
+ *
+ * Blocks of hashes whose shared leading bits already differ from the query
+ * in more than 'radius' places are skipped without being decoded.
+ *
+ * @param[out] out_hashes Receives up to max_hashes matches, in ascending
+ *                        order.
+ * @param[out] out_count Total number of matches, which may exceed
+ *                       max_hashes.
+ */
+PH_API PH_NODISCARD ph_error_t ph_hash_set_radius(const ph_hash_set_t *set, uint64_t query,
+                                                  int radius, uint64_t *out_hashes,
+                                                  size_t max_hashes, size_t *out_count);
+
+// --- Arrow Export ---
+
+/*
+ * Results exported as Arrow IPC record batches, readable in place by
+ * pyarrow, pandas or Polars (pa.ipc.open_stream / open_file, or a memory
+ * map of the file). The columns are "id" (uint64), then one per algorithm
+ * of 'algo_mask' in PH_ALGO_* bit order: uint64 for the uint64_t hashes and
+ * fixed_size_binary for BMH (32 bytes), color (9) and radial (40). A result
+ * without that algorithm in its mask, or with a digest of another size,
+ * gives a null. Column data is gathered straight into the destination;
+ * nothing is allocated per row.
+ */
+
+/** @brief Bytes ph_arrow_encode_schema() writes for 'algo_mask'. */
+PH_API size_t ph_arrow_schema_size(uint32_t algo_mask);
+
+/** @brief Bytes ph_arrow_encode_batch() writes for n results. */
+PH_API size_t ph_arrow_batch_size(uint32_t algo_mask, size_t n);
+
+/**
+ * @brief Writes the schema message that starts an Arrow IPC stream.
+ *
+ * @param[out] out_length Bytes written. Also set, with
+ *                        PH_ERR_INVALID_ARGUMENT returned, when 'buffer' is
+ *                        NULL or smaller than that.
+ */
+PH_API PH_NODISCARD ph_error_t ph_arrow_encode_schema(uint32_t algo_mask, uint8_t *buffer,
+                                                      size_t capacity, size_t *out_length);
+
+/**
+ * @brief Writes n results as one record batch message.
+ *
+ * Concatenating the schema message and any number of batches encoded with
+ * the same mask gives a complete Arrow IPC stream.
+ *
+ * @param ids Optional id per result; NULL numbers the rows from 0.
+ * @param[out] out_length As for ph_arrow_encode_schema().
+ */
+PH_API PH_NODISCARD ph_error_t ph_arrow_encode_batch(uint32_t algo_mask, const uint64_t *ids,
+                                                     const ph_hashes_t *results, size_t n,
+                                                     uint8_t *buffer, size_t capacity,
+                                                     size_t *out_length);
+
+/**
+ * @brief Layout written by a ph_arrow_writer_t.
+ */
+typedef enum {
+    PH_ARROW_STREAM = 0, ///< IPC streaming format (.arrows).
+    PH_ARROW_FILE = 1,   ///< IPC file format (.arrow): random access, memory-mappable.
+} ph_arrow_format_t;
+
+/**
+ * @brief Opaque writer of record batches to a file descriptor.
+ */
+typedef struct ph_arrow_writer ph_arrow_writer_t;
+
+/**
+ * @brief Writes the header to 'fd'. The descriptor stays owned by the
+ * caller and is never closed.
+ */
+PH_API PH_NODISCARD ph_error_t ph_arrow_writer_open(int fd, uint32_t algo_mask,
+                                                    ph_arrow_format_t format,
+                                                    ph_arrow_writer_t **out_writer);
+
+/**
+ * @brief Writes n results as one record batch.
+ *
+ * Reuses one buffer sized for the largest batch so far. After a write
+ * error (PH_ERR_IO) every later call fails the same way.
+ *
+ * @param ids Optional; NULL numbers the rows consecutively across batches.
+ */
+PH_API PH_NODISCARD ph_error_t ph_arrow_writer_write(ph_arrow_writer_t *writer,
+                                                     const uint64_t *ids,
+                                                     const ph_hashes_t *results, size_t n);
+
+/**
+ * @brief Ends the stream (and writes the footer of the file format), then
+ * frees the writer whatever the outcome.
+ */
+PH_API PH_NODISCARD ph_error_t ph_arrow_writer_close(ph_arrow_writer_t *writer);
+
+// --- Shared-Memory Frame Ring ---
+
+/**
+ * @brief Opaque handle to a ring of frame slots in shared memory.
+ *
+ * Carries raw frames from a producer process (e.g. a sandboxed decoder)
+ * to a consumer that hashes them in place, and the results back, without
+ * copies or a syscall per frame. The ring lives in a memfd: the consumer
+ * creates it and passes ph_frame_ring_fd() to the producer (inherited
+ * across fork() or sent over a Unix socket), which attaches to it. One
+ * producer and one consumer; a side only sleeps, on a futex in the shared
+ * mapping, when the other has nothing for it. Linux only.
+ */
+typedef struct ph_frame_ring ph_frame_ring_t;
+
+/**
+ * @brief Completion of one frame.
+ */
+typedef struct {
+    uint64_t frame_id;  ///< Value passed to ph_frame_ring_publish().
+    ph_error_t error;   ///< PH_SUCCESS or the first error met while hashing.
+    ph_hashes_t hashes; ///< Computed hashes.
+} ph_frame_result_t;
+
+/**
+ * @brief Creates a ring in a new memfd.
+ * @param slots Frames in flight, a power of two up to 65536.
+ * @param slot_bytes Largest frame, width * height * channels bytes.
+ * @return PH_ERR_IO if the memory cannot be created or mapped, and
+ *         PH_ERR_NOT_IMPLEMENTED outside Linux.
+ */
+PH_API PH_NODISCARD ph_error_t ph_frame_ring_create(uint32_t slots, size_t slot_bytes,
+                                                    ph_frame_ring_t **out_ring);
+
+/**
+ * @brief Maps a ring created by another process.
+ *
+ * The layout is validated against the size of the memfd, whose size is
+ * sealed, so neither side can make the other fault. 'fd' is not taken
+ * over and can be closed afterwards.
+ */
+PH_API PH_NODISCARD ph_error_t ph_frame_ring_attach(int fd, ph_frame_ring_t **out_ring);
+
+/** @brief The memfd backing the ring, owned by the ring that created it. */
+PH_API int ph_frame_ring_fd(const ph_frame_ring_t *ring);
+
+/** @brief Unmaps the ring (and closes its memfd if it was created here). */
+PH_API void ph_frame_ring_free(ph_frame_ring_t *ring);
+
+/**
+ * @brief Producer: returns the next free slot to write a frame into.
+ *
+ * Repeated calls return the same slot until it is published.
+ * @param[out] out_pixels The slot, ph_frame_ring_slot_bytes() long.
+ * @return PH_ERR_FULL while every slot holds a frame or an uncollected
+ *         result: collect with ph_frame_ring_poll_results() first.
+ */
+PH_API PH_NODISCARD ph_error_t ph_frame_ring_acquire(ph_frame_ring_t *ring, uint8_t **out_pixels);
+
+/** @brief Capacity of a slot in bytes. */
+PH_API size_t ph_frame_ring_slot_bytes(const ph_frame_ring_t *ring);
+
+/**
+ * @brief Producer: hands the acquired slot, now holding a width x height
+ * frame of 'channels' interleaved bytes per pixel, to the consumer.
+ * @param frame_id Returned with the result.
+ */
+PH_API PH_NODISCARD ph_error_t ph_frame_ring_publish(ph_frame_ring_t *ring, uint64_t frame_id,
+                                                     int width, int height, int channels);
+
+/**
+ * @brief Producer: collects results in publication order, freeing their slots.
+ * @param timeout_ms How long to wait for the first result; 0 returns at
+ *                   once, negative waits indefinitely.
+ * @return Number of results written, or a negative ph_error_t.
+ */
+PH_API int ph_frame_ring_poll_results(ph_frame_ring_t *ring, ph_frame_result_t *results,
+                                      size_t max, int timeout_ms);
+
+/**
+ * @brief Producer: announces that no more frames will be published.
+ */
+PH_API void ph_frame_ring_close(ph_frame_ring_t *ring);
+
+/**
+ * @brief Consumer: hashes every published frame in place and posts the
+ * results.
+ *
+ * Frames are loaded with ph_load_from_pixels() straight from the shared
+ * mapping. A frame whose size does not fit its slot completes with
+ * PH_ERR_INVALID_ARGUMENT.
+ * @param timeout_ms How long to wait for a first frame; 0 returns at once,
+ *                   negative waits indefinitely.
+ * @return Number of frames hashed, or a negative ph_error_t (PH_ERR_IO if
+ *         the producer corrupted the ring's counters). 0 after a timeout,
+ *         or once the ring is closed and drained.
+ */
+PH_API int ph_frame_ring_consume(ph_frame_ring_t *ring, ph_context_t *ctx, uint32_t algo_mask,
+                                 int timeout_ms);
+
+/** @brief Nonzero once the producer closed the ring. */
+PH_API int ph_frame_ring_closed(const ph_frame_ring_t *ring);
+
 // --- Comparison Functions ---
 
 PH_API int ph_hamming_distance(uint64_t hash1, uint64_t hash2);
 PH_API int ph_hamming_distance_digest(const ph_digest_t *a, const ph_digest_t *b);
 PH_API double ph_l2_distance(const ph_digest_t *a, const ph_digest_t *b);
 
+/** @deprecated The DCT tables are static; this does nothing. */
 void init_dct_matrix(void);
 #ifdef __cplusplus
 }
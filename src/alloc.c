@@ -0,0 +1,90 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Allocation hooks.
+ *
+ * Library objects (pools, caches, queues, join buffers) use the global
+ * allocator. Image memory follows the context: its own allocator when one
+ * is set, the global one otherwise. Decoders get no context argument, so
+ * the allocator of the context being decoded (or released) is published in
+ * a thread-local for the stb_image hooks and the built-in backends.
+ */
+
+static void *libc_malloc(void *user_data, size_t size) {
+    (void)user_data;
+    return malloc(size);
+}
+
+static void *libc_realloc(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+    (void)user_data;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void libc_free(void *user_data, void *ptr) {
+    (void)user_data;
+    free(ptr);
+}
+
+static ph_allocator_t s_global = {libc_malloc, libc_realloc, libc_free, NULL};
+static _Thread_local const ph_allocator_t *tls_decode = NULL;
+
+int ph_valid_allocator(const ph_allocator_t *allocator) {
+    return allocator->malloc_fn && allocator->realloc_fn && allocator->free_fn;
+}
+
+PH_API ph_error_t ph_set_allocator(const ph_allocator_t *allocator) {
+    if (!allocator) {
+        s_global = (ph_allocator_t){libc_malloc, libc_realloc, libc_free, NULL};
+        return PH_SUCCESS;
+    }
+    if (!ph_valid_allocator(allocator))
+        return PH_ERR_INVALID_ARGUMENT;
+    s_global = *allocator;
+    return PH_SUCCESS;
+}
+
+void *ph_mem_alloc(const ph_allocator_t *a, size_t size) {
+    if (!a)
+        a = &s_global;
+    return a->malloc_fn(a->user_data, size);
+}
+
+void *ph_mem_calloc(const ph_allocator_t *a, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size)
+        return NULL;
+    void *p = ph_mem_alloc(a, count * size);
+    if (p)
+        memset(p, 0, count * size);
+    return p;
+}
+
+void *ph_mem_realloc(const ph_allocator_t *a, void *ptr, size_t old_size, size_t new_size) {
+    if (!a)
+        a = &s_global;
+    return a->realloc_fn(a->user_data, ptr, ptr ? old_size : 0, new_size);
+}
+
+void ph_mem_free(const ph_allocator_t *a, void *ptr) {
+    if (!ptr)
+        return;
+    if (!a)
+        a = &s_global;
+    a->free_fn(a->user_data, ptr);
+}
+
+const ph_allocator_t *ph_set_decode_allocator(const ph_allocator_t *allocator) {
+    const ph_allocator_t *previous = tls_decode;
+    tls_decode = allocator;
+    return previous;
+}
+
+void *ph_decode_malloc(size_t size) { return ph_mem_alloc(tls_decode, size); }
+
+void *ph_decode_realloc(void *ptr, size_t old_size, size_t new_size) {
+    return ph_mem_realloc(tls_decode, ptr, old_size, new_size);
+}
+
+void ph_decode_free(void *ptr) { ph_mem_free(tls_decode, ptr); }
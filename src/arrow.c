@@ -0,0 +1,531 @@
+#include "internal.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+/*
+ * Arrow IPC export.
+ *
+ * Every message is a FlatBuffer (Message.fbs, Schema.fbs, File.fbs of the
+ * Arrow format) framed as 0xFFFFFFFF, its padded length, the FlatBuffer and
+ * the body. The FlatBuffers are written front to back: each table starts
+ * with its own vtable and the objects it refers to follow it, which keeps
+ * every offset pointing forward as the format requires. Their size depends
+ * only on the columns, so the metadata of a batch is built on the stack and
+ * the column data is gathered straight into the destination.
+ */
+
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+#define ARROW_V5 4
+#define HEADER_SCHEMA 1
+#define HEADER_RECORD_BATCH 3
+#define TYPE_INT 2
+#define TYPE_FIXED_SIZE_BINARY 15
+#define META_CAP 4096
+#define MAX_COLUMNS 9
+
+static const char s_file_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+
+/* --- FlatBuffer writer --- */
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int overflow;
+} fb_t;
+
+static inline size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static void fb_pad_to(fb_t *fb, size_t pos) {
+    if (pos > fb->cap) {
+        fb->overflow = 1;
+        return;
+    }
+    memset(fb->data + fb->len, 0, pos - fb->len);
+    fb->len = pos;
+}
+
+/* Zeroed space for 'size' bytes at the next multiple of 'align' */
+static size_t fb_reserve(fb_t *fb, size_t size, size_t align) {
+    size_t pos = (fb->len + align - 1) & ~(align - 1);
+    fb_pad_to(fb, pos + size);
+    return fb->overflow ? 0 : pos;
+}
+
+static void fb_put(fb_t *fb, size_t pos, const void *value, size_t size) {
+    if (!fb->overflow)
+        memcpy(fb->data + pos, value, size);
+}
+
+static void fb_u8(fb_t *fb, size_t pos, uint8_t v) {
+    fb_put(fb, pos, &v, 1);
+}
+static void fb_i16(fb_t *fb, size_t pos, int16_t v) {
+    fb_put(fb, pos, &v, 2);
+}
+static void fb_i32(fb_t *fb, size_t pos, int32_t v) {
+    fb_put(fb, pos, &v, 4);
+}
+static void fb_i64(fb_t *fb, size_t pos, int64_t v) {
+    fb_put(fb, pos, &v, 8);
+}
+
+/* Points the offset field at 'field' to the object at 'target' */
+static void fb_link(fb_t *fb, size_t field, size_t target) {
+    uint32_t offset = (uint32_t)(target - field);
+    fb_put(fb, field, &offset, 4);
+}
+
+/*
+ * A vtable followed by a table with one slot per non-zero entry of 'sizes'
+ * (absent fields take their default). The position of field i goes to
+ * at[i]; fields are aligned to their size and the table to 8.
+ */
+static size_t fb_table(fb_t *fb, int nfields, const uint8_t *sizes, size_t *at) {
+    uint16_t offsets[8];
+    size_t end = 4; /* After the vtable offset */
+    for (int i = 0; i < nfields; i++) {
+        offsets[i] = 0;
+        if (sizes[i]) {
+            end = (end + sizes[i] - 1) & ~(size_t)(sizes[i] - 1);
+            offsets[i] = (uint16_t)end;
+            end += sizes[i];
+        }
+    }
+
+    size_t vtable = fb_reserve(fb, 4 + 2 * (size_t)nfields, 2);
+    fb_put(fb, vtable, &(uint16_t){(uint16_t)(4 + 2 * nfields)}, 2);
+    fb_put(fb, vtable + 2, &(uint16_t){(uint16_t)end}, 2);
+    for (int i = 0; i < nfields; i++)
+        fb_put(fb, vtable + 4 + 2 * (size_t)i, &offsets[i], 2);
+
+    size_t table = fb_reserve(fb, end, 8);
+    fb_i32(fb, table, (int32_t)(table - vtable));
+    for (int i = 0; i < nfields; i++)
+        at[i] = table + offsets[i];
+    return table;
+}
+
+/* A vector's length field; its elements follow, aligned to 'align' */
+static size_t fb_vector(fb_t *fb, size_t count, size_t elem_size, size_t align) {
+    size_t start = ((fb->len + 4 + align - 1) & ~(align - 1)) - 4;
+    fb_pad_to(fb, start);
+    size_t pos = fb_reserve(fb, 4 + count * elem_size, 1);
+    fb_i32(fb, pos, (int32_t)count);
+    return pos;
+}
+
+static size_t fb_string(fb_t *fb, const char *s) {
+    size_t len = strlen(s);
+    size_t pos = fb_reserve(fb, 4 + len + 1, 4);
+    fb_i32(fb, pos, (int32_t)len);
+    fb_put(fb, pos + 4, s, len);
+    return pos;
+}
+
+/* --- Columns --- */
+
+typedef struct {
+    const char *name;
+    uint32_t algo;   /* 0 for the id column */
+    size_t offset;   /* Field in ph_hashes_t */
+    uint32_t width;  /* Bytes per value */
+    int fixed_size;  /* fixed_size_binary rather than uint64 */
+} column_t;
+
+static const column_t s_columns[MAX_COLUMNS] = {
+    {"id", 0, 0, 8, 0},
+    {"ahash", PH_ALGO_AHASH, offsetof(ph_hashes_t, ahash), 8, 0},
+    {"dhash", PH_ALGO_DHASH, offsetof(ph_hashes_t, dhash), 8, 0},
+    {"phash", PH_ALGO_PHASH, offsetof(ph_hashes_t, phash), 8, 0},
+    {"whash", PH_ALGO_WHASH, offsetof(ph_hashes_t, whash), 8, 0},
+    {"mhash", PH_ALGO_MHASH, offsetof(ph_hashes_t, mhash), 8, 0},
+    {"bmh", PH_ALGO_BMH, offsetof(ph_hashes_t, bmh), 32, 1},
+    {"color", PH_ALGO_COLOR, offsetof(ph_hashes_t, color), 9, 1},
+    {"radial", PH_ALGO_RADIAL, offsetof(ph_hashes_t, radial), 40, 1},
+};
+
+/* The columns selected by 'algo_mask', id first */
+static int select_columns(uint32_t algo_mask, const column_t **out) {
+    int n = 0;
+    for (int c = 0; c < MAX_COLUMNS; c++) {
+        if (c == 0 || (algo_mask & s_columns[c].algo))
+            out[n++] = &s_columns[c];
+    }
+    return n;
+}
+
+/* Hash columns carry a validity bitmap, the id column does not */
+static size_t column_body_size(const column_t *col, size_t n) {
+    return (col->algo ? pad8((n + 7) / 8) : 0) + pad8(n * col->width);
+}
+
+/* --- Messages --- */
+
+static size_t build_schema(fb_t *fb, const column_t **cols, int ncols) {
+    static const uint8_t schema_fields[2] = {0, 4}; /* endianness (little), fields */
+    static const uint8_t field_fields[6] = {4, 1, 1, 4, 0, 4};
+    static const uint8_t int_fields[2] = {4, 1};
+    static const uint8_t binary_fields[1] = {4};
+    size_t at[6];
+
+    size_t schema = fb_table(fb, 2, schema_fields, at);
+    size_t fields = fb_vector(fb, (size_t)ncols, 4, 4);
+    fb_link(fb, at[1], fields);
+
+    for (int i = 0; i < ncols; i++) {
+        size_t field = fb_table(fb, 6, field_fields, at);
+        fb_link(fb, fields + 4 + 4 * (size_t)i, field);
+        size_t name_at = at[0], type_at = at[3], children_at = at[5];
+        fb_u8(fb, at[1], cols[i]->algo != 0); /* nullable */
+        fb_u8(fb, at[2], cols[i]->fixed_size ? TYPE_FIXED_SIZE_BINARY : TYPE_INT);
+
+        fb_link(fb, name_at, fb_string(fb, cols[i]->name));
+        size_t type;
+        if (cols[i]->fixed_size) {
+            type = fb_table(fb, 1, binary_fields, at);
+            fb_i32(fb, at[0], (int32_t)cols[i]->width);
+        } else {
+            type = fb_table(fb, 2, int_fields, at);
+            fb_i32(fb, at[0], 64);
+            fb_u8(fb, at[1], 0); /* unsigned */
+        }
+        fb_link(fb, type_at, type);
+        fb_link(fb, children_at, fb_vector(fb, 0, 4, 4));
+    }
+    return schema;
+}
+
+/* Root offset and Message table; returns where the header offset goes */
+static size_t build_message(fb_t *fb, uint8_t header_type, size_t body_length) {
+    static const uint8_t message_fields[4] = {2, 1, 4, 8};
+    size_t at[4];
+    size_t root = fb_reserve(fb, 4, 4);
+    fb_link(fb, root, fb_table(fb, 4, message_fields, at));
+    fb_i16(fb, at[0], ARROW_V5);
+    fb_u8(fb, at[1], header_type);
+    fb_i64(fb, at[3], (int64_t)body_length);
+    return at[2];
+}
+
+static void build_schema_message(fb_t *fb, uint32_t algo_mask) {
+    const column_t *cols[MAX_COLUMNS];
+    int ncols = select_columns(algo_mask, cols);
+    size_t header_at = build_message(fb, HEADER_SCHEMA, 0);
+    fb_link(fb, header_at, build_schema(fb, cols, ncols));
+}
+
+/* The RecordBatch message of n rows; its buffers are laid out back to back */
+static size_t build_batch_message(fb_t *fb, uint32_t algo_mask, size_t n, const int64_t *nulls) {
+    static const uint8_t batch_fields[3] = {8, 4, 4}; /* length, nodes, buffers */
+    const column_t *cols[MAX_COLUMNS];
+    int ncols = select_columns(algo_mask, cols);
+    size_t body = 0;
+    for (int i = 0; i < ncols; i++)
+        body += column_body_size(cols[i], n);
+
+    size_t at[3];
+    size_t header_at = build_message(fb, HEADER_RECORD_BATCH, body);
+    fb_link(fb, header_at, fb_table(fb, 3, batch_fields, at));
+    fb_i64(fb, at[0], (int64_t)n);
+    size_t buffers_at = at[2];
+
+    /* FieldNode { length, null_count } */
+    size_t nodes = fb_vector(fb, (size_t)ncols, 16, 8);
+    fb_link(fb, at[1], nodes);
+    for (int i = 0; i < ncols; i++) {
+        fb_i64(fb, nodes + 4 + 16 * (size_t)i, (int64_t)n);
+        fb_i64(fb, nodes + 12 + 16 * (size_t)i, nulls ? nulls[i] : 0);
+    }
+
+    /* Buffer { offset, length }: validity, then values */
+    size_t buffers = fb_vector(fb, 2 * (size_t)ncols, 16, 8);
+    fb_link(fb, buffers_at, buffers);
+    size_t offset = 0, slot = buffers + 4;
+    for (int i = 0; i < ncols; i++) {
+        size_t validity = cols[i]->algo ? (n + 7) / 8 : 0;
+        fb_i64(fb, slot, (int64_t)offset);
+        fb_i64(fb, slot + 8, (int64_t)validity);
+        offset += pad8(validity);
+        fb_i64(fb, slot + 16, (int64_t)offset);
+        fb_i64(fb, slot + 24, (int64_t)(n * cols[i]->width));
+        offset += pad8(n * cols[i]->width);
+        slot += 32;
+    }
+    return body;
+}
+
+/* Frames the metadata in 'fb' into 'out'; returns the prefix + metadata size */
+static size_t frame_metadata(const fb_t *fb, uint8_t *out) {
+    size_t meta = pad8(fb->len);
+    uint32_t prefix[2] = {ARROW_CONTINUATION, (uint32_t)meta};
+    memcpy(out, prefix, 8);
+    memcpy(out + 8, fb->data, fb->len);
+    memset(out + 8 + fb->len, 0, meta - fb->len);
+    return 8 + meta;
+}
+
+static size_t batch_metadata_size(uint32_t algo_mask, size_t n) {
+    uint8_t storage[META_CAP];
+    fb_t fb = {storage, 0, sizeof(storage), 0};
+    build_batch_message(&fb, algo_mask, n, NULL);
+    return 8 + pad8(fb.len);
+}
+
+PH_API size_t ph_arrow_schema_size(uint32_t algo_mask) {
+    uint8_t storage[META_CAP];
+    fb_t fb = {storage, 0, sizeof(storage), 0};
+    build_schema_message(&fb, algo_mask & PH_ALGO_ALL);
+    return 8 + pad8(fb.len);
+}
+
+PH_API size_t ph_arrow_batch_size(uint32_t algo_mask, size_t n) {
+    const column_t *cols[MAX_COLUMNS];
+    int ncols = select_columns(algo_mask & PH_ALGO_ALL, cols);
+    size_t size = batch_metadata_size(algo_mask & PH_ALGO_ALL, n);
+    for (int i = 0; i < ncols; i++)
+        size += column_body_size(cols[i], n);
+    return size;
+}
+
+PH_API ph_error_t ph_arrow_encode_schema(uint32_t algo_mask, uint8_t *buffer, size_t capacity,
+                                         size_t *out_length) {
+    if (!out_length || (algo_mask & ~PH_ALGO_ALL))
+        return PH_ERR_INVALID_ARGUMENT;
+    uint8_t storage[META_CAP];
+    fb_t fb = {storage, 0, sizeof(storage), 0};
+    build_schema_message(&fb, algo_mask);
+    *out_length = 8 + pad8(fb.len);
+    if (!buffer || capacity < *out_length)
+        return PH_ERR_INVALID_ARGUMENT;
+    frame_metadata(&fb, buffer);
+    return PH_SUCCESS;
+}
+
+/* Gathers one column of n results into 'out', returning its null count */
+static int64_t gather_column(const column_t *col, const uint64_t *ids, uint64_t first_id,
+                             const ph_hashes_t *results, size_t n, uint8_t *out) {
+    if (!col->algo) {
+        uint64_t *values = (uint64_t *)out;
+        for (size_t i = 0; i < n; i++)
+            values[i] = ids ? ids[i] : first_id + i;
+        memset(out + n * 8, 0, pad8(n * 8) - n * 8);
+        return 0;
+    }
+
+    size_t bitmap = pad8((n + 7) / 8);
+    uint8_t *valid = out, *values = out + bitmap;
+    int64_t nulls = 0;
+    memset(valid, 0, bitmap);
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *field = (const uint8_t *)&results[i] + col->offset;
+        int present = (results[i].mask & col->algo) != 0;
+        if (present && col->fixed_size)
+            present = ((const ph_digest_t *)field)->size == col->width;
+        if (present) {
+            valid[i >> 3] |= (uint8_t)(1u << (i & 7));
+            memcpy(values + i * col->width, field, col->width);
+        } else {
+            memset(values + i * col->width, 0, col->width);
+            nulls++;
+        }
+    }
+    memset(values + n * col->width, 0, pad8(n * col->width) - n * col->width);
+    return nulls;
+}
+
+static void encode_batch(uint32_t algo_mask, const uint64_t *ids, uint64_t first_id,
+                         const ph_hashes_t *results, size_t n, uint8_t *buffer) {
+    const column_t *cols[MAX_COLUMNS];
+    int64_t nulls[MAX_COLUMNS];
+    int ncols = select_columns(algo_mask, cols);
+
+    /* The body goes first so the null counts are known for the metadata */
+    uint8_t *body = buffer + batch_metadata_size(algo_mask, n);
+    for (int i = 0; i < ncols; i++) {
+        nulls[i] = gather_column(cols[i], ids, first_id, results, n, body);
+        body += column_body_size(cols[i], n);
+    }
+
+    uint8_t storage[META_CAP];
+    fb_t fb = {storage, 0, sizeof(storage), 0};
+    build_batch_message(&fb, algo_mask, n, nulls);
+    frame_metadata(&fb, buffer);
+}
+
+PH_API ph_error_t ph_arrow_encode_batch(uint32_t algo_mask, const uint64_t *ids,
+                                        const ph_hashes_t *results, size_t n, uint8_t *buffer,
+                                        size_t capacity, size_t *out_length) {
+    if (!out_length || (algo_mask & ~PH_ALGO_ALL) || (!results && n > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+    *out_length = ph_arrow_batch_size(algo_mask, n);
+    if (!buffer || capacity < *out_length)
+        return PH_ERR_INVALID_ARGUMENT;
+    encode_batch(algo_mask, ids, 0, results, n, buffer);
+    return PH_SUCCESS;
+}
+
+/* --- File descriptor writer --- */
+
+typedef struct {
+    int64_t offset;
+    int32_t metadata_length;
+    int64_t body_length;
+} block_t;
+
+struct ph_arrow_writer {
+    int fd;
+    uint32_t algo_mask;
+    ph_arrow_format_t format;
+    uint64_t rows;
+    int64_t position;
+    uint8_t *scratch;
+    size_t scratch_cap;
+    block_t *blocks;
+    size_t nblocks, blocks_cap;
+    ph_error_t error; /* First write error; later calls return it */
+};
+
+static ph_error_t write_all(ph_arrow_writer_t *w, const void *data, size_t size) {
+    const uint8_t *p = data;
+    while (size > 0 && w->error == PH_SUCCESS) {
+        size_t chunk = size > (1u << 30) ? (1u << 30) : size;
+        long written = (long)write(w->fd, p, (unsigned)chunk);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            w->error = PH_ERR_IO;
+            break;
+        }
+        p += written;
+        size -= (size_t)written;
+        w->position += written;
+    }
+    return w->error;
+}
+
+PH_API ph_error_t ph_arrow_writer_open(int fd, uint32_t algo_mask, ph_arrow_format_t format,
+                                       ph_arrow_writer_t **out_writer) {
+    if (fd < 0 || (algo_mask & ~PH_ALGO_ALL) || !out_writer ||
+        (format != PH_ARROW_STREAM && format != PH_ARROW_FILE))
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_arrow_writer_t *w = ph_mem_calloc(NULL, 1, sizeof(ph_arrow_writer_t));
+    if (!w)
+        return PH_ERR_ALLOCATION_FAILED;
+    w->fd = fd;
+    w->algo_mask = algo_mask;
+    w->format = format;
+
+    uint8_t schema[META_CAP + 8];
+    size_t length = 0;
+    ph_error_t err = ph_arrow_encode_schema(algo_mask, schema, sizeof(schema), &length);
+    if (err == PH_SUCCESS && format == PH_ARROW_FILE)
+        err = write_all(w, s_file_magic, sizeof(s_file_magic));
+    if (err == PH_SUCCESS)
+        err = write_all(w, schema, length);
+    if (err != PH_SUCCESS) {
+        ph_mem_free(NULL, w);
+        return err;
+    }
+    *out_writer = w;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_arrow_writer_write(ph_arrow_writer_t *writer, const uint64_t *ids,
+                                        const ph_hashes_t *results, size_t n) {
+    if (!writer || (!results && n > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+    if (writer->error != PH_SUCCESS)
+        return writer->error;
+
+    size_t length = ph_arrow_batch_size(writer->algo_mask, n);
+    if (length > writer->scratch_cap) {
+        uint8_t *grown = ph_mem_realloc(NULL, writer->scratch, writer->scratch_cap, length);
+        if (!grown)
+            return PH_ERR_ALLOCATION_FAILED;
+        writer->scratch = grown;
+        writer->scratch_cap = length;
+    }
+    if (writer->format == PH_ARROW_FILE && writer->nblocks == writer->blocks_cap) {
+        size_t cap = writer->blocks_cap ? writer->blocks_cap * 2 : 64;
+        block_t *grown = ph_mem_realloc(NULL, writer->blocks, writer->blocks_cap * sizeof(block_t),
+                                        cap * sizeof(block_t));
+        if (!grown)
+            return PH_ERR_ALLOCATION_FAILED;
+        writer->blocks = grown;
+        writer->blocks_cap = cap;
+    }
+
+    encode_batch(writer->algo_mask, ids, writer->rows, results, n, writer->scratch);
+    size_t metadata = batch_metadata_size(writer->algo_mask, n);
+    block_t block = {writer->position, (int32_t)metadata, (int64_t)(length - metadata)};
+    ph_error_t err = write_all(writer, writer->scratch, length);
+    if (err != PH_SUCCESS)
+        return err;
+    if (writer->format == PH_ARROW_FILE)
+        writer->blocks[writer->nblocks++] = block;
+    writer->rows += n;
+    return PH_SUCCESS;
+}
+
+/* Footer: version, schema, dictionaries, recordBatches */
+static ph_error_t write_footer(ph_arrow_writer_t *w) {
+    static const uint8_t footer_fields[4] = {2, 4, 4, 4};
+    fb_t fb = {NULL, 0, META_CAP + 32 * w->nblocks, 0};
+    fb.data = ph_mem_alloc(NULL, fb.cap);
+    if (!fb.data)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    const column_t *cols[MAX_COLUMNS];
+    int ncols = select_columns(w->algo_mask, cols);
+    size_t at[4];
+    size_t root = fb_reserve(&fb, 4, 4);
+    fb_link(&fb, root, fb_table(&fb, 4, footer_fields, at));
+    fb_i16(&fb, at[0], ARROW_V5);
+    size_t batches_at = at[3], dictionaries_at = at[2];
+    fb_link(&fb, at[1], build_schema(&fb, cols, ncols));
+    fb_link(&fb, dictionaries_at, fb_vector(&fb, 0, 24, 8));
+
+    /* Block { offset, metaDataLength, (padding), bodyLength } */
+    size_t blocks = fb_vector(&fb, w->nblocks, 24, 8);
+    fb_link(&fb, batches_at, blocks);
+    for (size_t i = 0; i < w->nblocks; i++) {
+        size_t slot = blocks + 4 + 24 * i;
+        fb_i64(&fb, slot, w->blocks[i].offset);
+        fb_i32(&fb, slot + 8, w->blocks[i].metadata_length);
+        fb_i64(&fb, slot + 16, w->blocks[i].body_length);
+    }
+
+    int32_t footer_length = (int32_t)fb.len;
+    ph_error_t err = write_all(w, fb.data, fb.len);
+    if (err == PH_SUCCESS)
+        err = write_all(w, &footer_length, 4);
+    if (err == PH_SUCCESS)
+        err = write_all(w, s_file_magic, 6);
+    ph_mem_free(NULL, fb.data);
+    return err;
+}
+
+PH_API ph_error_t ph_arrow_writer_close(ph_arrow_writer_t *writer) {
+    if (!writer)
+        return PH_ERR_INVALID_ARGUMENT;
+    static const uint32_t end_of_stream[2] = {ARROW_CONTINUATION, 0};
+    ph_error_t err = write_all(writer, end_of_stream, sizeof(end_of_stream));
+    if (err == PH_SUCCESS && writer->format == PH_ARROW_FILE)
+        err = write_footer(writer);
+    ph_mem_free(NULL, writer->scratch);
+    ph_mem_free(NULL, writer->blocks);
+    ph_mem_free(NULL, writer);
+    return err;
+}
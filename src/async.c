@@ -0,0 +1,696 @@
+#include "internal.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(PH_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Submission queue depth of the reader ring. */
+#define URING_ENTRIES 64
+#endif
+
+typedef struct async_job {
+    struct async_job *next;
+    char *path;            /* Owned copy of the item path, or NULL */
+    const uint8_t *buffer; /* Encoded bytes (caller's, or 'owned') */
+    uint8_t *owned;        /* Buffer filled by the reader thread */
+    size_t length;
+    size_t done; /* Bytes read so far */
+    int fd;
+    uint32_t algo_mask;
+    ph_async_completion_t result;
+} async_job_t;
+
+typedef struct {
+    async_job_t *head;
+    async_job_t *tail;
+} job_list_t;
+
+static void list_push(job_list_t *l, async_job_t *job) {
+    job->next = NULL;
+    if (l->tail)
+        l->tail->next = job;
+    else
+        l->head = job;
+    l->tail = job;
+}
+
+static async_job_t *list_pop(job_list_t *l) {
+    async_job_t *job = l->head;
+    if (job) {
+        l->head = job->next;
+        if (!l->head)
+            l->tail = NULL;
+    }
+    return job;
+}
+
+static void job_free(async_job_t *job) {
+    ph_mem_free(NULL, job->path);
+    ph_mem_free(NULL, job->owned);
+    ph_mem_free(NULL, job);
+}
+
+#if defined(PH_HAVE_IO_URING)
+typedef struct {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+} uring_t;
+#endif
+
+struct ph_async_queue {
+    ph_mutex_t lock;
+    ph_cond_t work_cv;
+    job_list_t ready;     /* Jobs ready to decode and hash */
+    job_list_t completed; /* Finished jobs awaiting ph_async_poll() */
+    int stopping;
+
+    /* Admission against the decoded-bytes budget, in ticket order */
+    ph_cond_t budget_cv;
+    size_t budget; /* 0: unlimited */
+    size_t in_flight;
+    size_t peak;
+    uint64_t oversized;
+    uint64_t next_ticket;
+    uint64_t admit_ticket;
+
+    int nworkers;
+    ph_thread_t *workers;
+    ph_context_t **contexts; /* One per worker, reused across jobs */
+    int efd;
+
+#if defined(PH_HAVE_IO_URING)
+    int has_reader;     /* File jobs go to the reader; cleared if the ring fails */
+    int reader_started; /* The reader thread must be joined */
+    ph_thread_t reader;
+    ph_cond_t io_cv;
+    job_list_t io_pending; /* File jobs waiting for the reader thread */
+    uring_t ring;
+    /* Buffers of reads abandoned when the ring failed, freed on destroy */
+    uint8_t *orphans[URING_ENTRIES];
+    unsigned norphans;
+#endif
+};
+
+/* Hands a job to the decode workers. Caller holds the lock. */
+static void enqueue_ready(ph_async_queue_t *q, async_job_t *job) {
+    list_push(&q->ready, job);
+    ph_cond_signal(&q->work_cv);
+}
+
+#if defined(PH_HAVE_IO_URING)
+
+static int uring_setup(uring_t *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+        return -1;
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_size > r->sq_size)
+            r->sq_size = r->cq_size;
+        r->cq_size = r->sq_size;
+    }
+
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+                     IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED)
+        goto fail;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ptr = r->sq_ptr;
+    } else {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         r->fd, IORING_OFF_CQ_RING);
+        if (r->cq_ptr == MAP_FAILED) {
+            munmap(r->sq_ptr, r->sq_size);
+            goto fail;
+        }
+    }
+
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+                   IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (r->cq_ptr != r->sq_ptr)
+            munmap(r->cq_ptr, r->cq_size);
+        munmap(r->sq_ptr, r->sq_size);
+        goto fail;
+    }
+
+    uint8_t *sq = r->sq_ptr;
+    uint8_t *cq = r->cq_ptr;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+
+fail:
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+}
+
+static void uring_teardown(uring_t *r) {
+    munmap(r->sqes, r->sqes_size);
+    if (r->cq_ptr != r->sq_ptr)
+        munmap(r->cq_ptr, r->cq_size);
+    munmap(r->sq_ptr, r->sq_size);
+    close(r->fd);
+    r->fd = -1;
+}
+
+/* Queues a read of the job's remaining bytes, tagged with the reader's slot
+ * for the job. The reader never has more than URING_ENTRIES reads in
+ * flight, so a free SQE always exists. */
+static void uring_queue_read(uring_t *r, async_job_t *job, unsigned slot) {
+    unsigned tail = *r->sq_tail;
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = job->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(job->owned + job->done);
+    sqe->len = (unsigned)(job->length - job->done);
+    sqe->off = job->done;
+    sqe->user_data = slot;
+
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* SQEs queued but not yet consumed by the kernel */
+static unsigned uring_unsubmitted(const uring_t *r) {
+    return *r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+}
+
+static int uring_enter(uring_t *r, unsigned to_submit, unsigned min_complete) {
+    return (int)syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete,
+                        IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+/* Opens the file and allocates its buffer. Returns 0 when a read must be
+ * queued, or non-zero when the job is already finished (error or empty). */
+static int reader_open(async_job_t *job) {
+    job->fd = open(job->path, O_RDONLY | O_CLOEXEC);
+    if (job->fd < 0) {
+        job->result.error = PH_ERR_DECODE_FAILED;
+        return 1;
+    }
+    struct stat st;
+    if (fstat(job->fd, &st) != 0 || st.st_size <= 0) {
+        job->result.error = PH_ERR_DECODE_FAILED;
+        return 1;
+    }
+    job->length = (size_t)st.st_size;
+    job->owned = ph_mem_alloc(NULL, job->length);
+    if (!job->owned) {
+        job->result.error = PH_ERR_ALLOCATION_FAILED;
+        return 1;
+    }
+    return 0;
+}
+
+static void reader_finish(ph_async_queue_t *q, async_job_t *job) {
+    if (job->fd >= 0)
+        close(job->fd);
+    job->fd = -1;
+    job->buffer = job->owned;
+    job->length = job->done;
+    ph_mutex_lock(&q->lock);
+    enqueue_ready(q, job);
+    ph_mutex_unlock(&q->lock);
+}
+
+/* Handles one read completion. Returns 1 if the job needs another read. */
+static int reader_complete(async_job_t *job, int res) {
+    if (res == -EINVAL || res == -EOPNOTSUPP) {
+        /* Kernel predates IORING_OP_READ: finish synchronously */
+        while (job->done < job->length) {
+            ssize_t n = pread(job->fd, job->owned + job->done, job->length - job->done,
+                              (off_t)job->done);
+            if (n <= 0)
+                break;
+            job->done += (size_t)n;
+        }
+        return 0;
+    }
+    if (res < 0) {
+        job->result.error = PH_ERR_DECODE_FAILED;
+        return 0;
+    }
+    job->done += (size_t)res;
+    /* res == 0 means the file shrank; decode whatever was read */
+    return res > 0 && job->done < job->length;
+}
+
+/* The ring is unusable: fails the reads it held and hands everything else
+ * to the workers, which read files themselves from now on. */
+static void reader_fail(ph_async_queue_t *q, async_job_t **active) {
+    /* Closing the ring cancels its reads, but the kernel may still be
+     * writing into their buffers for a while */
+    uring_teardown(&q->ring);
+
+    ph_mutex_lock(&q->lock);
+    q->has_reader = 0;
+    for (unsigned i = 0; i < URING_ENTRIES; i++) {
+        async_job_t *job = active[i];
+        if (!job)
+            continue;
+        close(job->fd);
+        job->fd = -1;
+        q->orphans[q->norphans++] = job->owned;
+        job->owned = NULL;
+        job->result.error = PH_ERR_IO;
+        enqueue_ready(q, job);
+    }
+    async_job_t *job;
+    while ((job = list_pop(&q->io_pending)) != NULL)
+        enqueue_ready(q, job);
+    ph_mutex_unlock(&q->lock);
+}
+
+static void reader_main(void *arg) {
+    ph_async_queue_t *q = arg;
+    uring_t *r = &q->ring;
+    async_job_t *active[URING_ENTRIES] = {0}; /* Jobs by slot */
+    unsigned free_slots[URING_ENTRIES];
+    unsigned nfree = URING_ENTRIES;
+    for (unsigned i = 0; i < URING_ENTRIES; i++)
+        free_slots[i] = URING_ENTRIES - 1 - i;
+
+    for (;;) {
+        async_job_t *batch[URING_ENTRIES];
+        unsigned nbatch = 0;
+        unsigned inflight = URING_ENTRIES - nfree;
+
+        ph_mutex_lock(&q->lock);
+        while (!q->stopping && !q->io_pending.head && inflight == 0)
+            ph_cond_wait(&q->io_cv, &q->lock);
+        if (q->stopping) {
+            async_job_t *job;
+            while ((job = list_pop(&q->io_pending)) != NULL)
+                job_free(job);
+            if (inflight == 0) {
+                ph_mutex_unlock(&q->lock);
+                break;
+            }
+        }
+        while (inflight + nbatch < URING_ENTRIES && q->io_pending.head)
+            batch[nbatch++] = list_pop(&q->io_pending);
+        ph_mutex_unlock(&q->lock);
+
+        for (unsigned i = 0; i < nbatch; i++) {
+            if (reader_open(batch[i]) != 0) {
+                reader_finish(q, batch[i]);
+                continue;
+            }
+            unsigned slot = free_slots[--nfree];
+            active[slot] = batch[i];
+            uring_queue_read(r, batch[i], slot);
+        }
+        if (nfree == URING_ENTRIES)
+            continue;
+
+        /* Also resubmits whatever an interrupted or partial enter left in
+         * the SQ ring. The kernel only waits once all of it is consumed. */
+        if (uring_enter(r, uring_unsubmitted(r), 1) < 0 && errno != EINTR &&
+            errno != EAGAIN && errno != EBUSY) {
+            reader_fail(q, active);
+            return;
+        }
+
+        unsigned head = *r->cq_head;
+        while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            unsigned slot = (unsigned)cqe->user_data;
+            async_job_t *job = active[slot];
+            int res = cqe->res;
+            head++;
+            if (reader_complete(job, res)) {
+                /* Submitted by the next enter */
+                uring_queue_read(r, job, slot);
+            } else {
+                active[slot] = NULL;
+                free_slots[nfree++] = slot;
+                reader_finish(q, job);
+            }
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+#endif /* PH_HAVE_IO_URING */
+
+typedef struct {
+    ph_async_queue_t *queue;
+    ph_context_t *ctx;
+} worker_arg_t;
+
+/* Smallest side an oversized image is decoded at. The hashes resample to
+ * 32x32 at most, so this keeps ample detail. */
+#define OVERSIZED_MIN_SIDE 256
+
+/* Decoded bytes a job will hold: the pixels as stored plus the grayscale
+ * plane derived from them. 0 when the header is not recognized. */
+static size_t job_cost(const async_job_t *job) {
+    if (job->result.error != PH_SUCCESS)
+        return 0;
+    ph_image_info_t info;
+    ph_error_t err = job->buffer ? ph_probe(job->buffer, job->length, &info)
+                                 : ph_probe_file(job->path, &info);
+    if (err != PH_SUCCESS)
+        return 0;
+    size_t planes = (size_t)info.channels + (info.channels > 1);
+    return (size_t)info.width * (size_t)info.height * planes;
+}
+
+/* Waits for the job's turn and for room in the budget. An item larger
+ * than the budget is admitted once nothing else is in flight. Caller holds
+ * the lock; returns 0 if the queue stopped while waiting. */
+static int admit_job(ph_async_queue_t *q, uint64_t ticket, size_t cost) {
+    while (!q->stopping &&
+           (ticket != q->admit_ticket ||
+            (q->budget && q->in_flight > 0 &&
+             (q->in_flight >= q->budget || cost > q->budget - q->in_flight))))
+        ph_cond_wait(&q->budget_cv, &q->lock);
+    if (q->stopping)
+        return 0;
+
+    q->admit_ticket++;
+    q->in_flight += cost;
+    if (q->in_flight > q->peak)
+        q->peak = q->in_flight;
+    /* The next ticket may fit alongside this one */
+    ph_cond_broadcast(&q->budget_cv);
+    return 1;
+}
+
+static void process_job(ph_context_t *ctx, async_job_t *job) {
+    if (job->result.error != PH_SUCCESS)
+        return;
+
+    ph_error_t err;
+    if (job->buffer)
+        err = ph_load_from_memory(ctx, job->buffer, job->length);
+    else
+        err = ph_load_from_file(ctx, job->path);
+    if (err == PH_SUCCESS)
+        err = ph_compute_hashes(ctx, job->algo_mask, &job->result.hashes);
+    job->result.error = err;
+
+    /* Drop the decoded pixels now rather than holding them until the next job */
+    ph_release_image(ctx);
+}
+
+static void worker_main(void *arg) {
+    worker_arg_t *wa = arg;
+    ph_async_queue_t *q = wa->queue;
+    ph_context_t *ctx = wa->ctx;
+    ph_mem_free(NULL, wa);
+
+    for (;;) {
+        ph_mutex_lock(&q->lock);
+        while (!q->stopping && !q->ready.head)
+            ph_cond_wait(&q->work_cv, &q->lock);
+        if (q->stopping) {
+            ph_mutex_unlock(&q->lock);
+            break;
+        }
+        async_job_t *job = list_pop(&q->ready);
+        uint64_t ticket = q->next_ticket++;
+        int limited = q->budget != 0;
+        ph_mutex_unlock(&q->lock);
+
+        /* The header is probed outside the lock, then admission waits */
+        size_t cost = limited ? job_cost(job) : 0;
+        ph_mutex_lock(&q->lock);
+        if (!admit_job(q, ticket, cost)) {
+            ph_mutex_unlock(&q->lock);
+            job_free(job);
+            break;
+        }
+        int oversized = q->budget && cost > q->budget;
+        q->oversized += oversized;
+        ph_mutex_unlock(&q->lock);
+
+        if (oversized) {
+            /* Workers only ever load with default settings */
+            ph_context_set_min_resolution(ctx, OVERSIZED_MIN_SIDE, OVERSIZED_MIN_SIDE);
+            if (!(job->algo_mask & PH_ALGO_COLOR))
+                ph_context_set_load_flags(ctx, PH_LOAD_GRAY_ONLY);
+            process_job(ctx, job);
+            ph_context_set_min_resolution(ctx, 0, 0);
+            ph_context_set_load_flags(ctx, PH_LOAD_DEFAULT);
+        } else {
+            process_job(ctx, job);
+        }
+        ph_mem_free(NULL, job->owned);
+        job->owned = NULL;
+        job->buffer = NULL;
+
+        ph_mutex_lock(&q->lock);
+        q->in_flight -= cost;
+        ph_cond_broadcast(&q->budget_cv);
+        list_push(&q->completed, job);
+#if defined(__linux__)
+        if (q->efd >= 0) {
+            uint64_t one = 1;
+            ssize_t n = write(q->efd, &one, sizeof(one));
+            (void)n;
+        }
+#endif
+        ph_mutex_unlock(&q->lock);
+    }
+}
+
+PH_API ph_error_t ph_async_create(int threads, ph_async_queue_t **out_queue) {
+    if (!out_queue || threads < 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (threads == 0)
+        threads = ph_cpu_count();
+
+    ph_async_queue_t *q = ph_mem_calloc(NULL, 1, sizeof(ph_async_queue_t));
+    if (!q)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    q->workers = ph_mem_calloc(NULL, (size_t)threads, sizeof(ph_thread_t));
+    q->contexts = ph_mem_calloc(NULL, (size_t)threads, sizeof(ph_context_t *));
+    if (!q->workers || !q->contexts) {
+        ph_mem_free(NULL, q->workers);
+        ph_mem_free(NULL, q->contexts);
+        ph_mem_free(NULL, q);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+
+    ph_mutex_init(&q->lock);
+    ph_cond_init(&q->work_cv);
+    ph_cond_init(&q->budget_cv);
+    q->efd = -1;
+#if defined(__linux__)
+    q->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+
+#if defined(PH_HAVE_IO_URING)
+    ph_cond_init(&q->io_cv);
+    if (uring_setup(&q->ring, URING_ENTRIES) == 0) {
+        if (ph_thread_create(&q->reader, reader_main, q) == 0)
+            q->has_reader = q->reader_started = 1;
+        else
+            uring_teardown(&q->ring);
+    }
+#endif
+
+    for (int i = 0; i < threads; i++) {
+        worker_arg_t *wa = ph_mem_alloc(NULL, sizeof(*wa));
+        if (!wa || ph_create(&q->contexts[i]) != PH_SUCCESS) {
+            ph_mem_free(NULL, wa);
+            ph_async_destroy(q);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        wa->queue = q;
+        wa->ctx = q->contexts[i];
+        if (ph_thread_create(&q->workers[i], worker_main, wa) != 0) {
+            ph_mem_free(NULL, wa);
+            ph_free(q->contexts[i]);
+            q->contexts[i] = NULL;
+            ph_async_destroy(q);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        q->nworkers++;
+    }
+
+    *out_queue = q;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_async_destroy(ph_async_queue_t *queue) {
+    if (!queue)
+        return;
+
+    ph_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    ph_cond_broadcast(&queue->work_cv);
+    ph_cond_broadcast(&queue->budget_cv);
+#if defined(PH_HAVE_IO_URING)
+    ph_cond_broadcast(&queue->io_cv);
+#endif
+    ph_mutex_unlock(&queue->lock);
+
+#if defined(PH_HAVE_IO_URING)
+    if (queue->reader_started)
+        ph_thread_join(queue->reader);
+    if (queue->ring.fd >= 0)
+        uring_teardown(&queue->ring);
+    for (unsigned i = 0; i < queue->norphans; i++)
+        ph_mem_free(NULL, queue->orphans[i]);
+    ph_cond_destroy(&queue->io_cv);
+#endif
+    for (int i = 0; i < queue->nworkers; i++)
+        ph_thread_join(queue->workers[i]);
+    for (int i = 0; i < queue->nworkers; i++)
+        ph_free(queue->contexts[i]);
+
+    async_job_t *job;
+    while ((job = list_pop(&queue->ready)) != NULL)
+        job_free(job);
+    while ((job = list_pop(&queue->completed)) != NULL)
+        job_free(job);
+
+#if defined(__linux__)
+    if (queue->efd >= 0)
+        close(queue->efd);
+#endif
+    ph_cond_destroy(&queue->work_cv);
+    ph_cond_destroy(&queue->budget_cv);
+    ph_mutex_destroy(&queue->lock);
+    ph_mem_free(NULL, queue->workers);
+    ph_mem_free(NULL, queue->contexts);
+    ph_mem_free(NULL, queue);
+}
+
+PH_API ph_error_t ph_async_submit(ph_async_queue_t *queue, const ph_async_item_t *item,
+                                  uint32_t algo_mask, void *user_data) {
+    if (!queue || !item || (algo_mask & ~PH_ALGO_ALL) != 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (!item->path && (!item->buffer || item->length == 0))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    async_job_t *job = ph_mem_calloc(NULL, 1, sizeof(async_job_t));
+    if (!job)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    if (item->path) {
+        size_t len = strlen(item->path) + 1;
+        job->path = ph_mem_alloc(NULL, len);
+        if (!job->path) {
+            ph_mem_free(NULL, job);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        memcpy(job->path, item->path, len);
+    } else {
+        job->buffer = item->buffer;
+        job->length = item->length;
+    }
+    job->fd = -1;
+    job->algo_mask = algo_mask;
+    job->result.user_data = user_data;
+    job->result.error = PH_SUCCESS;
+
+    ph_mutex_lock(&queue->lock);
+#if defined(PH_HAVE_IO_URING)
+    if (job->path && queue->has_reader) {
+        list_push(&queue->io_pending, job);
+        ph_cond_signal(&queue->io_cv);
+        ph_mutex_unlock(&queue->lock);
+        return PH_SUCCESS;
+    }
+#endif
+    /* Without a reader ring, workers read files themselves */
+    enqueue_ready(queue, job);
+    ph_mutex_unlock(&queue->lock);
+    return PH_SUCCESS;
+}
+
+PH_API int ph_async_poll(ph_async_queue_t *queue, ph_async_completion_t *completions, size_t max) {
+    if (!queue || (!completions && max > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    int count = 0;
+    ph_mutex_lock(&queue->lock);
+    while ((size_t)count < max && queue->completed.head) {
+        async_job_t *job = list_pop(&queue->completed);
+        completions[count++] = job->result;
+        job_free(job);
+    }
+#if defined(__linux__)
+    /* Reset readiness once everything has been drained */
+    if (!queue->completed.head && queue->efd >= 0) {
+        uint64_t value;
+        ssize_t n = read(queue->efd, &value, sizeof(value));
+        (void)n;
+    }
+#endif
+    ph_mutex_unlock(&queue->lock);
+    return count;
+}
+
+PH_API int ph_async_fd(const ph_async_queue_t *queue) { return queue ? queue->efd : -1; }
+
+PH_API ph_error_t ph_async_set_memory_budget(ph_async_queue_t *queue, size_t max_decoded_bytes) {
+    if (!queue)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_mutex_lock(&queue->lock);
+    queue->budget = max_decoded_bytes;
+    ph_cond_broadcast(&queue->budget_cv);
+    ph_mutex_unlock(&queue->lock);
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_async_get_memory_stats(ph_async_queue_t *queue,
+                                            ph_async_memory_stats_t *out_stats) {
+    if (!queue || !out_stats)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_mutex_lock(&queue->lock);
+    out_stats->budget = queue->budget;
+    out_stats->in_flight = queue->in_flight;
+    out_stats->peak = queue->peak;
+    out_stats->oversized = queue->oversized;
+    ph_mutex_unlock(&queue->lock);
+    return PH_SUCCESS;
+}
@@ -0,0 +1,348 @@
+#include "internal.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* Bump whenever an algorithm's output changes so stale tables are discarded */
+#define CACHE_VERSION 2
+#define CACHE_MAGIC "PHCACHE1"
+#define CACHE_WAYS 8
+
+#define ENTRY_VALID 1u
+#define ENTRY_REFERENCED 2u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t capacity;
+    uint64_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+} cache_header_t;
+
+typedef struct {
+    ph_cache_key_t key;
+    uint32_t flags;
+    uint32_t reserved;
+    ph_hashes_t hashes;
+} cache_entry_t;
+
+struct ph_cache {
+    ph_mutex_t lock;
+    cache_header_t *header;
+    cache_entry_t *entries;
+    size_t nbuckets;
+    size_t map_size;
+    int mapped; /* 1 when backed by a file mapping */
+};
+
+// --- Fingerprints ---
+
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t mix_round(uint64_t acc, uint64_t v) {
+    acc += v * PRIME2;
+    return rotl64(acc, 31) * PRIME1;
+}
+
+static inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+ph_cache_key_t ph_cache_key_memory(const uint8_t *buffer, size_t length) {
+    /* Four independent lanes over 32-byte stripes keep the multipliers busy;
+     * hashing runs at memory speed, far below the cost of a decode. */
+    uint64_t v[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        v[0] = mix_round(v[0], read64(buffer + i));
+        v[1] = mix_round(v[1], read64(buffer + i + 8));
+        v[2] = mix_round(v[2], read64(buffer + i + 16));
+        v[3] = mix_round(v[3], read64(buffer + i + 24));
+    }
+    if (i < length) {
+        uint8_t tail[32] = {0};
+        memcpy(tail, buffer + i, length - i);
+        for (int l = 0; l < 4; l++)
+            v[l] = mix_round(v[l], read64(tail + 8 * l));
+    }
+
+    ph_cache_key_t key;
+    key.lo = avalanche((rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18)) ^
+                       (uint64_t)length);
+    key.hi = avalanche(v[0] ^ rotl64(v[1], 17) ^ (v[2] * PRIME3) ^ rotl64(v[3], 41) ^
+                       ((uint64_t)length * PRIME1));
+    return key;
+}
+
+int ph_cache_key_file(const char *filepath, ph_cache_key_t *out_key) {
+    struct stat st;
+    if (stat(filepath, &st) != 0 || st.st_ino == 0)
+        return -1;
+
+    uint64_t mtime_ns = (uint64_t)st.st_mtime * 1000000000ULL;
+#if defined(__linux__)
+    mtime_ns += (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    /* Distinct seeds keep file identities apart from content fingerprints */
+    out_key->lo = avalanche(mix_round(mix_round(0x46494C45ULL, (uint64_t)st.st_dev),
+                                      (uint64_t)st.st_ino));
+    out_key->hi =
+        avalanche(mix_round(mix_round(PRIME3, (uint64_t)st.st_size), mtime_ns) ^ out_key->lo);
+    return 0;
+}
+
+// --- Table ---
+
+static size_t region_size(uint64_t capacity) {
+    return sizeof(cache_header_t) + (size_t)capacity * sizeof(cache_entry_t);
+}
+
+static int header_valid(const cache_header_t *h, uint64_t capacity) {
+    return memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) == 0 && h->version == CACHE_VERSION &&
+           h->entry_size == sizeof(cache_entry_t) && h->capacity == capacity;
+}
+
+static void header_init(cache_header_t *h, uint64_t capacity) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, CACHE_MAGIC, sizeof(h->magic));
+    h->version = CACHE_VERSION;
+    h->entry_size = sizeof(cache_entry_t);
+    h->capacity = capacity;
+}
+
+PH_API ph_error_t ph_cache_open(const char *path, size_t capacity, ph_cache_t **out_cache) {
+    if (!out_cache || capacity == 0)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    uint64_t slots = ((uint64_t)capacity + CACHE_WAYS - 1) / CACHE_WAYS * CACHE_WAYS;
+    size_t size = region_size(slots);
+
+    ph_cache_t *cache = ph_mem_calloc(NULL, 1, sizeof(ph_cache_t));
+    if (!cache)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    void *region = NULL;
+    if (!path) {
+        region = ph_mem_calloc(NULL, 1, size);
+        if (!region) {
+            ph_mem_free(NULL, cache);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        header_init(region, slots);
+    } else {
+#if defined(_WIN32)
+        ph_mem_free(NULL, cache);
+        return PH_ERR_NOT_IMPLEMENTED;
+#else
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            ph_mem_free(NULL, cache);
+            return PH_ERR_INVALID_ARGUMENT;
+        }
+        struct stat st;
+        int fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != size;
+        if (fresh && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)) {
+            close(fd);
+            ph_mem_free(NULL, cache);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (region == MAP_FAILED) {
+            ph_mem_free(NULL, cache);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        if (fresh || !header_valid(region, slots)) {
+            memset(region, 0, size);
+            header_init(region, slots);
+        }
+        cache->mapped = 1;
+#endif
+    }
+
+    cache->header = region;
+    cache->entries = (cache_entry_t *)((uint8_t *)region + sizeof(cache_header_t));
+    cache->nbuckets = (size_t)(slots / CACHE_WAYS);
+    cache->map_size = size;
+    ph_mutex_init(&cache->lock);
+
+    *out_cache = cache;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_cache_close(ph_cache_t *cache) {
+    if (!cache)
+        return;
+#if !defined(_WIN32)
+    if (cache->mapped)
+        munmap(cache->header, cache->map_size);
+    else
+#endif
+        ph_mem_free(NULL, cache->header);
+    ph_mutex_destroy(&cache->lock);
+    ph_mem_free(NULL, cache);
+}
+
+PH_API void ph_cache_get_stats(ph_cache_t *cache, ph_cache_stats_t *out_stats) {
+    if (!cache || !out_stats)
+        return;
+    ph_mutex_lock(&cache->lock);
+    const cache_header_t *h = cache->header;
+    out_stats->capacity = h->capacity;
+    out_stats->entries = h->entries;
+    out_stats->hits = h->hits;
+    out_stats->misses = h->misses;
+    out_stats->insertions = h->insertions;
+    out_stats->evictions = h->evictions;
+    ph_mutex_unlock(&cache->lock);
+}
+
+static inline int key_equal(ph_cache_key_t a, ph_cache_key_t b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+static cache_entry_t *bucket_of(ph_cache_t *cache, ph_cache_key_t key) {
+    return &cache->entries[(key.lo % cache->nbuckets) * CACHE_WAYS];
+}
+
+int ph_cache_lookup(ph_cache_t *cache, ph_cache_key_t key, ph_hashes_t *out) {
+    int hit = 0;
+    ph_mutex_lock(&cache->lock);
+    cache_entry_t *set = bucket_of(cache, key);
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        if ((set[w].flags & ENTRY_VALID) && key_equal(set[w].key, key)) {
+            set[w].flags |= ENTRY_REFERENCED;
+            *out = set[w].hashes;
+            hit = 1;
+            break;
+        }
+    }
+    if (hit)
+        cache->header->hits++;
+    else
+        cache->header->misses++;
+    ph_mutex_unlock(&cache->lock);
+    return hit;
+}
+
+void ph_cache_insert(ph_cache_t *cache, ph_cache_key_t key, const ph_hashes_t *hashes) {
+    ph_mutex_lock(&cache->lock);
+    cache_entry_t *set = bucket_of(cache, key);
+    cache_entry_t *slot = NULL;
+
+    for (int w = 0; w < CACHE_WAYS && !slot; w++) {
+        if ((set[w].flags & ENTRY_VALID) && key_equal(set[w].key, key))
+            slot = &set[w];
+    }
+    if (!slot) {
+        for (int w = 0; w < CACHE_WAYS && !slot; w++) {
+            if (!(set[w].flags & ENTRY_VALID)) {
+                slot = &set[w];
+                cache->header->entries++;
+            }
+        }
+        if (!slot) {
+            /* CLOCK within the set: the first entry not referenced since the
+             * last sweep is the victim; referenced ones get a second chance. */
+            for (int w = 0; w < 2 * CACHE_WAYS && !slot; w++) {
+                cache_entry_t *e = &set[w % CACHE_WAYS];
+                if (e->flags & ENTRY_REFERENCED)
+                    e->flags &= ~ENTRY_REFERENCED;
+                else
+                    slot = e;
+            }
+            cache->header->evictions++;
+        }
+        cache->header->insertions++;
+        slot->key = key;
+    }
+    slot->flags = ENTRY_VALID | ENTRY_REFERENCED;
+    slot->hashes = *hashes;
+    ph_mutex_unlock(&cache->lock);
+}
+
+// --- Context Integration ---
+
+static void *result_field(ph_hashes_t *h, ph_algo_t algo, size_t *size) {
+    *size = sizeof(uint64_t);
+    switch (algo) {
+        case PH_ALGO_AHASH:
+            return &h->ahash;
+        case PH_ALGO_DHASH:
+            return &h->dhash;
+        case PH_ALGO_PHASH:
+            return &h->phash;
+        case PH_ALGO_WHASH:
+            return &h->whash;
+        case PH_ALGO_MHASH:
+            return &h->mhash;
+        default:
+            break;
+    }
+    *size = sizeof(ph_digest_t);
+    switch (algo) {
+        case PH_ALGO_BMH:
+            return &h->bmh;
+        case PH_ALGO_COLOR:
+            return &h->color;
+        case PH_ALGO_RADIAL:
+            return &h->radial;
+        default:
+            return NULL;
+    }
+}
+
+int ph_cache_fetch(const ph_context_t *ctx, ph_algo_t algo, void *out) {
+    if (!(ctx->cached.mask & (uint32_t)algo))
+        return 0;
+    size_t size;
+    void *field = result_field((ph_hashes_t *)&ctx->cached, algo, &size);
+    memcpy(out, field, size);
+    return 1;
+}
+
+void ph_cache_store(ph_context_t *ctx, ph_algo_t algo, const void *result) {
+    if (!ctx->cache || !ctx->has_cache_key)
+        return;
+    size_t size;
+    void *field = result_field(&ctx->cached, algo, &size);
+    if (!field)
+        return;
+    memcpy(field, result, size);
+    ctx->cached.mask |= (uint32_t)algo;
+    ph_cache_insert(ctx->cache, ctx->cache_key, &ctx->cached);
+}
+
+PH_API void ph_context_set_cache(ph_context_t *ctx, ph_cache_t *cache) {
+    if (!ctx)
+        return;
+    ctx->cache = cache;
+    /* Results of the current image are not tied to the new table */
+    ctx->has_cache_key = 0;
+}
@@ -0,0 +1,150 @@
+#include "internal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Verification cascade.
+ *
+ * The undecided candidates are kept as a list of indexes. Each stage makes
+ * one pass over the list, comparing integer distances (Hamming, or squared
+ * L2 on digest bytes) against integer limits, moves early accepts to the
+ * output and compacts the rest in place.
+ */
+
+/* Largest integer distance within 'max', or -1 when nothing is */
+static int64_t raw_limit(double max) {
+    if (!(max >= 0.0))
+        return -1;
+    double limit = floor(max + 1e-9);
+    return limit >= (double)INT64_MAX ? INT64_MAX : (int64_t)limit;
+}
+
+static int compare_index(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int single_algo(ph_algo_t algo) {
+    uint32_t bits = (uint32_t)algo;
+    return bits != 0 && (bits & (bits - 1)) == 0 && (bits & ~PH_ALGO_ALL) == 0;
+}
+
+static ph_error_t compute_query(ph_context_t *ctx, ph_algo_t algo, ph_hashes_t *query) {
+    if (query->mask & algo)
+        return PH_SUCCESS;
+
+    ph_error_t err;
+    uint64_t *u64 = ph_hashes_u64(query, algo);
+    if (u64) {
+        err = ph_compute_u64(ctx, algo, u64);
+    } else {
+        ph_digest_t *digest = ph_hashes_digest(query, algo);
+        if (algo == PH_ALGO_BMH)
+            err = ph_compute_bmh(ctx, digest);
+        else if (algo == PH_ALGO_COLOR)
+            err = ph_compute_color_hash(ctx, digest);
+        else
+            err = ph_compute_radial_hash(ctx, digest);
+    }
+    if (err == PH_SUCCESS)
+        query->mask |= algo;
+    return err;
+}
+
+typedef enum { HAMMING_U64, HAMMING_DIGEST, L2_DIGEST } metric_t;
+
+/* Integer distance of a candidate, or -1 when the digests cannot be
+ * compared. 'offset' locates the stage's field in ph_hashes_t. */
+static inline int64_t distance(metric_t metric, size_t offset, const ph_hashes_t *query,
+                               const ph_hashes_t *candidate) {
+    const uint8_t *q = (const uint8_t *)query + offset;
+    const uint8_t *c = (const uint8_t *)candidate + offset;
+    if (metric == HAMMING_U64)
+        return ph_hamming_distance(*(const uint64_t *)q, *(const uint64_t *)c);
+
+    const ph_digest_t *qd = (const ph_digest_t *)q, *cd = (const ph_digest_t *)c;
+    if (qd->size != cd->size)
+        return -1;
+    if (metric == HAMMING_DIGEST)
+        return ph_hamming_distance_digest(qd, cd);
+    return ph_l2_sq_u8(qd->data, cd->data, qd->size);
+}
+
+PH_API ph_error_t ph_query_cascade(ph_context_t *ctx, ph_hashes_t *query,
+                                   const ph_hashes_t *candidates, size_t n,
+                                   const ph_cascade_stage_t *stages, size_t nstages,
+                                   uint32_t *out_matches, size_t *out_count) {
+    if (!ctx || !ctx->is_loaded || (!candidates && n > 0) || (!stages && nstages > 0) ||
+        (!out_matches && n > 0) || !out_count || n > UINT32_MAX)
+        return PH_ERR_INVALID_ARGUMENT;
+    for (size_t s = 0; s < nstages; s++) {
+        if (!single_algo(stages[s].algo))
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+
+    ph_hashes_t local;
+    if (!query) {
+        memset(&local, 0, sizeof(local));
+        query = &local;
+    }
+    *out_count = 0;
+    if (n == 0)
+        return PH_SUCCESS;
+
+    uint32_t *alive = ph_mem_alloc(NULL, n * sizeof(uint32_t));
+    if (!alive)
+        return PH_ERR_ALLOCATION_FAILED;
+    for (size_t i = 0; i < n; i++)
+        alive[i] = (uint32_t)i;
+
+    size_t live = n, matched = 0;
+    ph_error_t err = PH_SUCCESS;
+    for (size_t s = 0; s < nstages && live > 0; s++) {
+        ph_algo_t algo = stages[s].algo;
+        int l2 = algo == PH_ALGO_COLOR || algo == PH_ALGO_RADIAL;
+        metric_t metric = l2 ? L2_DIGEST : algo == PH_ALGO_BMH ? HAMMING_DIGEST : HAMMING_U64;
+        double max = stages[s].max_distance, accept = stages[s].accept_distance;
+        int64_t max_raw = raw_limit(l2 && max >= 0.0 ? max * max : max);
+        int64_t accept_raw = raw_limit(l2 && accept >= 0.0 ? accept * accept : accept);
+
+        size_t holders = 0;
+        for (size_t i = 0; i < live && !holders; i++)
+            holders += (candidates[alive[i]].mask & algo) != 0;
+        if (!holders)
+            continue;
+        err = compute_query(ctx, algo, query);
+        if (err != PH_SUCCESS)
+            break;
+        const uint8_t *field = metric == HAMMING_U64
+                                   ? (const uint8_t *)ph_hashes_u64(query, algo)
+                                   : (const uint8_t *)ph_hashes_digest(query, algo);
+        size_t offset = (size_t)(field - (const uint8_t *)query);
+
+        size_t kept = 0;
+        for (size_t i = 0; i < live; i++) {
+            uint32_t idx = alive[i];
+            if (!(candidates[idx].mask & algo)) {
+                alive[kept++] = idx;
+                continue;
+            }
+            int64_t d = distance(metric, offset, query, &candidates[idx]);
+            if (d < 0 || d > max_raw)
+                continue;
+            if (d <= accept_raw)
+                out_matches[matched++] = idx;
+            else
+                alive[kept++] = idx;
+        }
+        live = kept;
+    }
+
+    if (err == PH_SUCCESS) {
+        memcpy(out_matches + matched, alive, live * sizeof(uint32_t));
+        matched += live;
+        qsort(out_matches, matched, sizeof(uint32_t), compare_index);
+        *out_count = matched;
+    }
+    ph_mem_free(NULL, alive);
+    return err;
+}
@@ -0,0 +1,494 @@
+#include "internal.h"
+#include "thread.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Near-duplicate clustering by permuted block tables (Manku et al.).
+ *
+ * Pigeonhole principle: if the bits are split into m disjoint blocks, two
+ * hashes within max_dist differ in at most max_dist blocks, so they agree
+ * exactly on at least k = m - max_dist of them. For every choice of k blocks
+ * (a "table") the deduplicated hashes are radix-sorted by the concatenated
+ * block bits; only hashes sharing a run of equal keys are verified, in
+ * parallel, and merged in a lock-free union-find. m is picked from a cost
+ * model so that keys are wide enough to keep runs short for the given n.
+ * Memory stays linear in n.
+ */
+
+/* Sorted positions claimed by a verification worker at a time */
+#define VERIFY_CHUNK 4096
+/* Upper bound on the number of tables a plan may use */
+#define MAX_TABLES 4096
+
+// --- Concurrent Union-Find ---
+
+static uint32_t uf_find(_Atomic uint32_t *parent, uint32_t x) {
+    for (;;) {
+        uint32_t p = atomic_load_explicit(&parent[x], memory_order_relaxed);
+        if (p == x)
+            return x;
+        uint32_t gp = atomic_load_explicit(&parent[p], memory_order_relaxed);
+        if (gp != p) {
+            /* Path halving; a lost race only skips a shortcut */
+            atomic_compare_exchange_weak_explicit(&parent[x], &p, gp, memory_order_relaxed,
+                                                  memory_order_relaxed);
+        }
+        x = gp;
+    }
+}
+
+static void uf_union(_Atomic uint32_t *parent, uint32_t a, uint32_t b) {
+    for (;;) {
+        a = uf_find(parent, a);
+        b = uf_find(parent, b);
+        if (a == b)
+            return;
+        /* Always hang the larger root under the smaller: no cycles, and the
+         * root of a set is its smallest index */
+        if (a > b) {
+            uint32_t t = a;
+            a = b;
+            b = t;
+        }
+        uint32_t expected = b;
+        if (atomic_compare_exchange_strong_explicit(&parent[b], &expected, a, memory_order_acq_rel,
+                                                    memory_order_relaxed))
+            return;
+    }
+}
+
+// --- Radix Sort ---
+
+/* LSD radix sort of (key, id) pairs on the low 'key_bits' bits of 'keys'.
+ * Result ends up in 'keys'/'ids'; 'tk'/'ti' are scratch of the same size. */
+static void radix_sort_pairs(uint64_t *keys, uint32_t *ids, uint64_t *tk, uint32_t *ti, size_t n,
+                             int key_bits) {
+    uint64_t *out_keys = keys;
+    uint32_t *out_ids = ids;
+    int passes = 0;
+
+    for (int shift = 0; shift < key_bits; shift += 8, passes++) {
+        size_t count[257] = {0};
+        for (size_t i = 0; i < n; i++)
+            count[((keys[i] >> shift) & 0xFF) + 1]++;
+        for (int d = 0; d < 256; d++)
+            count[d + 1] += count[d];
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = count[(keys[i] >> shift) & 0xFF]++;
+            tk[pos] = keys[i];
+            ti[pos] = ids[i];
+        }
+        uint64_t *sk = keys;
+        uint32_t *si = ids;
+        keys = tk;
+        ids = ti;
+        tk = sk;
+        ti = si;
+    }
+    if (passes & 1) {
+        memcpy(out_keys, keys, n * sizeof(uint64_t));
+        memcpy(out_ids, ids, n * sizeof(uint32_t));
+    }
+}
+
+// --- Bit Blocks ---
+
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Reads 'len' (<= 64) bits starting at bit 'start' of a little-endian byte string */
+static uint64_t read_bits(const uint8_t *data, int start, int len) {
+    uint64_t v = 0;
+    for (int i = 0; i < len; i++) {
+        int bit = start + i;
+        v |= (uint64_t)((data[bit >> 3] >> (bit & 7)) & 1) << i;
+    }
+    return v;
+}
+
+/* Sort key of block [start, start + len) of a digest: exact up to 64 bits,
+ * a hash of the bits beyond that (equal blocks still give equal keys). */
+static uint64_t digest_block_key(const ph_digest_t *d, int start, int len) {
+    if (len <= 64)
+        return read_bits(d->data, start, len);
+    uint64_t h = 0;
+    for (int off = 0; off < len; off += 64) {
+        int chunk = (len - off < 64) ? len - off : 64;
+        h = mix64(h ^ read_bits(d->data, start + off, chunk));
+    }
+    return h;
+}
+
+// --- Table Plan ---
+
+typedef struct {
+    int nbits;
+    int blocks; /* m */
+    int keep;   /* k: blocks that must match exactly */
+    int start[PH_DIGEST_MAX_BYTES * 8 + 1]; /* Block b covers [start[b], start[b + 1]) */
+} table_plan_t;
+
+static double binomial(int m, int k) {
+    double r = 1.0;
+    for (int i = 1; i <= k; i++)
+        r = r * (m - k + i) / i;
+    return r;
+}
+
+/* Relative cost of one radix pass per element (cache-missing scatter) versus
+ * one candidate-pair distance check */
+#define SORT_PASS_COST 8.0
+
+/* Estimated work of a plan for n uniformly spread hashes: sorting plus the
+ * pairs expected to share a key by chance, for every table. */
+static double plan_cost(double n, int nbits, int m, int k) {
+    double key_bits = (double)k * nbits / m;
+    if (key_bits > 64)
+        key_bits = 64;
+    double passes = ceil(key_bits / 8);
+    double per_table = n * (SORT_PASS_COST * passes + 2.0) + n * n / 2.0 / pow(2.0, key_bits);
+    return binomial(m, k) * per_table;
+}
+
+static void plan_tables(table_plan_t *plan, size_t n, int nbits, int max_dist) {
+    int best_m = max_dist + 1;
+    double best_cost = plan_cost((double)n, nbits, best_m, 1);
+    for (int m = max_dist + 2; m <= nbits; m++) {
+        int k = m - max_dist;
+        if (binomial(m, k) > MAX_TABLES)
+            break;
+        double cost = plan_cost((double)n, nbits, m, k);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_m = m;
+        }
+    }
+    plan->nbits = nbits;
+    plan->blocks = best_m;
+    plan->keep = best_m - max_dist;
+    for (int b = 0; b <= best_m; b++)
+        plan->start[b] = b * nbits / best_m;
+}
+
+/* Advances 'comb' (k ascending indices below m) to the next combination */
+static int next_combination(int *comb, int k, int m) {
+    int i = k - 1;
+    while (i >= 0 && comb[i] == m - k + i)
+        i--;
+    if (i < 0)
+        return 0;
+    comb[i]++;
+    for (int j = i + 1; j < k; j++)
+        comb[j] = comb[j - 1] + 1;
+    return 1;
+}
+
+static int table_key_bits(const table_plan_t *plan, const int *comb) {
+    int bits = 0;
+    for (int j = 0; j < plan->keep; j++)
+        bits += plan->start[comb[j] + 1] - plan->start[comb[j]];
+    return bits;
+}
+
+static uint64_t u64_table_key(const table_plan_t *plan, const int *comb, uint64_t v) {
+    uint64_t key = 0;
+    for (int j = 0; j < plan->keep; j++) {
+        int start = plan->start[comb[j]];
+        int len = plan->start[comb[j] + 1] - start;
+        uint64_t mask = (len == 64) ? ~0ULL : ((1ULL << len) - 1);
+        key = (len == 64 ? 0 : key << len) | ((v >> start) & mask);
+    }
+    return key;
+}
+
+static uint64_t digest_table_key(const table_plan_t *plan, const int *comb, const ph_digest_t *d,
+                                 int key_bits) {
+    uint64_t key = 0;
+    for (int j = 0; j < plan->keep; j++) {
+        int start = plan->start[comb[j]];
+        int len = plan->start[comb[j] + 1] - start;
+        uint64_t part = digest_block_key(d, start, len);
+        if (key_bits > 64)
+            key = mix64(key ^ part);
+        else
+            key = (len == 64 ? 0 : key << len) | part;
+    }
+    return key;
+}
+
+// --- Parallel Verification ---
+
+typedef struct {
+    const uint64_t *values;     /* u64 mode: hash values in block-key order */
+    const ph_digest_t *digests; /* digest mode: input digests */
+    const uint32_t *rep_index;  /* Representative -> input index */
+    const uint64_t *keys;       /* Sorted block keys */
+    const uint32_t *order;      /* Representatives in block-key order */
+    size_t nreps;
+    int max_dist;
+    _Atomic uint32_t *parent;
+    atomic_size_t cursor;
+} verify_job_t;
+
+static void verify_run(verify_job_t *job, size_t begin, size_t end) {
+    const uint32_t *order = job->order;
+    const uint32_t *rep_index = job->rep_index;
+
+    if (job->values) {
+        const uint64_t *v = job->values;
+        const int max_dist = job->max_dist;
+        for (size_t a = begin; a < end; a++) {
+            const uint64_t va = v[a];
+            for (size_t b = a + 1; b < end; b++) {
+                if (popcount64(va ^ v[b]) <= max_dist)
+                    uf_union(job->parent, rep_index[order[a]], rep_index[order[b]]);
+            }
+        }
+        return;
+    }
+
+    for (size_t a = begin; a < end; a++) {
+        uint32_t ia = rep_index[order[a]];
+        for (size_t b = a + 1; b < end; b++) {
+            uint32_t ib = rep_index[order[b]];
+            if (ph_hamming_distance_digest(&job->digests[ia], &job->digests[ib]) <= job->max_dist)
+                uf_union(job->parent, ia, ib);
+        }
+    }
+}
+
+static void verify_worker(void *arg) {
+    verify_job_t *job = arg;
+    const uint64_t *keys = job->keys;
+    size_t n = job->nreps;
+
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->cursor, VERIFY_CHUNK);
+        if (start >= n)
+            break;
+        size_t end = (start + VERIFY_CHUNK < n) ? start + VERIFY_CHUNK : n;
+        /* Each run is handled by the worker whose chunk contains its start */
+        for (size_t i = start; i < end; i++) {
+            if (i > 0 && keys[i] == keys[i - 1])
+                continue;
+            size_t j = i + 1;
+            while (j < n && keys[j] == keys[i])
+                j++;
+            if (j - i > 1)
+                verify_run(job, i, j);
+        }
+    }
+}
+
+static void run_verification(verify_job_t *job, int threads) {
+    atomic_store(&job->cursor, 0);
+    ph_thread_t *pool = NULL;
+    int started = 0;
+    if (threads > 1)
+        pool = ph_mem_alloc(NULL, (size_t)(threads - 1) * sizeof(ph_thread_t));
+    for (int t = 0; pool && t < threads - 1; t++) {
+        if (ph_thread_create(&pool[t], verify_worker, job) != 0)
+            break;
+        started++;
+    }
+    verify_worker(job);
+    for (int t = 0; t < started; t++)
+        ph_thread_join(pool[t]);
+    ph_mem_free(NULL, pool);
+}
+
+// --- Driver ---
+
+typedef struct {
+    uint64_t *keys;
+    uint32_t *ids;
+    uint64_t *tmp_keys;
+    uint32_t *tmp_ids;
+    uint32_t *rep_index;
+    uint64_t *values;
+    _Atomic uint32_t *parent;
+} cluster_buffers_t;
+
+static void free_buffers(cluster_buffers_t *b) {
+    ph_mem_free(NULL, b->keys);
+    ph_mem_free(NULL, b->ids);
+    ph_mem_free(NULL, b->tmp_keys);
+    ph_mem_free(NULL, b->tmp_ids);
+    ph_mem_free(NULL, b->rep_index);
+    ph_mem_free(NULL, b->values);
+    ph_mem_free(NULL, (void *)b->parent);
+}
+
+static int alloc_buffers(cluster_buffers_t *b, size_t n, int with_values) {
+    memset(b, 0, sizeof(*b));
+    b->keys = ph_mem_alloc(NULL, n * sizeof(uint64_t));
+    b->ids = ph_mem_alloc(NULL, n * sizeof(uint32_t));
+    b->tmp_keys = ph_mem_alloc(NULL, n * sizeof(uint64_t));
+    b->tmp_ids = ph_mem_alloc(NULL, n * sizeof(uint32_t));
+    b->rep_index = ph_mem_alloc(NULL, n * sizeof(uint32_t));
+    b->values = with_values ? ph_mem_alloc(NULL, n * sizeof(uint64_t)) : NULL;
+    b->parent = ph_mem_alloc(NULL, n * sizeof(_Atomic uint32_t));
+    if (!b->keys || !b->ids || !b->tmp_keys || !b->tmp_ids || !b->rep_index || !b->parent ||
+        (with_values && !b->values)) {
+        free_buffers(b);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+        atomic_init(&b->parent[i], (uint32_t)i);
+    return 0;
+}
+
+/* Turns the union-find forest into dense labels in order of first appearance */
+static void write_labels(_Atomic uint32_t *parent, size_t n, uint32_t *out_labels) {
+    uint32_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t root = uf_find(parent, (uint32_t)i);
+        /* Roots are the smallest index of their set, so already labelled */
+        out_labels[i] = (root == i) ? next++ : out_labels[root];
+    }
+}
+
+static int check_args(size_t n, int max_dist, int *threads, const void *in, const void *out) {
+    if (!in || !out || max_dist < 0 || *threads < 0 || n > UINT32_MAX)
+        return -1;
+    if (*threads == 0)
+        *threads = ph_cpu_count();
+    return 0;
+}
+
+/* Runs every table of the plan over the deduplicated representatives */
+static void run_tables(cluster_buffers_t *b, const ph_digest_t *digests, size_t nreps,
+                       int nbits, int max_dist, int threads) {
+    table_plan_t plan;
+    plan_tables(&plan, nreps, nbits, max_dist);
+
+    verify_job_t job = {0};
+    job.values = digests ? NULL : b->tmp_keys;
+    job.digests = digests;
+    job.rep_index = b->rep_index;
+    job.keys = b->keys;
+    job.order = b->ids;
+    job.nreps = nreps;
+    job.max_dist = max_dist;
+    job.parent = b->parent;
+
+    int comb[PH_DIGEST_MAX_BYTES * 8];
+    for (int j = 0; j < plan.keep; j++)
+        comb[j] = j;
+    do {
+        int key_bits = table_key_bits(&plan, comb);
+        for (size_t r = 0; r < nreps; r++) {
+            b->keys[r] =
+                digests ? digest_table_key(&plan, comb, &digests[b->rep_index[r]], key_bits)
+                        : u64_table_key(&plan, comb, b->values[r]);
+            b->ids[r] = (uint32_t)r;
+        }
+        radix_sort_pairs(b->keys, b->ids, b->tmp_keys, b->tmp_ids, nreps,
+                         key_bits > 64 ? 64 : key_bits);
+        if (!digests) {
+            /* Lay the values out in key order so runs are scanned contiguously */
+            for (size_t i = 0; i < nreps; i++)
+                b->tmp_keys[i] = b->values[b->ids[i]];
+        }
+        run_verification(&job, threads);
+    } while (next_combination(comb, plan.keep, plan.blocks));
+}
+
+PH_API ph_error_t ph_cluster_u64(const uint64_t *hashes, size_t n, int max_dist, int threads,
+                                 uint32_t *out_labels) {
+    if (check_args(n, max_dist, &threads, hashes, out_labels) != 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (n == 0)
+        return PH_SUCCESS;
+    if (max_dist >= 64) {
+        memset(out_labels, 0, n * sizeof(uint32_t));
+        return PH_SUCCESS;
+    }
+
+    cluster_buffers_t b;
+    if (alloc_buffers(&b, n, 1) != 0)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    /* Collapse exact duplicates first so long runs of identical hashes
+     * never reach the quadratic verification */
+    for (size_t i = 0; i < n; i++) {
+        b.keys[i] = hashes[i];
+        b.ids[i] = (uint32_t)i;
+    }
+    radix_sort_pairs(b.keys, b.ids, b.tmp_keys, b.tmp_ids, n, 64);
+    size_t nreps = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && b.keys[i] == b.keys[i - 1]) {
+            uf_union(b.parent, b.rep_index[nreps - 1], b.ids[i]);
+            continue;
+        }
+        b.values[nreps] = b.keys[i];
+        b.rep_index[nreps++] = b.ids[i];
+    }
+
+    if (max_dist > 0)
+        run_tables(&b, NULL, nreps, 64, max_dist, threads);
+
+    write_labels(b.parent, n, out_labels);
+    free_buffers(&b);
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_cluster_digest(const ph_digest_t *digests, size_t n, int max_dist,
+                                    int threads, uint32_t *out_labels) {
+    if (check_args(n, max_dist, &threads, digests, out_labels) != 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (n == 0)
+        return PH_SUCCESS;
+
+    int size = digests[0].size;
+    if (size == 0 || size > PH_DIGEST_MAX_BYTES)
+        return PH_ERR_INVALID_ARGUMENT;
+    for (size_t i = 1; i < n; i++) {
+        if (digests[i].size != size)
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+    int nbits = size * 8;
+    if (max_dist >= nbits) {
+        memset(out_labels, 0, n * sizeof(uint32_t));
+        return PH_SUCCESS;
+    }
+
+    cluster_buffers_t b;
+    if (alloc_buffers(&b, n, 0) != 0)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    /* Collapse exact duplicates (by whole-digest key, confirmed bytewise) */
+    for (size_t i = 0; i < n; i++) {
+        b.keys[i] = digest_block_key(&digests[i], 0, nbits);
+        b.ids[i] = (uint32_t)i;
+    }
+    radix_sort_pairs(b.keys, b.ids, b.tmp_keys, b.tmp_ids, n, 64);
+    size_t nreps = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && b.keys[i] == b.keys[i - 1]) {
+            uint32_t rep = b.rep_index[nreps - 1];
+            if (memcmp(digests[rep].data, digests[b.ids[i]].data, (size_t)size) == 0) {
+                uf_union(b.parent, rep, b.ids[i]);
+                continue;
+            }
+        }
+        b.rep_index[nreps++] = b.ids[i];
+    }
+
+    /* Hash collisions between distinct digests are resolved by the tables */
+    run_tables(&b, digests, nreps, nbits, max_dist, threads);
+
+    write_labels(b.parent, n, out_labels);
+    free_buffers(&b);
+    return PH_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "internal.h"
+#include <string.h>
+
+PH_API ph_error_t ph_compute_hashes(ph_context_t *ctx, uint32_t algo_mask, ph_hashes_t *out) {
+    if (!ctx || !ctx->is_loaded || !out || (algo_mask & ~PH_ALGO_ALL) != 0)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    memset(out, 0, sizeof(*out));
+
+    ph_error_t err = PH_SUCCESS;
+#define PH_RUN(bit, call)                                                                          \
+    if (algo_mask & (bit)) {                                                                       \
+        err = (call);                                                                              \
+        if (err != PH_SUCCESS)                                                                     \
+            return err;                                                                            \
+        out->mask |= (bit);                                                                        \
+    }
+
+    PH_RUN(PH_ALGO_AHASH, ph_compute_ahash(ctx, &out->ahash));
+    PH_RUN(PH_ALGO_DHASH, ph_compute_dhash(ctx, &out->dhash));
+    PH_RUN(PH_ALGO_PHASH, ph_compute_phash(ctx, &out->phash));
+    PH_RUN(PH_ALGO_WHASH, ph_compute_whash(ctx, &out->whash));
+    PH_RUN(PH_ALGO_MHASH, ph_compute_mhash(ctx, &out->mhash));
+    PH_RUN(PH_ALGO_BMH, ph_compute_bmh(ctx, &out->bmh));
+    PH_RUN(PH_ALGO_COLOR, ph_compute_color_hash(ctx, &out->color));
+    PH_RUN(PH_ALGO_RADIAL, ph_compute_radial_hash(ctx, &out->radial));
+
+#undef PH_RUN
+    return err;
+}
+
+ph_error_t ph_compute_u64(ph_context_t *ctx, ph_algo_t algo, uint64_t *out_hash) {
+    switch (algo) {
+        case PH_ALGO_AHASH:
+            return ph_compute_ahash(ctx, out_hash);
+        case PH_ALGO_DHASH:
+            return ph_compute_dhash(ctx, out_hash);
+        case PH_ALGO_PHASH:
+            return ph_compute_phash(ctx, out_hash);
+        case PH_ALGO_WHASH:
+            return ph_compute_whash(ctx, out_hash);
+        case PH_ALGO_MHASH:
+            return ph_compute_mhash(ctx, out_hash);
+        default:
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+}
+
+uint64_t *ph_hashes_u64(ph_hashes_t *hashes, ph_algo_t algo) {
+    switch (algo) {
+        case PH_ALGO_AHASH:
+            return &hashes->ahash;
+        case PH_ALGO_DHASH:
+            return &hashes->dhash;
+        case PH_ALGO_PHASH:
+            return &hashes->phash;
+        case PH_ALGO_WHASH:
+            return &hashes->whash;
+        case PH_ALGO_MHASH:
+            return &hashes->mhash;
+        default:
+            return NULL;
+    }
+}
+
+ph_digest_t *ph_hashes_digest(ph_hashes_t *hashes, ph_algo_t algo) {
+    switch (algo) {
+        case PH_ALGO_BMH:
+            return &hashes->bmh;
+        case PH_ALGO_COLOR:
+            return &hashes->color;
+        case PH_ALGO_RADIAL:
+            return &hashes->radial;
+        default:
+            return NULL;
+    }
+}
@@ -1,16 +1,40 @@
 #include "internal.h"
+#include "tables.h"
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define STB_IMAGE_IMPLEMENTATION
+#define STBI_MALLOC(size) ph_decode_malloc(size)
+#define STBI_REALLOC_SIZED(ptr, old_size, new_size) ph_decode_realloc(ptr, old_size, new_size)
+#define STBI_FREE(ptr) ph_decode_free(ptr)
 #include "../vendor/stb_image.h"
 
 PH_API const char *ph_version(void) { return "1.2.0"; }
 
+/* Cached results depend on the gamma LUT and on how images are decoded: key
+ * them by both, and stop reusing results already fetched for the current
+ * image */
+static void update_cache_salt(ph_context_t *ctx) {
+    ctx->cache_salt = ph_cache_key_memory(ctx->gamma_lut, sizeof(ctx->gamma_lut)).lo;
+    ctx->cache_salt ^= ((uint64_t)ctx->min_width << 32 | (uint32_t)ctx->min_height) *
+                       0x9E3779B97F4A7C15ULL;
+    ctx->cache_salt ^= (uint64_t)ctx->load_flags * 0xC2B2AE3D27D4EB4FULL;
+    ctx->has_cache_key = 0;
+    ctx->cached.mask = 0;
+}
+
 PH_API void ph_context_set_gamma(ph_context_t *ctx, float gamma) {
     if (!ctx || gamma <= 0.001f)
         return;
 
+    if (gamma == PH_DEFAULT_GAMMA) {
+        memcpy(ctx->gamma_lut, ph_default_gamma_lut, sizeof(ctx->gamma_lut));
+        update_cache_salt(ctx);
+        return;
+    }
+
     // Precompute LUT for O(1) access during processing
     for (int i = 0; i < 256; i++) {
         double val = i / 255.0;
@@ -18,18 +42,33 @@ PH_API void ph_context_set_gamma(ph_context_t *ctx, float gamma) {
         double res = pow(val, 1.0 / (double)gamma) * 255.0;
         ctx->gamma_lut[i] = (uint8_t)(res > 255.0 ? 255.0 : res);
     }
+
+    update_cache_salt(ctx);
+}
+
+PH_API void ph_context_set_min_resolution(ph_context_t *ctx, int min_width, int min_height) {
+    if (!ctx)
+        return;
+    ctx->min_width = min_width > 0 ? min_width : 0;
+    ctx->min_height = min_height > 0 ? min_height : 0;
+    update_cache_salt(ctx);
+}
+
+PH_API void ph_context_set_load_flags(ph_context_t *ctx, uint32_t flags) {
+    if (!ctx)
+        return;
+    ctx->load_flags = flags;
+    update_cache_salt(ctx);
 }
 
 PH_API ph_error_t ph_create(ph_context_t **out_ctx) {
     if (!out_ctx)
         return PH_ERR_INVALID_ARGUMENT;
 
-    ph_context_t *ctx = (ph_context_t *)calloc(1, sizeof(ph_context_t));
+    ph_context_t *ctx = (ph_context_t *)ph_mem_calloc(NULL, 1, sizeof(ph_context_t));
     if (!ctx)
         return PH_ERR_ALLOCATION_FAILED;
 
-    init_dct_matrix();
-
     ctx->data = NULL;
     ctx->gray_data = NULL;
     ctx->width = 0;
@@ -37,46 +76,311 @@ PH_API ph_error_t ph_create(ph_context_t **out_ctx) {
     ctx->channels = 0;
     ctx->is_loaded = 0;
 
-    ph_context_set_gamma(ctx, 2.2f);
+    ph_context_set_gamma(ctx, PH_DEFAULT_GAMMA);
 
     *out_ctx = ctx;
     return PH_SUCCESS;
 }
+void ph_release_image(ph_context_t *ctx) {
+    const ph_allocator_t *previous = ph_set_decode_allocator(PH_CTX_ALLOC(ctx));
+    if (ctx->frames)
+        stbi_image_free(ctx->frames);
+    else if (ctx->data && ctx->release_pixels)
+        ctx->release_pixels(ctx->release_user_data, ctx->data);
+    else if (ctx->data)
+        stbi_image_free(ctx->data);
+    if (ctx->frame_delays)
+        stbi_image_free(ctx->frame_delays);
+    ph_set_decode_allocator(previous);
+    ph_invalidate_pyramid(ctx);
+    ctx->release_pixels = NULL;
+    ctx->release_user_data = NULL;
+    ctx->frames = NULL;
+    ctx->frame_delays = NULL;
+    ctx->frame_count = 0;
+    ctx->frame_index = 0;
+    ctx->data = NULL;
+    ctx->gray_data = NULL;
+    ctx->width = 0;
+    ctx->height = 0;
+    ctx->channels = 0;
+    ctx->is_loaded = 0;
+    ctx->source = PH_SOURCE_NONE;
+    ctx->has_cache_key = 0;
+    ctx->cached.mask = 0;
+    ctx->deferred = 0;
+}
+
+void ph_context_reset(ph_context_t *ctx, const ph_context_t *defaults) {
+    ph_release_image(ctx);
+    memcpy(ctx->gamma_lut, defaults->gamma_lut, sizeof(ctx->gamma_lut));
+    ctx->cache_salt = defaults->cache_salt;
+    ctx->cache = NULL;
+    ctx->min_width = defaults->min_width;
+    ctx->min_height = defaults->min_height;
+    ctx->load_flags = defaults->load_flags;
+    if (ctx->has_allocator || defaults->has_allocator) {
+        // Buffers kept so far belong to the allocator being replaced
+        ph_context_trim_buffers(ctx);
+        ctx->allocator = defaults->allocator;
+        ctx->has_allocator = defaults->has_allocator;
+    }
+}
+
+void ph_context_trim_buffers(ph_context_t *ctx) {
+    const ph_allocator_t *a = PH_CTX_ALLOC(ctx);
+    ph_mem_free(a, ctx->deferred_path);
+    ph_mem_free(a, ctx->deferred_buf);
+    ph_mem_free(a, ctx->pyramid);
+    ph_mem_free(a, ctx->sat);
+    ph_mem_free(a, ctx->gray_buf);
+    ctx->deferred_path = NULL;
+    ctx->deferred_buf = NULL;
+    ctx->deferred_cap = 0;
+    ctx->pyramid = NULL;
+    ctx->pyramid_cap = 0;
+    ctx->sat = NULL;
+    ctx->sat_cap = 0;
+    ctx->gray_buf = NULL;
+    ctx->gray_cap = 0;
+}
+
+PH_API void ph_context_trim(ph_context_t *ctx) {
+    if (!ctx)
+        return;
+    ph_release_image(ctx);
+    ph_context_trim_buffers(ctx);
+}
+
+PH_API ph_error_t ph_context_set_allocator(ph_context_t *ctx, const ph_allocator_t *allocator) {
+    if (!ctx || (allocator && !ph_valid_allocator(allocator)))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_context_trim(ctx);
+    ctx->has_allocator = allocator != NULL;
+    if (allocator)
+        ctx->allocator = *allocator;
+    return PH_SUCCESS;
+}
+
 PH_API void ph_free(ph_context_t *ctx) {
     if (ctx) {
-        if (ctx->data)
-            stbi_image_free(ctx->data);
-        if (ctx->gray_data)
-            free(ctx->gray_data);
-        free(ctx);
+        ph_context_trim(ctx);
+        ph_mem_free(NULL, ctx);
     }
 }
 
-PH_API ph_error_t ph_load_from_file(ph_context_t *ctx, const char *filepath) {
-    if (!ctx || !filepath)
-        return PH_ERR_INVALID_ARGUMENT;
-    if (ctx->data)
-        stbi_image_free(ctx->data);
+PH_API ph_load_source_t ph_get_load_source(const ph_context_t *ctx) {
+    return ctx ? ctx->source : PH_SOURCE_NONE;
+}
+
+/* Number of channels to request from stb_image (0: as stored) */
+static int wanted_channels(const ph_context_t *ctx) {
+    return (ctx->load_flags & PH_LOAD_GRAY_ONLY) ? 1 : 0;
+}
+
+/* Smallest thumbnail accepted by PH_LOAD_EXIF_THUMBNAIL: the minimum
+ * resolution when one is set, else the 32x32 the uint64_t hashes need */
+#define THUMBNAIL_MIN_SIDE 32
 
-    ctx->data = stbi_load(filepath, &ctx->width, &ctx->height, &ctx->channels, 0);
+/* Decodes the embedded thumbnail instead of the image when it is large
+ * enough and has the image's aspect ratio (to within 2%, so letterboxed
+ * thumbnails are refused). Nonzero on success. */
+static int decode_thumbnail(ph_context_t *ctx, const uint8_t *buffer, size_t length) {
+    const uint8_t *thumb;
+    size_t thumb_len;
+    int w, h, tw, th, comp;
+    if (!ph_find_thumbnail(buffer, length, &thumb, &thumb_len) || thumb_len > INT32_MAX ||
+        !stbi_info_from_memory(buffer, (int)length, &w, &h, &comp) ||
+        !stbi_info_from_memory(thumb, (int)thumb_len, &tw, &th, &comp))
+        return 0;
+
+    int need_w = ctx->min_width ? ctx->min_width : THUMBNAIL_MIN_SIDE;
+    int need_h = ctx->min_height ? ctx->min_height : THUMBNAIL_MIN_SIDE;
+    int64_t skew = (int64_t)tw * h - (int64_t)th * w;
+    if (tw < need_w || th < need_h || tw > w || th > h ||
+        (skew < 0 ? -skew : skew) * 50 > (int64_t)th * w)
+        return 0;
+
+    int stored = 0;
+    if (ph_decode_with_backends(ctx, thumb, thumb_len) != PH_SUCCESS) {
+        ctx->data = stbi_load_from_memory(thumb, (int)thumb_len, &ctx->width, &ctx->height,
+                                          &stored, wanted_channels(ctx));
+        ctx->channels = wanted_channels(ctx) ? wanted_channels(ctx) : stored;
+    }
+    return ctx->data != NULL;
+}
+
+static ph_error_t decode_memory(ph_context_t *ctx, const uint8_t *buffer, size_t length) {
+    const ph_allocator_t *previous = ph_set_decode_allocator(PH_CTX_ALLOC(ctx));
+    if ((ctx->load_flags & PH_LOAD_EXIF_THUMBNAIL) && decode_thumbnail(ctx, buffer, length)) {
+        ph_set_decode_allocator(previous);
+        ctx->is_loaded = 1;
+        ctx->source = PH_SOURCE_THUMBNAIL;
+        return PH_SUCCESS;
+    }
+    if (ph_decode_with_backends(ctx, buffer, length) != PH_SUCCESS) {
+        int stored = 0;
+        ctx->data = stbi_load_from_memory(buffer, (int)length, &ctx->width, &ctx->height, &stored,
+                                          wanted_channels(ctx));
+        ctx->channels = wanted_channels(ctx) ? wanted_channels(ctx) : stored;
+    }
+    ph_set_decode_allocator(previous);
     if (!ctx->data)
         return PH_ERR_DECODE_FAILED;
 
     ctx->is_loaded = 1;
+    ctx->source = PH_SOURCE_DECODED;
     return PH_SUCCESS;
 }
 
+static ph_error_t decode_file(ph_context_t *ctx, const char *filepath) {
+    if (!ph_have_decoders() && !(ctx->load_flags & PH_LOAD_EXIF_THUMBNAIL)) {
+        int stored = 0;
+        const ph_allocator_t *previous = ph_set_decode_allocator(PH_CTX_ALLOC(ctx));
+        ctx->data = stbi_load(filepath, &ctx->width, &ctx->height, &stored, wanted_channels(ctx));
+        ph_set_decode_allocator(previous);
+        if (!ctx->data)
+            return PH_ERR_DECODE_FAILED;
+        ctx->channels = wanted_channels(ctx) ? wanted_channels(ctx) : stored;
+
+        ctx->is_loaded = 1;
+        ctx->source = PH_SOURCE_DECODED;
+        return PH_SUCCESS;
+    }
+
+    // Backends and the thumbnail lookup work from memory
+    FILE *f = fopen(filepath, "rb");
+    if (!f)
+        return PH_ERR_DECODE_FAILED;
+    uint8_t *buf = NULL;
+    long len = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+        buf = ph_mem_alloc(PH_CTX_ALLOC(ctx), (size_t)len);
+    ph_error_t err = PH_ERR_DECODE_FAILED;
+    if (buf && fread(buf, 1, (size_t)len, f) == (size_t)len)
+        err = decode_memory(ctx, buf, (size_t)len);
+    else if (len > 0 && !buf)
+        err = PH_ERR_ALLOCATION_FAILED;
+    fclose(f);
+    ph_mem_free(PH_CTX_ALLOC(ctx), buf);
+    return err;
+}
+
+/* Looks the image up in the attached cache. On a hit the context is marked
+ * loaded with the decode deferred until an uncached result is requested. */
+static int load_cached(ph_context_t *ctx, ph_cache_key_t key) {
+    key.hi ^= ctx->cache_salt;
+    ctx->cache_key = key;
+    ctx->has_cache_key = 1;
+    if (!ph_cache_lookup(ctx->cache, key, &ctx->cached))
+        return 0;
+
+    ctx->is_loaded = 1;
+    ctx->deferred = 1;
+    ctx->source = PH_SOURCE_CACHE;
+    return 1;
+}
+
+ph_error_t ph_ensure_decoded(ph_context_t *ctx) {
+    if (!ctx->deferred)
+        return PH_SUCCESS;
+
+    ctx->deferred = 0;
+    ph_error_t err = ctx->deferred_path ? decode_file(ctx, ctx->deferred_path)
+                                        : decode_memory(ctx, ctx->deferred_buf, ctx->deferred_len);
+    ctx->source = PH_SOURCE_CACHE;
+    if (err != PH_SUCCESS)
+        ctx->is_loaded = 0;
+    return err;
+}
+
+PH_API ph_error_t ph_load_from_file(ph_context_t *ctx, const char *filepath) {
+    if (!ctx || !filepath)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_release_image(ctx);
+
+    ph_cache_key_t key;
+    if (ctx->cache && ph_cache_key_file(filepath, &key) == 0 && load_cached(ctx, key)) {
+        size_t len = strlen(filepath) + 1;
+        // The old path is overwritten anyway: no need to copy it over
+        ph_mem_free(PH_CTX_ALLOC(ctx), ctx->deferred_path);
+        char *path = ph_mem_alloc(PH_CTX_ALLOC(ctx), len);
+        ctx->deferred_path = path;
+        if (!path) {
+            ph_release_image(ctx);
+            return PH_ERR_ALLOCATION_FAILED;
+        }
+        memcpy(path, filepath, len);
+        return PH_SUCCESS;
+    }
+    return decode_file(ctx, filepath);
+}
+
 PH_API ph_error_t ph_load_from_memory(ph_context_t *ctx, const uint8_t *buffer, size_t length) {
     if (!ctx || !buffer || length == 0)
         return PH_ERR_INVALID_ARGUMENT;
-    if (ctx->data)
-        stbi_image_free(ctx->data);
+    ph_release_image(ctx);
 
-    ctx->data =
-        stbi_load_from_memory(buffer, (int)length, &ctx->width, &ctx->height, &ctx->channels, 0);
-    if (!ctx->data)
-        return PH_ERR_DECODE_FAILED;
+    if (ctx->cache && load_cached(ctx, ph_cache_key_memory(buffer, length))) {
+        // The caller's buffer may be gone by the time a decode is needed
+        if (length > ctx->deferred_cap) {
+            uint8_t *buf =
+                ph_mem_realloc(PH_CTX_ALLOC(ctx), ctx->deferred_buf, ctx->deferred_cap, length);
+            if (!buf) {
+                ph_release_image(ctx);
+                return PH_ERR_ALLOCATION_FAILED;
+            }
+            ctx->deferred_buf = buf;
+            ctx->deferred_cap = length;
+        }
+        memcpy(ctx->deferred_buf, buffer, length);
+        ctx->deferred_len = length;
+        ph_mem_free(PH_CTX_ALLOC(ctx), ctx->deferred_path);
+        ctx->deferred_path = NULL;
+        return PH_SUCCESS;
+    }
+    return decode_memory(ctx, buffer, length);
+}
 
+/* Pixels given to ph_load_from_pixels() belong to the caller */
+static void keep_borrowed(void *user_data, uint8_t *pixels) {
+    (void)user_data;
+    (void)pixels;
+}
+
+PH_API ph_error_t ph_load_from_pixels(ph_context_t *ctx, const uint8_t *pixels, int width,
+                                      int height, int channels) {
+    if (!ctx || !pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_release_image(ctx);
+
+    // Hashing only reads 'data'; the gray plane and pyramid are separate buffers
+    ctx->data = (uint8_t *)pixels;
+    ctx->release_pixels = keep_borrowed;
+    ctx->width = width;
+    ctx->height = height;
+    ctx->channels = channels;
     ctx->is_loaded = 1;
+    ctx->source = PH_SOURCE_PIXELS;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_probe(const uint8_t *buffer, size_t length, ph_image_info_t *out_info) {
+    if (!buffer || length == 0 || !out_info)
+        return PH_ERR_INVALID_ARGUMENT;
+    // Only the header is parsed; a huge buffer can be cut short safely
+    int len = length > INT32_MAX ? INT32_MAX : (int)length;
+    if (!stbi_info_from_memory(buffer, len, &out_info->width, &out_info->height,
+                               &out_info->channels))
+        return PH_ERR_DECODE_FAILED;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_probe_file(const char *filepath, ph_image_info_t *out_info) {
+    if (!filepath || !out_info)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (!stbi_info(filepath, &out_info->width, &out_info->height, &out_info->channels))
+        return PH_ERR_DECODE_FAILED;
     return PH_SUCCESS;
 }
@@ -0,0 +1,165 @@
+#include "internal.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DECODERS 16
+#define MAX_NAME 64
+
+typedef struct {
+    char name[MAX_NAME];
+    ph_decoder_t decoder;
+} registry_entry_t;
+
+static ph_mutex_t s_lock = PH_MUTEX_INITIALIZER;
+static registry_entry_t s_registry[MAX_DECODERS];
+static int s_count = 0;
+
+#if defined(PH_HAVE_LIBJPEG)
+extern const ph_decoder_t ph_libjpeg_decoder;
+#endif
+
+/* Backends shipped with the library, consulted after the registered ones */
+static const ph_decoder_t *const s_builtin[] = {
+#if defined(PH_HAVE_LIBJPEG)
+    &ph_libjpeg_decoder,
+#endif
+    NULL,
+};
+
+static void default_release(void *user_data, uint8_t *pixels) {
+    (void)user_data;
+    free(pixels);
+}
+
+static void decode_release(void *user_data, uint8_t *pixels) {
+    (void)user_data;
+    ph_decode_free(pixels);
+}
+
+PH_API ph_error_t ph_register_decoder(const ph_decoder_t *decoder) {
+    if (!decoder || !decoder->name || !decoder->probe || !decoder->decode ||
+        strlen(decoder->name) >= MAX_NAME)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_error_t err = PH_SUCCESS;
+    ph_mutex_lock(&s_lock);
+    for (int i = 0; i < s_count; i++) {
+        if (strcmp(s_registry[i].name, decoder->name) == 0)
+            err = PH_ERR_INVALID_ARGUMENT;
+    }
+    if (err == PH_SUCCESS && s_count == MAX_DECODERS)
+        err = PH_ERR_ALLOCATION_FAILED;
+    if (err == PH_SUCCESS) {
+        registry_entry_t *e = &s_registry[s_count++];
+        strcpy(e->name, decoder->name);
+        e->decoder = *decoder;
+        e->decoder.name = e->name;
+    }
+    ph_mutex_unlock(&s_lock);
+    return err;
+}
+
+PH_API ph_error_t ph_unregister_decoder(const char *name) {
+    if (!name)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_error_t err = PH_ERR_INVALID_ARGUMENT;
+    ph_mutex_lock(&s_lock);
+    for (int i = 0; i < s_count; i++) {
+        if (strcmp(s_registry[i].name, name) == 0) {
+            memmove(&s_registry[i], &s_registry[i + 1],
+                    (size_t)(s_count - i - 1) * sizeof(registry_entry_t));
+            s_count--;
+            for (int j = i; j < s_count; j++)
+                s_registry[j].decoder.name = s_registry[j].name;
+            err = PH_SUCCESS;
+            break;
+        }
+    }
+    ph_mutex_unlock(&s_lock);
+    return err;
+}
+
+int ph_have_decoders(void) {
+    ph_mutex_lock(&s_lock);
+    int count = s_count;
+    ph_mutex_unlock(&s_lock);
+    return count > 0 || s_builtin[0] != NULL;
+}
+
+/* Validates a backend's output before the context takes ownership */
+static int valid_image(const ph_decoded_image_t *img, int gray_only) {
+    return img->pixels && img->width > 0 && img->height > 0 &&
+           (img->channels == 3 || img->channels == 4 || (gray_only && img->channels == 1));
+}
+
+/* Replaces color output with its gray plane when only luminance was asked for */
+static ph_error_t to_gray_plane(ph_decoded_image_t *img, const ph_decoder_t *d,
+                                void (**release)(void *, uint8_t *), void **user_data) {
+    uint8_t *gray = ph_decode_malloc((size_t)img->width * img->height);
+    if (!gray)
+        return PH_ERR_ALLOCATION_FAILED;
+    ph_to_grayscale(img->pixels, img->width, img->height, img->channels, gray);
+    (*release)(d->user_data, img->pixels);
+    img->pixels = gray;
+    img->channels = 1;
+    *release = decode_release;
+    *user_data = NULL;
+    return PH_SUCCESS;
+}
+
+static ph_error_t try_decoder(ph_context_t *ctx, const ph_decoder_t *d, const uint8_t *buffer,
+                              size_t length) {
+    if (!d->probe(d->user_data, buffer, length))
+        return PH_ERR_NOT_IMPLEMENTED;
+
+    int gray_only = (ctx->load_flags & PH_LOAD_GRAY_ONLY) != 0;
+    ph_decoded_image_t img = {0};
+    img.channels = gray_only ? 1 : 0;
+    ph_error_t err;
+    if (d->decode_scaled && (ctx->min_width > 0 || ctx->min_height > 0))
+        err = d->decode_scaled(d->user_data, buffer, length, ctx->min_width, ctx->min_height, &img);
+    else
+        err = d->decode(d->user_data, buffer, length, &img);
+
+    void (*release)(void *, uint8_t *) = d->release ? d->release : default_release;
+    void *user_data = d->user_data;
+    if (err == PH_SUCCESS && !valid_image(&img, gray_only))
+        err = PH_ERR_DECODE_FAILED;
+    if (err == PH_SUCCESS && gray_only && img.channels != 1)
+        err = to_gray_plane(&img, d, &release, &user_data);
+    if (err != PH_SUCCESS) {
+        if (img.pixels)
+            release(user_data, img.pixels);
+        return err;
+    }
+
+    ctx->data = img.pixels;
+    ctx->width = img.width;
+    ctx->height = img.height;
+    ctx->channels = img.channels;
+    ctx->release_pixels = release;
+    ctx->release_user_data = user_data;
+    return PH_SUCCESS;
+}
+
+ph_error_t ph_decode_with_backends(ph_context_t *ctx, const uint8_t *buffer, size_t length) {
+    // Work on a snapshot so callbacks run without the lock held
+    ph_decoder_t snapshot[MAX_DECODERS];
+    ph_mutex_lock(&s_lock);
+    int count = s_count;
+    for (int i = 0; i < count; i++)
+        snapshot[i] = s_registry[i].decoder;
+    ph_mutex_unlock(&s_lock);
+
+    for (int i = count - 1; i >= 0; i--) {
+        if (try_decoder(ctx, &snapshot[i], buffer, length) == PH_SUCCESS)
+            return PH_SUCCESS;
+    }
+    for (int i = 0; s_builtin[i]; i++) {
+        if (try_decoder(ctx, s_builtin[i], buffer, length) == PH_SUCCESS)
+            return PH_SUCCESS;
+    }
+    return PH_ERR_NOT_IMPLEMENTED;
+}
@@ -0,0 +1,109 @@
+/*
+ * JPEG backend on the system libjpeg (or libjpeg-turbo).
+ * Built when configured with -DPHASH_WITH_LIBJPEG=ON and the library is found.
+ */
+#if defined(PH_HAVE_LIBJPEG)
+
+#include "internal.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <jpeglib.h>
+
+typedef struct {
+    struct jpeg_error_mgr base;
+    jmp_buf escape;
+} error_mgr_t;
+
+static void on_error(j_common_ptr cinfo) {
+    error_mgr_t *err = (error_mgr_t *)cinfo->err;
+    longjmp(err->escape, 1);
+}
+
+static void on_message(j_common_ptr cinfo) { (void)cinfo; }
+
+static int jpeg_probe(void *user_data, const uint8_t *buffer, size_t length) {
+    (void)user_data;
+    return length >= 3 && buffer[0] == 0xFF && buffer[1] == 0xD8 && buffer[2] == 0xFF;
+}
+
+/* Largest 1/N DCT scaling (N = 8, 4, 2) that keeps both minimums */
+static unsigned pick_denominator(unsigned w, unsigned h, int min_w, int min_h) {
+    if (min_w <= 0 && min_h <= 0)
+        return 1;
+    for (unsigned d = 8; d > 1; d /= 2) {
+        if ((w + d - 1) / d >= (unsigned)min_w && (h + d - 1) / d >= (unsigned)min_h)
+            return d;
+    }
+    return 1;
+}
+
+static ph_error_t jpeg_decode_scaled(void *user_data, const uint8_t *buffer, size_t length,
+                                     int min_width, int min_height, ph_decoded_image_t *out) {
+    (void)user_data;
+    struct jpeg_decompress_struct cinfo;
+    error_mgr_t jerr;
+    // Written between setjmp and longjmp, so it must not live in a register
+    uint8_t *volatile pixels = NULL;
+
+    cinfo.err = jpeg_std_error(&jerr.base);
+    jerr.base.error_exit = on_error;
+    jerr.base.output_message = on_message;
+    if (setjmp(jerr.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        ph_decode_free(pixels);
+        return PH_ERR_DECODE_FAILED;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)buffer, (unsigned long)length);
+    jpeg_read_header(&cinfo, TRUE);
+
+    // Grayscale output skips chroma upsampling and color conversion
+    int channels = out->channels == 1 ? 1 : 3;
+    cinfo.out_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = pick_denominator(cinfo.image_width, cinfo.image_height, min_width,
+                                         min_height);
+    jpeg_start_decompress(&cinfo);
+
+    size_t stride = (size_t)cinfo.output_width * channels;
+    pixels = ph_decode_malloc(stride * cinfo.output_height);
+    if (!pixels) {
+        jpeg_destroy_decompress(&cinfo);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = pixels + cinfo.output_scanline * stride;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+
+    out->pixels = pixels;
+    out->width = (int)cinfo.output_width;
+    out->height = (int)cinfo.output_height;
+    out->channels = channels;
+    jpeg_destroy_decompress(&cinfo);
+    return PH_SUCCESS;
+}
+
+static ph_error_t jpeg_decode(void *user_data, const uint8_t *buffer, size_t length,
+                              ph_decoded_image_t *out) {
+    return jpeg_decode_scaled(user_data, buffer, length, 0, 0, out);
+}
+
+/* Pixels come from the allocator of the context being decoded */
+static void jpeg_release(void *user_data, uint8_t *pixels) {
+    (void)user_data;
+    ph_decode_free(pixels);
+}
+
+const ph_decoder_t ph_libjpeg_decoder = {
+    "libjpeg", NULL, jpeg_probe, jpeg_decode, jpeg_decode_scaled, jpeg_release,
+};
+
+#else
+typedef int ph_libjpeg_unused_t; /* ISO C forbids an empty translation unit */
+#endif
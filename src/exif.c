@@ -0,0 +1,116 @@
+#include "internal.h"
+#include <string.h>
+
+/*
+ * Embedded JPEG thumbnails.
+ *
+ * The header segments of a JPEG are walked up to the first frame or scan
+ * marker. An APP1 "Exif" segment holds a TIFF structure whose second IFD
+ * (IFD1) describes the thumbnail: tags 0x0201 / 0x0202 give its offset
+ * from the TIFF header and its length. An APP0 "JFXX" segment with
+ * extension code 0x10 carries a JPEG thumbnail directly. Every offset is
+ * checked against the segment it came from.
+ */
+
+#define TAG_THUMBNAIL_OFFSET 0x0201
+#define TAG_THUMBNAIL_LENGTH 0x0202
+#define JFXX_JPEG 0x10
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    int big_endian;
+} tiff_t;
+
+static uint32_t tiff_u16(const tiff_t *t, size_t at) {
+    const uint8_t *p = t->data + at;
+    return t->big_endian ? (uint32_t)p[0] << 8 | p[1] : (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint32_t tiff_u32(const tiff_t *t, size_t at) {
+    const uint8_t *p = t->data + at;
+    return t->big_endian ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]
+                         : (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+/* An IFD entry's value: SHORT or LONG, stored inline */
+static uint32_t entry_value(const tiff_t *t, size_t entry) {
+    return tiff_u16(t, entry + 2) == 3 ? tiff_u16(t, entry + 8) : tiff_u32(t, entry + 8);
+}
+
+static int exif_thumbnail(const uint8_t *seg, size_t len, const uint8_t **out, size_t *out_len) {
+    if (len < 14 || memcmp(seg, "Exif\0\0", 6) != 0)
+        return 0;
+    tiff_t t = {seg + 6, len - 6, seg[6] == 'M'};
+    if (memcmp(t.data, t.big_endian ? "MM\0*" : "II*\0", 4) != 0)
+        return 0;
+
+    /* Skip IFD0 to reach IFD1 */
+    uint32_t ifd = tiff_u32(&t, 4);
+    if (ifd > t.len - 2)
+        return 0;
+    uint32_t entries = tiff_u16(&t, ifd);
+    if ((uint64_t)ifd + 2 + entries * 12u + 4 > t.len)
+        return 0;
+    ifd = tiff_u32(&t, ifd + 2 + entries * 12u);
+    if (ifd == 0 || ifd > t.len - 2)
+        return 0;
+    entries = tiff_u16(&t, ifd);
+    if ((uint64_t)ifd + 2 + entries * 12u > t.len)
+        return 0;
+
+    uint32_t offset = 0, length = 0;
+    for (uint32_t i = 0; i < entries; i++) {
+        size_t entry = ifd + 2 + i * 12u;
+        uint32_t tag = tiff_u16(&t, entry);
+        if (tag == TAG_THUMBNAIL_OFFSET)
+            offset = entry_value(&t, entry);
+        else if (tag == TAG_THUMBNAIL_LENGTH)
+            length = entry_value(&t, entry);
+    }
+    if (offset == 0 || length < 4 || offset > t.len || length > t.len - offset)
+        return 0;
+    *out = t.data + offset;
+    *out_len = length;
+    return 1;
+}
+
+static int jfxx_thumbnail(const uint8_t *seg, size_t len, const uint8_t **out, size_t *out_len) {
+    if (len < 10 || memcmp(seg, "JFXX\0", 5) != 0 || seg[5] != JFXX_JPEG)
+        return 0;
+    *out = seg + 6;
+    *out_len = len - 6;
+    return 1;
+}
+
+int ph_find_thumbnail(const uint8_t *buffer, size_t length, const uint8_t **out_data,
+                      size_t *out_length) {
+    if (length < 4 || buffer[0] != 0xFF || buffer[1] != 0xD8)
+        return 0;
+
+    size_t at = 2;
+    while (at + 4 <= length) {
+        if (buffer[at] != 0xFF)
+            return 0;
+        uint8_t marker = buffer[at + 1];
+        if (marker == 0xFF) { /* Fill byte */
+            at++;
+            continue;
+        }
+        /* Thumbnails sit in the header: stop at the first frame or scan */
+        if ((marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 &&
+             marker != 0xCC) ||
+            marker == 0xDA || marker == 0xD9)
+            return 0;
+        size_t seg_len = (size_t)buffer[at + 2] << 8 | buffer[at + 3];
+        if (seg_len < 2 || at + 2 + seg_len > length)
+            return 0;
+        const uint8_t *seg = buffer + at + 4;
+        if (marker == 0xE1 && exif_thumbnail(seg, seg_len - 2, out_data, out_length))
+            return 1;
+        if (marker == 0xE0 && jfxx_thumbnail(seg, seg_len - 2, out_data, out_length))
+            return 1;
+        at += 2 + seg_len;
+    }
+    return 0;
+}
@@ -0,0 +1,434 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* memfd_create */
+#endif
+#include "internal.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Shared-memory frame ring.
+ *
+ * One memfd holds a header, a descriptor and a result record per slot, and
+ * the pixel slots themselves (page aligned). Three free-running 32-bit
+ * counters drive a single-producer/single-consumer ring: 'head' (frames
+ * published, advanced by the producer), 'done' (frames hashed, advanced by
+ * the consumer) and the producer's private 'tail' (results collected). A
+ * slot is free again once its result has been collected, so the result
+ * records form the completion ring alongside the frames.
+ *
+ * A side about to sleep sets its 'waiting' flag, re-checks the counter and
+ * waits on a futex word in the mapping; the other side only issues a wake
+ * when it sees the flag, so a busy pipeline makes no syscalls. Counters
+ * and flags use sequentially consistent atomics, so either the sleeper
+ * sees the new counter or the waker sees the flag.
+ *
+ * The producer may be sandboxed and is not trusted: the consumer keeps its
+ * own copy of the geometry, copies each descriptor once before checking
+ * it, and the memfd is sealed against resizing.
+ */
+
+#if defined(__linux__)
+
+#define RING_MAGIC 0x52464850u /* "PHFR" */
+#define RING_VERSION 1u
+#define RING_MAX_SLOTS 65536u
+#define RING_LINE 64
+#define RING_PAGE 4096
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t result_size; /* sizeof(ph_frame_result_t): both sides must agree */
+    uint64_t slot_bytes;
+    uint64_t pixels_offset;
+    uint8_t pad0[RING_LINE - 32];
+
+    /* Written by the producer */
+    _Atomic uint32_t head;
+    _Atomic uint32_t closed;
+    _Atomic uint32_t producer_waiting;
+    _Atomic uint32_t to_consumer; /* Futex word the consumer sleeps on */
+    uint8_t pad1[RING_LINE - 16];
+
+    /* Written by the consumer */
+    _Atomic uint32_t done;
+    _Atomic uint32_t consumer_waiting;
+    _Atomic uint32_t to_producer; /* Futex word the producer sleeps on */
+    uint8_t pad2[RING_LINE - 12];
+} ring_header_t;
+
+typedef struct {
+    uint64_t frame_id;
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t reserved[3];
+} frame_desc_t;
+
+struct ph_frame_ring {
+    ring_header_t *hdr;
+    frame_desc_t *descs;
+    ph_frame_result_t *results;
+    uint8_t *pixels;
+    size_t map_len;
+    int fd; /* Owned memfd, or -1 when attached */
+
+    /* Local copies: the other process may scribble over the header */
+    uint32_t slots;
+    size_t slot_bytes;
+    uint32_t head; /* Producer */
+    uint32_t tail; /* Producer */
+    uint32_t done; /* Consumer */
+};
+
+/* Offset of the pixel slots: after the header, descriptors and results */
+static size_t pixels_offset(uint32_t slots) {
+    size_t meta =
+        sizeof(ring_header_t) + slots * (sizeof(frame_desc_t) + sizeof(ph_frame_result_t));
+    return (meta + RING_PAGE - 1) / RING_PAGE * RING_PAGE;
+}
+
+static int valid_geometry(uint32_t slots, uint64_t slot_bytes, size_t *out_len) {
+    if (slots == 0 || slots > RING_MAX_SLOTS || (slots & (slots - 1)) != 0)
+        return 0;
+    size_t offset = pixels_offset(slots);
+    if (slot_bytes == 0 || slot_bytes % RING_LINE != 0 || slot_bytes > (SIZE_MAX - offset) / slots)
+        return 0;
+    *out_len = offset + (size_t)slot_bytes * slots;
+    return 1;
+}
+
+static ph_error_t map_ring(int fd, size_t len, ph_frame_ring_t *ring) {
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return PH_ERR_IO;
+    ring->hdr = map;
+    ring->map_len = len;
+    ring->descs = (frame_desc_t *)(ring->hdr + 1);
+    ring->results = (ph_frame_result_t *)(ring->descs + ring->slots);
+    ring->pixels = (uint8_t *)map + pixels_offset(ring->slots);
+    return PH_SUCCESS;
+}
+
+static void futex_wait(_Atomic uint32_t *word, uint32_t expected, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+    /* Shared (not FUTEX_PRIVATE): the waker is another process */
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, timeout_ms < 0 ? NULL : &ts, NULL,
+            0);
+}
+
+static void notify(_Atomic uint32_t *waiting, _Atomic uint32_t *word) {
+    if (atomic_load(waiting)) {
+        atomic_fetch_add(word, 1);
+        syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+static int elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int)((now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+/* Sleeps until '*counter' is no longer 'seen', 'timeout_ms' passed
+ * (negative: no limit) or, for the consumer, the ring is closed */
+static void wait_for(ph_frame_ring_t *ring, _Atomic uint32_t *counter, uint32_t seen,
+                     _Atomic uint32_t *waiting, _Atomic uint32_t *word, int timeout_ms,
+                     int until_closed) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        uint32_t signal = atomic_load(word);
+        atomic_store(waiting, 1);
+        if (atomic_load(counter) != seen || (until_closed && atomic_load(&ring->hdr->closed)))
+            break;
+        int left = -1;
+        if (timeout_ms >= 0) {
+            left = timeout_ms - elapsed_ms(&start);
+            if (left <= 0)
+                break;
+        }
+        futex_wait(word, signal, left);
+    }
+    atomic_store(waiting, 0);
+}
+
+PH_API ph_error_t ph_frame_ring_create(uint32_t slots, size_t slot_bytes,
+                                       ph_frame_ring_t **out_ring) {
+    if (!out_ring || slot_bytes == 0 || slot_bytes > SIZE_MAX - RING_LINE)
+        return PH_ERR_INVALID_ARGUMENT;
+    slot_bytes = (slot_bytes + RING_LINE - 1) / RING_LINE * RING_LINE;
+    size_t len;
+    if (!valid_geometry(slots, slot_bytes, &len))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_frame_ring_t *ring = ph_mem_calloc(NULL, 1, sizeof(ph_frame_ring_t));
+    if (!ring)
+        return PH_ERR_ALLOCATION_FAILED;
+    ring->slots = slots;
+    ring->slot_bytes = slot_bytes;
+    ring->fd = memfd_create("libphash-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (ring->fd < 0 || ftruncate(ring->fd, (off_t)len) != 0 ||
+        fcntl(ring->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0 ||
+        map_ring(ring->fd, len, ring) != PH_SUCCESS) {
+        if (ring->fd >= 0)
+            close(ring->fd);
+        ph_mem_free(NULL, ring);
+        return PH_ERR_IO;
+    }
+
+    ring_header_t *hdr = ring->hdr;
+    hdr->magic = RING_MAGIC;
+    hdr->version = RING_VERSION;
+    hdr->slots = slots;
+    hdr->result_size = sizeof(ph_frame_result_t);
+    hdr->slot_bytes = slot_bytes;
+    hdr->pixels_offset = pixels_offset(slots);
+    *out_ring = ring;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_frame_ring_attach(int fd, ph_frame_ring_t **out_ring) {
+    if (fd < 0 || !out_ring)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    struct stat st;
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (fstat(fd, &st) != 0 || seals < 0 || !(seals & F_SEAL_SHRINK) ||
+        (uint64_t)st.st_size < sizeof(ring_header_t))
+        return PH_ERR_IO;
+    ring_header_t hdr;
+    if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+        return PH_ERR_IO;
+    size_t len;
+    if (hdr.magic != RING_MAGIC || hdr.version != RING_VERSION ||
+        hdr.result_size != sizeof(ph_frame_result_t) ||
+        !valid_geometry(hdr.slots, hdr.slot_bytes, &len) ||
+        hdr.pixels_offset != pixels_offset(hdr.slots) || (uint64_t)st.st_size != len)
+        return PH_ERR_IO;
+
+    ph_frame_ring_t *ring = ph_mem_calloc(NULL, 1, sizeof(ph_frame_ring_t));
+    if (!ring)
+        return PH_ERR_ALLOCATION_FAILED;
+    ring->fd = -1;
+    ring->slots = hdr.slots;
+    ring->slot_bytes = (size_t)hdr.slot_bytes;
+    if (map_ring(fd, len, ring) != PH_SUCCESS) {
+        ph_mem_free(NULL, ring);
+        return PH_ERR_IO;
+    }
+    ring->head = atomic_load(&ring->hdr->head);
+    ring->done = atomic_load(&ring->hdr->done);
+    ring->tail = ring->done;
+    *out_ring = ring;
+    return PH_SUCCESS;
+}
+
+PH_API int ph_frame_ring_fd(const ph_frame_ring_t *ring) { return ring ? ring->fd : -1; }
+
+PH_API void ph_frame_ring_free(ph_frame_ring_t *ring) {
+    if (!ring)
+        return;
+    munmap(ring->hdr, ring->map_len);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    ph_mem_free(NULL, ring);
+}
+
+PH_API size_t ph_frame_ring_slot_bytes(const ph_frame_ring_t *ring) {
+    return ring ? ring->slot_bytes : 0;
+}
+
+PH_API ph_error_t ph_frame_ring_acquire(ph_frame_ring_t *ring, uint8_t **out_pixels) {
+    if (!ring || !out_pixels)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (ring->head - ring->tail >= ring->slots)
+        return PH_ERR_FULL;
+    *out_pixels = ring->pixels + (size_t)(ring->head & (ring->slots - 1)) * ring->slot_bytes;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_frame_ring_publish(ph_frame_ring_t *ring, uint64_t frame_id, int width,
+                                       int height, int channels) {
+    if (!ring || width <= 0 || height <= 0 || channels < 1 || channels > 4 ||
+        (uint64_t)width * (uint64_t)height * (uint64_t)channels > ring->slot_bytes)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (ring->head - ring->tail >= ring->slots)
+        return PH_ERR_FULL;
+
+    frame_desc_t *d = &ring->descs[ring->head & (ring->slots - 1)];
+    d->frame_id = frame_id;
+    d->width = width;
+    d->height = height;
+    d->channels = channels;
+    ring->head++;
+    atomic_store(&ring->hdr->head, ring->head);
+    notify(&ring->hdr->consumer_waiting, &ring->hdr->to_consumer);
+    return PH_SUCCESS;
+}
+
+PH_API int ph_frame_ring_poll_results(ph_frame_ring_t *ring, ph_frame_result_t *results,
+                                      size_t max, int timeout_ms) {
+    if (!ring || (!results && max > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ring_header_t *hdr = ring->hdr;
+    uint32_t done = atomic_load(&hdr->done);
+    if (done == ring->tail && timeout_ms != 0 && ring->head != ring->tail) {
+        wait_for(ring, &hdr->done, done, &hdr->producer_waiting, &hdr->to_producer, timeout_ms,
+                 0);
+        done = atomic_load(&hdr->done);
+    }
+    if (done - ring->tail > ring->head - ring->tail)
+        return PH_ERR_IO;
+
+    size_t count = done - ring->tail;
+    if (count > max)
+        count = max;
+    for (size_t i = 0; i < count; i++)
+        results[i] = ring->results[(ring->tail + i) & (ring->slots - 1)];
+    ring->tail += (uint32_t)count;
+    return (int)count;
+}
+
+PH_API void ph_frame_ring_close(ph_frame_ring_t *ring) {
+    if (!ring)
+        return;
+    atomic_store(&ring->hdr->closed, 1);
+    atomic_fetch_add(&ring->hdr->to_consumer, 1);
+    syscall(SYS_futex, (uint32_t *)&ring->hdr->to_consumer, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+PH_API int ph_frame_ring_closed(const ph_frame_ring_t *ring) {
+    return ring ? (int)atomic_load(&ring->hdr->closed) : 0;
+}
+
+/* Hashes the frame in slot 'i' where it lies */
+static void hash_slot(ph_frame_ring_t *ring, uint32_t i, ph_context_t *ctx, uint32_t algo_mask) {
+    frame_desc_t d;
+    memcpy(&d, &ring->descs[i], sizeof(d));
+    ph_frame_result_t result;
+    memset(&result, 0, sizeof(result));
+    result.frame_id = d.frame_id;
+    result.error = PH_ERR_INVALID_ARGUMENT;
+    if (d.width > 0 && d.height > 0 && d.channels >= 1 && d.channels <= 4 &&
+        (uint64_t)d.width * (uint64_t)d.height * (uint64_t)d.channels <= ring->slot_bytes) {
+        result.error = ph_load_from_pixels(ctx, ring->pixels + (size_t)i * ring->slot_bytes,
+                                           d.width, d.height, d.channels);
+        if (result.error == PH_SUCCESS)
+            result.error = ph_compute_hashes(ctx, algo_mask, &result.hashes);
+        ph_release_image(ctx);
+    }
+    ring->results[i] = result;
+}
+
+PH_API int ph_frame_ring_consume(ph_frame_ring_t *ring, ph_context_t *ctx, uint32_t algo_mask,
+                                 int timeout_ms) {
+    if (!ring || !ctx || (algo_mask & ~PH_ALGO_ALL) != 0)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ring_header_t *hdr = ring->hdr;
+    uint32_t head = atomic_load(&hdr->head);
+    if (head == ring->done && timeout_ms != 0) {
+        wait_for(ring, &hdr->head, head, &hdr->consumer_waiting, &hdr->to_consumer, timeout_ms,
+                 1);
+        head = atomic_load(&hdr->head);
+    }
+
+    int count = 0;
+    while (head != ring->done) {
+        if (head - ring->done > ring->slots)
+            return count > 0 ? count : PH_ERR_IO;
+        hash_slot(ring, ring->done & (ring->slots - 1), ctx, algo_mask);
+        ring->done++;
+        count++;
+        atomic_store(&hdr->done, ring->done);
+        notify(&hdr->producer_waiting, &hdr->to_producer);
+        if (head == ring->done)
+            head = atomic_load(&hdr->head);
+    }
+    return count;
+}
+
+#else
+
+PH_API ph_error_t ph_frame_ring_create(uint32_t slots, size_t slot_bytes,
+                                       ph_frame_ring_t **out_ring) {
+    (void)slots;
+    (void)slot_bytes;
+    (void)out_ring;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API ph_error_t ph_frame_ring_attach(int fd, ph_frame_ring_t **out_ring) {
+    (void)fd;
+    (void)out_ring;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API int ph_frame_ring_fd(const ph_frame_ring_t *ring) {
+    (void)ring;
+    return -1;
+}
+
+PH_API void ph_frame_ring_free(ph_frame_ring_t *ring) { (void)ring; }
+
+PH_API size_t ph_frame_ring_slot_bytes(const ph_frame_ring_t *ring) {
+    (void)ring;
+    return 0;
+}
+
+PH_API ph_error_t ph_frame_ring_acquire(ph_frame_ring_t *ring, uint8_t **out_pixels) {
+    (void)ring;
+    (void)out_pixels;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API ph_error_t ph_frame_ring_publish(ph_frame_ring_t *ring, uint64_t frame_id, int width,
+                                       int height, int channels) {
+    (void)ring;
+    (void)frame_id;
+    (void)width;
+    (void)height;
+    (void)channels;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API int ph_frame_ring_poll_results(ph_frame_ring_t *ring, ph_frame_result_t *results,
+                                      size_t max, int timeout_ms) {
+    (void)ring;
+    (void)results;
+    (void)max;
+    (void)timeout_ms;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API void ph_frame_ring_close(ph_frame_ring_t *ring) { (void)ring; }
+
+PH_API int ph_frame_ring_closed(const ph_frame_ring_t *ring) {
+    (void)ring;
+    return 0;
+}
+
+PH_API int ph_frame_ring_consume(ph_frame_ring_t *ring, ph_context_t *ctx, uint32_t algo_mask,
+                                 int timeout_ms) {
+    (void)ring;
+    (void)ctx;
+    (void)algo_mask;
+    (void)timeout_ms;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+#endif
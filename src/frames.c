@@ -0,0 +1,148 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "../vendor/stb_image.h"
+
+/* GIF frames are always expanded to RGBA by stb_image */
+#define FRAME_CHANNELS 4
+
+static size_t frame_stride(const ph_context_t *ctx) {
+    return (size_t)ctx->width * ctx->height * FRAME_CHANNELS;
+}
+
+PH_API ph_error_t ph_load_frames_from_memory(ph_context_t *ctx, const uint8_t *buffer,
+                                             size_t length, int *out_frame_count) {
+    if (!ctx || !buffer || length == 0)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    if (length < 4 || memcmp(buffer, "GIF8", 4) != 0) {
+        // Still images are a single frame
+        ph_error_t err = ph_load_from_memory(ctx, buffer, length);
+        if (err == PH_SUCCESS && out_frame_count)
+            *out_frame_count = 1;
+        return err;
+    }
+
+    ph_release_image(ctx);
+
+    int comp = 0, count = 0;
+    const ph_allocator_t *previous = ph_set_decode_allocator(PH_CTX_ALLOC(ctx));
+    ctx->frames = stbi_load_gif_from_memory(buffer, (int)length, &ctx->frame_delays, &ctx->width,
+                                            &ctx->height, &count, &comp, FRAME_CHANNELS);
+    ph_set_decode_allocator(previous);
+    if (!ctx->frames || count <= 0) {
+        ph_release_image(ctx);
+        return PH_ERR_DECODE_FAILED;
+    }
+
+    ctx->frame_count = count;
+    ctx->frame_index = 0;
+    ctx->channels = FRAME_CHANNELS;
+    ctx->data = ctx->frames;
+    ctx->is_loaded = 1;
+    ctx->source = PH_SOURCE_DECODED;
+    if (out_frame_count)
+        *out_frame_count = count;
+    return PH_SUCCESS;
+}
+
+PH_API int ph_frame_count(const ph_context_t *ctx) {
+    if (!ctx || !ctx->is_loaded)
+        return 0;
+    return ctx->frames ? ctx->frame_count : 1;
+}
+
+PH_API int ph_frame_delay(const ph_context_t *ctx, int index) {
+    if (!ctx || !ctx->frames || !ctx->frame_delays || index < 0 || index >= ctx->frame_count)
+        return 0;
+    return ctx->frame_delays[index];
+}
+
+/* Points the context at another frame and returns how many rows differ from
+ * the current one. A grayscale cache is patched in place: only those rows are
+ * converted again. */
+static int switch_frame(ph_context_t *ctx, int index) {
+    uint8_t *next = ctx->frames + (size_t)index * frame_stride(ctx);
+    const uint8_t *prev = ctx->data;
+    size_t row_bytes = (size_t)ctx->width * FRAME_CHANNELS;
+    int changed = 0;
+
+    for (int y = 0; y < ctx->height && next != prev; y++) {
+        const uint8_t *row = next + y * row_bytes;
+        if (memcmp(row, prev + y * row_bytes, row_bytes) != 0) {
+            if (ctx->gray_data)
+                ph_to_grayscale(row, ctx->width, 1, FRAME_CHANNELS,
+                                ctx->gray_data + (size_t)y * ctx->width);
+            changed++;
+        }
+    }
+
+    if (changed > 0)
+        ph_invalidate_pyramid(ctx);
+    ctx->data = next;
+    ctx->frame_index = index;
+    // Results fetched for another frame no longer apply
+    ctx->cached.mask = 0;
+    ctx->has_cache_key = 0;
+    return changed;
+}
+
+PH_API ph_error_t ph_select_frame(ph_context_t *ctx, int index) {
+    if (!ctx || !ctx->is_loaded || index < 0 || index >= ph_frame_count(ctx))
+        return PH_ERR_INVALID_ARGUMENT;
+    if (ctx->frames)
+        switch_frame(ctx, index);
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_compute_frame_hashes(ph_context_t *ctx, ph_algo_t algo, uint64_t *out_hashes,
+                                          size_t max_hashes, uint64_t *out_aggregate) {
+    if (!ctx || !ctx->is_loaded || (!out_hashes && max_hashes > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+    if (algo != PH_ALGO_AHASH && algo != PH_ALGO_DHASH && algo != PH_ALGO_PHASH &&
+        algo != PH_ALGO_WHASH && algo != PH_ALGO_MHASH)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    int count = ph_frame_count(ctx);
+    if ((size_t)count > max_hashes && !out_aggregate)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    // Per-bit votes weighted by frame duration (frames without a delay count once)
+    uint64_t votes[64] = {0};
+    uint64_t total_weight = 0;
+    uint64_t hash = 0;
+
+    for (int i = 0; i < count; i++) {
+        int changed = 1;
+        if (ctx->frames && i != ctx->frame_index)
+            changed = switch_frame(ctx, i);
+
+        // An unchanged frame (same pixels as the previous one) keeps its hash
+        if (i == 0 || changed != 0) {
+            ph_error_t err = ph_compute_u64(ctx, algo, &hash);
+            if (err != PH_SUCCESS)
+                return err;
+        }
+        if ((size_t)i < max_hashes)
+            out_hashes[i] = hash;
+
+        int delay = ph_frame_delay(ctx, i);
+        uint64_t weight = delay > 0 ? (uint64_t)delay : 1;
+        total_weight += weight;
+        for (int b = 0; b < 64; b++) {
+            if (hash & (1ULL << b))
+                votes[b] += weight;
+        }
+    }
+
+    if (out_aggregate) {
+        uint64_t aggregate = 0;
+        for (int b = 0; b < 64; b++) {
+            if (votes[b] * 2 > total_weight)
+                aggregate |= 1ULL << b;
+        }
+        *out_aggregate = aggregate;
+    }
+    return PH_SUCCESS;
+}
@@ -0,0 +1,595 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* accept4 */
+#endif
+#include "hashd.h"
+#include "internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Query daemon.
+ *
+ * A single-threaded epoll loop. Each wake-up reads whatever the clients
+ * sent, collects every complete request into one batch and answers the
+ * batch with a single pass over the mapped store: the store is walked in
+ * cache-sized blocks and each block is compared against all queued
+ * queries before moving on, so concurrent callers share the memory
+ * traffic of one scan.
+ */
+
+PH_API ph_error_t ph_hash_store_write(const char *path, const uint64_t *hashes, size_t count) {
+    if (!path || (!hashes && count > 0))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return PH_ERR_IO;
+    ph_store_header_t header = {PH_STORE_MAGIC, PH_STORE_VERSION, (uint64_t)count};
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             (count == 0 || fwrite(hashes, sizeof(uint64_t), count, f) == count);
+    if (fclose(f) != 0)
+        ok = 0;
+    return ok ? PH_SUCCESS : PH_ERR_IO;
+}
+
+#if defined(__linux__)
+
+#define BLOCK_HASHES 4096
+#define READ_CHUNK 65536
+#define READ_LIMIT (1 << 20) /* buffered input per connection */
+/* Result slots answered per pass; a request alone always fits */
+#define BATCH_SLOTS (4 * (size_t)PH_HASHD_MAX_SLOTS)
+
+typedef struct {
+    int fd;
+    uint8_t *in;
+    size_t in_len, in_cap;
+    size_t in_done; /* bytes of 'in' consumed by the current batch */
+    uint8_t *out;
+    size_t out_len, out_off, out_cap;
+    int writing; /* registered for EPOLLOUT */
+    int closed;
+} conn_t;
+
+/* A request taken into the current batch */
+typedef struct {
+    conn_t *conn;
+    ph_hashd_request_t req;
+    const uint64_t *queries; /* points into conn->in */
+    size_t first;            /* index of its first query in the batch */
+    int32_t status;
+} job_t;
+
+struct ph_hashd {
+    int listen_fd;
+    int stop_fd;
+    int epoll_fd;
+    char *socket_path;
+    int bound; /* socket_path is ours to unlink */
+
+    void *map;
+    size_t map_len;
+    const uint64_t *hashes;
+    size_t count;
+
+    conn_t **conns;
+    size_t nconns, conns_cap;
+
+    /* Batch scratch, kept between wake-ups */
+    job_t *jobs;
+    size_t jobs_cap;
+    uint32_t *totals;     /* per query: radius matches found / k-NN kept */
+    size_t *slot;         /* per query: offset of its slots in 'results' */
+    size_t queries_cap;
+    ph_candidate_t *results;
+    size_t results_cap;
+};
+
+static int grow(void **buf, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap)
+        return 1;
+    size_t cap2 = *cap ? *cap : 64;
+    while (cap2 < need)
+        cap2 *= 2;
+    void *p = ph_mem_realloc(NULL, *buf, *cap * elem, cap2 * elem);
+    if (!p)
+        return 0;
+    *buf = p;
+    *cap = cap2;
+    return 1;
+}
+
+static ph_error_t map_store(ph_hashd_t *d, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return PH_ERR_IO;
+    struct stat st;
+    ph_error_t err = PH_ERR_IO;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ph_store_header_t)) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            const ph_store_header_t *h = map;
+            size_t room = ((size_t)st.st_size - sizeof(*h)) / sizeof(uint64_t);
+            /* Indexes travel as uint32_t */
+            if (h->magic == PH_STORE_MAGIC && h->version == PH_STORE_VERSION &&
+                h->count <= room && h->count <= UINT32_MAX) {
+                madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+                d->map = map;
+                d->map_len = (size_t)st.st_size;
+                d->hashes = (const uint64_t *)(h + 1);
+                d->count = (size_t)h->count;
+                err = PH_SUCCESS;
+            } else {
+                munmap(map, (size_t)st.st_size);
+                err = PH_ERR_DECODE_FAILED;
+            }
+        }
+    }
+    close(fd);
+    return err;
+}
+
+/* Makes 'addr' free to bind: nothing there, or a socket nobody listens on
+ * any more, which is removed. Anything else is left alone. */
+static int claim_socket_path(const struct sockaddr_un *addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st) != 0)
+        return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode))
+        return 0;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return 0;
+    int stale = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0 &&
+                errno == ECONNREFUSED;
+    close(fd);
+    return stale && unlink(addr->sun_path) == 0;
+}
+
+static int watch(ph_hashd_t *d, int op, int fd, uint32_t events, void *ptr) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = ptr;
+    return epoll_ctl(d->epoll_fd, op, fd, &ev);
+}
+
+PH_API ph_error_t ph_hashd_create(const char *store_path, const char *socket_path,
+                                  ph_hashd_t **out_daemon) {
+    struct sockaddr_un addr;
+    if (!store_path || !socket_path || !out_daemon || strlen(socket_path) >= sizeof(addr.sun_path))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_hashd_t *d = ph_mem_calloc(NULL, 1, sizeof(ph_hashd_t));
+    if (!d)
+        return PH_ERR_ALLOCATION_FAILED;
+    d->listen_fd = d->stop_fd = d->epoll_fd = -1;
+
+    ph_error_t err = map_store(d, store_path);
+    if (err != PH_SUCCESS) {
+        ph_hashd_free(d);
+        return err;
+    }
+
+    size_t len = strlen(socket_path) + 1;
+    d->socket_path = ph_mem_alloc(NULL, len);
+    if (!d->socket_path) {
+        ph_hashd_free(d);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+    memcpy(d->socket_path, socket_path, len);
+    if (!grow((void **)&d->jobs, &d->jobs_cap, 1, sizeof(job_t))) {
+        ph_hashd_free(d);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, len);
+    if (!claim_socket_path(&addr)) {
+        ph_hashd_free(d);
+        return PH_ERR_IO;
+    }
+
+    d->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    d->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (d->listen_fd < 0 || d->stop_fd < 0 || d->epoll_fd < 0 ||
+        bind(d->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        ph_hashd_free(d);
+        return PH_ERR_IO;
+    }
+    d->bound = 1;
+    if (listen(d->listen_fd, SOMAXCONN) != 0 ||
+        watch(d, EPOLL_CTL_ADD, d->listen_fd, EPOLLIN, &d->listen_fd) != 0 ||
+        watch(d, EPOLL_CTL_ADD, d->stop_fd, EPOLLIN, &d->stop_fd) != 0) {
+        ph_hashd_free(d);
+        return PH_ERR_IO;
+    }
+
+    *out_daemon = d;
+    return PH_SUCCESS;
+}
+
+static void drop_conn(ph_hashd_t *d, size_t i) {
+    conn_t *c = d->conns[i];
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    ph_mem_free(NULL, c->in);
+    ph_mem_free(NULL, c->out);
+    ph_mem_free(NULL, c);
+    d->conns[i] = d->conns[--d->nconns];
+}
+
+static void accept_conns(ph_hashd_t *d) {
+    for (;;) {
+        int fd = accept4(d->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        conn_t *c = ph_mem_calloc(NULL, 1, sizeof(conn_t));
+        if (!c || !grow((void **)&d->conns, &d->conns_cap, d->nconns + 1, sizeof(conn_t *)) ||
+            watch(d, EPOLL_CTL_ADD, fd, EPOLLIN, c) != 0) {
+            ph_mem_free(NULL, c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        d->conns[d->nconns++] = c;
+    }
+}
+
+static void read_conn(conn_t *c) {
+    while (c->in_len < READ_LIMIT) {
+        if (!grow((void **)&c->in, &c->in_cap, c->in_len + READ_CHUNK, 1)) {
+            c->closed = 1;
+            return;
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                c->closed = 1;
+            return;
+        }
+    }
+}
+
+static void write_conn(ph_hashd_t *d, conn_t *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_off += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            c->closed = 1;
+            return;
+        }
+    }
+    int pending = c->out_off < c->out_len;
+    if (!pending)
+        c->out_off = c->out_len = 0;
+    /* While a response is unsent the connection is not read: backpressure */
+    if (pending != c->writing) {
+        if (watch(d, EPOLL_CTL_MOD, c->fd, pending ? EPOLLOUT : EPOLLIN, c) != 0)
+            c->closed = 1;
+        c->writing = pending;
+    }
+}
+
+static int32_t check_request(const ph_hashd_request_t *r) {
+    if (r->op != PH_HASHD_OP_RADIUS && r->op != PH_HASHD_OP_KNN)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (r->limit == 0 || r->limit > PH_HASHD_MAX_RESULTS ||
+        (uint64_t)r->count * r->limit > PH_HASHD_MAX_SLOTS)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (r->op == PH_HASHD_OP_KNN && r->param != r->limit)
+        return PH_ERR_INVALID_ARGUMENT;
+    return PH_SUCCESS;
+}
+
+/* Takes the complete requests buffered on idle connections into the batch,
+ * up to BATCH_SLOTS result slots. Sets *deferred when requests were left
+ * for another pass. A request that cannot get memory is answered with
+ * PH_ERR_ALLOCATION_FAILED. Returns the number of queries. */
+static size_t collect(ph_hashd_t *d, size_t *out_jobs, int *deferred) {
+    size_t njobs = 0, nqueries = 0, nslots = 0;
+    *deferred = 0;
+
+    for (size_t i = 0; i < d->nconns; i++) {
+        conn_t *c = d->conns[i];
+        c->in_done = 0;
+        if (c->closed || c->writing)
+            continue;
+        for (;;) {
+            ph_hashd_request_t req;
+            size_t avail = c->in_len - c->in_done;
+            if (avail < sizeof(req))
+                break;
+            memcpy(&req, c->in + c->in_done, sizeof(req));
+            if (req.magic != PH_HASHD_MAGIC || req.count > PH_HASHD_MAX_QUERIES) {
+                c->closed = 1; /* Cannot resynchronise the stream */
+                break;
+            }
+            size_t size = sizeof(req) + (size_t)req.count * sizeof(uint64_t);
+            if (avail < size)
+                break;
+            int32_t status = check_request(&req);
+            size_t slots = status == PH_SUCCESS ? (size_t)req.count * req.limit : 0;
+            if (nslots + slots > BATCH_SLOTS) {
+                /* The rest of this connection waits, keeping its order */
+                *deferred = 1;
+                break;
+            }
+            /* ph_hashd_create() reserved the first jobs, so a pass always
+             * takes at least one request and the rest can wait */
+            if (!grow((void **)&d->jobs, &d->jobs_cap, njobs + 1, sizeof(job_t))) {
+                *deferred = 1;
+                goto done;
+            }
+
+            job_t *job = &d->jobs[njobs++];
+            job->conn = c;
+            job->req = req;
+            job->queries = (const uint64_t *)(c->in + c->in_done + sizeof(req));
+            job->first = nqueries;
+            job->status = status;
+            c->in_done += size;
+            if (job->status != PH_SUCCESS)
+                continue;
+
+            size_t need = nqueries + req.count;
+            size_t cap = d->queries_cap;
+            if (!grow((void **)&d->totals, &cap, need, sizeof(uint32_t)) ||
+                !grow((void **)&d->slot, &d->queries_cap, need, sizeof(size_t)) ||
+                !grow((void **)&d->results, &d->results_cap, nslots + slots,
+                      sizeof(ph_candidate_t))) {
+                job->status = PH_ERR_ALLOCATION_FAILED;
+                continue;
+            }
+            for (uint32_t q = 0; q < req.count; q++) {
+                d->totals[nqueries + q] = 0;
+                d->slot[nqueries + q] = nslots + (size_t)q * req.limit;
+            }
+            nqueries = need;
+            nslots += slots;
+        }
+    }
+
+done:
+    *out_jobs = njobs;
+    return nqueries;
+}
+
+/* The single pass: each block of the store against every queued query */
+static void scan_batch(ph_hashd_t *d, size_t njobs) {
+    for (size_t start = 0; start < d->count; start += BLOCK_HASHES) {
+        size_t end = d->count - start < BLOCK_HASHES ? d->count : start + BLOCK_HASHES;
+        const uint64_t *h = d->hashes;
+
+        for (size_t j = 0; j < njobs; j++) {
+            const job_t *job = &d->jobs[j];
+            if (job->status != PH_SUCCESS)
+                continue;
+            for (uint32_t q = 0; q < job->req.count; q++) {
+                uint64_t query;
+                memcpy(&query, &job->queries[q], sizeof(query));
+                uint32_t *total = &d->totals[job->first + q];
+                ph_candidate_t *res = d->results + d->slot[job->first + q];
+
+                if (job->req.op == PH_HASHD_OP_RADIUS) {
+                    for (size_t i = start; i < end; i++) {
+                        uint32_t dist = (uint32_t)ph_hamming_distance(h[i], query);
+                        if (dist > job->req.param)
+                            continue;
+                        if (*total < job->req.limit)
+                            res[*total] = (ph_candidate_t){dist, (uint32_t)i};
+                        if (*total < UINT32_MAX)
+                            (*total)++;
+                    }
+                } else {
+                    size_t kept = *total;
+                    for (size_t i = start; i < end; i++) {
+                        uint32_t dist = (uint32_t)ph_hamming_distance(h[i], query);
+                        if (kept == job->req.limit && dist > res[0].dist)
+                            continue;
+                        ph_topk_push(res, &kept, job->req.limit,
+                                     (ph_candidate_t){dist, (uint32_t)i});
+                    }
+                    *total = (uint32_t)kept;
+                }
+            }
+        }
+    }
+}
+
+static size_t response_size(const ph_hashd_t *d, const job_t *job) {
+    uint32_t count = job->status == PH_SUCCESS ? job->req.count : 0;
+    size_t entries = 0;
+    for (uint32_t q = 0; q < count; q++) {
+        uint32_t t = d->totals[job->first + q];
+        entries += t < job->req.limit ? t : job->req.limit;
+    }
+    return sizeof(ph_hashd_response_t) + count * sizeof(uint32_t) +
+           entries * 2 * sizeof(uint32_t);
+}
+
+/* Appends the job's response. Without memory for the results the request
+ * is answered with PH_ERR_ALLOCATION_FAILED alone, and without memory even
+ * for that the connection is dropped. */
+static void respond(ph_hashd_t *d, job_t *job) {
+    conn_t *c = job->conn;
+    size_t size = response_size(d, job);
+    if (!grow((void **)&c->out, &c->out_cap, c->out_len + size, 1)) {
+        job->status = PH_ERR_ALLOCATION_FAILED;
+        size = response_size(d, job);
+        if (!grow((void **)&c->out, &c->out_cap, c->out_len + size, 1)) {
+            c->closed = 1;
+            return;
+        }
+    }
+    uint32_t count = job->status == PH_SUCCESS ? job->req.count : 0;
+
+    uint8_t *p = c->out + c->out_len;
+    ph_hashd_response_t resp = {PH_HASHD_MAGIC, job->status, count};
+    memcpy(p, &resp, sizeof(resp));
+    p += sizeof(resp);
+    memcpy(p, d->totals + job->first, count * sizeof(uint32_t));
+    p += count * sizeof(uint32_t);
+    for (uint32_t q = 0; q < count; q++) {
+        uint32_t t = d->totals[job->first + q];
+        size_t n = t < job->req.limit ? t : job->req.limit;
+        ph_candidate_t *res = d->results + d->slot[job->first + q];
+        if (job->req.op == PH_HASHD_OP_KNN)
+            ph_topk_sort(res, n);
+        for (size_t i = 0; i < n; i++) {
+            uint32_t pair[2] = {res[i].index, res[i].dist};
+            memcpy(p, pair, sizeof(pair));
+            p += sizeof(pair);
+        }
+    }
+    c->out_len += size;
+}
+
+/* Answers the buffered requests in passes of at most BATCH_SLOTS. Deferred
+ * requests are already buffered and epoll will not report them again, so
+ * the passes continue until nothing was left behind. */
+static void serve_batch(ph_hashd_t *d) {
+    int deferred;
+    do {
+        size_t njobs = 0;
+        size_t nqueries = collect(d, &njobs, &deferred);
+        if (njobs == 0)
+            return;
+
+        if (nqueries > 0)
+            scan_batch(d, njobs);
+        for (size_t j = 0; j < njobs; j++)
+            respond(d, &d->jobs[j]);
+
+        /* Consume the answered requests and start sending */
+        for (size_t i = 0; i < d->nconns; i++) {
+            conn_t *c = d->conns[i];
+            if (c->in_done == 0)
+                continue;
+            memmove(c->in, c->in + c->in_done, c->in_len - c->in_done);
+            c->in_len -= c->in_done;
+            c->in_done = 0;
+            write_conn(d, c);
+        }
+    } while (deferred);
+}
+
+PH_API ph_error_t ph_hashd_run(ph_hashd_t *daemon) {
+    if (!daemon)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    struct epoll_event events[64];
+    for (;;) {
+        int n = epoll_wait(daemon->epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return PH_ERR_IO;
+        }
+
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &daemon->stop_fd) {
+                uint64_t value;
+                ssize_t r = read(daemon->stop_fd, &value, sizeof(value));
+                (void)r;
+                return PH_SUCCESS;
+            }
+            if (ptr == &daemon->listen_fd) {
+                accept_conns(daemon);
+                continue;
+            }
+            conn_t *c = ptr;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                c->closed = 1;
+            if (events[i].events & EPOLLIN)
+                read_conn(c);
+            if (events[i].events & EPOLLOUT)
+                write_conn(daemon, c);
+        }
+
+        serve_batch(daemon);
+        for (size_t i = daemon->nconns; i-- > 0;) {
+            if (daemon->conns[i]->closed)
+                drop_conn(daemon, i);
+        }
+    }
+}
+
+PH_API void ph_hashd_stop(ph_hashd_t *daemon) {
+    if (daemon && daemon->stop_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t n = write(daemon->stop_fd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+PH_API void ph_hashd_free(ph_hashd_t *daemon) {
+    if (!daemon)
+        return;
+    while (daemon->nconns > 0)
+        drop_conn(daemon, daemon->nconns - 1);
+    if (daemon->listen_fd >= 0)
+        close(daemon->listen_fd);
+    if (daemon->bound)
+        unlink(daemon->socket_path);
+    if (daemon->stop_fd >= 0)
+        close(daemon->stop_fd);
+    if (daemon->epoll_fd >= 0)
+        close(daemon->epoll_fd);
+    if (daemon->map)
+        munmap(daemon->map, daemon->map_len);
+    ph_mem_free(NULL, daemon->socket_path);
+    ph_mem_free(NULL, daemon->conns);
+    ph_mem_free(NULL, daemon->jobs);
+    ph_mem_free(NULL, daemon->totals);
+    ph_mem_free(NULL, daemon->slot);
+    ph_mem_free(NULL, daemon->results);
+    ph_mem_free(NULL, daemon);
+}
+
+#else
+
+PH_API ph_error_t ph_hashd_create(const char *store_path, const char *socket_path,
+                                  ph_hashd_t **out_daemon) {
+    (void)store_path;
+    (void)socket_path;
+    (void)out_daemon;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API ph_error_t ph_hashd_run(ph_hashd_t *daemon) {
+    (void)daemon;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API void ph_hashd_stop(ph_hashd_t *daemon) { (void)daemon; }
+
+PH_API void ph_hashd_free(ph_hashd_t *daemon) { (void)daemon; }
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PH_HASHD_H
+#define PH_HASHD_H
+
+#include <stdint.h>
+
+/*
+ * Hash store file and phashd wire protocol.
+ *
+ * Both ends of the socket run on the same host, so every field is in
+ * native byte order. A request is a ph_hashd_request_t followed by 'count'
+ * uint64_t queries. The response is a ph_hashd_response_t, then 'count'
+ * uint32_t totals, then for every query min(total, limit) entries of two
+ * uint32_t (index, distance). Requests on one connection are answered in
+ * order.
+ */
+
+#define PH_STORE_MAGIC 0x53484850u /* "PHHS" */
+#define PH_STORE_VERSION 1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;
+} ph_store_header_t;
+
+#define PH_HASHD_MAGIC 0x31514850u /* "PHQ1" */
+
+/* Queries per request, and result slots (count * limit) per request */
+#define PH_HASHD_MAX_QUERIES 4096u
+#define PH_HASHD_MAX_SLOTS (1u << 20)
+
+enum { PH_HASHD_OP_RADIUS = 1, PH_HASHD_OP_KNN = 2 };
+
+typedef struct {
+    uint32_t magic;
+    uint16_t op;
+    uint16_t reserved;
+    uint32_t param; /* radius, or k */
+    uint32_t limit; /* result slots per query */
+    uint32_t count; /* number of queries */
+} ph_hashd_request_t;
+
+typedef struct {
+    uint32_t magic;
+    int32_t status; /* ph_error_t */
+    uint32_t count;
+} ph_hashd_response_t;
+
+#endif /* PH_HASHD_H */
@@ -0,0 +1,226 @@
+#include "hashd.h"
+#include "internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+ * phashd client.
+ *
+ * Batches are split into requests the daemon accepts (at most
+ * PH_HASHD_MAX_QUERIES queries and PH_HASHD_MAX_SLOTS result slots) and
+ * sent one round trip at a time. A transport error leaves the stream out
+ * of step, so the connection is closed and later calls fail with
+ * PH_ERR_IO.
+ */
+
+#if defined(__linux__)
+
+struct ph_hashd_client {
+    int fd;
+    uint8_t *buf;
+    size_t cap;
+};
+
+PH_API ph_error_t ph_hashd_connect(const char *socket_path, ph_hashd_client_t **out_client) {
+    struct sockaddr_un addr;
+    if (!socket_path || !out_client || strlen(socket_path) >= sizeof(addr.sun_path))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_hashd_client_t *c = ph_mem_calloc(NULL, 1, sizeof(ph_hashd_client_t));
+    if (!c)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, socket_path, strlen(socket_path));
+    c->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        if (c->fd >= 0)
+            close(c->fd);
+        ph_mem_free(NULL, c);
+        return PH_ERR_IO;
+    }
+    *out_client = c;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_hashd_disconnect(ph_hashd_client_t *client) {
+    if (client) {
+        if (client->fd >= 0)
+            close(client->fd);
+        ph_mem_free(NULL, client->buf);
+        ph_mem_free(NULL, client);
+    }
+}
+
+static int reserve(ph_hashd_client_t *c, size_t size) {
+    if (size <= c->cap)
+        return 1;
+    uint8_t *buf = ph_mem_realloc(NULL, c->buf, c->cap, size);
+    if (!buf)
+        return 0;
+    c->buf = buf;
+    c->cap = size;
+    return 1;
+}
+
+static int send_all(int fd, const uint8_t *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return 0;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+static int recv_all(int fd, uint8_t *p, size_t n) {
+    while (n > 0) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return 0;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 1;
+}
+
+static ph_error_t broken(ph_hashd_client_t *c) {
+    close(c->fd);
+    c->fd = -1;
+    return PH_ERR_IO;
+}
+
+/* One request of n <= PH_HASHD_MAX_QUERIES queries */
+static ph_error_t round_trip(ph_hashd_client_t *c, uint16_t op, uint32_t param, uint32_t limit,
+                             const uint64_t *queries, uint32_t n, ph_match_t *out_matches,
+                             size_t *out_counts) {
+    ph_hashd_request_t req = {PH_HASHD_MAGIC, op, 0, param, limit, n};
+    size_t size = sizeof(req) + (size_t)n * sizeof(uint64_t);
+    if (!reserve(c, size))
+        return PH_ERR_ALLOCATION_FAILED;
+    memcpy(c->buf, &req, sizeof(req));
+    memcpy(c->buf + sizeof(req), queries, (size_t)n * sizeof(uint64_t));
+    if (!send_all(c->fd, c->buf, size))
+        return broken(c);
+
+    ph_hashd_response_t resp;
+    if (!recv_all(c->fd, (uint8_t *)&resp, sizeof(resp)) || resp.magic != PH_HASHD_MAGIC)
+        return broken(c);
+    if (resp.status != PH_SUCCESS)
+        return resp.count == 0 ? (ph_error_t)resp.status : broken(c);
+    if (resp.count != n)
+        return broken(c);
+
+    if (!recv_all(c->fd, c->buf, (size_t)n * sizeof(uint32_t)))
+        return broken(c);
+    size_t entries = 0;
+    for (uint32_t q = 0; q < n; q++) {
+        uint32_t total;
+        memcpy(&total, c->buf + q * sizeof(uint32_t), sizeof(total));
+        out_counts[q] = total;
+        entries += total < limit ? total : limit;
+    }
+
+    if (!reserve(c, entries * 2 * sizeof(uint32_t)))
+        return broken(c);
+    if (!recv_all(c->fd, c->buf, entries * 2 * sizeof(uint32_t)))
+        return broken(c);
+    const uint8_t *p = c->buf;
+    for (uint32_t q = 0; q < n; q++) {
+        size_t kept = out_counts[q] < limit ? out_counts[q] : limit;
+        for (size_t i = 0; i < kept; i++) {
+            uint32_t pair[2];
+            memcpy(pair, p, sizeof(pair));
+            p += sizeof(pair);
+            out_matches[(size_t)q * limit + i].index = pair[0];
+            out_matches[(size_t)q * limit + i].distance = (float)pair[1];
+        }
+    }
+    return PH_SUCCESS;
+}
+
+static ph_error_t query(ph_hashd_client_t *c, uint16_t op, uint32_t param, size_t limit,
+                        const uint64_t *queries, size_t n, ph_match_t *out_matches,
+                        size_t *out_counts) {
+    if (c->fd < 0)
+        return PH_ERR_IO;
+
+    size_t chunk = PH_HASHD_MAX_SLOTS / limit;
+    if (chunk > PH_HASHD_MAX_QUERIES)
+        chunk = PH_HASHD_MAX_QUERIES;
+    for (size_t start = 0; start < n; start += chunk) {
+        size_t m = n - start < chunk ? n - start : chunk;
+        ph_error_t err = round_trip(c, op, param, (uint32_t)limit, queries + start, (uint32_t)m,
+                                    out_matches + start * limit, out_counts + start);
+        if (err != PH_SUCCESS)
+            return err;
+    }
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_hashd_radius(ph_hashd_client_t *client, const uint64_t *queries, size_t n,
+                                  int radius, ph_match_t *out_matches, size_t max_per_query,
+                                  size_t *out_counts) {
+    if (!client || (n > 0 && (!queries || !out_matches || !out_counts)) || radius < 0 ||
+        max_per_query == 0 || max_per_query > PH_HASHD_MAX_RESULTS)
+        return PH_ERR_INVALID_ARGUMENT;
+    return query(client, PH_HASHD_OP_RADIUS, (uint32_t)radius, max_per_query, queries, n,
+                 out_matches, out_counts);
+}
+
+PH_API ph_error_t ph_hashd_knn(ph_hashd_client_t *client, const uint64_t *queries, size_t n,
+                               size_t k, ph_match_t *out_matches, size_t *out_counts) {
+    if (!client || (n > 0 && (!queries || !out_matches || !out_counts)) || k == 0 ||
+        k > PH_HASHD_MAX_RESULTS)
+        return PH_ERR_INVALID_ARGUMENT;
+    return query(client, PH_HASHD_OP_KNN, (uint32_t)k, k, queries, n, out_matches, out_counts);
+}
+
+#else
+
+PH_API ph_error_t ph_hashd_connect(const char *socket_path, ph_hashd_client_t **out_client) {
+    (void)socket_path;
+    (void)out_client;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API void ph_hashd_disconnect(ph_hashd_client_t *client) { (void)client; }
+
+PH_API ph_error_t ph_hashd_radius(ph_hashd_client_t *client, const uint64_t *queries, size_t n,
+                                  int radius, ph_match_t *out_matches, size_t max_per_query,
+                                  size_t *out_counts) {
+    (void)client;
+    (void)queries;
+    (void)n;
+    (void)radius;
+    (void)out_matches;
+    (void)max_per_query;
+    (void)out_counts;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+PH_API ph_error_t ph_hashd_knn(ph_hashd_client_t *client, const uint64_t *queries, size_t n,
+                               size_t k, ph_match_t *out_matches, size_t *out_counts) {
+    (void)client;
+    (void)queries;
+    (void)n;
+    (void)k;
+    (void)out_matches;
+    (void)out_counts;
+    return PH_ERR_NOT_IMPLEMENTED;
+}
+
+#endif
@@ -1,19 +1,7 @@
 #include "../internal.h"
 #include <stdlib.h>
 
-PH_API ph_error_t ph_compute_ahash(ph_context_t *ctx, uint64_t *out_hash) {
-    if (!ctx || !ctx->is_loaded || !out_hash) {
-        return PH_ERR_INVALID_ARGUMENT;
-    }
-
-    uint8_t *gray_full = ph_get_gray(ctx);
-    if (!gray_full) {
-        return PH_ERR_ALLOCATION_FAILED;
-    }
-
-    uint8_t tiny[64];
-    ph_resize_bilinear(gray_full, ctx->width, ctx->height, tiny, 8, 8);
-
+uint64_t ph_ahash_kernel(const uint8_t tiny[64]) {
     uint64_t total_sum = 0;
     for (int i = 0; i < 64; i++) {
         total_sum += tiny[i];
@@ -26,7 +14,31 @@ PH_API ph_error_t ph_compute_ahash(ph_context_t *ctx, uint64_t *out_hash) {
             hash |= (1ULL << i);
         }
     }
+    return hash;
+}
+
+PH_API ph_error_t ph_compute_ahash(ph_context_t *ctx, uint64_t *out_hash) {
+    if (!ctx || !ctx->is_loaded || !out_hash) {
+        return PH_ERR_INVALID_ARGUMENT;
+    }
+
+    if (ph_cache_fetch(ctx, PH_ALGO_AHASH, out_hash))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
+    // Resample from the nearest pyramid level above the target size
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 8, 8, &w, &h);
+    if (!level) {
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+
+    uint8_t tiny[64];
+    ph_resize_bilinear(level, w, h, tiny, 8, 8);
 
-    *out_hash = hash;
+    *out_hash = ph_ahash_kernel(tiny);
+    ph_cache_store(ctx, PH_ALGO_AHASH, out_hash);
     return PH_SUCCESS;
 }
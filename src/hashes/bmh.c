@@ -7,18 +7,23 @@ PH_API ph_error_t ph_compute_bmh(ph_context_t *ctx, ph_digest_t *out_digest) {
         return PH_ERR_INVALID_ARGUMENT;
     }
 
+    if (ph_cache_fetch(ctx, PH_ALGO_BMH, out_digest))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
     // Clear digest and set size (256 bits = 32 bytes)
     memset(out_digest, 0, sizeof(ph_digest_t));
     out_digest->size = 32;
 
     uint8_t pixels[256];
-    uint8_t *full_gray = malloc(ctx->width * ctx->height);
-    if (!full_gray)
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 16, 16, &w, &h);
+    if (!level)
         return PH_ERR_ALLOCATION_FAILED;
 
-    ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, full_gray);
-    ph_resize_grayscale(full_gray, ctx->width, ctx->height, pixels, 16, 16);
-    free(full_gray);
+    ph_resize_grayscale(level, w, h, pixels, 16, 16);
 
     uint64_t total_sum = 0;
     for (int i = 0; i < 256; i++) {
@@ -32,5 +37,6 @@ PH_API ph_error_t ph_compute_bmh(ph_context_t *ctx, ph_digest_t *out_digest) {
         }
     }
 
+    ph_cache_store(ctx, PH_ALGO_BMH, out_digest);
     return PH_SUCCESS;
 }
@@ -7,6 +7,14 @@ PH_API ph_error_t ph_compute_color_hash(ph_context_t *ctx, ph_digest_t *out_dige
     if (!ctx || !ctx->is_loaded || !out_digest) {
         return PH_ERR_INVALID_ARGUMENT;
     }
+    if (ctx->load_flags & PH_LOAD_GRAY_ONLY)
+        return PH_ERR_NO_COLOR;
+
+    if (ph_cache_fetch(ctx, PH_ALGO_COLOR, out_digest))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
 
     /* We calculate 3 color moments for 3 channels (R, G, B) = 9 values total.
      * Each value is stored as 1 byte (9 bytes required).
@@ -16,11 +24,14 @@ PH_API ph_error_t ph_compute_color_hash(ph_context_t *ctx, ph_digest_t *out_dige
 
     double mean[3] = {0}, std_dev[3] = {0}, skew[3] = {0};
     int num_pixels = ctx->width * ctx->height;
+    // Gray images repeat their single channel as R, G and B
+    int stride = ctx->channels;
+    int step = ctx->channels < 3 ? 0 : 1;
 
     /* Step 1: Calculate the Arithmetic Mean */
     for (int i = 0; i < num_pixels; i++) {
         for (int c = 0; c < 3; c++) {
-            mean[c] += ctx->data[i * ctx->channels + c];
+            mean[c] += ctx->data[i * stride + c * step];
         }
     }
     for (int c = 0; c < 3; c++) {
@@ -31,7 +42,7 @@ PH_API ph_error_t ph_compute_color_hash(ph_context_t *ctx, ph_digest_t *out_dige
      */
     for (int i = 0; i < num_pixels; i++) {
         for (int c = 0; c < 3; c++) {
-            double diff = ctx->data[i * ctx->channels + c] - mean[c];
+            double diff = ctx->data[i * stride + c * step] - mean[c];
             std_dev[c] += diff * diff;
             skew[c] += diff * diff * diff;
         }
@@ -52,5 +63,6 @@ PH_API ph_error_t ph_compute_color_hash(ph_context_t *ctx, ph_digest_t *out_dige
         out_digest->data[c * 3 + 2] = (uint8_t)fmin(255.0, fabs(skew[c]));
     }
 
+    ph_cache_store(ctx, PH_ALGO_COLOR, out_digest);
     return PH_SUCCESS;
 }
@@ -9,6 +9,11 @@
 #elif defined(__SSE4_2__)
 #include <nmmintrin.h>
 #endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 PH_API int ph_hamming_distance(uint64_t hash1, uint64_t hash2) {
     uint64_t x = hash1 ^ hash2;
@@ -85,14 +90,115 @@ PH_API int ph_hamming_distance_digest(const ph_digest_t *a, const ph_digest_t *b
     return total;
 }
 
+/*
+ * Byte-vector distance kernels. Differences are widened to 16 bits and
+ * squared with a multiply-add into 32-bit lanes (SAD has a dedicated
+ * instruction on x86), so the whole computation stays in integers.
+ */
+static inline uint32_t l2_sq(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint32_t total = 0;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i zero256 = _mm256_setzero_si256();
+    __m256i acc256 = zero256;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i lo = _mm256_sub_epi16(_mm256_unpacklo_epi8(va, zero256),
+                                      _mm256_unpacklo_epi8(vb, zero256));
+        __m256i hi = _mm256_sub_epi16(_mm256_unpackhi_epi8(va, zero256),
+                                      _mm256_unpackhi_epi8(vb, zero256));
+        acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(lo, lo));
+        acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(hi, hi));
+    }
+    __m128i acc = _mm_add_epi32(_mm256_castsi256_si128(acc256),
+                                _mm256_extracti128_si256(acc256, 1));
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+#endif
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    total += (uint32_t)_mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+        acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+        acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+    }
+    total += vaddvq_u32(acc);
+#endif
+
+    for (; i < n; i++) {
+        int32_t diff = (int32_t)a[i] - (int32_t)b[i];
+        total += (uint32_t)(diff * diff);
+    }
+    return total;
+}
+
+static inline uint32_t sad(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint32_t total = 0;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    __m256i acc256 = _mm256_setzero_si256();
+    for (; i + 32 <= n; i += 32) {
+        acc256 = _mm256_add_epi64(
+            acc256, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                    _mm256_loadu_si256((const __m256i *)(b + i))));
+    }
+    __m128i acc = _mm_add_epi64(_mm256_castsi256_si128(acc256),
+                                _mm256_extracti128_si256(acc256, 1));
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+#endif
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(a + i)),
+                                              _mm_loadu_si128((const __m128i *)(b + i))));
+    }
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+    total += (uint32_t)_mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+    total += vaddvq_u32(acc);
+#endif
+
+    for (; i < n; i++)
+        total += (uint32_t)(a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]);
+    return total;
+}
+
+uint32_t ph_l2_sq_u8(const uint8_t *a, const uint8_t *b, size_t n) { return l2_sq(a, b, n); }
+
+void ph_l2_sq_rows(const uint8_t *query, const uint8_t *rows, size_t n, size_t count,
+                   uint32_t *out) {
+    for (size_t r = 0; r < count; r++)
+        out[r] = l2_sq(query, rows + r * n, n);
+}
+
+void ph_sad_rows(const uint8_t *query, const uint8_t *rows, size_t n, size_t count,
+                 uint32_t *out) {
+    for (size_t r = 0; r < count; r++)
+        out[r] = sad(query, rows + r * n, n);
+}
+
 PH_API double ph_l2_distance(const ph_digest_t *a, const ph_digest_t *b) {
     if (!a || !b || a->size != b->size)
         return -1.0;
 
-    double sum = 0;
-    for (int i = 0; i < a->size; i++) {
-        double diff = (double)a->data[i] - (double)b->data[i];
-        sum += diff * diff;
-    }
-    return sqrt(sum);
+    return sqrt((double)l2_sq(a->data, b->data, a->size));
 }
@@ -1,28 +1,39 @@
 #include "../internal.h"
 #include <stdlib.h>
 
+uint64_t ph_dhash_kernel(const uint8_t tiny[72]) {
+    uint64_t hash = 0;
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            if (tiny[row * 9 + col] < tiny[row * 9 + col + 1]) {
+                hash |= (1ULL << (row * 8 + col));
+            }
+        }
+    }
+    return hash;
+}
+
 PH_API ph_error_t ph_compute_dhash(ph_context_t *ctx, uint64_t *out_hash) {
     if (!ctx || !ctx->is_loaded || !out_hash) {
         return PH_ERR_INVALID_ARGUMENT;
     }
 
-    uint8_t *gray_full = ph_get_gray(ctx);
-    if (!gray_full) {
+    if (ph_cache_fetch(ctx, PH_ALGO_DHASH, out_hash))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 9, 8, &w, &h);
+    if (!level) {
         return PH_ERR_ALLOCATION_FAILED;
     }
 
     uint8_t tiny[72];
-    ph_resize_bilinear(gray_full, ctx->width, ctx->height, tiny, 9, 8);
-
-    uint64_t hash = 0;
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            if (tiny[row * 9 + col] < tiny[row * 9 + col + 1]) {
-                hash |= (1ULL << (row * 8 + col));
-            }
-        }
-    }
+    ph_resize_bilinear(level, w, h, tiny, 9, 8);
 
-    *out_hash = hash;
+    *out_hash = ph_dhash_kernel(tiny);
+    ph_cache_store(ctx, PH_ALGO_DHASH, out_hash);
     return PH_SUCCESS;
 }
@@ -1,18 +1,8 @@
 #include "../internal.h"
 #include <stdlib.h>
 
-PH_API ph_error_t ph_compute_mhash(ph_context_t *ctx, uint64_t *out_hash) {
-    if (!ctx || !ctx->is_loaded || !out_hash)
-        return PH_ERR_INVALID_ARGUMENT;
-
-    // 1. Resize to 16x16 to capture structural edges
-    uint8_t tiny[256];
-    uint8_t *full_gray = malloc(ctx->width * ctx->height);
-    ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, full_gray);
-    ph_resize_grayscale(full_gray, ctx->width, ctx->height, tiny, 16, 16);
-    free(full_gray);
-
-    // 2. Simple 3x3 Laplacian Kernel for edge detection
+uint64_t ph_mhash_kernel(const uint8_t tiny[256]) {
+    // Simple 3x3 Laplacian Kernel for edge detection
     //  0 -1  0
     // -1  4 -1
     //  0 -1  0
@@ -28,6 +18,28 @@ PH_API ph_error_t ph_compute_mhash(ph_context_t *ctx, uint64_t *out_hash) {
             bit_idx++;
         }
     }
-    *out_hash = hash;
+    return hash;
+}
+
+PH_API ph_error_t ph_compute_mhash(ph_context_t *ctx, uint64_t *out_hash) {
+    if (!ctx || !ctx->is_loaded || !out_hash)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    if (ph_cache_fetch(ctx, PH_ALGO_MHASH, out_hash))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
+    // Resize to 16x16 to capture structural edges
+    uint8_t tiny[256];
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 16, 16, &w, &h);
+    if (!level)
+        return PH_ERR_ALLOCATION_FAILED;
+    ph_resize_grayscale(level, w, h, tiny, 16, 16);
+
+    *out_hash = ph_mhash_kernel(tiny);
+    ph_cache_store(ctx, PH_ALGO_MHASH, out_hash);
     return PH_SUCCESS;
 }
@@ -1,78 +1,163 @@
 #include "../internal.h"
+#include "../tables.h"
 #include <math.h>
-#include <stdatomic.h>
-#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
-static double dct_matrix[32][32];
-static atomic_bool dct_globally_initialized = false;
+/* The DCT basis is a generated constant table; nothing to initialize.
+ * Kept because it is part of the public ABI. */
+void init_dct_matrix(void) {}
 
-void init_dct_matrix(void) {
-    if (atomic_exchange(&dct_globally_initialized, true)) {
-        return;
+/* Low-frequency 8x8 corner of the DCT of a 32x32 image. The eight outputs
+ * of a row are accumulated side by side, so the loops vectorize while each
+ * sum still runs over k in order. */
+static void low_frequencies(const uint8_t gray32[1024], double block[64]) {
+    // Only the 8 lowest frequencies are needed in each direction
+    double basis_t[32][8];
+    for (int j = 0; j < 8; j++) {
+        for (int k = 0; k < 32; k++)
+            basis_t[k][j] = ph_dct_matrix[j][k];
     }
-    double c = sqrt(1.0 / 32.0);
-    for (int j = 0; j < 32; j++)
-        dct_matrix[0][j] = c;
-
-    c = sqrt(2.0 / 32.0);
-    for (int i = 1; i < 32; i++) {
-        for (int j = 0; j < 32; j++) {
-            dct_matrix[i][j] = c * cos(M_PI * i * (j + 0.5) / 32.0);
+    double temp[32][8];
+    for (int i = 0; i < 32; i++) {
+        double sum[8] = {0};
+        for (int k = 0; k < 32; k++) {
+            double v = gray32[i * 32 + k];
+            for (int j = 0; j < 8; j++)
+                sum[j] += basis_t[k][j] * v;
+        }
+        memcpy(temp[i], sum, sizeof(sum));
+    }
+    for (int i = 0; i < 8; i++) {
+        double sum[8] = {0};
+        for (int k = 0; k < 32; k++) {
+            for (int j = 0; j < 8; j++)
+                sum[j] += ph_dct_matrix[i][k] * temp[k][j];
         }
+        memcpy(block + i * 8, sum, sizeof(sum));
+    }
+}
+
+/* One bit per coefficient above the mean of the 63 AC coefficients */
+static uint64_t threshold_block(const double block[64]) {
+    double sum_dct = 0;
+    for (int i = 1; i < 64; i++)
+        sum_dct += block[i];
+
+    double avg = sum_dct / 63.0;
+    uint64_t hash = 0;
+    for (int i = 0; i < 64; i++) {
+        if (block[i] > avg)
+            hash |= (1ULL << i);
     }
-    dct_globally_initialized = true;
+    return hash;
+}
+
+uint64_t ph_phash_kernel(const uint8_t gray32[1024]) {
+    double block[64];
+    low_frequencies(gray32, block);
+    return threshold_block(block);
+}
+
+/* Resamples the image to the 32x32 input of the DCT */
+static ph_error_t load_gray32(ph_context_t *ctx, uint8_t gray32[1024]) {
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 32, 32, &w, &h);
+    if (!level)
+        return PH_ERR_ALLOCATION_FAILED;
+    ph_resize_bilinear(level, w, h, gray32, 32, 32);
+    return PH_SUCCESS;
 }
 
 PH_API ph_error_t ph_compute_phash(ph_context_t *ctx, uint64_t *out_hash) {
     if (!ctx || !ctx->is_loaded || !out_hash)
         return PH_ERR_INVALID_ARGUMENT;
 
-    uint8_t *gray_full = ph_get_gray(ctx);
-    if (!gray_full)
-        return PH_ERR_ALLOCATION_FAILED;
+    if (ph_cache_fetch(ctx, PH_ALGO_PHASH, out_hash))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
 
     uint8_t gray32[1024];
-    ph_resize_bilinear(gray_full, ctx->width, ctx->height, gray32, 32, 32);
+    err = load_gray32(ctx, gray32);
+    if (err != PH_SUCCESS)
+        return err;
 
-    double temp[1024], dct_out[1024];
+    *out_hash = ph_phash_kernel(gray32);
+    ph_cache_store(ctx, PH_ALGO_PHASH, out_hash);
+    return PH_SUCCESS;
+}
 
-    for (int i = 0; i < 32; i++) {
-        for (int j = 0; j < 32; j++) {
-            double sum = 0;
-            for (int k = 0; k < 32; k++)
-                sum += dct_matrix[j][k] * gray32[i * 32 + k];
-            temp[i * 32 + j] = sum;
-        }
-    }
-    for (int j = 0; j < 32; j++) {
-        for (int i = 0; i < 32; i++) {
-            double sum = 0;
-            for (int k = 0; k < 32; k++)
-                sum += dct_matrix[i][k] * temp[k * 32 + j];
-            dct_out[i * 32 + j] = sum;
-        }
-    }
+/*
+ * Orientations in the order of ph_phash_orientation_t, as operations on the
+ * DCT block: mirroring a signal of length N flips the sign of its odd
+ * frequencies (X'[k] = (-1)^k X[k]), and transposing the image transposes
+ * the coefficients. 'transpose' is applied first.
+ */
+static const struct {
+    uint8_t transpose;
+    uint8_t negate_odd_rows; /* Vertical mirror */
+    uint8_t negate_odd_cols; /* Horizontal mirror */
+} s_orientations[8] = {
+    {0, 0, 0}, /* Identity */
+    {1, 0, 1}, /* Rotated 90 degrees clockwise */
+    {0, 1, 1}, /* Rotated 180 degrees */
+    {1, 1, 0}, /* Rotated 270 degrees clockwise */
+    {0, 0, 1}, /* Mirrored left-right */
+    {0, 1, 0}, /* Mirrored top-bottom */
+    {1, 0, 0}, /* Transposed (main diagonal) */
+    {1, 1, 1}, /* Transposed (anti-diagonal) */
+};
 
-    double sum_dct = 0;
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (i == 0 && j == 0)
-                continue;
-            sum_dct += dct_out[i * 32 + j];
-        }
-    }
+PH_API ph_error_t ph_compute_phash_dihedral(ph_context_t *ctx, uint64_t out_hashes[8]) {
+    if (!ctx || !ctx->is_loaded || !out_hashes)
+        return PH_ERR_INVALID_ARGUMENT;
 
-    double avg = sum_dct / 63.0;
-    uint64_t hash = 0;
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (dct_out[i * 32 + j] > avg) {
-                hash |= (1ULL << (i * 8 + j));
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
+    uint8_t gray32[1024];
+    err = load_gray32(ctx, gray32);
+    if (err != PH_SUCCESS)
+        return err;
+
+    double block[64];
+    low_frequencies(gray32, block);
+
+    for (int o = 0; o < 8; o++) {
+        double oriented[64];
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 8; j++) {
+                double c = s_orientations[o].transpose ? block[j * 8 + i] : block[i * 8 + j];
+                if ((s_orientations[o].negate_odd_rows && (i & 1)) ^
+                    (s_orientations[o].negate_odd_cols && (j & 1)))
+                    c = -c;
+                oriented[i * 8 + j] = c;
             }
         }
+        out_hashes[o] = threshold_block(oriented);
     }
 
-    *out_hash = hash;
+    ph_cache_store(ctx, PH_ALGO_PHASH, &out_hashes[PH_ORIENT_IDENTITY]);
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_compute_phash_canonical(ph_context_t *ctx, uint64_t *out_hash) {
+    if (!out_hash)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    uint64_t hashes[8];
+    ph_error_t err = ph_compute_phash_dihedral(ctx, hashes);
+    if (err != PH_SUCCESS)
+        return err;
+
+    uint64_t min = hashes[0];
+    for (int o = 1; o < 8; o++) {
+        if (hashes[o] < min)
+            min = hashes[o];
+    }
+    *out_hash = min;
     return PH_SUCCESS;
 }
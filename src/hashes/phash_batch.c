@@ -0,0 +1,221 @@
+#include "../internal.h"
+#include "../tables.h"
+#include "../thread.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * pHash of many 32x32 planes at once.
+ *
+ * The low-frequency block of one plane X is D X D^T, with D the 8x32 corner
+ * of the DCT basis. Over a tile of planes both products are GEMMs against
+ * that constant: stacking the planes' rows gives T = X D^T (32n x 32 times
+ * 32 x 8), and placing the T's side by side gives D [T_1 .. T_n] (8 x 32
+ * times 32 x 8n). Both micro-kernels keep a 4x8 accumulator block in SSE
+ * registers and stream over K, broadcasting one operand against 8-float
+ * rows of the other. A tile's T stays in L1 between the two passes, and the
+ * basis is transposed once per call.
+ *
+ * float32 sums can fall on the other side of the threshold than the double
+ * kernel's when a coefficient is within rounding of the mean. Those planes
+ * are rehashed with ph_phash_kernel(), so results are bit-identical to it.
+ */
+
+/* Planes per tile: T takes TILE * 1 KB */
+#define TILE 16
+/* Planes claimed at once by a worker */
+#define CHUNK 512
+/* A row of the basis sums to at most 32 * sqrt(1/32) < 5.66 in absolute
+ * value, so a first-pass value is at most 255 * 5.66 = 1443 and a
+ * coefficient at most 8167. Chains of 32 rounded multiply-adds put the
+ * float32 error of a coefficient below 2 * 33 * 2^-24 * 8167 < 0.033; the
+ * mean, summed in double, is off by no more. */
+#define F32_MARGIN 0.07
+
+typedef struct {
+    float dt[32][8]; /* D^T: dt[k][j] = D[j][k] */
+    float d[8][32];
+} basis_t;
+
+static void load_basis(basis_t *b) {
+    for (int j = 0; j < 8; j++) {
+        for (int k = 0; k < 32; k++) {
+            b->d[j][k] = ph_dct_matrix_f32[j][k];
+            b->dt[k][j] = ph_dct_matrix_f32[j][k];
+        }
+    }
+}
+
+#if defined(__SSE2__)
+
+/* t[r][0..8] = x[r][0..32] . D^T for 4 consecutive rows */
+static void rows_kernel(const basis_t *b, const float *x, float t[4][8]) {
+    __m128 acc[4][2];
+    for (int r = 0; r < 4; r++)
+        acc[r][0] = acc[r][1] = _mm_setzero_ps();
+    for (int k = 0; k < 32; k++) {
+        __m128 lo = _mm_loadu_ps(&b->dt[k][0]), hi = _mm_loadu_ps(&b->dt[k][4]);
+        for (int r = 0; r < 4; r++) {
+            __m128 v = _mm_set1_ps(x[r * 32 + k]);
+            acc[r][0] = _mm_add_ps(acc[r][0], _mm_mul_ps(v, lo));
+            acc[r][1] = _mm_add_ps(acc[r][1], _mm_mul_ps(v, hi));
+        }
+    }
+    for (int r = 0; r < 4; r++) {
+        _mm_storeu_ps(&t[r][0], acc[r][0]);
+        _mm_storeu_ps(&t[r][4], acc[r][1]);
+    }
+}
+
+/* block[i][0..8] = D[i][0..32] . t for 4 consecutive i */
+static void cols_kernel(const basis_t *b, int i0, const float t[32][8], float *block) {
+    __m128 acc[4][2];
+    for (int i = 0; i < 4; i++)
+        acc[i][0] = acc[i][1] = _mm_setzero_ps();
+    for (int k = 0; k < 32; k++) {
+        __m128 lo = _mm_loadu_ps(&t[k][0]), hi = _mm_loadu_ps(&t[k][4]);
+        for (int i = 0; i < 4; i++) {
+            __m128 d = _mm_set1_ps(b->d[i0 + i][k]);
+            acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(d, lo));
+            acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(d, hi));
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_ps(block + (i0 + i) * 8, acc[i][0]);
+        _mm_storeu_ps(block + (i0 + i) * 8 + 4, acc[i][1]);
+    }
+}
+
+#else
+
+static void rows_kernel(const basis_t *b, const float *x, float t[4][8]) {
+    float acc[4][8] = {{0}};
+    for (int k = 0; k < 32; k++) {
+        for (int r = 0; r < 4; r++) {
+            for (int j = 0; j < 8; j++)
+                acc[r][j] += x[r * 32 + k] * b->dt[k][j];
+        }
+    }
+    memcpy(t, acc, sizeof(acc));
+}
+
+static void cols_kernel(const basis_t *b, int i0, const float t[32][8], float *block) {
+    float acc[4][8] = {{0}};
+    for (int k = 0; k < 32; k++) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 8; j++)
+                acc[i][j] += b->d[i0 + i][k] * t[k][j];
+        }
+    }
+    memcpy(block + i0 * 8, acc, sizeof(acc));
+}
+
+#endif
+
+/* Same thresholding as the double kernel; 0 if a coefficient is too close
+ * to the mean for float32 to decide */
+static int threshold_f32(const float block[64], uint64_t *out) {
+    double sum = 0;
+    for (int i = 1; i < 64; i++)
+        sum += block[i];
+    double avg = sum / 63.0;
+
+    uint64_t hash = 0;
+    int close = 0;
+    for (int i = 0; i < 64; i++) {
+        double diff = block[i] - avg;
+        hash |= (uint64_t)(diff > 0) << i;
+        close |= diff < F32_MARGIN && diff > -F32_MARGIN;
+    }
+    *out = hash;
+    return !close;
+}
+
+static void hash_range(const basis_t *b, const uint8_t *planes, size_t start, size_t end,
+                       uint64_t *out) {
+    float x[32 * 32];
+    float t[TILE][32][8];
+    for (size_t tile = start; tile < end; tile += TILE) {
+        size_t count = end - tile < TILE ? end - tile : TILE;
+        const uint8_t *plane = planes + tile * 1024;
+
+        /* T = X D^T over all rows of the tile */
+        for (size_t p = 0; p < count; p++) {
+            for (int i = 0; i < 1024; i++)
+                x[i] = plane[p * 1024 + i];
+            for (int r = 0; r < 32; r += 4)
+                rows_kernel(b, x + r * 32, (float(*)[8])t[p][r]);
+        }
+        /* D T per plane, then the threshold */
+        for (size_t p = 0; p < count; p++) {
+            float block[64];
+            cols_kernel(b, 0, (const float(*)[8])t[p], block);
+            cols_kernel(b, 4, (const float(*)[8])t[p], block);
+            if (!threshold_f32(block, &out[tile + p]))
+                out[tile + p] = ph_phash_kernel(plane + p * 1024);
+        }
+    }
+}
+
+typedef struct {
+    const basis_t *basis;
+    const uint8_t *planes;
+    size_t n;
+    uint64_t *out;
+    atomic_size_t cursor;
+} batch_job_t;
+
+static void batch_worker(void *arg) {
+    batch_job_t *job = arg;
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->cursor, CHUNK);
+        if (start >= job->n)
+            break;
+        size_t end = start + CHUNK < job->n ? start + CHUNK : job->n;
+        hash_range(job->basis, job->planes, start, end, job->out);
+    }
+}
+
+PH_API ph_error_t ph_phash_batch_threaded(const uint8_t *planes32, size_t n, int threads,
+                                          uint64_t *out_hashes) {
+    if ((!planes32 || !out_hashes) && n > 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (threads < 0)
+        return PH_ERR_INVALID_ARGUMENT;
+    if (threads == 0)
+        threads = ph_cpu_count();
+    size_t chunks = (n + CHUNK - 1) / CHUNK;
+    if ((size_t)threads > chunks)
+        threads = chunks > 0 ? (int)chunks : 1;
+
+    basis_t basis;
+    load_basis(&basis);
+    if (threads == 1) {
+        hash_range(&basis, planes32, 0, n, out_hashes);
+        return PH_SUCCESS;
+    }
+
+    ph_thread_t *pool = ph_mem_alloc(NULL, (size_t)(threads - 1) * sizeof(ph_thread_t));
+    if (!pool)
+        return PH_ERR_ALLOCATION_FAILED;
+    batch_job_t job = {&basis, planes32, n, out_hashes, 0};
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (ph_thread_create(&pool[t - 1], batch_worker, &job) != 0)
+            break;
+        started++;
+    }
+    batch_worker(&job);
+    for (int t = 0; t < started; t++)
+        ph_thread_join(pool[t]);
+    ph_mem_free(NULL, pool);
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_phash_batch(const uint8_t *planes32, size_t n, uint64_t *out_hashes) {
+    return ph_phash_batch_threaded(planes32, n, 1, out_hashes);
+}
@@ -1,9 +1,10 @@
 #include "../internal.h"
+#include "../tables.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define RADIAL_PROJECTIONS 40
+#define RADIAL_PROJECTIONS PH_RADIAL_PROJECTIONS
 #define SAMPLES_PER_LINE 128
 
 /**
@@ -34,35 +35,38 @@ PH_API ph_error_t ph_compute_radial_hash(ph_context_t *ctx, ph_digest_t *out_dig
     if (!ctx || !ctx->is_loaded || !out_digest)
         return PH_ERR_INVALID_ARGUMENT;
 
+    if (ph_cache_fetch(ctx, PH_ALGO_RADIAL, out_digest))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+
     memset(out_digest, 0, sizeof(ph_digest_t));
     out_digest->size = 40;
 
-    size_t img_size = ctx->width * ctx->height;
-    uint8_t *gray = malloc(img_size);
-    uint8_t *blurred = malloc(img_size);
+    // Every line is sampled SAMPLES_PER_LINE times: a pyramid level with that
+    // many pixels across holds all the detail the projections can see
+    int w = 0, h = 0;
+    const uint8_t *gray = ph_get_level(ctx, SAMPLES_PER_LINE, SAMPLES_PER_LINE, &w, &h);
+    uint8_t *blurred = gray ? ph_mem_alloc(PH_CTX_ALLOC(ctx), (size_t)w * h) : NULL;
 
-    if (!gray || !blurred) {
-        free(gray);
-        free(blurred);
+    if (!blurred)
         return PH_ERR_ALLOCATION_FAILED;
-    }
 
-    ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, gray);
-    ph_apply_gaussian_blur(gray, ctx->width, ctx->height, blurred);
+    ph_apply_gaussian_blur(gray, w, h, blurred);
 
-    ph_apply_gamma(ctx, blurred, ctx->width, ctx->height);
+    ph_apply_gamma(ctx, blurred, w, h);
 
-    double centerX = ctx->width / 2.0;
-    double centerY = ctx->height / 2.0;
-    double min_side = (ctx->width < ctx->height) ? ctx->width : ctx->height;
+    double centerX = w / 2.0;
+    double centerY = h / 2.0;
+    double min_side = (w < h) ? w : h;
     double maxRadius = min_side / 2.0;
     double variances[RADIAL_PROJECTIONS];
     double max_var = 0.0;
 
     for (int i = 0; i < RADIAL_PROJECTIONS; i++) {
-        double theta = (i * M_PI) / RADIAL_PROJECTIONS;
-        double cos_t = cos(theta);
-        double sin_t = sin(theta);
+        double cos_t = ph_radial_cos[i];
+        double sin_t = ph_radial_sin[i];
         double sum = 0.0;
         double sumSq = 0.0;
         int count = 0;
@@ -71,7 +75,7 @@ PH_API ph_error_t ph_compute_radial_hash(ph_context_t *ctx, ph_digest_t *out_dig
             double dist = (r * maxRadius) / (SAMPLES_PER_LINE / 2.0);
             double px = centerX + dist * cos_t;
             double py = centerY + dist * sin_t;
-            double val = get_pixel_bilinear(blurred, ctx->width, ctx->height, px, py);
+            double val = get_pixel_bilinear(blurred, w, h, px, py);
             if (val > 0.0) {
                 sum += val;
                 sumSq += val * val;
@@ -97,7 +101,7 @@ PH_API ph_error_t ph_compute_radial_hash(ph_context_t *ctx, ph_digest_t *out_dig
         }
     }
 
-    free(gray);
-    free(blurred);
+    ph_mem_free(PH_CTX_ALLOC(ctx), blurred);
+    ph_cache_store(ctx, PH_ALGO_RADIAL, out_digest);
     return PH_SUCCESS;
 }
@@ -12,18 +12,7 @@ static void haar_1d(double *data, int n) {
         data[i] = temp[i];
 }
 
-PH_API ph_error_t ph_compute_whash(ph_context_t *ctx, uint64_t *out_hash) {
-    if (!ctx || !ctx->is_loaded || !out_hash)
-        return PH_ERR_INVALID_ARGUMENT;
-    uint8_t gray[64];
-    uint8_t *full_gray = malloc(ctx->width * ctx->height);
-    if (!full_gray)
-        return PH_ERR_ALLOCATION_FAILED;
-
-    ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, full_gray);
-    ph_resize_grayscale(full_gray, ctx->width, ctx->height, gray, 8, 8);
-    free(full_gray);
-
+uint64_t ph_whash_kernel(const uint8_t gray[64]) {
     double d[64];
     for (int i = 0; i < 64; i++)
         d[i] = gray[i];
@@ -48,6 +37,27 @@ PH_API ph_error_t ph_compute_whash(ph_context_t *ctx, uint64_t *out_hash) {
     for (int i = 0; i < 64; i++)
         if (d[i] > avg)
             hash |= (1ULL << i);
-    *out_hash = hash;
+    return hash;
+}
+
+PH_API ph_error_t ph_compute_whash(ph_context_t *ctx, uint64_t *out_hash) {
+    if (!ctx || !ctx->is_loaded || !out_hash)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    if (ph_cache_fetch(ctx, PH_ALGO_WHASH, out_hash))
+        return PH_SUCCESS;
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+    uint8_t gray[64];
+    int w = 0, h = 0;
+    const uint8_t *level = ph_get_level(ctx, 8, 8, &w, &h);
+    if (!level)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    ph_resize_grayscale(level, w, h, gray, 8, 8);
+
+    *out_hash = ph_whash_kernel(gray);
+    ph_cache_store(ctx, PH_ALGO_WHASH, out_hash);
     return PH_SUCCESS;
 }
@@ -0,0 +1,378 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Compressed hash set.
+ *
+ * The distinct hashes are sorted and cut into blocks of 256. Each block is
+ * Elias-Fano coded relative to its first value: with u the block's span
+ * and n its size, every value keeps its low L = floor(log2(u / n)) bits
+ * verbatim and its high bits in unary, one bit set per value in a vector
+ * of n + (u >> L) + 1 bits. That is L + 2 bits per hash; for uniformly
+ * spread hashes L is about 64 - log2(count), so a billion hashes take under
+ * 5 bytes each. The high parts count from the block's first value shifted
+ * right by L, so a value's high part plus that base is exactly its top
+ * 64 - L bits. The directory holds every block's first value and bit
+ * position, 16 bytes per 256 hashes, and a table indexed by the top bits
+ * of a hash narrows the directory search to a block or two.
+ *
+ * Every value in a block lies between its first value and the next
+ * block's, so it shares their common leading bits. A radius query skips
+ * any block whose common prefix alone is already too far from the query.
+ * In the others it decodes the top bits into an L1-sized buffer and
+ * screens them with popcount first; only survivors read their low bits.
+ */
+
+#define BLOCK_SIZE 256
+/* Directory lookup table: one entry per block or fewer */
+#define MAX_BUCKET_BITS 28
+
+typedef struct {
+    uint64_t first;
+    uint64_t position; /* Bit offset << 8 | low-bit width */
+} block_t;
+
+struct ph_hash_set {
+    size_t count;
+    size_t nblocks;
+    uint64_t max;
+    block_t *blocks;
+    uint32_t *buckets; /* First block whose top bucket_bits are >= the index */
+    int bucket_bits;
+    uint64_t *bits;
+    size_t nwords;
+    uint64_t nbits;
+};
+
+static inline int ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline int clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (1ULL << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* --- Sorting --- */
+
+static void insertion_sort(uint64_t *a, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        uint64_t v = a[i];
+        size_t j = i;
+        for (; j > 0 && a[j - 1] > v; j--)
+            a[j] = a[j - 1];
+        a[j] = v;
+    }
+}
+
+/* In-place MSD radix sort, one byte per level (American flag sort) */
+static void radix_sort(uint64_t *a, size_t n, int shift) {
+    if (n < 64) {
+        insertion_sort(a, n);
+        return;
+    }
+    size_t count[256] = {0}, next[256], end[256];
+    for (size_t i = 0; i < n; i++)
+        count[(a[i] >> shift) & 0xFF]++;
+    size_t sum = 0;
+    for (int b = 0; b < 256; b++) {
+        next[b] = sum;
+        sum += count[b];
+        end[b] = sum;
+    }
+    for (int b = 0; b < 256; b++) {
+        while (next[b] < end[b]) {
+            uint64_t v = a[next[b]];
+            int digit = (int)((v >> shift) & 0xFF);
+            while (digit != b) {
+                uint64_t displaced = a[next[digit]];
+                a[next[digit]++] = v;
+                v = displaced;
+                digit = (int)((v >> shift) & 0xFF);
+            }
+            a[next[b]++] = v;
+        }
+    }
+    if (shift == 0)
+        return;
+    for (int b = 0; b < 256; b++)
+        radix_sort(a + end[b] - count[b], count[b], shift - 8);
+}
+
+/* --- Bit stream --- */
+
+static inline uint64_t low_mask(unsigned width) {
+    return width ? ~0ULL >> (64 - width) : 0;
+}
+
+static inline void put_bits(uint64_t *words, uint64_t pos, uint64_t value, unsigned width) {
+    if (width == 0)
+        return;
+    size_t w = (size_t)(pos >> 6);
+    unsigned s = (unsigned)(pos & 63);
+    words[w] |= value << s;
+    if (s + width > 64)
+        words[w + 1] |= value >> (64 - s);
+}
+
+/*
+ * Up to 56 bits fit one unaligned little-endian load at the containing
+ * byte; wider fields combine two words. The spare word at the end keeps
+ * both reads in bounds.
+ */
+static inline uint64_t get_bits(const uint64_t *words, uint64_t pos, unsigned width,
+                                uint64_t mask) {
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (width <= 56) {
+        uint64_t v;
+        memcpy(&v, (const uint8_t *)words + (pos >> 3), 8);
+        return (v >> (pos & 7)) & mask;
+    }
+#else
+    (void)width;
+#endif
+    size_t w = (size_t)(pos >> 6);
+    unsigned s = (unsigned)(pos & 63);
+    return ((words[w] >> s) | ((words[w + 1] << 1) << (63 - s))) & mask;
+}
+
+static inline unsigned low_width(uint64_t span, size_t n) {
+    uint64_t ratio = span / n;
+    return ratio ? 63u - (unsigned)clz64(ratio) : 0u;
+}
+
+static inline size_t block_count(const ph_hash_set_t *set, size_t b) {
+    return b + 1 < set->nblocks ? BLOCK_SIZE : set->count - b * BLOCK_SIZE;
+}
+
+static inline unsigned block_width(const block_t *block) {
+    return (unsigned)(block->position & 0xFF);
+}
+
+static inline uint64_t bucket_of(const ph_hash_set_t *set, uint64_t hash) {
+    return set->bucket_bits ? hash >> (64 - set->bucket_bits) : 0;
+}
+
+/* High parts (value >> width) of block b's values, in order; returns how many */
+static size_t decode_tops(const ph_hash_set_t *set, size_t b, uint64_t *tops) {
+    const block_t *block = &set->blocks[b];
+    size_t n = block_count(set, b);
+    unsigned width = block_width(block);
+    uint64_t upper = (block->position >> 8) + n * width, top = block->first >> width;
+
+    size_t w = (size_t)(upper >> 6);
+    uint64_t offset = (uint64_t)w * 64 - upper; /* Wraps; only differences matter */
+    uint64_t word = set->bits[w] & (~0ULL << (upper & 63));
+    for (size_t i = 0; i < n; i++) {
+        while (!word) {
+            word = set->bits[++w];
+            offset += 64;
+        }
+        tops[i] = top + (offset + (uint64_t)ctz64(word) - i);
+        word &= word - 1;
+    }
+    return n;
+}
+
+/*
+ * Values whose high part is 'target' come right after the target-th zero
+ * of the unary vector, so membership selects that zero with word
+ * popcounts and only reads the low bits of that run.
+ */
+static int block_contains(const ph_hash_set_t *set, size_t b, uint64_t hash) {
+    const block_t *block = &set->blocks[b];
+    size_t n = block_count(set, b);
+    unsigned width = block_width(block);
+    uint64_t lows = block->position >> 8, upper = lows + n * width;
+    uint64_t end = b + 1 < set->nblocks ? set->blocks[b + 1].position >> 8 : set->nbits;
+    uint64_t target = (hash >> width) - (block->first >> width), mask = low_mask(width);
+    if (target >= end - upper - n)
+        return 0;
+
+    uint64_t pos = upper;
+    if (target > 0) {
+        uint64_t skip = target - 1;
+        size_t w = (size_t)(upper >> 6);
+        uint64_t zeros = ~set->bits[w] & (~0ULL << (upper & 63));
+        for (int c; (uint64_t)(c = popcount64(zeros)) <= skip;) {
+            skip -= (uint64_t)c;
+            zeros = ~set->bits[++w];
+        }
+        for (; skip > 0; skip--)
+            zeros &= zeros - 1;
+        pos = (uint64_t)w * 64 + (uint64_t)ctz64(zeros) + 1;
+    }
+
+    uint64_t low = hash & mask;
+    for (size_t i = (size_t)(pos - upper - target); i < n; i++, pos++) {
+        if (!((set->bits[pos >> 6] >> (pos & 63)) & 1))
+            return 0;
+        uint64_t v = get_bits(set->bits, lows + i * width, width, mask);
+        if (v >= low)
+            return v == low;
+    }
+    return 0;
+}
+
+/* --- Public API --- */
+
+PH_API ph_error_t ph_hash_set_build(uint64_t *hashes, size_t n, ph_hash_set_t **out_set) {
+    if ((!hashes && n > 0) || !out_set)
+        return PH_ERR_INVALID_ARGUMENT;
+    radix_sort(hashes, n, 56);
+
+    size_t distinct = 0;
+    for (size_t i = 0; i < n; i++)
+        distinct += i == 0 || hashes[i] != hashes[i - 1];
+    if (distinct / BLOCK_SIZE >= UINT32_MAX)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_hash_set_t *set = ph_mem_calloc(NULL, 1, sizeof(ph_hash_set_t));
+    if (!set)
+        return PH_ERR_ALLOCATION_FAILED;
+    set->count = distinct;
+    set->nblocks = (distinct + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    while (set->bucket_bits < MAX_BUCKET_BITS && (2ull << set->bucket_bits) <= set->nblocks)
+        set->bucket_bits++;
+    size_t nbuckets = (size_t)1 << set->bucket_bits;
+    set->blocks = ph_mem_alloc(NULL, (set->nblocks + 1) * sizeof(block_t));
+    set->buckets = ph_mem_alloc(NULL, (nbuckets + 1) * sizeof(uint32_t));
+    if (!set->blocks || !set->buckets) {
+        ph_hash_set_free(set);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+
+    /* Block layout: the low-bit width, then the size of both parts */
+    for (size_t i = 0, b = 0; b < set->nblocks; b++) {
+        size_t count = block_count(set, b);
+        uint64_t first = 0, last = 0;
+        for (size_t k = 0; k < count; i++) {
+            if (i > 0 && hashes[i] == hashes[i - 1])
+                continue;
+            if (k++ == 0)
+                first = hashes[i];
+            last = hashes[i];
+        }
+        unsigned width = low_width(last - first, count);
+        set->blocks[b].first = first;
+        set->blocks[b].position = set->nbits << 8 | width;
+        set->nbits += count * width + count + ((last >> width) - (first >> width)) + 1;
+        set->max = last;
+    }
+    for (size_t k = 0, b = 0; k <= nbuckets; k++) {
+        while (b < set->nblocks && bucket_of(set, set->blocks[b].first) < k)
+            b++;
+        set->buckets[k] = (uint32_t)b;
+    }
+
+    set->nwords = (size_t)((set->nbits + 63) / 64) + 1; /* One spare word for reads */
+    set->bits = ph_mem_calloc(NULL, set->nwords, sizeof(uint64_t));
+    if (!set->bits) {
+        ph_hash_set_free(set);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+    for (size_t i = 0, b = 0; b < set->nblocks; b++) {
+        size_t count = block_count(set, b);
+        unsigned width = block_width(&set->blocks[b]);
+        uint64_t lows = set->blocks[b].position >> 8, upper = lows + count * width;
+        uint64_t top = set->blocks[b].first >> width, mask = low_mask(width);
+        for (size_t k = 0; k < count; i++) {
+            if (i > 0 && hashes[i] == hashes[i - 1])
+                continue;
+            put_bits(set->bits, lows + k * width, hashes[i] & mask, width);
+            put_bits(set->bits, upper + ((hashes[i] >> width) - top) + k, 1, 1);
+            k++;
+        }
+    }
+    *out_set = set;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_hash_set_free(ph_hash_set_t *set) {
+    if (!set)
+        return;
+    ph_mem_free(NULL, set->blocks);
+    ph_mem_free(NULL, set->buckets);
+    ph_mem_free(NULL, set->bits);
+    ph_mem_free(NULL, set);
+}
+
+PH_API size_t ph_hash_set_count(const ph_hash_set_t *set) {
+    return set ? set->count : 0;
+}
+
+PH_API size_t ph_hash_set_memory_usage(const ph_hash_set_t *set) {
+    if (!set)
+        return 0;
+    return sizeof(*set) + set->nblocks * sizeof(block_t) +
+           (((size_t)1 << set->bucket_bits) + 1) * sizeof(uint32_t) +
+           set->nwords * sizeof(uint64_t);
+}
+
+PH_API int ph_hash_set_contains(const ph_hash_set_t *set, uint64_t hash) {
+    if (!set || set->count == 0 || hash < set->blocks[0].first || hash > set->max)
+        return 0;
+    /* The last block starting at or before 'hash': from its top-bits bucket */
+    uint64_t k = bucket_of(set, hash);
+    size_t lo = set->buckets[k], hi = set->buckets[k + 1];
+    lo = lo > 0 ? lo - 1 : 0;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (set->blocks[mid].first <= hash)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return block_contains(set, lo, hash);
+}
+
+PH_API ph_error_t ph_hash_set_radius(const ph_hash_set_t *set, uint64_t query, int radius,
+                                     uint64_t *out_hashes, size_t max_hashes, size_t *out_count) {
+    if (!set || radius < 0 || radius > 64 || (!out_hashes && max_hashes > 0) || !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    uint64_t tops[BLOCK_SIZE];
+    size_t found = 0;
+    for (size_t b = 0; b < set->nblocks; b++) {
+        uint64_t lo = set->blocks[b].first;
+        uint64_t hi = b + 1 < set->nblocks ? set->blocks[b + 1].first - 1 : set->max;
+        int common = lo == hi ? 64 : clz64(lo ^ hi);
+        if (common > 0 && popcount64((lo ^ query) >> (64 - common)) > radius)
+            continue;
+
+        /* High parts first; only the values they do not rule out read low bits */
+        unsigned width = block_width(&set->blocks[b]);
+        uint64_t lows = set->blocks[b].position >> 8, mask = low_mask(width);
+        uint64_t query_top = query >> width;
+        size_t n = decode_tops(set, b, tops);
+        for (size_t i = 0; i < n; i++) {
+            if (popcount64(tops[i] ^ query_top) > radius)
+                continue;
+            uint64_t v = tops[i] << width | get_bits(set->bits, lows + i * width, width, mask);
+            if (popcount64(v ^ query) <= radius) {
+                if (found < max_hashes)
+                    out_hashes[found] = v;
+                found++;
+            }
+        }
+    }
+    *out_count = found;
+    return PH_SUCCESS;
+}
@@ -5,16 +5,160 @@
 #include <string.h>
 
 uint8_t *ph_get_gray(ph_context_t *ctx) {
+    // A single-channel image is its own gray plane
+    if (!ctx->gray_data && ctx->data && ctx->channels == 1)
+        ctx->gray_data = ctx->data;
     if (!ctx->gray_data && ctx->data) {
-        ctx->gray_data = malloc(ctx->width * ctx->height);
-        if (ctx->gray_data) {
-            ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, ctx->gray_data);
+        // The buffer outlives the image so later loads can reuse it
+        size_t size = (size_t)ctx->width * ctx->height;
+        if (size > ctx->gray_cap) {
+            uint8_t *buf = ph_mem_realloc(PH_CTX_ALLOC(ctx), ctx->gray_buf, ctx->gray_cap, size);
+            if (!buf)
+                return NULL;
+            ctx->gray_buf = buf;
+            ctx->gray_cap = size;
         }
+        ctx->gray_data = ctx->gray_buf;
+        ph_to_grayscale(ctx->data, ctx->width, ctx->height, ctx->channels, ctx->gray_data);
     }
     return ctx->gray_data;
 }
 
+void ph_invalidate_pyramid(ph_context_t *ctx) {
+    ctx->pyramid_levels = 0;
+    ctx->has_sat = 0;
+}
+
+static int build_sat(ph_context_t *ctx) {
+    const uint8_t *gray = ph_get_gray(ctx);
+    if (!gray)
+        return 0;
+
+    size_t stride = (size_t)ctx->width + 1;
+    size_t size = stride * ((size_t)ctx->height + 1);
+    if (size > ctx->sat_cap) {
+        uint32_t *buf = ph_mem_realloc(PH_CTX_ALLOC(ctx), ctx->sat, ctx->sat_cap * sizeof(uint32_t),
+                                       size * sizeof(uint32_t));
+        if (!buf)
+            return 0;
+        ctx->sat = buf;
+        ctx->sat_cap = size;
+    }
+
+    uint32_t *sat = ctx->sat;
+    memset(sat, 0, stride * sizeof(uint32_t));
+    for (int y = 0; y < ctx->height; y++) {
+        const uint8_t *row = gray + (size_t)y * ctx->width;
+        const uint32_t *above = sat + (size_t)y * stride;
+        uint32_t *out = sat + (size_t)(y + 1) * stride;
+        uint32_t run = 0;
+        out[0] = 0;
+        for (int x = 0; x < ctx->width; x++) {
+            run += row[x];
+            out[x + 1] = above[x + 1] + run;
+        }
+    }
+    ctx->has_sat = 1;
+    return 1;
+}
+
+int ph_sample_area(ph_context_t *ctx, int x, int y, int w, int h, uint8_t *dst, int dw, int dh) {
+    if (!ctx->has_sat && !build_sat(ctx))
+        return 0;
+
+    const uint32_t *sat = ctx->sat;
+    size_t stride = (size_t)ctx->width + 1;
+    for (int j = 0; j < dh; j++) {
+        // Box rows [y0, y1): at least one row when upsampling
+        int y0 = y + (int)((int64_t)j * h / dh);
+        int y1 = y + (int)((int64_t)(j + 1) * h / dh);
+        if (y1 <= y0)
+            y1 = y0 + 1;
+        const uint32_t *top = sat + (size_t)y0 * stride;
+        const uint32_t *bottom = sat + (size_t)y1 * stride;
+        for (int i = 0; i < dw; i++) {
+            int x0 = x + (int)((int64_t)i * w / dw);
+            int x1 = x + (int)((int64_t)(i + 1) * w / dw);
+            if (x1 <= x0)
+                x1 = x0 + 1;
+            uint32_t sum = bottom[x1] - bottom[x0] - top[x1] + top[x0];
+            uint32_t area = (uint32_t)(x1 - x0) * (uint32_t)(y1 - y0);
+            dst[j * dw + i] = (uint8_t)((sum + area / 2) / area);
+        }
+    }
+    return 1;
+}
+
+/* Computes the size of every level for the current image and makes sure the
+ * buffer holds them all (at most a third of the gray plane). */
+static int layout_pyramid(ph_context_t *ctx) {
+    int w = ctx->width, h = ctx->height;
+    size_t total = 0;
+    for (int k = 1; k < PH_PYRAMID_MAX_LEVELS; k++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ctx->level_w[k] = w;
+        ctx->level_h[k] = h;
+        ctx->level_offset[k] = total;
+        total += (size_t)w * h;
+    }
+    if (total > ctx->pyramid_cap) {
+        uint8_t *buf = ph_mem_realloc(PH_CTX_ALLOC(ctx), ctx->pyramid, ctx->pyramid_cap, total);
+        if (!buf)
+            return 0;
+        ctx->pyramid = buf;
+        ctx->pyramid_cap = total;
+    }
+    return 1;
+}
+
+/* Halves an image with a 2x2 mean; an odd last row/column is repeated */
+static void downsample_2x(const uint8_t *src, int sw, int sh, uint8_t *dst, int dw, int dh) {
+    for (int y = 0; y < dh; y++) {
+        const uint8_t *r0 = src + (size_t)(2 * y) * sw;
+        const uint8_t *r1 = (2 * y + 1 < sh) ? r0 + sw : r0;
+        uint8_t *out = dst + (size_t)y * dw;
+        for (int x = 0; x < dw; x++) {
+            int x0 = 2 * x;
+            int x1 = (x0 + 1 < sw) ? x0 + 1 : x0;
+            out[x] = (uint8_t)((r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2);
+        }
+    }
+}
+
+const uint8_t *ph_get_level(ph_context_t *ctx, int min_w, int min_h, int *out_w, int *out_h) {
+    const uint8_t *level = ph_get_gray(ctx);
+    if (!level)
+        return NULL;
+
+    int w = ctx->width, h = ctx->height;
+    for (int k = 1; k < PH_PYRAMID_MAX_LEVELS; k++) {
+        int nw = (w + 1) / 2, nh = (h + 1) / 2;
+        if (nw < min_w || nh < min_h || (w == 1 && h == 1))
+            break;
+        if (k > ctx->pyramid_levels) {
+            // Without memory for the levels, resample from the finer one
+            if (ctx->pyramid_levels == 0 && !layout_pyramid(ctx))
+                break;
+            downsample_2x(level, w, h, ctx->pyramid + ctx->level_offset[k], nw, nh);
+            ctx->pyramid_levels = k;
+        }
+        level = ctx->pyramid + ctx->level_offset[k];
+        w = nw;
+        h = nh;
+    }
+    *out_w = w;
+    *out_h = h;
+    return level;
+}
+
 void ph_to_grayscale(const uint8_t *src, int w, int h, int channels, uint8_t *dst) {
+    if (channels < 3) {
+        // Gray or gray + alpha: luminance is the first channel
+        for (int i = 0; i < w * h; i++)
+            dst[i] = src[i * channels];
+        return;
+    }
     for (int i = 0; i < w * h; i++) {
         uint32_t r = src[i * channels];
         uint32_t g = src[i * channels + 1];
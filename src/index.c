@@ -0,0 +1,246 @@
+#include "internal.h"
+#include "thread.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/*
+ * Concurrent hash index.
+ *
+ * Multi-index hashing: a hash is cut into four 16-bit segments and each
+ * entry is linked into one bucket per segment, keyed by that segment's
+ * value. Two hashes within distance r agree to within r / 4 bits on at
+ * least one segment, so a query walks the buckets of every segment value
+ * within that many bits of its own. When that enumeration would cost more
+ * than reading every entry, the query scans the entries instead.
+ *
+ * Entries live in fixed chunks that never move. An insert fills in an
+ * entry, links it at the head of its four buckets with release stores and
+ * then publishes the new count, so a reader that acquires a head or the
+ * count only ever meets complete entries. Nothing is unlinked or freed
+ * while the index is live, which is what lets readers run without locks or
+ * a reclamation scheme. Inserts hold the writer lock;
+ * ph_hash_index_find_or_insert() queries without it and, under it, only
+ * re-checks the entries added in the meantime.
+ */
+
+#define SEGMENTS 4
+#define SEGMENT_BITS 16
+#define BUCKETS (1u << SEGMENT_BITS)
+#define CHUNK_BITS 16
+#define CHUNK_SIZE (1u << CHUNK_BITS)
+#define MAX_CHUNKS (1u << (32 - CHUNK_BITS))
+
+/* Links hold id + 1, so a zeroed bucket is empty */
+typedef struct {
+    uint64_t hash;
+    uint32_t next[SEGMENTS];
+} entry_t;
+
+struct ph_hash_index {
+    _Atomic uint32_t heads[SEGMENTS][BUCKETS];
+    _Atomic(entry_t *) chunks[MAX_CHUNKS];
+    _Atomic uint32_t count;
+    ph_mutex_t write_lock;
+};
+
+typedef void (*visit_fn)(void *arg, uint32_t id, int dist);
+
+/* Number of 16-bit values within k bits of a given one: sum of C(16, i) */
+static const uint32_t s_ball_size[SEGMENT_BITS + 1] = {
+    1, 17, 137, 697, 2517, 6885, 14893, 26333, 39203, 50643, 58651, 63019, 64839, 65399, 65519,
+    65535, 65536};
+
+static inline uint32_t segment(uint64_t hash, int s) {
+    return (uint32_t)(hash >> (s * SEGMENT_BITS)) & (BUCKETS - 1);
+}
+
+static inline const entry_t *entry(const ph_hash_index_t *index, uint32_t id) {
+    entry_t *chunk = atomic_load_explicit(&index->chunks[id >> CHUNK_BITS], memory_order_acquire);
+    return &chunk[id & (CHUNK_SIZE - 1)];
+}
+
+static void scan_range(const ph_hash_index_t *index, uint64_t hash, int radius, uint32_t from,
+                       uint32_t to, visit_fn visit, void *arg) {
+    for (uint32_t id = from; id < to;) {
+        const entry_t *e = entry(index, id);
+        uint32_t end = (id | (CHUNK_SIZE - 1)) + 1;
+        if (end > to || end == 0)
+            end = to;
+        for (; id < end; id++, e++) {
+            int dist = ph_hamming_distance(e->hash, hash);
+            if (dist <= radius)
+                visit(arg, id, dist);
+        }
+    }
+}
+
+static void walk_bucket(const ph_hash_index_t *index, uint64_t hash, int radius, int within,
+                        int s, uint32_t bucket, visit_fn visit, void *arg) {
+    uint32_t link = atomic_load_explicit(&index->heads[s][bucket], memory_order_acquire);
+    while (link) {
+        const entry_t *e = entry(index, link - 1);
+        int dist = ph_hamming_distance(e->hash, hash);
+        if (dist <= radius) {
+            /* Report each entry from the first segment that can reach it */
+            int first = 0;
+            while (first < s && ph_hamming_distance(segment(e->hash ^ hash, first), 0) > within)
+                first++;
+            if (first == s)
+                visit(arg, link - 1, dist);
+        }
+        link = e->next[s];
+    }
+}
+
+static void search(const ph_hash_index_t *index, uint64_t hash, int radius, visit_fn visit,
+                   void *arg) {
+    uint32_t count = atomic_load_explicit(&index->count, memory_order_acquire);
+    int within = radius / SEGMENTS;
+    if ((uint64_t)SEGMENTS * s_ball_size[within] * 4 >= count) {
+        scan_range(index, hash, radius, 0, count, visit, arg);
+        return;
+    }
+
+    for (int s = 0; s < SEGMENTS; s++) {
+        uint32_t own = segment(hash, s);
+        walk_bucket(index, hash, radius, within, s, own, visit, arg);
+        /* Every flip mask of k bits, by Gosper's hack */
+        for (int k = 1; k <= within; k++) {
+            for (uint32_t m = (1u << k) - 1; m < BUCKETS;) {
+                walk_bucket(index, hash, radius, within, s, own ^ m, visit, arg);
+                uint32_t c = m & (0u - m), r = m + c;
+                m = (((r ^ m) >> 2) / c) | r;
+            }
+        }
+    }
+}
+
+PH_API ph_error_t ph_hash_index_create(ph_hash_index_t **out_index) {
+    if (!out_index)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_hash_index_t *index = ph_mem_calloc(NULL, 1, sizeof(ph_hash_index_t));
+    if (!index)
+        return PH_ERR_ALLOCATION_FAILED;
+    ph_mutex_init(&index->write_lock);
+    *out_index = index;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_hash_index_free(ph_hash_index_t *index) {
+    if (!index)
+        return;
+    for (uint32_t c = 0; c < MAX_CHUNKS; c++)
+        ph_mem_free(NULL, atomic_load_explicit(&index->chunks[c], memory_order_relaxed));
+    ph_mutex_destroy(&index->write_lock);
+    ph_mem_free(NULL, index);
+}
+
+PH_API size_t ph_hash_index_count(const ph_hash_index_t *index) {
+    return index ? atomic_load_explicit(&index->count, memory_order_acquire) : 0;
+}
+
+/* Called with the writer lock held */
+static ph_error_t insert_locked(ph_hash_index_t *index, uint64_t hash, uint32_t *out_id) {
+    uint32_t id = atomic_load_explicit(&index->count, memory_order_relaxed);
+    if (id == UINT32_MAX)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    entry_t *chunk = atomic_load_explicit(&index->chunks[id >> CHUNK_BITS], memory_order_relaxed);
+    if (!chunk) {
+        chunk = ph_mem_alloc(NULL, CHUNK_SIZE * sizeof(entry_t));
+        if (!chunk)
+            return PH_ERR_ALLOCATION_FAILED;
+        atomic_store_explicit(&index->chunks[id >> CHUNK_BITS], chunk, memory_order_release);
+    }
+
+    entry_t *e = &chunk[id & (CHUNK_SIZE - 1)];
+    e->hash = hash;
+    for (int s = 0; s < SEGMENTS; s++)
+        e->next[s] = atomic_load_explicit(&index->heads[s][segment(hash, s)], memory_order_relaxed);
+    for (int s = 0; s < SEGMENTS; s++)
+        atomic_store_explicit(&index->heads[s][segment(hash, s)], id + 1, memory_order_release);
+    atomic_store_explicit(&index->count, id + 1, memory_order_release);
+
+    if (out_id)
+        *out_id = id;
+    return PH_SUCCESS;
+}
+
+PH_API ph_error_t ph_hash_index_insert(ph_hash_index_t *index, uint64_t hash, uint32_t *out_id) {
+    if (!index)
+        return PH_ERR_INVALID_ARGUMENT;
+    ph_mutex_lock(&index->write_lock);
+    ph_error_t err = insert_locked(index, hash, out_id);
+    ph_mutex_unlock(&index->write_lock);
+    return err;
+}
+
+typedef struct {
+    ph_match_t *out;
+    size_t max;
+    size_t found;
+} collect_t;
+
+static void collect_match(void *arg, uint32_t id, int dist) {
+    collect_t *c = arg;
+    if (c->found < c->max) {
+        c->out[c->found].index = id;
+        c->out[c->found].distance = (float)dist;
+    }
+    c->found++;
+}
+
+PH_API ph_error_t ph_hash_index_query(const ph_hash_index_t *index, uint64_t hash, int radius,
+                                      ph_match_t *out_matches, size_t max_matches,
+                                      size_t *out_count) {
+    if (!index || radius < 0 || radius > 64 || (!out_matches && max_matches > 0) || !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    collect_t c = {out_matches, max_matches, 0};
+    search(index, hash, radius, collect_match, &c);
+    *out_count = c.found;
+    return PH_SUCCESS;
+}
+
+typedef struct {
+    uint32_t id;
+    int dist;
+} nearest_t;
+
+static void keep_nearest(void *arg, uint32_t id, int dist) {
+    nearest_t *n = arg;
+    if (dist < n->dist || (dist == n->dist && id < n->id)) {
+        n->id = id;
+        n->dist = dist;
+    }
+}
+
+PH_API ph_error_t ph_hash_index_find_or_insert(ph_hash_index_t *index, uint64_t hash, int radius,
+                                               uint32_t *out_id, int *out_inserted) {
+    if (!index || radius < 0 || radius > 64 || !out_id || !out_inserted)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    nearest_t nearest = {UINT32_MAX, INT_MAX};
+    uint32_t seen = atomic_load_explicit(&index->count, memory_order_acquire);
+    search(index, hash, radius, keep_nearest, &nearest);
+    *out_inserted = 0;
+    if (nearest.dist <= radius) {
+        *out_id = nearest.id;
+        return PH_SUCCESS;
+    }
+
+    /* Only hashes inserted since the lock-free pass can still conflict */
+    ph_mutex_lock(&index->write_lock);
+    uint32_t now = atomic_load_explicit(&index->count, memory_order_relaxed);
+    scan_range(index, hash, radius, seen, now, keep_nearest, &nearest);
+    ph_error_t err = PH_SUCCESS;
+    if (nearest.dist <= radius) {
+        *out_id = nearest.id;
+    } else {
+        err = insert_locked(index, hash, out_id);
+        *out_inserted = err == PH_SUCCESS;
+    }
+    ph_mutex_unlock(&index->write_lock);
+    return err;
+}
@@ -24,16 +24,201 @@ void ph_resize_bilinear(const uint8_t *src, int sw, int sh, uint8_t *dst, int dw
 
 uint8_t *ph_get_gray(ph_context_t *ctx);
 
+/* Returns the smallest level of the gray mip pyramid that is at least
+ * min_w x min_h (level 0 is the gray plane itself), building levels on
+ * demand. Each level halves the previous one with a 2x2 mean. */
+const uint8_t *ph_get_level(ph_context_t *ctx, int min_w, int min_h, int *out_w, int *out_h);
+
+/* Drops the pyramid levels and summed-area table after the gray plane
+ * changed */
+void ph_invalidate_pyramid(ph_context_t *ctx);
+
+/* Area-averages the gray plane rectangle (x, y, w, h) down (or up) to
+ * dw x dh using the summed-area table, built on first use: O(1) per output
+ * pixel whatever the size of the rectangle. Returns 0 when the table could
+ * not be allocated. */
+int ph_sample_area(ph_context_t *ctx, int x, int y, int w, int h, uint8_t *dst, int dw, int dh);
+
+/* Releases the decoded image and every buffer derived from it */
+void ph_release_image(ph_context_t *ctx);
+
+/* Releases the image and restores the settings of 'defaults', a freshly
+ * created context. Grown buffers are kept for the next image. */
+void ph_context_reset(ph_context_t *ctx, const ph_context_t *defaults);
+
+/* Hash kernels over gray pixels already resampled to the algorithm's input:
+ * 8x8 for aHash and wHash, 9x8 for dHash, 16x16 for mHash, 32x32 for pHash */
+uint64_t ph_ahash_kernel(const uint8_t tiny[64]);
+uint64_t ph_dhash_kernel(const uint8_t tiny[72]);
+uint64_t ph_whash_kernel(const uint8_t gray[64]);
+uint64_t ph_mhash_kernel(const uint8_t tiny[256]);
+uint64_t ph_phash_kernel(const uint8_t gray32[1024]);
+
+/* Set bits of x, inlined into the Hamming loops of the joins and sets */
+static inline int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    return ph_hamming_distance(x, 0);
+#endif
+}
+
+/* Squared L2 distance between two byte vectors of length n */
+uint32_t ph_l2_sq_u8(const uint8_t *a, const uint8_t *b, size_t n);
+
+/* Squared L2 distance / sum of absolute differences between 'query' and
+ * each of 'count' rows of n bytes packed back to back */
+void ph_l2_sq_rows(const uint8_t *query, const uint8_t *rows, size_t n, size_t count,
+                   uint32_t *out);
+void ph_sad_rows(const uint8_t *query, const uint8_t *rows, size_t n, size_t count,
+                 uint32_t *out);
+
+/* Bounded top-k selection: a max-heap on (dist, index) whose root is the
+ * worst of the k kept. Push candidates with ph_topk_push(), then
+ * ph_topk_sort() orders the kept ones nearest first, ties by index. */
+typedef struct {
+    uint32_t dist;
+    uint32_t index;
+} ph_candidate_t;
+
+void ph_topk_push(ph_candidate_t *heap, size_t *kept, size_t k, ph_candidate_t c);
+void ph_topk_sort(ph_candidate_t *heap, size_t n);
+
+/* Dispatches to the ph_compute_* function of a uint64_t algorithm */
+ph_error_t ph_compute_u64(ph_context_t *ctx, ph_algo_t algo, uint64_t *out_hash);
+
+/* Field of 'hashes' holding the result of a uint64_t / digest algorithm,
+ * or NULL when 'algo' is not one */
+uint64_t *ph_hashes_u64(ph_hashes_t *hashes, ph_algo_t algo);
+ph_digest_t *ph_hashes_digest(ph_hashes_t *hashes, ph_algo_t algo);
+
+/* Decodes with the registered decoder backends. Returns
+ * PH_ERR_NOT_IMPLEMENTED when none of them produced an image. */
+ph_error_t ph_decode_with_backends(ph_context_t *ctx, const uint8_t *buffer, size_t length);
+
+/* Nonzero when any decoder backend is available */
+int ph_have_decoders(void);
+
+/* Locates the JPEG thumbnail embedded in the EXIF (APP1) or JFXX (APP0)
+ * header of a JPEG. Returns 0 when there is none. */
+int ph_find_thumbnail(const uint8_t *buffer, size_t length, const uint8_t **out_data,
+                      size_t *out_length);
+
+/* Decodes an image whose load was answered from the result cache */
+ph_error_t ph_ensure_decoded(ph_context_t *ctx);
+
+/*
+ * Allocation Helpers
+ */
+
+/* Allocate through 'a', or the global allocator when it is NULL */
+void *ph_mem_alloc(const ph_allocator_t *a, size_t size);
+void *ph_mem_calloc(const ph_allocator_t *a, size_t count, size_t size);
+void *ph_mem_realloc(const ph_allocator_t *a, void *ptr, size_t old_size, size_t new_size);
+void ph_mem_free(const ph_allocator_t *a, void *ptr);
+
+int ph_valid_allocator(const ph_allocator_t *allocator);
+
+/* Allocator of the context's image memory (NULL: the global one) */
+#define PH_CTX_ALLOC(ctx) ((ctx)->has_allocator ? &(ctx)->allocator : NULL)
+
+/* Makes the ph_decode_* functions (stb_image's hooks) allocate through
+ * 'allocator' on this thread. Returns the previous one for restoring. */
+const ph_allocator_t *ph_set_decode_allocator(const ph_allocator_t *allocator);
+void *ph_decode_malloc(size_t size);
+void *ph_decode_realloc(void *ptr, size_t old_size, size_t new_size);
+void ph_decode_free(void *ptr);
+
+/* Frees the buffers a context keeps between images */
+void ph_context_trim_buffers(ph_context_t *ctx);
+
+/*
+ * Result Cache Helpers
+ */
+
+/* 128-bit fingerprints identifying an image in the result cache */
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} ph_cache_key_t;
+
+ph_cache_key_t ph_cache_key_memory(const uint8_t *buffer, size_t length);
+int ph_cache_key_file(const char *filepath, ph_cache_key_t *out_key);
+
+/* Copies the stored entry for 'key' into 'out'. Returns 1 on a hit. */
+int ph_cache_lookup(ph_cache_t *cache, ph_cache_key_t key, ph_hashes_t *out);
+
+/* Inserts or replaces the entry for 'key' */
+void ph_cache_insert(ph_cache_t *cache, ph_cache_key_t key, const ph_hashes_t *hashes);
+
+/* Serves 'algo' from the context's cached results. Returns 1 on a hit.
+ * 'out' is a uint64_t* or ph_digest_t* depending on the algorithm. */
+int ph_cache_fetch(const ph_context_t *ctx, ph_algo_t algo, void *out);
+
+/* Records a freshly computed result in the attached cache */
+void ph_cache_store(ph_context_t *ctx, ph_algo_t algo, const void *result);
+
+#define PH_PYRAMID_MAX_LEVELS 32
+
 /* Internal Context Structure */
 struct ph_context {
     uint8_t *data;
-    uint8_t *gray_data;
+    uint8_t *gray_data; /* 'gray_buf', or 'data' itself for one-channel images */
+    uint8_t *gray_buf;
+    size_t gray_cap;
     int width;
     int height;
     int channels;
     int is_loaded;
+    ph_load_source_t source;
+
+    /* Set when 'data' came from a decoder backend (NULL: stb_image) */
+    void (*release_pixels)(void *user_data, uint8_t *pixels);
+    void *release_user_data;
+    int min_width; /* Decode hint, see ph_context_set_min_resolution() */
+    int min_height;
+    uint32_t load_flags; /* PH_LOAD_* */
+
+    /* Animation frames, back to back; 'data' points at the selected one */
+    uint8_t *frames;
+    int *frame_delays;
+    int frame_count;
+    int frame_index;
 
     uint8_t gamma_lut[256];
+
+    /* Allocator for image memory, see ph_context_set_allocator() */
+    ph_allocator_t allocator;
+    int has_allocator;
+
+    /* Gray mip pyramid: levels 1..pyramid_levels packed in one buffer */
+    uint8_t *pyramid;
+    size_t pyramid_cap;
+    int pyramid_levels;
+    int level_w[PH_PYRAMID_MAX_LEVELS];
+    int level_h[PH_PYRAMID_MAX_LEVELS];
+    size_t level_offset[PH_PYRAMID_MAX_LEVELS];
+
+    /* Summed-area table of the gray plane, (width + 1) x (height + 1) with a
+     * zero first row and column. Sums wrap modulo 2^32; differences over
+     * rectangles of fewer than 2^32 / 255 pixels are still exact. */
+    uint32_t *sat;
+    size_t sat_cap;
+    int has_sat;
+
+    /* Result cache state */
+    ph_cache_t *cache;
+    ph_cache_key_t cache_key;
+    uint64_t cache_salt; /* Fingerprint of settings that affect results */
+    int has_cache_key;
+    ph_hashes_t cached; /* Results known for the current image */
+
+    /* Source kept for a decode deferred by a cache hit */
+    int deferred;
+    char *deferred_path;
+    uint8_t *deferred_buf;
+    size_t deferred_len;
+    size_t deferred_cap;
 };
 
 #endif /* INTERNAL_H */
@@ -0,0 +1,314 @@
+#include "internal.h"
+#include "thread.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Thresholded all-pairs join between two hash sets.
+ *
+ * Work is split into tiles of A rows claimed dynamically by the workers. A
+ * worker sweeps its rows over B one cache-sized tile at a time, so each B
+ * tile is loaded from memory once per A tile instead of once per row. For
+ * uint64_t hashes four A rows are kept in registers and compared against
+ * each B value (XOR + hardware popcount); the digest kernels are written
+ * over fixed-size words and byte lanes the compiler vectorizes. Matches are
+ * buffered per worker and handed to the callback in batches under a lock,
+ * so memory stays bounded no matter how many pairs qualify.
+ */
+
+/* A rows per work unit */
+#define TILE_A 64
+/* B entries swept per pass: 2048 hashes (16 KB) or 128 digests (9 KB) stay in L1 */
+#define TILE_B_U64 2048
+#define TILE_B_DIGEST 128
+/* Pairs buffered per worker before a callback */
+#define PAIR_BATCH 4096
+
+typedef enum { MODE_U64, MODE_HAMMING, MODE_L2 } pair_mode_t;
+
+typedef struct {
+    pair_mode_t mode;
+    const uint64_t *a64;
+    const uint64_t *b64;
+    const ph_digest_t *ad;
+    const ph_digest_t *bd;
+    size_t na;
+    size_t nb;
+    int self; /* B is A: each unordered pair once, with a < b */
+    int max_dist;
+    int64_t max_sq; /* L2: squared threshold */
+    ph_pair_callback_t callback;
+    void *user_data;
+    ph_mutex_t emit_lock;
+    atomic_size_t cursor;
+    atomic_int stop;
+} pair_job_t;
+
+typedef struct {
+    pair_job_t *job;
+    ph_pair_t *pairs;
+    size_t count;
+} pair_sink_t;
+
+static void flush(pair_sink_t *sink) {
+    pair_job_t *job = sink->job;
+    if (sink->count == 0)
+        return;
+    ph_mutex_lock(&job->emit_lock);
+    if (!atomic_load_explicit(&job->stop, memory_order_relaxed) &&
+        job->callback(sink->pairs, sink->count, job->user_data) != 0)
+        atomic_store(&job->stop, 1);
+    ph_mutex_unlock(&job->emit_lock);
+    sink->count = 0;
+}
+
+static inline void emit(pair_sink_t *sink, size_t a, size_t b, float distance) {
+    ph_pair_t *p = &sink->pairs[sink->count++];
+    p->a = (uint32_t)a;
+    p->b = (uint32_t)b;
+    p->distance = distance;
+    if (sink->count == PAIR_BATCH)
+        flush(sink);
+}
+
+// --- Kernels ---
+
+static void tile_u64(pair_sink_t *sink, size_t a_begin, size_t a_end) {
+    const pair_job_t *job = sink->job;
+    const uint64_t *A = job->a64, *B = job->b64;
+    const int max = job->max_dist;
+    size_t b_start = job->self ? a_begin + 1 : 0;
+
+    for (size_t jb = b_start; jb < job->nb; jb += TILE_B_U64) {
+        size_t jend = jb + TILE_B_U64 < job->nb ? jb + TILE_B_U64 : job->nb;
+        size_t i = a_begin;
+
+        for (; i + 4 <= a_end; i += 4) {
+            const uint64_t a0 = A[i], a1 = A[i + 1], a2 = A[i + 2], a3 = A[i + 3];
+            size_t j = jb;
+            if (job->self && j < i + 1)
+                j = i + 1;
+            for (; j < jend; j++) {
+                const uint64_t v = B[j];
+                int d0 = popcount64(a0 ^ v), d1 = popcount64(a1 ^ v);
+                int d2 = popcount64(a2 ^ v), d3 = popcount64(a3 ^ v);
+                if ((d0 <= max) | (d1 <= max) | (d2 <= max) | (d3 <= max)) {
+                    // In a self-join, lane k only pairs with j > i + k
+                    if (d0 <= max)
+                        emit(sink, i, j, (float)d0);
+                    if (d1 <= max && (!job->self || j > i + 1))
+                        emit(sink, i + 1, j, (float)d1);
+                    if (d2 <= max && (!job->self || j > i + 2))
+                        emit(sink, i + 2, j, (float)d2);
+                    if (d3 <= max && (!job->self || j > i + 3))
+                        emit(sink, i + 3, j, (float)d3);
+                }
+            }
+        }
+        for (; i < a_end; i++) {
+            const uint64_t a0 = A[i];
+            size_t j = (job->self && jb < i + 1) ? i + 1 : jb;
+            for (; j < jend; j++) {
+                int d = popcount64(a0 ^ B[j]);
+                if (d <= max)
+                    emit(sink, i, j, (float)d);
+            }
+        }
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed))
+            return;
+    }
+}
+
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Hamming distance of two digests, giving up once it exceeds 'max' */
+static inline int digest_hamming(const uint8_t *a, const uint8_t *b, int size, int max) {
+    int d = 0, i = 0;
+    for (; i + 8 <= size; i += 8) {
+        d += popcount64(load64(a + i) ^ load64(b + i));
+        if (d > max)
+            return d;
+    }
+    for (; i < size; i++)
+        d += popcount64((uint64_t)(a[i] ^ b[i]));
+    return d;
+}
+
+static void tile_digest(pair_sink_t *sink, size_t a_begin, size_t a_end) {
+    const pair_job_t *job = sink->job;
+    const ph_digest_t *A = job->ad, *B = job->bd;
+    const int size = job->na > 0 ? A[0].size : 0;
+    size_t b_start = job->self ? a_begin + 1 : 0;
+
+    for (size_t jb = b_start; jb < job->nb; jb += TILE_B_DIGEST) {
+        size_t jend = jb + TILE_B_DIGEST < job->nb ? jb + TILE_B_DIGEST : job->nb;
+        for (size_t i = a_begin; i < a_end; i++) {
+            const uint8_t *a = A[i].data;
+            size_t j = (job->self && jb < i + 1) ? i + 1 : jb;
+            if (job->mode == MODE_HAMMING) {
+                for (; j < jend; j++) {
+                    int d = digest_hamming(a, B[j].data, size, job->max_dist);
+                    if (d <= job->max_dist)
+                        emit(sink, i, j, (float)d);
+                }
+            } else {
+                for (; j < jend; j++) {
+                    int64_t sq = ph_l2_sq_u8(a, B[j].data, (size_t)size);
+                    if (sq <= job->max_sq)
+                        emit(sink, i, j, (float)sqrt((double)sq));
+                }
+            }
+        }
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed))
+            return;
+    }
+}
+
+// --- Driver ---
+
+static void pair_worker(void *arg) {
+    pair_sink_t *sink = arg;
+    pair_job_t *job = sink->job;
+
+    for (;;) {
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed))
+            break;
+        size_t start = atomic_fetch_add(&job->cursor, TILE_A);
+        if (start >= job->na)
+            break;
+        size_t end = start + TILE_A < job->na ? start + TILE_A : job->na;
+        if (job->mode == MODE_U64)
+            tile_u64(sink, start, end);
+        else
+            tile_digest(sink, start, end);
+    }
+    flush(sink);
+}
+
+static ph_error_t run_join(pair_job_t *job, int threads) {
+    if (threads == 0)
+        threads = ph_cpu_count();
+    size_t tiles = (job->na + TILE_A - 1) / TILE_A;
+    if ((size_t)threads > tiles)
+        threads = tiles > 0 ? (int)tiles : 1;
+
+    pair_sink_t *sinks = ph_mem_calloc(NULL, (size_t)threads, sizeof(pair_sink_t));
+    ph_pair_t *buffers = ph_mem_alloc(NULL, (size_t)threads * PAIR_BATCH * sizeof(ph_pair_t));
+    ph_thread_t *pool =
+        threads > 1 ? ph_mem_alloc(NULL, (size_t)(threads - 1) * sizeof(ph_thread_t)) : NULL;
+    if (!sinks || !buffers || (threads > 1 && !pool)) {
+        ph_mem_free(NULL, sinks);
+        ph_mem_free(NULL, buffers);
+        ph_mem_free(NULL, pool);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+    for (int t = 0; t < threads; t++) {
+        sinks[t].job = job;
+        sinks[t].pairs = buffers + (size_t)t * PAIR_BATCH;
+    }
+
+    ph_mutex_init(&job->emit_lock);
+    atomic_store(&job->cursor, 0);
+    atomic_store(&job->stop, 0);
+
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (ph_thread_create(&pool[t - 1], pair_worker, &sinks[t]) != 0)
+            break;
+        started++;
+    }
+    pair_worker(&sinks[0]);
+    for (int t = 0; t < started; t++)
+        ph_thread_join(pool[t]);
+
+    ph_mutex_destroy(&job->emit_lock);
+    ph_mem_free(NULL, pool);
+    ph_mem_free(NULL, buffers);
+    ph_mem_free(NULL, sinks);
+    return PH_SUCCESS;
+}
+
+static int valid_sets(const void *a, size_t na, const void *b, size_t nb) {
+    return (a || na == 0) && (b || nb == 0) && na <= UINT32_MAX && nb <= UINT32_MAX;
+}
+
+/* All digests of both sets must share one size */
+static int uniform_size(const ph_digest_t *a, size_t na, const ph_digest_t *b, size_t nb) {
+    int size = na > 0 ? a[0].size : (nb > 0 ? b[0].size : 0);
+    if (size > PH_DIGEST_MAX_BYTES)
+        return 0;
+    for (size_t i = 0; i < na; i++) {
+        if (a[i].size != size)
+            return 0;
+    }
+    for (size_t i = 0; b != a && i < nb; i++) {
+        if (b[i].size != size)
+            return 0;
+    }
+    return 1;
+}
+
+static void init_job(pair_job_t *job, size_t na, size_t nb, int self,
+                     ph_pair_callback_t callback, void *user_data) {
+    memset(job, 0, sizeof(*job));
+    job->na = na;
+    job->nb = nb;
+    job->self = self;
+    job->callback = callback;
+    job->user_data = user_data;
+}
+
+PH_API ph_error_t ph_pairs_within_u64(const uint64_t *a, size_t na, const uint64_t *b, size_t nb,
+                                      int max_dist, int threads, ph_pair_callback_t callback,
+                                      void *user_data) {
+    if (!callback || max_dist < 0 || threads < 0 || !valid_sets(a, na, b, nb))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    pair_job_t job;
+    init_job(&job, na, nb, a == b && na == nb, callback, user_data);
+    job.mode = MODE_U64;
+    job.a64 = a;
+    job.b64 = b;
+    job.max_dist = max_dist;
+    return run_join(&job, threads);
+}
+
+PH_API ph_error_t ph_pairs_within_digest(const ph_digest_t *a, size_t na, const ph_digest_t *b,
+                                         size_t nb, int max_dist, int threads,
+                                         ph_pair_callback_t callback, void *user_data) {
+    if (!callback || max_dist < 0 || threads < 0 || !valid_sets(a, na, b, nb) ||
+        !uniform_size(a, na, b, nb))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    pair_job_t job;
+    init_job(&job, na, nb, a == b && na == nb, callback, user_data);
+    job.mode = MODE_HAMMING;
+    job.ad = a;
+    job.bd = b;
+    job.max_dist = max_dist;
+    return run_join(&job, threads);
+}
+
+PH_API ph_error_t ph_pairs_within_l2(const ph_digest_t *a, size_t na, const ph_digest_t *b,
+                                     size_t nb, double max_dist, int threads,
+                                     ph_pair_callback_t callback, void *user_data) {
+    if (!callback || !(max_dist >= 0.0) || threads < 0 || !valid_sets(a, na, b, nb) ||
+        !uniform_size(a, na, b, nb))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    pair_job_t job;
+    init_job(&job, na, nb, a == b && na == nb, callback, user_data);
+    job.mode = MODE_L2;
+    job.ad = a;
+    job.bd = b;
+    // Squared distances are integers: compare against the largest one allowed
+    double max_sq = floor(max_dist * max_dist + 1e-9);
+    job.max_sq = max_sq > (double)INT64_MAX ? INT64_MAX : (int64_t)max_sq;
+    return run_join(&job, threads);
+}
@@ -0,0 +1,149 @@
+#include "internal.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/*
+ * Context pool.
+ *
+ * Idle contexts sit in slots of a fixed array (one per allowed idle
+ * context). Slots are linked into lock-free Treiber stacks: one of empty
+ * slots and one of filled slots per shard. Stack heads pack a slot index
+ * with a version tag in 64 bits so a slot popped and pushed back between a
+ * load and a CAS (ABA) cannot corrupt a list.
+ *
+ * Each thread is assigned a home shard on first use. Releasing pushes onto
+ * it and acquiring pops from it first, so a thread tends to get back the
+ * context (and buffers) it used last, still warm in its cache. Other shards
+ * are only searched when the home shard is empty.
+ */
+
+#define MAX_SHARDS 64
+#define NIL 0xFFFFFFFFu
+
+typedef struct {
+    ph_context_t *ctx;
+    _Atomic uint32_t next;
+} pool_slot_t;
+
+/* Tagged stack head: version in the high half, slot index in the low half */
+typedef _Atomic uint64_t stack_head_t;
+
+struct ph_context_pool {
+    pool_slot_t *slots;
+    size_t max_idle;
+    int shard_count;
+    stack_head_t empty;
+    stack_head_t shards[MAX_SHARDS];
+    ph_context_t *defaults; /* Settings restored on release */
+};
+
+static atomic_uint s_next_thread = 0;
+static _Thread_local int tls_thread_id = -1;
+
+static int home_shard(const ph_context_pool_t *pool) {
+    if (tls_thread_id < 0)
+        tls_thread_id = (int)(atomic_fetch_add(&s_next_thread, 1) & 0x7FFFFFFF);
+    return tls_thread_id % pool->shard_count;
+}
+
+static void push(ph_context_pool_t *pool, stack_head_t *head, uint32_t slot) {
+    uint64_t old = atomic_load_explicit(head, memory_order_relaxed);
+    for (;;) {
+        atomic_store_explicit(&pool->slots[slot].next, (uint32_t)old, memory_order_relaxed);
+        uint64_t tagged = ((old >> 32) + 1) << 32 | slot;
+        if (atomic_compare_exchange_weak_explicit(head, &old, tagged, memory_order_release,
+                                                  memory_order_relaxed))
+            return;
+    }
+}
+
+static uint32_t pop(ph_context_pool_t *pool, stack_head_t *head) {
+    uint64_t old = atomic_load_explicit(head, memory_order_acquire);
+    for (;;) {
+        uint32_t slot = (uint32_t)old;
+        if (slot == NIL)
+            return NIL;
+        uint32_t next = atomic_load_explicit(&pool->slots[slot].next, memory_order_relaxed);
+        uint64_t tagged = ((old >> 32) + 1) << 32 | next;
+        if (atomic_compare_exchange_weak_explicit(head, &old, tagged, memory_order_acquire,
+                                                  memory_order_acquire))
+            return slot;
+    }
+}
+
+PH_API ph_error_t ph_context_pool_create(size_t max_idle, ph_context_pool_t **out_pool) {
+    if (!out_pool || max_idle >= NIL)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_context_pool_t *pool = ph_mem_calloc(NULL, 1, sizeof(ph_context_pool_t));
+    if (!pool)
+        return PH_ERR_ALLOCATION_FAILED;
+    pool->slots = ph_mem_calloc(NULL, max_idle > 0 ? max_idle : 1, sizeof(pool_slot_t));
+    if (!pool->slots || ph_create(&pool->defaults) != PH_SUCCESS) {
+        ph_mem_free(NULL, pool->slots);
+        ph_mem_free(NULL, pool);
+        return PH_ERR_ALLOCATION_FAILED;
+    }
+
+    int cpus = ph_cpu_count();
+    pool->shard_count = cpus < MAX_SHARDS ? cpus : MAX_SHARDS;
+    pool->max_idle = max_idle;
+    atomic_init(&pool->empty, NIL);
+    for (int s = 0; s < MAX_SHARDS; s++)
+        atomic_init(&pool->shards[s], NIL);
+    for (size_t i = max_idle; i-- > 0;)
+        push(pool, &pool->empty, (uint32_t)i);
+
+    *out_pool = pool;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_context_pool_destroy(ph_context_pool_t *pool) {
+    if (!pool)
+        return;
+    for (int s = 0; s < pool->shard_count; s++) {
+        uint32_t slot;
+        while ((slot = pop(pool, &pool->shards[s])) != NIL)
+            ph_free(pool->slots[slot].ctx);
+    }
+    ph_free(pool->defaults);
+    ph_mem_free(NULL, pool->slots);
+    ph_mem_free(NULL, pool);
+}
+
+PH_API ph_error_t ph_context_pool_acquire(ph_context_pool_t *pool, ph_context_t **out_ctx) {
+    if (!pool || !out_ctx)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    int home = home_shard(pool);
+    for (int i = 0; i < pool->shard_count; i++) {
+        int s = (home + i) % pool->shard_count;
+        uint32_t slot = pop(pool, &pool->shards[s]);
+        if (slot != NIL) {
+            *out_ctx = pool->slots[slot].ctx;
+            push(pool, &pool->empty, slot);
+            return PH_SUCCESS;
+        }
+    }
+    return ph_create(out_ctx);
+}
+
+PH_API void ph_context_pool_release(ph_context_pool_t *pool, ph_context_t *ctx) {
+    if (!ctx)
+        return;
+    if (!pool) {
+        ph_free(ctx);
+        return;
+    }
+
+    uint32_t slot = pop(pool, &pool->empty);
+    if (slot == NIL) {
+        // Already max_idle contexts waiting
+        ph_free(ctx);
+        return;
+    }
+    ph_context_reset(ctx, pool->defaults);
+    pool->slots[slot].ctx = ctx;
+    push(pool, &pool->shards[home_shard(pool)], slot);
+}
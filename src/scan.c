@@ -0,0 +1,227 @@
+#include "internal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Digest scans.
+ *
+ * The set stores digests as rows of exactly 'size' bytes. A scan computes
+ * the distances of a block of rows into a small buffer with the batched
+ * kernels and filters the buffer afterwards, keeping the kernels free of
+ * branches on the results.
+ */
+
+#define BLOCK_ROWS 256
+
+struct ph_digest_set {
+    uint8_t *rows;
+    size_t count;
+    size_t cap;
+    int size;
+};
+
+typedef void (*rows_kernel_t)(const uint8_t *query, const uint8_t *rows, size_t n, size_t count,
+                              uint32_t *out);
+
+PH_API ph_error_t ph_digest_set_create(int digest_size, ph_digest_set_t **out_set) {
+    if (!out_set || digest_size < 1 || digest_size > PH_DIGEST_MAX_BYTES)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    ph_digest_set_t *set = ph_mem_calloc(NULL, 1, sizeof(ph_digest_set_t));
+    if (!set)
+        return PH_ERR_ALLOCATION_FAILED;
+    set->size = digest_size;
+    *out_set = set;
+    return PH_SUCCESS;
+}
+
+PH_API void ph_digest_set_free(ph_digest_set_t *set) {
+    if (set) {
+        ph_mem_free(NULL, set->rows);
+        ph_mem_free(NULL, set);
+    }
+}
+
+PH_API ph_error_t ph_digest_set_add(ph_digest_set_t *set, const ph_digest_t *digests, size_t n) {
+    if (!set || (!digests && n > 0) || n > UINT32_MAX - set->count)
+        return PH_ERR_INVALID_ARGUMENT;
+    for (size_t i = 0; i < n; i++) {
+        if (digests[i].size != set->size)
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+
+    if (set->count + n > set->cap) {
+        size_t cap = set->cap ? set->cap : 64;
+        while (cap < set->count + n)
+            cap *= 2;
+        uint8_t *rows = ph_mem_realloc(NULL, set->rows, set->cap * (size_t)set->size,
+                                       cap * (size_t)set->size);
+        if (!rows)
+            return PH_ERR_ALLOCATION_FAILED;
+        set->rows = rows;
+        set->cap = cap;
+    }
+    for (size_t i = 0; i < n; i++)
+        memcpy(set->rows + (set->count + i) * set->size, digests[i].data, (size_t)set->size);
+    set->count += n;
+    return PH_SUCCESS;
+}
+
+PH_API size_t ph_digest_set_count(const ph_digest_set_t *set) { return set ? set->count : 0; }
+
+PH_API ph_error_t ph_digest_set_get(const ph_digest_set_t *set, size_t index,
+                                    ph_digest_t *out_digest) {
+    if (!set || !out_digest || index >= set->count)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    memset(out_digest, 0, sizeof(*out_digest));
+    memcpy(out_digest->data, set->rows + index * set->size, (size_t)set->size);
+    out_digest->size = (uint8_t)set->size;
+    return PH_SUCCESS;
+}
+
+static ph_error_t scan(const ph_digest_t *query, const ph_digest_set_t *set, rows_kernel_t kernel,
+                       uint32_t max_raw, int squared, ph_match_t *out_matches, size_t max_matches,
+                       size_t *out_count) {
+    uint32_t dist[BLOCK_ROWS];
+    size_t found = 0;
+
+    for (size_t start = 0; start < set->count; start += BLOCK_ROWS) {
+        size_t rows = set->count - start < BLOCK_ROWS ? set->count - start : BLOCK_ROWS;
+        kernel(query->data, set->rows + start * set->size, (size_t)set->size, rows, dist);
+        for (size_t r = 0; r < rows; r++) {
+            if (dist[r] > max_raw)
+                continue;
+            if (found < max_matches) {
+                out_matches[found].index = (uint32_t)(start + r);
+                out_matches[found].distance =
+                    squared ? (float)sqrt((double)dist[r]) : (float)dist[r];
+            }
+            found++;
+        }
+    }
+    *out_count = found;
+    return PH_SUCCESS;
+}
+
+/* Max-heap on (distance, index): the root is the worst of the k kept */
+static int worse(ph_candidate_t a, ph_candidate_t b) {
+    return a.dist > b.dist || (a.dist == b.dist && a.index > b.index);
+}
+
+static void sift_down(ph_candidate_t *heap, size_t n, size_t i) {
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, top = i;
+        if (l < n && worse(heap[l], heap[top]))
+            top = l;
+        if (r < n && worse(heap[r], heap[top]))
+            top = r;
+        if (top == i)
+            return;
+        ph_candidate_t tmp = heap[i];
+        heap[i] = heap[top];
+        heap[top] = tmp;
+        i = top;
+    }
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    const ph_candidate_t *x = a, *y = b;
+    return worse(*x, *y) ? 1 : worse(*y, *x) ? -1 : 0;
+}
+
+void ph_topk_push(ph_candidate_t *heap, size_t *kept, size_t k, ph_candidate_t c) {
+    if (*kept < k) {
+        heap[(*kept)++] = c;
+        if (*kept == k) {
+            for (size_t i = k / 2; i-- > 0;)
+                sift_down(heap, k, i);
+        }
+    } else if (k > 0 && worse(heap[0], c)) {
+        heap[0] = c;
+        sift_down(heap, k, 0);
+    }
+}
+
+void ph_topk_sort(ph_candidate_t *heap, size_t n) {
+    qsort(heap, n, sizeof(ph_candidate_t), compare_candidates);
+}
+
+static ph_error_t topk(const ph_digest_t *query, const ph_digest_set_t *set, rows_kernel_t kernel,
+                       int squared, size_t k, ph_match_t *out_matches, size_t *out_count) {
+    if (k > set->count)
+        k = set->count;
+    *out_count = 0;
+    if (k == 0)
+        return PH_SUCCESS;
+
+    ph_candidate_t *heap = ph_mem_alloc(NULL, k * sizeof(ph_candidate_t));
+    if (!heap)
+        return PH_ERR_ALLOCATION_FAILED;
+
+    uint32_t dist[BLOCK_ROWS];
+    size_t kept = 0;
+    for (size_t start = 0; start < set->count; start += BLOCK_ROWS) {
+        size_t rows = set->count - start < BLOCK_ROWS ? set->count - start : BLOCK_ROWS;
+        kernel(query->data, set->rows + start * set->size, (size_t)set->size, rows, dist);
+        for (size_t r = 0; r < rows; r++) {
+            ph_candidate_t c = {dist[r], (uint32_t)(start + r)};
+            ph_topk_push(heap, &kept, k, c);
+        }
+    }
+
+    ph_topk_sort(heap, k);
+    for (size_t i = 0; i < k; i++) {
+        out_matches[i].index = heap[i].index;
+        out_matches[i].distance =
+            squared ? (float)sqrt((double)heap[i].dist) : (float)heap[i].dist;
+    }
+    ph_mem_free(NULL, heap);
+    *out_count = k;
+    return PH_SUCCESS;
+}
+
+static int valid_query(const ph_digest_t *query, const ph_digest_set_t *set) {
+    return query && set && query->size == set->size;
+}
+
+/* Distances are integers: the largest raw value still within max_dist */
+static uint32_t raw_limit(double max) {
+    double limit = floor(max + 1e-9);
+    return limit >= (double)UINT32_MAX ? UINT32_MAX : (uint32_t)limit;
+}
+
+PH_API ph_error_t ph_l2_scan(const ph_digest_t *query, const ph_digest_set_t *set,
+                             double max_dist, ph_match_t *out_matches, size_t max_matches,
+                             size_t *out_count) {
+    if (!valid_query(query, set) || !(max_dist >= 0.0) || (!out_matches && max_matches > 0) ||
+        !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+    return scan(query, set, ph_l2_sq_rows, raw_limit(max_dist * max_dist), 1, out_matches,
+                max_matches, out_count);
+}
+
+PH_API ph_error_t ph_sad_scan(const ph_digest_t *query, const ph_digest_set_t *set,
+                              double max_dist, ph_match_t *out_matches, size_t max_matches,
+                              size_t *out_count) {
+    if (!valid_query(query, set) || !(max_dist >= 0.0) || (!out_matches && max_matches > 0) ||
+        !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+    return scan(query, set, ph_sad_rows, raw_limit(max_dist), 0, out_matches, max_matches,
+                out_count);
+}
+
+PH_API ph_error_t ph_l2_topk(const ph_digest_t *query, const ph_digest_set_t *set, size_t k,
+                             ph_match_t *out_matches, size_t *out_count) {
+    if (!valid_query(query, set) || (!out_matches && k > 0) || !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+    return topk(query, set, ph_l2_sq_rows, 1, k, out_matches, out_count);
+}
+
+PH_API ph_error_t ph_sad_topk(const ph_digest_t *query, const ph_digest_set_t *set, size_t k,
+                              ph_match_t *out_matches, size_t *out_count) {
+    if (!valid_query(query, set) || (!out_matches && k > 0) || !out_count)
+        return PH_ERR_INVALID_ARGUMENT;
+    return topk(query, set, ph_sad_rows, 0, k, out_matches, out_count);
+}
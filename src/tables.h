@@ -0,0 +1,27 @@
+#ifndef PH_TABLES_H
+#define PH_TABLES_H
+
+#include <stdint.h>
+
+/*
+ * Constant tables generated at build time by tools/gen_tables.c.
+ * They are plain read-only data: nothing to initialize, safe to use from
+ * any thread.
+ */
+
+#define PH_DCT_SIZE 32
+#define PH_RADIAL_PROJECTIONS 40
+#define PH_DEFAULT_GAMMA 2.2f
+
+/* Orthonormal DCT-II basis: row i is frequency i, column j is sample j */
+extern const double ph_dct_matrix[PH_DCT_SIZE][PH_DCT_SIZE];
+extern const float ph_dct_matrix_f32[PH_DCT_SIZE][PH_DCT_SIZE];
+
+/* Gamma LUT for PH_DEFAULT_GAMMA, as computed by ph_context_set_gamma() */
+extern const uint8_t ph_default_gamma_lut[256];
+
+/* cos/sin of the projection angles i * pi / PH_RADIAL_PROJECTIONS */
+extern const double ph_radial_cos[PH_RADIAL_PROJECTIONS];
+extern const double ph_radial_sin[PH_RADIAL_PROJECTIONS];
+
+#endif /* PH_TABLES_H */
@@ -0,0 +1,99 @@
+#include "internal.h"
+#include "thread.h"
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+typedef struct {
+    ph_thread_fn fn;
+    void *arg;
+} thread_start_t;
+
+#if defined(_WIN32)
+
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+    thread_start_t start = *(thread_start_t *)p;
+    ph_mem_free(NULL, p);
+    start.fn(start.arg);
+    return 0;
+}
+
+int ph_thread_create(ph_thread_t *thread, ph_thread_fn fn, void *arg) {
+    thread_start_t *start = ph_mem_alloc(NULL, sizeof(*start));
+    if (!start)
+        return -1;
+    start->fn = fn;
+    start->arg = arg;
+    *thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (!*thread) {
+        ph_mem_free(NULL, start);
+        return -1;
+    }
+    return 0;
+}
+
+void ph_thread_join(ph_thread_t thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+void ph_mutex_init(ph_mutex_t *m) { InitializeSRWLock(m); }
+void ph_mutex_destroy(ph_mutex_t *m) { (void)m; }
+void ph_mutex_lock(ph_mutex_t *m) { AcquireSRWLockExclusive(m); }
+void ph_mutex_unlock(ph_mutex_t *m) { ReleaseSRWLockExclusive(m); }
+
+void ph_cond_init(ph_cond_t *c) { InitializeConditionVariable(c); }
+void ph_cond_destroy(ph_cond_t *c) { (void)c; }
+void ph_cond_wait(ph_cond_t *c, ph_mutex_t *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+void ph_cond_signal(ph_cond_t *c) { WakeConditionVariable(c); }
+void ph_cond_broadcast(ph_cond_t *c) { WakeAllConditionVariable(c); }
+
+int ph_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+static void *thread_trampoline(void *p) {
+    thread_start_t start = *(thread_start_t *)p;
+    ph_mem_free(NULL, p);
+    start.fn(start.arg);
+    return NULL;
+}
+
+int ph_thread_create(ph_thread_t *thread, ph_thread_fn fn, void *arg) {
+    thread_start_t *start = ph_mem_alloc(NULL, sizeof(*start));
+    if (!start)
+        return -1;
+    start->fn = fn;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+        ph_mem_free(NULL, start);
+        return -1;
+    }
+    return 0;
+}
+
+void ph_thread_join(ph_thread_t thread) { pthread_join(thread, NULL); }
+
+void ph_mutex_init(ph_mutex_t *m) { pthread_mutex_init(m, NULL); }
+void ph_mutex_destroy(ph_mutex_t *m) { pthread_mutex_destroy(m); }
+void ph_mutex_lock(ph_mutex_t *m) { pthread_mutex_lock(m); }
+void ph_mutex_unlock(ph_mutex_t *m) { pthread_mutex_unlock(m); }
+
+void ph_cond_init(ph_cond_t *c) { pthread_cond_init(c, NULL); }
+void ph_cond_destroy(ph_cond_t *c) { pthread_cond_destroy(c); }
+void ph_cond_wait(ph_cond_t *c, ph_mutex_t *m) { pthread_cond_wait(c, m); }
+void ph_cond_signal(ph_cond_t *c) { pthread_cond_signal(c); }
+void ph_cond_broadcast(ph_cond_t *c) { pthread_cond_broadcast(c); }
+
+int ph_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+#endif
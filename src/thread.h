@@ -0,0 +1,43 @@
+#ifndef PH_THREAD_H
+#define PH_THREAD_H
+
+/*
+ * Minimal portable threading layer (POSIX threads / Win32).
+ * Only what the library's worker pools need.
+ */
+
+#if defined(_WIN32)
+#include <windows.h>
+typedef HANDLE ph_thread_t;
+typedef SRWLOCK ph_mutex_t;
+typedef CONDITION_VARIABLE ph_cond_t;
+#define PH_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+#include <pthread.h>
+typedef pthread_t ph_thread_t;
+typedef pthread_mutex_t ph_mutex_t;
+typedef pthread_cond_t ph_cond_t;
+#define PH_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+typedef void (*ph_thread_fn)(void *arg);
+
+/* Returns 0 on success. */
+int ph_thread_create(ph_thread_t *thread, ph_thread_fn fn, void *arg);
+void ph_thread_join(ph_thread_t thread);
+
+void ph_mutex_init(ph_mutex_t *m);
+void ph_mutex_destroy(ph_mutex_t *m);
+void ph_mutex_lock(ph_mutex_t *m);
+void ph_mutex_unlock(ph_mutex_t *m);
+
+void ph_cond_init(ph_cond_t *c);
+void ph_cond_destroy(ph_cond_t *c);
+void ph_cond_wait(ph_cond_t *c, ph_mutex_t *m);
+void ph_cond_signal(ph_cond_t *c);
+void ph_cond_broadcast(ph_cond_t *c);
+
+/* Number of online CPUs (at least 1). */
+int ph_cpu_count(void);
+
+#endif /* PH_THREAD_H */
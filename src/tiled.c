@@ -0,0 +1,83 @@
+#include "internal.h"
+#include <math.h>
+
+/*
+ * Tiled hashing.
+ *
+ * Every tile is area-averaged straight from the summed-area table to the
+ * input size of the hash kernel, so a tile costs the same whatever its size
+ * and the only full-image pass is building the table.
+ */
+
+#define MAX_GRID 64
+#define MAX_OVERLAP 0.9f
+
+/* Splits 'length' pixels into 'grid' spans overlapping by 'overlap' of a span */
+static void tile_span(int length, int grid, float overlap, int index, int *out_start,
+                      int *out_size) {
+    double size = length / (grid - (grid - 1) * (double)overlap);
+    double step = size * (1.0 - overlap);
+    int start = (int)lround(index * step);
+    int end = (index == grid - 1) ? length : (int)lround(index * step + size);
+    if (end > length)
+        end = length;
+    if (end <= start)
+        end = start + 1;
+    *out_start = start;
+    *out_size = end - start;
+}
+
+PH_API ph_error_t ph_compute_tiled(ph_context_t *ctx, ph_algo_t algo, int grid, float overlap,
+                                   uint64_t *out_hashes) {
+    if (!ctx || !ctx->is_loaded || !out_hashes || grid < 1 || grid > MAX_GRID ||
+        !(overlap >= 0.0f && overlap <= MAX_OVERLAP))
+        return PH_ERR_INVALID_ARGUMENT;
+
+    int dw, dh;
+    uint64_t (*kernel)(const uint8_t *);
+    switch (algo) {
+        case PH_ALGO_AHASH:
+            dw = dh = 8;
+            kernel = ph_ahash_kernel;
+            break;
+        case PH_ALGO_DHASH:
+            dw = 9;
+            dh = 8;
+            kernel = ph_dhash_kernel;
+            break;
+        case PH_ALGO_PHASH:
+            dw = dh = 32;
+            kernel = ph_phash_kernel;
+            break;
+        case PH_ALGO_WHASH:
+            dw = dh = 8;
+            kernel = ph_whash_kernel;
+            break;
+        case PH_ALGO_MHASH:
+            dw = dh = 16;
+            kernel = ph_mhash_kernel;
+            break;
+        default:
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+
+    ph_error_t err = ph_ensure_decoded(ctx);
+    if (err != PH_SUCCESS)
+        return err;
+    if (ctx->width < grid || ctx->height < grid)
+        return PH_ERR_INVALID_ARGUMENT;
+
+    uint8_t tile[32 * 32];
+    for (int ty = 0; ty < grid; ty++) {
+        int y, h;
+        tile_span(ctx->height, grid, overlap, ty, &y, &h);
+        for (int tx = 0; tx < grid; tx++) {
+            int x, w;
+            tile_span(ctx->width, grid, overlap, tx, &x, &w);
+            if (!ph_sample_area(ctx, x, y, w, h, tile, dw, dh))
+                return PH_ERR_ALLOCATION_FAILED;
+            out_hashes[ty * grid + tx] = kernel(tile);
+        }
+    }
+    return PH_SUCCESS;
+}
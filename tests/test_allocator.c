@@ -0,0 +1,160 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Counting allocator: each block carries its size in a 16-byte header */
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t live;
+    size_t peak;
+    int bad_old_size;
+} counter_t;
+
+static void *count_malloc(void *user_data, size_t size) {
+    counter_t *c = user_data;
+    uint8_t *p = malloc(size + 16);
+    if (!p)
+        return NULL;
+    memcpy(p, &size, sizeof(size));
+    c->allocs++;
+    c->live += size;
+    if (c->live > c->peak)
+        c->peak = c->live;
+    return p + 16;
+}
+
+static void count_free(void *user_data, void *ptr) {
+    counter_t *c = user_data;
+    uint8_t *p = (uint8_t *)ptr - 16;
+    size_t size;
+    memcpy(&size, p, sizeof(size));
+    c->frees++;
+    c->live -= size;
+    free(p);
+}
+
+static void *count_realloc(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+    counter_t *c = user_data;
+    if (ptr) {
+        size_t size;
+        memcpy(&size, (uint8_t *)ptr - 16, sizeof(size));
+        if (size != old_size)
+            c->bad_old_size = 1;
+    }
+    void *fresh = count_malloc(c, new_size);
+    if (fresh && ptr) {
+        memcpy(fresh, ptr, old_size < new_size ? old_size : new_size);
+        count_free(c, ptr);
+    }
+    return fresh;
+}
+
+/* Bump arena: freeing does nothing, the whole arena is reset at once */
+typedef struct {
+    uint8_t *base;
+    size_t used;
+    size_t size;
+} arena_t;
+
+static void *arena_malloc(void *user_data, size_t size) {
+    arena_t *a = user_data;
+    size_t start = (a->used + 15) & ~(size_t)15;
+    if (start + size > a->size)
+        return NULL;
+    a->used = start + size;
+    return a->base + start;
+}
+
+static void *arena_realloc(void *user_data, void *ptr, size_t old_size, size_t new_size) {
+    void *fresh = arena_malloc(user_data, new_size);
+    if (fresh && ptr)
+        memcpy(fresh, ptr, old_size < new_size ? old_size : new_size);
+    return fresh;
+}
+
+static void arena_free(void *user_data, void *ptr) {
+    (void)user_data;
+    (void)ptr;
+}
+
+void test_global_allocator() {
+    counter_t c = {0};
+    ph_allocator_t hooks = {count_malloc, count_realloc, count_free, &c};
+    ph_context_t *ctx = NULL;
+    ph_context_pool_t *pool = NULL;
+    ph_hashes_t hashes;
+
+    ASSERT_OK(ph_set_allocator(&hooks));
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_hashes(ctx, PH_ALGO_ALL, &hashes));
+    uint64_t tiles[4];
+    ASSERT_OK(ph_compute_tiled(ctx, PH_ALGO_PHASH, 2, 0.0f, tiles));
+
+    /* The decoder's 400x400 RGB output went through the hooks too */
+    ASSERT_INT_EQ(1, c.peak >= 400 * 400 * 3);
+
+    ASSERT_OK(ph_context_pool_create(2, &pool));
+    ph_context_t *pooled = NULL;
+    ASSERT_OK(ph_context_pool_acquire(pool, &pooled));
+    ph_context_pool_release(pool, pooled);
+    ph_context_pool_destroy(pool);
+    ph_free(ctx);
+
+    ASSERT_INT_EQ(0, c.bad_old_size);
+    ASSERT_INT_EQ((int)c.allocs, (int)c.frees);
+    ASSERT_INT_EQ(0, (int)c.live);
+
+    ASSERT_OK(ph_set_allocator(NULL));
+    ph_allocator_t incomplete = {count_malloc, NULL, count_free, &c};
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_set_allocator(&incomplete));
+    printf("test_global_allocator: PASSED\n");
+}
+
+void test_context_arena() {
+    counter_t c = {0};
+    ph_allocator_t global = {count_malloc, count_realloc, count_free, &c};
+    arena_t arena = {malloc(8 << 20), 0, 8 << 20};
+    ph_allocator_t hooks = {arena_malloc, arena_realloc, arena_free, &arena};
+    ph_context_t *ctx = NULL, *plain = NULL;
+    ph_hashes_t expected, got;
+
+    ASSERT_OK(ph_create(&plain));
+    ASSERT_OK(ph_load_from_file(plain, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_hashes(plain, PH_ALGO_ALL, &expected));
+    ph_free(plain);
+
+    ASSERT_OK(ph_set_allocator(&global));
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_context_set_allocator(ctx, &hooks));
+    size_t before = c.allocs;
+
+    for (int request = 0; request < 3; request++) {
+        ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+        ASSERT_OK(ph_compute_hashes(ctx, PH_ALGO_ALL, &got));
+        ASSERT_INT_EQ(0, memcmp(&expected, &got, sizeof(got)));
+        ASSERT_INT_EQ(1, arena.used >= 400 * 400 * 3);
+
+        /* Nothing refers to the arena any more: reset it */
+        ph_context_trim(ctx);
+        arena.used = 0;
+    }
+
+    /* Image memory never touched the global allocator */
+    ASSERT_INT_EQ((int)before, (int)c.allocs);
+
+    ph_free(ctx);
+    ASSERT_INT_EQ((int)c.allocs, (int)c.frees);
+    ASSERT_OK(ph_set_allocator(NULL));
+    free(arena.base);
+    printf("test_context_arena: PASSED\n");
+}
+
+int main() {
+    test_global_allocator();
+    test_context_arena();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROWS 100
+
+static ph_hashes_t s_results[ROWS];
+
+static void make_results(void) {
+    ph_context_t *ctx = NULL;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_hashes(ctx, PH_ALGO_ALL, &s_results[0]));
+    ph_free(ctx);
+    for (int i = 1; i < ROWS; i++) {
+        s_results[i] = s_results[0];
+        s_results[i].phash ^= (uint64_t)i;
+        if (i % 10 == 5)
+            s_results[i].mask &= ~(uint32_t)PH_ALGO_PHASH; /* A null */
+    }
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+void test_arrow_batch_layout() {
+    make_results();
+    uint32_t mask = PH_ALGO_PHASH | PH_ALGO_RADIAL;
+    uint64_t ids[ROWS];
+    for (int i = 0; i < ROWS; i++)
+        ids[i] = 1000 + (uint64_t)i;
+
+    size_t size = ph_arrow_batch_size(mask, ROWS), length = 0;
+    uint8_t *buffer = malloc(size);
+    ASSERT_PTR_NOT_NULL(buffer);
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_arrow_encode_batch(mask, ids, s_results, ROWS, buffer, size - 1, &length));
+    ASSERT_INT_EQ((int)size, (int)length);
+    ASSERT_OK(ph_arrow_encode_batch(mask, ids, s_results, ROWS, buffer, size, &length));
+    ASSERT_INT_EQ((int)size, (int)length);
+
+    /* Continuation marker, then 8-aligned metadata and the body */
+    ASSERT_INT_EQ((int)0xFFFFFFFFu, (int)read_u32(buffer));
+    uint32_t meta = read_u32(buffer + 4);
+    ASSERT_INT_EQ(0, (int)(meta % 8));
+    const uint8_t *body = buffer + 8 + meta;
+
+    /* id values, then the pHash validity bitmap and values */
+    ASSERT_INT_EQ(0, memcmp(body, ids, sizeof(ids)));
+    const uint8_t *valid = body + sizeof(ids);
+    const uint8_t *phash = valid + 16;
+    for (int i = 0; i < ROWS; i++) {
+        int present = (valid[i / 8] >> (i % 8)) & 1;
+        ASSERT_INT_EQ(i % 10 != 5, present);
+        uint64_t v;
+        memcpy(&v, phash + 8 * i, 8);
+        ASSERT_INT_EQ(1, v == (present ? s_results[i].phash : 0));
+    }
+    /* The radial column ends the body */
+    const uint8_t *radial = buffer + size - 40 * ROWS;
+    ASSERT_INT_EQ(0, memcmp(radial + 40 * 7, s_results[7].radial.data, 40));
+
+    size_t schema = 0;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_arrow_encode_schema(mask, NULL, 0, &schema));
+    ASSERT_INT_EQ((int)ph_arrow_schema_size(mask), (int)schema);
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_arrow_encode_batch(0x100, ids, s_results, ROWS, buffer, size, &length));
+    free(buffer);
+    printf("test_arrow_batch_layout: PASSED\n");
+}
+
+void test_arrow_file_writer() {
+    char path[] = "/tmp/test_arrow_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_INT_EQ(1, fd >= 0);
+
+    ph_arrow_writer_t *writer = NULL;
+    ASSERT_OK(ph_arrow_writer_open(fd, PH_ALGO_ALL, PH_ARROW_FILE, &writer));
+    ASSERT_OK(ph_arrow_writer_write(writer, NULL, s_results, ROWS));
+    ASSERT_OK(ph_arrow_writer_write(writer, NULL, s_results, 7));
+    ASSERT_OK(ph_arrow_writer_close(writer));
+
+    /* Magic at both ends, and the schema message right after the first */
+    off_t end = lseek(fd, 0, SEEK_END);
+    uint8_t head[16], tail[6];
+    ASSERT_INT_EQ(16, (int)pread(fd, head, 16, 0));
+    ASSERT_INT_EQ(6, (int)pread(fd, tail, 6, end - 6));
+    ASSERT_INT_EQ(0, memcmp(head, "ARROW1\0\0", 8));
+    ASSERT_INT_EQ((int)0xFFFFFFFFu, (int)read_u32(head + 8));
+    ASSERT_INT_EQ((int)ph_arrow_schema_size(PH_ALGO_ALL) - 8, (int)read_u32(head + 12));
+    ASSERT_INT_EQ(0, memcmp(tail, "ARROW1", 6));
+
+    /* Second batch's ids continue the first's */
+    off_t second = 8 + (off_t)ph_arrow_schema_size(PH_ALGO_ALL) +
+                   (off_t)ph_arrow_batch_size(PH_ALGO_ALL, ROWS);
+    uint8_t prefix[8];
+    uint64_t id = 0;
+    ASSERT_INT_EQ(8, (int)pread(fd, prefix, 8, second));
+    ASSERT_INT_EQ(8, (int)pread(fd, &id, 8, second + 8 + read_u32(prefix + 4)));
+    ASSERT_INT_EQ(ROWS, (int)id);
+
+    close(fd);
+    unlink(path);
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_arrow_writer_open(-1, PH_ALGO_ALL, PH_ARROW_STREAM, &writer));
+    printf("test_arrow_file_writer: PASSED\n");
+}
+
+int main() {
+    test_arrow_batch_layout();
+    test_arrow_file_writer();
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+void test_async_matches_sync() {
+    const uint32_t mask = PH_ALGO_AHASH | PH_ALGO_DHASH | PH_ALGO_PHASH | PH_ALGO_BMH;
+    ph_context_t *ctx = NULL;
+    ph_hashes_t expected;
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_hashes(ctx, mask, &expected));
+    ASSERT_INT_EQ((int)mask, (int)expected.mask);
+    ph_free(ctx);
+
+    size_t len = 0;
+    uint8_t *bytes = read_file("tests/photo.jpeg", &len);
+
+    ph_async_queue_t *queue = NULL;
+    ASSERT_OK(ph_async_create(2, &queue));
+
+    const int per_kind = 8;
+    for (int i = 0; i < per_kind; i++) {
+        ph_async_item_t from_file = {"tests/photo.jpeg", NULL, 0};
+        ph_async_item_t from_memory = {NULL, bytes, len};
+        ASSERT_OK(ph_async_submit(queue, &from_file, mask, (void *)(intptr_t)(2 * i)));
+        ASSERT_OK(ph_async_submit(queue, &from_memory, mask, (void *)(intptr_t)(2 * i + 1)));
+    }
+    ph_async_item_t missing = {"tests/does_not_exist.jpeg", NULL, 0};
+    ASSERT_OK(ph_async_submit(queue, &missing, mask, (void *)(intptr_t)-1));
+
+    int received = 0, failed = 0;
+    while (received < 2 * per_kind + 1) {
+#if defined(__linux__)
+        struct pollfd pfd = {ph_async_fd(queue), POLLIN, 0};
+        if (pfd.fd >= 0)
+            poll(&pfd, 1, 1000);
+#endif
+        ph_async_completion_t done[4];
+        int n = ph_async_poll(queue, done, 4);
+        if (n < 0) {
+            fprintf(stderr, "ph_async_poll failed: %d\n", n);
+            exit(1);
+        }
+        for (int i = 0; i < n; i++) {
+            if ((intptr_t)done[i].user_data == -1) {
+                if (done[i].error == PH_SUCCESS) {
+                    fprintf(stderr, "Missing file reported success\n");
+                    exit(1);
+                }
+                failed++;
+                continue;
+            }
+            ASSERT_OK(done[i].error);
+            ASSERT_INT_EQ((int)mask, (int)done[i].hashes.mask);
+            if (done[i].hashes.phash != expected.phash ||
+                done[i].hashes.dhash != expected.dhash ||
+                ph_hamming_distance_digest(&done[i].hashes.bmh, &expected.bmh) != 0) {
+                fprintf(stderr, "Async result differs from synchronous computation\n");
+                exit(1);
+            }
+        }
+        received += n;
+    }
+    ASSERT_INT_EQ(1, failed);
+    ASSERT_INT_EQ(0, ph_async_poll(queue, NULL, 0));
+
+    ph_async_destroy(queue);
+    free(bytes);
+    printf("test_async_matches_sync: PASSED\n");
+}
+
+int main() {
+    test_async_matches_sync();
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+#define ITEMS 12
+
+void test_probe() {
+    size_t len;
+    uint8_t *bytes = read_file("tests/photo.jpeg", &len);
+    ph_image_info_t info = {0}, from_file = {0};
+
+    ASSERT_OK(ph_probe(bytes, len, &info));
+    ASSERT_INT_EQ(400, info.width);
+    ASSERT_INT_EQ(400, info.height);
+    ASSERT_INT_EQ(3, info.channels);
+    ASSERT_OK(ph_probe_file("tests/photo.jpeg", &from_file));
+    ASSERT_INT_EQ(0, memcmp(&info, &from_file, sizeof(info)));
+
+    /* The header alone is enough */
+    ASSERT_OK(ph_probe(bytes, len / 4, &info));
+    ASSERT_INT_EQ(400, info.width);
+
+    ASSERT_INT_EQ(PH_ERR_DECODE_FAILED, ph_probe((const uint8_t *)"not an image", 12, &info));
+    ASSERT_INT_EQ(PH_ERR_DECODE_FAILED, ph_probe_file("tests/does_not_exist.jpeg", &info));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_probe(bytes, 0, &info));
+    free(bytes);
+    printf("test_probe: PASSED\n");
+}
+
+/* Submits ITEMS copies of photo.jpeg under 'budget' and checks every phash */
+static void run_with_budget(size_t budget, int max_distance, ph_async_memory_stats_t *stats) {
+    const uint32_t mask = PH_ALGO_PHASH | PH_ALGO_DHASH;
+    ph_context_t *ctx = NULL;
+    ph_hashes_t expected;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_hashes(ctx, mask, &expected));
+    ph_free(ctx);
+
+    size_t len;
+    uint8_t *bytes = read_file("tests/photo.jpeg", &len);
+    ph_async_queue_t *queue = NULL;
+    ASSERT_OK(ph_async_create(4, &queue));
+    ASSERT_OK(ph_async_set_memory_budget(queue, budget));
+    for (int i = 0; i < ITEMS; i++) {
+        ph_async_item_t from_file = {"tests/photo.jpeg", NULL, 0};
+        ph_async_item_t from_memory = {NULL, bytes, len};
+        ASSERT_OK(ph_async_submit(queue, i % 2 ? &from_file : &from_memory, mask, NULL));
+    }
+
+    int received = 0;
+    while (received < ITEMS) {
+#if defined(__linux__)
+        struct pollfd pfd = {ph_async_fd(queue), POLLIN, 0};
+        if (pfd.fd >= 0)
+            poll(&pfd, 1, 1000);
+#endif
+        ph_async_completion_t done[4];
+        int n = ph_async_poll(queue, done, 4);
+        ASSERT_INT_EQ(1, n >= 0);
+        for (int i = 0; i < n; i++) {
+            ASSERT_OK(done[i].error);
+            ASSERT_INT_EQ((int)mask, (int)done[i].hashes.mask);
+            ASSERT_INT_EQ(1, ph_hamming_distance(done[i].hashes.phash, expected.phash) <=
+                                 max_distance);
+        }
+        received += n;
+    }
+
+    ASSERT_OK(ph_async_get_memory_stats(queue, stats));
+    ASSERT_INT_EQ(1, stats->budget == budget);
+    ASSERT_INT_EQ(1, stats->in_flight == 0);
+    ph_async_destroy(queue);
+    free(bytes);
+}
+
+void test_memory_budget() {
+    /* 400x400 RGB: the pixels plus the grayscale plane */
+    const size_t cost = 400 * 400 * 4;
+    ph_async_memory_stats_t stats;
+
+    /* Unlimited: nothing is probed or charged */
+    run_with_budget(0, 0, &stats);
+    ASSERT_INT_EQ(1, stats.peak == 0);
+
+    /* Room for two at a time out of four workers */
+    run_with_budget(2 * cost + cost / 2, 0, &stats);
+    ASSERT_INT_EQ(1, stats.peak >= cost && stats.peak <= 2 * cost);
+    ASSERT_INT_EQ(0, (int)stats.oversized);
+
+    /* Every image is oversized: one at a time, on the reduced path */
+    run_with_budget(cost / 2, 4, &stats);
+    ASSERT_INT_EQ(1, stats.peak == cost);
+    ASSERT_INT_EQ(ITEMS, (int)stats.oversized);
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_async_set_memory_budget(NULL, 1));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_async_get_memory_stats(NULL, &stats));
+    printf("test_memory_budget: PASSED\n");
+}
+
+int main() {
+    test_probe();
+    test_memory_budget();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "../src/internal.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_FILE "test_cache.tmp"
+
+void test_cache_hit_skips_decode() {
+    ph_cache_t *cache = NULL;
+    ph_context_t *ctx = NULL;
+    uint64_t phash_first = 0, phash_cached = 0, dhash = 0;
+    ph_digest_t radial_first, radial_cached;
+
+    remove(CACHE_FILE);
+    ASSERT_OK(ph_cache_open(CACHE_FILE, 64, &cache));
+    ASSERT_OK(ph_create(&ctx));
+    ph_context_set_cache(ctx, cache);
+
+    size_t len = 0;
+    uint8_t *bytes = read_file("tests/photo.jpeg", &len);
+
+    /* Miss: decode and populate */
+    ASSERT_OK(ph_load_from_memory(ctx, bytes, len));
+    ASSERT_INT_EQ(PH_SOURCE_DECODED, ph_get_load_source(ctx));
+    ASSERT_OK(ph_compute_phash(ctx, &phash_first));
+    ASSERT_OK(ph_compute_radial_hash(ctx, &radial_first));
+
+    /* Hit: results come back without pixels */
+    ASSERT_OK(ph_load_from_memory(ctx, bytes, len));
+    ASSERT_INT_EQ(PH_SOURCE_CACHE, ph_get_load_source(ctx));
+    ASSERT_INT_EQ(1, ctx->data == NULL);
+    ASSERT_OK(ph_compute_phash(ctx, &phash_cached));
+    ASSERT_OK(ph_compute_radial_hash(ctx, &radial_cached));
+    ASSERT_INT_EQ(1, ctx->data == NULL);
+    ASSERT_INT_EQ(1, phash_first == phash_cached);
+    ASSERT_INT_EQ(0, (int)ph_l2_distance(&radial_first, &radial_cached));
+
+    /* An algorithm missing from the entry decodes on demand */
+    ASSERT_OK(ph_compute_dhash(ctx, &dhash));
+    ASSERT_PTR_NOT_NULL(ctx->data);
+
+    /* Files are keyed by identity; a different gamma is a different key */
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_INT_EQ(PH_SOURCE_DECODED, ph_get_load_source(ctx));
+    ASSERT_OK(ph_compute_phash(ctx, &phash_cached));
+    ph_context_set_gamma(ctx, 1.5f);
+    ASSERT_OK(ph_load_from_memory(ctx, bytes, len));
+    ASSERT_INT_EQ(PH_SOURCE_DECODED, ph_get_load_source(ctx));
+
+    ph_cache_stats_t stats;
+    ph_cache_get_stats(cache, &stats);
+    ASSERT_INT_EQ(1, (int)stats.hits);
+    ASSERT_INT_EQ(3, (int)stats.misses);
+    ph_context_set_cache(ctx, NULL);
+    ph_cache_close(cache);
+
+    /* The table persists across reopening */
+    ph_context_set_gamma(ctx, 2.2f);
+    ASSERT_OK(ph_cache_open(CACHE_FILE, 64, &cache));
+    ph_context_set_cache(ctx, cache);
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_INT_EQ(PH_SOURCE_CACHE, ph_get_load_source(ctx));
+    ph_context_set_cache(ctx, NULL);
+    ph_cache_close(cache);
+
+    ph_free(ctx);
+    free(bytes);
+    remove(CACHE_FILE);
+    printf("test_cache_hit_skips_decode: PASSED\n");
+}
+
+void test_cache_bounded_eviction() {
+    ph_cache_t *cache = NULL;
+    ph_hashes_t h, out;
+    memset(&h, 0, sizeof(h));
+    h.mask = PH_ALGO_PHASH;
+
+    ASSERT_OK(ph_cache_open(NULL, 16, &cache));
+    for (uint64_t i = 0; i < 1000; i++) {
+        uint8_t blob[8];
+        memcpy(blob, &i, sizeof(i));
+        h.phash = i;
+        ph_cache_insert(cache, ph_cache_key_memory(blob, sizeof(blob)), &h);
+    }
+
+    ph_cache_stats_t stats;
+    ph_cache_get_stats(cache, &stats);
+    ASSERT_INT_EQ(16, (int)stats.capacity);
+    ASSERT_INT_EQ(1, stats.entries <= 16);
+    ASSERT_INT_EQ(1000, (int)stats.insertions);
+    ASSERT_INT_EQ(1000, (int)(stats.entries + stats.evictions));
+
+    /* The most recent insertion is always retained */
+    uint64_t last = 999;
+    ASSERT_INT_EQ(1, ph_cache_lookup(cache, ph_cache_key_memory((uint8_t *)&last, 8), &out));
+    ASSERT_INT_EQ(999, (int)out.phash);
+
+    ph_cache_close(cache);
+    printf("test_cache_bounded_eviction: PASSED\n");
+}
+
+int main() {
+    test_cache_hit_skips_decode();
+    test_cache_bounded_eviction();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PHOTOS 4
+#define SYNTHETIC 1000
+
+static const char *s_photos[PHOTOS] = {"tests/photo.jpeg", "tests/photo_copy.jpeg",
+                                       "tests/photo_color_changed.jpeg",
+                                       "tests/photo_rotated_90.jpeg"};
+static ph_hashes_t s_records[PHOTOS + SYNTHETIC];
+
+/* The real photos, then records whose dHash is far from all of them */
+static void make_records(void) {
+    for (int i = 0; i < PHOTOS; i++) {
+        ph_context_t *ctx = NULL;
+        ASSERT_OK(ph_create(&ctx));
+        ASSERT_OK(ph_load_from_file(ctx, s_photos[i]));
+        ASSERT_OK(ph_compute_hashes(ctx, PH_ALGO_ALL, &s_records[i]));
+        ph_free(ctx);
+    }
+    uint64_t state = 5;
+    for (int i = 0; i < SYNTHETIC; i++) {
+        ph_hashes_t *r = &s_records[PHOTOS + i];
+        *r = s_records[0];
+        uint64_t flip;
+        do {
+            flip = next_random(&state);
+        } while (ph_hamming_distance(flip, 0) < 20);
+        r->dhash ^= flip;
+        r->phash = next_random(&state);
+        r->mask = PH_ALGO_DHASH | PH_ALGO_PHASH | PH_ALGO_COLOR;
+    }
+}
+
+/* The cascade rule evaluated directly on fully computed hashes */
+static int reference_match(const ph_hashes_t *q, const ph_hashes_t *c,
+                           const ph_cascade_stage_t *stages, size_t nstages) {
+    for (size_t s = 0; s < nstages; s++) {
+        double d;
+        switch (stages[s].algo) {
+            case PH_ALGO_DHASH:
+                d = ph_hamming_distance(q->dhash, c->dhash);
+                break;
+            case PH_ALGO_PHASH:
+                d = ph_hamming_distance(q->phash, c->phash);
+                break;
+            case PH_ALGO_COLOR:
+                d = ph_l2_distance(&q->color, &c->color);
+                break;
+            case PH_ALGO_RADIAL:
+                d = ph_l2_distance(&q->radial, &c->radial);
+                break;
+            default:
+                d = 1e9;
+                break;
+        }
+        if (d > stages[s].max_distance)
+            return 0;
+        if (d <= stages[s].accept_distance)
+            return 1;
+    }
+    return 1;
+}
+
+static void check_cascade(const ph_cascade_stage_t *stages, size_t nstages, int expected_count) {
+    ph_context_t *ctx = NULL;
+    ph_hashes_t query, full;
+    uint32_t matches[PHOTOS + SYNTHETIC];
+    size_t count = 0;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, s_photos[0]));
+    memset(&query, 0, sizeof(query));
+    ASSERT_OK(ph_query_cascade(ctx, &query, s_records, PHOTOS + SYNTHETIC, stages, nstages,
+                               matches, &count));
+    ASSERT_OK(ph_compute_hashes(ctx, PH_ALGO_ALL, &full));
+
+    size_t expected = 0;
+    for (uint32_t i = 0; i < PHOTOS + SYNTHETIC; i++) {
+        if (reference_match(&full, &s_records[i], stages, nstages)) {
+            ASSERT_INT_EQ(1, expected < count);
+            ASSERT_INT_EQ((int)i, (int)matches[expected]);
+            expected++;
+        }
+    }
+    ASSERT_INT_EQ((int)expected, (int)count);
+    ASSERT_INT_EQ(expected_count, (int)count);
+    ph_free(ctx);
+}
+
+void test_cascade_matches_reference() {
+    make_records();
+
+    /* Screen with dHash, confirm with pHash, settle on color */
+    ph_cascade_stage_t stages[] = {{PH_ALGO_DHASH, 10.0f, -1.0f},
+                                   {PH_ALGO_PHASH, 8.0f, -1.0f},
+                                   {PH_ALGO_COLOR, 20.0f, -1.0f}};
+    check_cascade(stages, 3, 2); /* The photo and its copy, not the recolored one */
+
+    /* An exact pHash accepts before the color stage */
+    stages[1].accept_distance = 0.0f;
+    check_cascade(stages, 3, 3);
+    printf("test_cascade_matches_reference: PASSED\n");
+}
+
+void test_cascade_is_lazy() {
+    ph_context_t *ctx = NULL;
+    ph_hashes_t query;
+    uint32_t matches[SYNTHETIC];
+    size_t count = 1;
+    ph_cascade_stage_t stages[] = {{PH_ALGO_DHASH, 10.0f, -1.0f},
+                                   {PH_ALGO_PHASH, 8.0f, -1.0f},
+                                   {PH_ALGO_RADIAL, 50.0f, -1.0f}};
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, s_photos[0]));
+    memset(&query, 0, sizeof(query));
+
+    /* Every synthetic record fails the dHash screen */
+    ASSERT_OK(ph_query_cascade(ctx, &query, s_records + PHOTOS, SYNTHETIC, stages, 3, matches,
+                               &count));
+    ASSERT_INT_EQ(0, (int)count);
+    ASSERT_INT_EQ(PH_ALGO_DHASH, (int)query.mask);
+
+    /* Results passed in are used as they are */
+    query.dhash = s_records[PHOTOS].dhash;
+    ASSERT_OK(ph_query_cascade(ctx, &query, s_records + PHOTOS, 1, stages, 2, matches, &count));
+    ASSERT_INT_EQ(0, (int)count); /* Rejected by the random pHash */
+    ASSERT_INT_EQ(PH_ALGO_DHASH | PH_ALGO_PHASH, (int)query.mask);
+
+    ph_cascade_stage_t mixed = {PH_ALGO_DHASH | PH_ALGO_PHASH, 1.0f, -1.0f};
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_query_cascade(ctx, NULL, s_records, 1, &mixed, 1, matches, &count));
+    ph_free(ctx);
+    printf("test_cascade_is_lazy: PASSED\n");
+}
+
+int main() {
+    test_cascade_matches_reference();
+    test_cascade_is_lazy();
+    return 0;
+}
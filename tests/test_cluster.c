@@ -0,0 +1,133 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+/* Flips 'bits' random bits */
+static uint64_t perturb(uint64_t h, int bits) {
+    for (int i = 0; i < bits; i++)
+        h ^= 1ULL << (next_random(&rng_state) % 64);
+    return h;
+}
+
+static uint32_t find(uint32_t *parent, uint32_t x) {
+    while (parent[x] != x)
+        x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+/* Brute-force reference: same single-linkage partition, O(n^2) */
+static void reference_roots(const uint64_t *h, const ph_digest_t *d, size_t n, int max_dist,
+                            uint32_t *roots) {
+    for (size_t i = 0; i < n; i++)
+        roots[i] = (uint32_t)i;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            int dist =
+                h ? ph_hamming_distance(h[i], h[j]) : ph_hamming_distance_digest(&d[i], &d[j]);
+            if (dist <= max_dist) {
+                uint32_t a = find(roots, (uint32_t)i), b = find(roots, (uint32_t)j);
+                if (a != b)
+                    roots[a > b ? a : b] = a < b ? a : b;
+            }
+        }
+    }
+    for (size_t i = 0; i < n; i++)
+        roots[i] = find(roots, (uint32_t)i);
+}
+
+/* Labels and reference roots must describe the same partition */
+static void assert_same_partition(const uint32_t *labels, const uint32_t *roots, size_t n) {
+    uint8_t *label_used = calloc(n, 1);
+    for (size_t i = 0; i < n; i++) {
+        if (labels[i] >= n || labels[i] != labels[roots[i]]) {
+            fprintf(stderr, "Item %zu not clustered with %u\n", i, roots[i]);
+            exit(1);
+        }
+        if (roots[i] == i) {
+            if (label_used[labels[i]]) {
+                fprintf(stderr, "Cluster of item %zu wrongly merged\n", i);
+                exit(1);
+            }
+            label_used[labels[i]] = 1;
+        }
+    }
+    free(label_used);
+}
+
+void test_cluster_u64() {
+    const size_t n = 3000;
+    uint64_t *hashes = malloc(n * sizeof(uint64_t));
+    uint32_t *labels = malloc(n * sizeof(uint32_t));
+    uint32_t *roots = malloc(n * sizeof(uint32_t));
+
+    /* Planted groups of near-duplicates and exact copies among noise */
+    for (size_t i = 0; i < n; i++) {
+        if (i % 3 == 0 || i < 10)
+            hashes[i] = next_random(&rng_state);
+        else
+            hashes[i] = perturb(hashes[i - 1 - next_random(&rng_state) % (i < 20 ? 1 : 10)],
+                                (int)(i % 5));
+    }
+
+    for (int max_dist = 0; max_dist <= 8; max_dist += 4) {
+        reference_roots(hashes, NULL, n, max_dist, roots);
+        for (int threads = 1; threads <= 3; threads += 2) {
+            memset(labels, 0xFF, n * sizeof(uint32_t));
+            ASSERT_OK(ph_cluster_u64(hashes, n, max_dist, threads, labels));
+            ASSERT_INT_EQ(0, (int)labels[0]);
+            assert_same_partition(labels, roots, n);
+        }
+    }
+
+    /* Radius covering every bit puts everything together */
+    ASSERT_OK(ph_cluster_u64(hashes, n, 64, 2, labels));
+    ASSERT_INT_EQ(0, (int)labels[n - 1]);
+
+    free(hashes);
+    free(labels);
+    free(roots);
+    printf("test_cluster_u64: PASSED\n");
+}
+
+void test_cluster_digest() {
+    const size_t n = 600;
+    ph_digest_t *digests = calloc(n, sizeof(ph_digest_t));
+    uint32_t *labels = malloc(n * sizeof(uint32_t));
+    uint32_t *roots = malloc(n * sizeof(uint32_t));
+
+    for (size_t i = 0; i < n; i++) {
+        digests[i].size = 32;
+        if (i % 4 == 0) {
+            for (int b = 0; b < 32; b++)
+                digests[i].data[b] = (uint8_t)next_random(&rng_state);
+        } else {
+            digests[i] = digests[i - 1];
+            for (size_t f = 0; f < i % 7; f++) {
+                int bit = (int)(next_random(&rng_state) % 256);
+                digests[i].data[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+            }
+        }
+    }
+
+    reference_roots(NULL, digests, n, 6, roots);
+    ASSERT_OK(ph_cluster_digest(digests, n, 6, 2, labels));
+    assert_same_partition(labels, roots, n);
+
+    digests[5].size = 16;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_cluster_digest(digests, n, 6, 2, labels));
+
+    free(digests);
+    free(labels);
+    free(roots);
+    printf("test_cluster_digest: PASSED\n");
+}
+
+int main() {
+    test_cluster_u64();
+    test_cluster_digest();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_FILE "test_decoder.tmp"
+#define MOCK_SIZE 64
+
+/* Mock format: "MOCK" followed by a flag byte ('!' makes decoding fail) */
+typedef struct {
+    int probes;
+    int decodes;
+    int scaled_decodes;
+    int releases;
+    int last_min_width;
+} mock_state_t;
+
+static int mock_probe(void *user_data, const uint8_t *buffer, size_t length) {
+    ((mock_state_t *)user_data)->probes++;
+    return length >= 5 && memcmp(buffer, "MOCK", 4) == 0;
+}
+
+static ph_error_t mock_render(const uint8_t *buffer, int size, ph_decoded_image_t *out) {
+    if (buffer[4] == '!')
+        return PH_ERR_DECODE_FAILED;
+    out->pixels = malloc((size_t)size * size * 3);
+    if (!out->pixels)
+        return PH_ERR_ALLOCATION_FAILED;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            uint8_t *p = out->pixels + (y * size + x) * 3;
+            p[0] = p[1] = p[2] = (uint8_t)((x * 255 / size + (y / 8 % 2) * 64) % 256);
+        }
+    }
+    out->width = out->height = size;
+    out->channels = 3;
+    return PH_SUCCESS;
+}
+
+static ph_error_t mock_decode(void *user_data, const uint8_t *buffer, size_t length,
+                              ph_decoded_image_t *out) {
+    (void)length;
+    ((mock_state_t *)user_data)->decodes++;
+    return mock_render(buffer, MOCK_SIZE, out);
+}
+
+static ph_error_t mock_decode_scaled(void *user_data, const uint8_t *buffer, size_t length,
+                                     int min_width, int min_height, ph_decoded_image_t *out) {
+    mock_state_t *state = user_data;
+    (void)length;
+    (void)min_height;
+    state->scaled_decodes++;
+    state->last_min_width = min_width;
+    return mock_render(buffer, MOCK_SIZE / 2, out);
+}
+
+static void mock_release(void *user_data, uint8_t *pixels) {
+    ((mock_state_t *)user_data)->releases++;
+    free(pixels);
+}
+
+void test_decoder_registration() {
+    mock_state_t state = {0};
+    ph_decoder_t mock = {"mock", &state, mock_probe, mock_decode, NULL, mock_release};
+
+    ASSERT_OK(ph_register_decoder(&mock));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_register_decoder(&mock));
+
+    ph_decoder_t incomplete = mock;
+    incomplete.name = "incomplete";
+    incomplete.probe = NULL;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_register_decoder(&incomplete));
+
+    ASSERT_OK(ph_unregister_decoder("mock"));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_unregister_decoder("mock"));
+    printf("test_decoder_registration: PASSED\n");
+}
+
+void test_decoder_backend() {
+    mock_state_t state = {0};
+    ph_decoder_t mock = {"mock", &state, mock_probe, mock_decode, mock_decode_scaled,
+                         mock_release};
+    ph_context_t *ctx = NULL;
+    uint64_t jpeg_before = 0, jpeg_after = 0, hash = 0;
+    const uint8_t good[] = "MOCK.", bad[] = "MOCK!";
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_phash(ctx, &jpeg_before));
+
+    ASSERT_OK(ph_register_decoder(&mock));
+
+    /* The backend takes data it recognizes */
+    ASSERT_OK(ph_load_from_memory(ctx, good, sizeof(good)));
+    ASSERT_INT_EQ(1, state.decodes);
+    ASSERT_OK(ph_compute_phash(ctx, &hash));
+
+    /* A minimum resolution switches to the scaled entry point */
+    ph_context_set_min_resolution(ctx, 16, 16);
+    ASSERT_OK(ph_load_from_memory(ctx, good, sizeof(good)));
+    ASSERT_INT_EQ(1, state.releases);
+    ASSERT_INT_EQ(1, state.scaled_decodes);
+    ASSERT_INT_EQ(16, state.last_min_width);
+    ASSERT_OK(ph_compute_phash(ctx, &hash));
+    ph_context_set_min_resolution(ctx, 0, 0);
+
+    /* Files go through the backends too */
+    FILE *f = fopen(MOCK_FILE, "wb");
+    ASSERT_PTR_NOT_NULL(f);
+    fwrite(good, 1, sizeof(good), f);
+    fclose(f);
+    ASSERT_OK(ph_load_from_file(ctx, MOCK_FILE));
+    ASSERT_INT_EQ(2, state.decodes);
+    remove(MOCK_FILE);
+
+    /* Rejected or failed data falls back to stb_image */
+    ASSERT_INT_EQ(PH_ERR_DECODE_FAILED, ph_load_from_memory(ctx, bad, sizeof(bad)));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_phash(ctx, &jpeg_after));
+    ASSERT_INT_EQ(1, jpeg_before == jpeg_after);
+    ASSERT_INT_EQ(3, state.releases);
+
+    ASSERT_OK(ph_unregister_decoder("mock"));
+    ph_free(ctx);
+    printf("test_decoder_backend: PASSED\n");
+}
+
+int main() {
+    test_decoder_registration();
+    test_decoder_backend();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SIZE 32
+#define PPM_HEADER "P6\n32 32\n255\n"
+
+/* A 32x32 image hashes without resampling, so orientations match exactly */
+static void make_pattern(uint8_t *rgb) {
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            uint8_t v = (uint8_t)((x * 7 + y * y * 3 + (x * y) % 11 * 9) & 0xFF);
+            if (x > 20 && y < 9)
+                v = 250;
+            memset(&rgb[(y * SIZE + x) * 3], v, 3);
+        }
+    }
+}
+
+/* Source coordinates of output pixel (x, y) for each ph_phash_orientation_t */
+static void source_pixel(int o, int x, int y, int *sx, int *sy) {
+    const int m = SIZE - 1;
+    switch (o) {
+        case PH_ORIENT_ROT90:
+            *sx = y;
+            *sy = m - x;
+            break;
+        case PH_ORIENT_ROT180:
+            *sx = m - x;
+            *sy = m - y;
+            break;
+        case PH_ORIENT_ROT270:
+            *sx = m - y;
+            *sy = x;
+            break;
+        case PH_ORIENT_FLIP_H:
+            *sx = m - x;
+            *sy = y;
+            break;
+        case PH_ORIENT_FLIP_V:
+            *sx = x;
+            *sy = m - y;
+            break;
+        case PH_ORIENT_TRANSPOSE:
+            *sx = y;
+            *sy = x;
+            break;
+        case PH_ORIENT_TRANSVERSE:
+            *sx = m - y;
+            *sy = m - x;
+            break;
+        default:
+            *sx = x;
+            *sy = y;
+            break;
+    }
+}
+
+static void load_oriented(ph_context_t *ctx, const uint8_t *rgb, int o) {
+    uint8_t ppm[sizeof(PPM_HEADER) - 1 + SIZE * SIZE * 3];
+    uint8_t *pixels = ppm + sizeof(PPM_HEADER) - 1;
+    memcpy(ppm, PPM_HEADER, sizeof(PPM_HEADER) - 1);
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            int sx, sy;
+            source_pixel(o, x, y, &sx, &sy);
+            memcpy(&pixels[(y * SIZE + x) * 3], &rgb[(sy * SIZE + sx) * 3], 3);
+        }
+    }
+    ASSERT_OK(ph_load_from_memory(ctx, ppm, sizeof(ppm)));
+}
+
+void test_dihedral_orientations() {
+    ph_context_t *ctx = NULL;
+    uint8_t rgb[SIZE * SIZE * 3];
+    uint64_t all[8], canonical = 0;
+
+    make_pattern(rgb);
+    ASSERT_OK(ph_create(&ctx));
+    load_oriented(ctx, rgb, PH_ORIENT_IDENTITY);
+    ASSERT_OK(ph_compute_phash_dihedral(ctx, all));
+    ASSERT_OK(ph_compute_phash_canonical(ctx, &canonical));
+
+    for (int o = 0; o < 8; o++) {
+        uint64_t direct = 0, again = 0;
+        load_oriented(ctx, rgb, o);
+        ASSERT_OK(ph_compute_phash(ctx, &direct));
+        if (direct != all[o]) {
+            fprintf(stderr, "Orientation %d: %016llx != %016llx\n", o,
+                    (unsigned long long)direct, (unsigned long long)all[o]);
+        }
+        ASSERT_INT_EQ(1, direct == all[o]);
+
+        /* Every orientation has the same canonical hash */
+        ASSERT_OK(ph_compute_phash_canonical(ctx, &again));
+        ASSERT_INT_EQ(1, again == canonical);
+    }
+
+    ph_free(ctx);
+    printf("test_dihedral_orientations: PASSED\n");
+}
+
+void test_dihedral_matches_phash() {
+    ph_context_t *ctx = NULL;
+    uint64_t all[8], single = 0;
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_phash_dihedral(ctx, all));
+    ASSERT_OK(ph_compute_phash(ctx, &single));
+    ASSERT_INT_EQ(1, all[PH_ORIENT_IDENTITY] == single);
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_compute_phash_dihedral(ctx, NULL));
+    ph_free(ctx);
+    printf("test_dihedral_matches_phash: PASSED\n");
+}
+
+int main() {
+    test_dihedral_orientations();
+    test_dihedral_matches_phash();
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 64
+#define HEIGHT 48
+#define SLOTS 8
+#define FRAMES 100
+
+static const uint32_t mask = PH_ALGO_PHASH | PH_ALGO_DHASH | PH_ALGO_COLOR;
+
+/* A moving gradient, so every frame hashes differently */
+static void draw_frame(uint8_t *pixels, int index, int channels) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            for (int c = 0; c < channels; c++)
+                pixels[(y * WIDTH + x) * channels + c] =
+                    (uint8_t)((x * (index % 7 + 1) + y * (c + 2) + index * 3) & 0xFF);
+        }
+    }
+}
+
+static ph_hashes_t hash_pixels(const uint8_t *pixels, int channels) {
+    ph_context_t *ctx = NULL;
+    ph_hashes_t hashes;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_pixels(ctx, pixels, WIDTH, HEIGHT, channels));
+    ASSERT_INT_EQ(PH_SOURCE_PIXELS, ph_get_load_source(ctx));
+    ASSERT_OK(ph_compute_hashes(ctx, mask, &hashes));
+    ph_free(ctx);
+    return hashes;
+}
+
+void test_load_from_pixels() {
+    uint8_t pixels[WIDTH * HEIGHT * 3], copy[sizeof(pixels)];
+    draw_frame(pixels, 5, 3);
+    memcpy(copy, pixels, sizeof(pixels));
+
+    ph_hashes_t a = hash_pixels(pixels, 3), b = hash_pixels(pixels, 3);
+    ASSERT_INT_EQ((int)mask, (int)a.mask);
+    ASSERT_INT_EQ(1, a.phash == b.phash && a.dhash == b.dhash);
+    ASSERT_INT_EQ(0, memcmp(pixels, copy, sizeof(pixels))); /* Only read */
+
+    ph_context_t *ctx = NULL;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_load_from_pixels(ctx, pixels, 0, HEIGHT, 3));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_load_from_pixels(ctx, pixels, WIDTH, HEIGHT, 5));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_load_from_pixels(ctx, NULL, WIDTH, HEIGHT, 3));
+    ph_free(ctx);
+    printf("test_load_from_pixels: PASSED\n");
+}
+
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Producer: publishes FRAMES frames and checks every result against an
+ * in-process hash of the same pixels. Returns the exit status. */
+static int run_producer(int fd) {
+    ph_frame_ring_t *ring = NULL;
+    if (ph_frame_ring_attach(fd, &ring) != PH_SUCCESS)
+        return 2;
+
+    uint8_t frame[WIDTH * HEIGHT * 4];
+    int published = 0, received = 0;
+    while (received < FRAMES) {
+        uint8_t *slot;
+        while (published < FRAMES && ph_frame_ring_acquire(ring, &slot) == PH_SUCCESS) {
+            int channels = published % 3 == 0 ? 1 : 3;
+            draw_frame(slot, published, channels);
+            if (ph_frame_ring_publish(ring, 1000 + published, WIDTH, HEIGHT, channels) !=
+                PH_SUCCESS)
+                return 3;
+            published++;
+        }
+        if (published == FRAMES)
+            ph_frame_ring_close(ring);
+
+        ph_frame_result_t results[SLOTS];
+        int n = ph_frame_ring_poll_results(ring, results, SLOTS, 5000);
+        if (n <= 0)
+            return 4;
+        for (int i = 0; i < n; i++, received++) {
+            int channels = received % 3 == 0 ? 1 : 3;
+            draw_frame(frame, received, channels);
+            ph_hashes_t expected = hash_pixels(frame, channels);
+            if (results[i].frame_id != (uint64_t)(1000 + received) ||
+                results[i].error != PH_SUCCESS || results[i].hashes.phash != expected.phash ||
+                results[i].hashes.dhash != expected.dhash ||
+                ph_hamming_distance_digest(&results[i].hashes.color, &expected.color) != 0)
+                return 5;
+        }
+    }
+    ph_frame_ring_free(ring);
+    return 0;
+}
+
+void test_frame_ring_across_processes() {
+    ph_frame_ring_t *ring = NULL;
+    ASSERT_OK(ph_frame_ring_create(SLOTS, WIDTH * HEIGHT * 3, &ring));
+    ASSERT_INT_EQ(1, ph_frame_ring_slot_bytes(ring) >= WIDTH * HEIGHT * 3);
+
+    pid_t pid = fork();
+    ASSERT_INT_EQ(1, pid >= 0);
+    if (pid == 0)
+        _exit(run_producer(ph_frame_ring_fd(ring)));
+
+    ph_context_t *ctx = NULL;
+    ASSERT_OK(ph_create(&ctx));
+    int hashed = 0;
+    while (!ph_frame_ring_closed(ring) || hashed < FRAMES) {
+        int n = ph_frame_ring_consume(ring, ctx, mask, 5000);
+        ASSERT_INT_EQ(1, n >= 0);
+        if (n == 0 && !ph_frame_ring_closed(ring))
+            break; /* Timed out: the producer died */
+        hashed += n;
+    }
+    ASSERT_INT_EQ(FRAMES, hashed);
+
+    int status = 0;
+    ASSERT_INT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_INT_EQ(1, WIFEXITED(status));
+    ASSERT_INT_EQ(0, WEXITSTATUS(status));
+    ph_free(ctx);
+    ph_frame_ring_free(ring);
+    printf("test_frame_ring_across_processes: PASSED\n");
+}
+
+void test_frame_ring_errors() {
+    ph_frame_ring_t *ring = NULL, *attached = NULL;
+    uint8_t *slot;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_frame_ring_create(3, 1024, &ring));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_frame_ring_create(4, 0, &ring));
+    ASSERT_OK(ph_frame_ring_create(2, 16 * 16, &ring));
+    ASSERT_OK(ph_frame_ring_attach(ph_frame_ring_fd(ring), &attached));
+
+    /* Too large for a slot */
+    ASSERT_OK(ph_frame_ring_acquire(attached, &slot));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_frame_ring_publish(attached, 0, 32, 32, 1));
+
+    /* Both slots in use until their results are collected */
+    for (int i = 0; i < 2; i++) {
+        ASSERT_OK(ph_frame_ring_acquire(attached, &slot));
+        memset(slot, i * 100, 16 * 16);
+        ASSERT_OK(ph_frame_ring_publish(attached, (uint64_t)i, 16, 16, 1));
+    }
+    ASSERT_INT_EQ(PH_ERR_FULL, ph_frame_ring_acquire(attached, &slot));
+    ph_frame_result_t results[2];
+    ASSERT_INT_EQ(0, ph_frame_ring_poll_results(attached, results, 2, 0));
+
+    ph_context_t *ctx = NULL;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_INT_EQ(2, ph_frame_ring_consume(ring, ctx, PH_ALGO_AHASH, 0));
+    ASSERT_INT_EQ(0, ph_frame_ring_consume(ring, ctx, PH_ALGO_AHASH, 10)); /* Timeout */
+    ASSERT_INT_EQ(2, ph_frame_ring_poll_results(attached, results, 2, 0));
+    ASSERT_INT_EQ(1, results[1].frame_id == 1 && results[1].error == PH_SUCCESS);
+    ASSERT_OK(ph_frame_ring_acquire(attached, &slot));
+
+    ph_frame_ring_close(attached);
+    ASSERT_INT_EQ(1, ph_frame_ring_closed(ring));
+    ASSERT_INT_EQ(0, ph_frame_ring_consume(ring, ctx, PH_ALGO_AHASH, -1)); /* Closed */
+
+    ASSERT_INT_EQ(PH_ERR_IO, ph_frame_ring_attach(STDIN_FILENO, &attached));
+    ph_free(ctx);
+    ph_frame_ring_free(attached);
+    ph_frame_ring_free(ring);
+    printf("test_frame_ring_errors: PASSED\n");
+}
+#endif
+
+int main() {
+    test_load_from_pixels();
+#if defined(__linux__)
+    test_frame_ring_across_processes();
+    test_frame_ring_errors();
+#endif
+    return 0;
+}
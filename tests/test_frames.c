@@ -0,0 +1,155 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GIF_SIZE 32
+#define GIF_COLORS 128
+
+static void put16(uint8_t **p, int v) {
+    *(*p)++ = (uint8_t)(v & 0xFF);
+    *(*p)++ = (uint8_t)(v >> 8);
+}
+
+/*
+ * Writes one frame with a gray palette index per pixel. The LZW stream uses
+ * 8-bit codes only: a clear code every 100 literals keeps the code table from
+ * ever growing past 8 bits.
+ */
+static void put_frame(uint8_t **p, const uint8_t *pixels, int delay_cs) {
+    uint8_t codes[GIF_SIZE * GIF_SIZE * 2];
+    size_t n = 0;
+
+    *(*p)++ = 0x21; // Graphic Control Extension
+    *(*p)++ = 0xF9;
+    *(*p)++ = 4;
+    *(*p)++ = 0x04; // Do not dispose
+    put16(p, delay_cs);
+    *(*p)++ = 0;
+    *(*p)++ = 0;
+
+    *(*p)++ = 0x2C; // Image Descriptor
+    put16(p, 0);
+    put16(p, 0);
+    put16(p, GIF_SIZE);
+    put16(p, GIF_SIZE);
+    *(*p)++ = 0;
+    *(*p)++ = 7; // LZW minimum code size
+
+    for (int i = 0; i < GIF_SIZE * GIF_SIZE; i++) {
+        if (i % 100 == 0)
+            codes[n++] = GIF_COLORS; // Clear
+        codes[n++] = pixels[i];
+    }
+    codes[n++] = GIF_COLORS + 1; // End of information
+
+    for (size_t off = 0; off < n; off += 255) {
+        size_t chunk = n - off < 255 ? n - off : 255;
+        *(*p)++ = (uint8_t)chunk;
+        memcpy(*p, codes + off, chunk);
+        *p += chunk;
+    }
+    *(*p)++ = 0;
+}
+
+/* Three frames: a gradient, the same gradient again, then its mirror */
+static size_t make_gif(uint8_t *out) {
+    uint8_t *p = out;
+    uint8_t gradient[GIF_SIZE * GIF_SIZE], mirrored[GIF_SIZE * GIF_SIZE];
+
+    for (int y = 0; y < GIF_SIZE; y++) {
+        for (int x = 0; x < GIF_SIZE; x++) {
+            gradient[y * GIF_SIZE + x] = (uint8_t)((x * 3 + (y % 8) * 5) % GIF_COLORS);
+            mirrored[y * GIF_SIZE + x] = (uint8_t)(GIF_COLORS - 1 - (y * 4 % GIF_COLORS));
+        }
+    }
+
+    memcpy(p, "GIF89a", 6);
+    p += 6;
+    put16(&p, GIF_SIZE);
+    put16(&p, GIF_SIZE);
+    *p++ = 0xF6; // Global color table of 128 entries
+    *p++ = 0;
+    *p++ = 0;
+    for (int i = 0; i < GIF_COLORS; i++) {
+        p[0] = p[1] = p[2] = (uint8_t)(i * 2);
+        p += 3;
+    }
+
+    put_frame(&p, gradient, 10);
+    put_frame(&p, gradient, 10);
+    put_frame(&p, mirrored, 5);
+    *p++ = 0x3B;
+    return (size_t)(p - out);
+}
+
+void test_animated_gif() {
+    uint8_t *gif = malloc(16384);
+    size_t len = make_gif(gif);
+    ph_context_t *ctx = NULL, *fresh = NULL;
+    uint64_t hashes[3], aggregate = 0, direct = 0;
+    int count = 0;
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_frames_from_memory(ctx, gif, len, &count));
+    ASSERT_INT_EQ(3, count);
+    ASSERT_INT_EQ(3, ph_frame_count(ctx));
+    ASSERT_INT_EQ(100, ph_frame_delay(ctx, 0));
+    ASSERT_INT_EQ(50, ph_frame_delay(ctx, 2));
+
+    ASSERT_OK(ph_compute_frame_hashes(ctx, PH_ALGO_DHASH, hashes, 3, &aggregate));
+    ASSERT_INT_EQ(1, hashes[0] == hashes[1]);
+    ASSERT_INT_EQ(1, hashes[0] != hashes[2]);
+    /* The gradient is on screen four times longer than its mirror */
+    ASSERT_INT_EQ(1, aggregate == hashes[0]);
+
+    /* Patched grayscale rows match a frame converted from scratch */
+    ASSERT_OK(ph_create(&fresh));
+    ASSERT_OK(ph_load_frames_from_memory(fresh, gif, len, NULL));
+    ASSERT_OK(ph_select_frame(fresh, 2));
+    ASSERT_OK(ph_compute_dhash(fresh, &direct));
+    ASSERT_INT_EQ(1, direct == hashes[2]);
+
+    ASSERT_OK(ph_select_frame(ctx, 0));
+    ASSERT_OK(ph_compute_dhash(ctx, &direct));
+    ASSERT_INT_EQ(1, direct == hashes[0]);
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_select_frame(ctx, 3));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_compute_frame_hashes(ctx, PH_ALGO_DHASH, hashes, 2, NULL));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_compute_frame_hashes(ctx, PH_ALGO_BMH, hashes, 3, NULL));
+
+    ph_free(fresh);
+    ph_free(ctx);
+    free(gif);
+    printf("test_animated_gif: PASSED\n");
+}
+
+void test_still_image_is_one_frame() {
+    ph_context_t *ctx = NULL;
+    uint64_t frame_hash = 0, aggregate = 0, direct = 0;
+    int count = 0;
+    size_t len = 0;
+    uint8_t *bytes = read_file("tests/photo.jpeg", &len);
+
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_frames_from_memory(ctx, bytes, len, &count));
+    ASSERT_INT_EQ(1, count);
+    ASSERT_INT_EQ(0, ph_frame_delay(ctx, 0));
+    ASSERT_OK(ph_compute_frame_hashes(ctx, PH_ALGO_PHASH, &frame_hash, 1, &aggregate));
+    ASSERT_OK(ph_compute_phash(ctx, &direct));
+    ASSERT_INT_EQ(1, frame_hash == direct);
+    ASSERT_INT_EQ(1, aggregate == direct);
+
+    ph_free(ctx);
+    free(bytes);
+    printf("test_still_image_is_one_frame: PASSED\n");
+}
+
+int main() {
+    test_animated_gif();
+    test_still_image_is_one_frame();
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../src/internal.h"
+#include "test_macros.h"
+#include <stdio.h>
+
+void test_gray_only_load() {
+    ph_context_t *rgb = NULL, *gray = NULL;
+    ph_hashes_t full, luma;
+    ph_digest_t color;
+    const uint32_t luma_algos = PH_ALGO_ALL & ~PH_ALGO_COLOR;
+
+    ASSERT_OK(ph_create(&rgb));
+    ASSERT_OK(ph_create(&gray));
+    ph_context_set_load_flags(gray, PH_LOAD_GRAY_ONLY);
+
+    ASSERT_OK(ph_load_from_file(rgb, "tests/photo.jpeg"));
+    ASSERT_OK(ph_load_from_file(gray, "tests/photo.jpeg"));
+    ASSERT_INT_EQ(1, gray->channels);
+    ASSERT_INT_EQ(rgb->width, gray->width);
+
+    ASSERT_OK(ph_compute_hashes(rgb, luma_algos, &full));
+    ASSERT_OK(ph_compute_hashes(gray, luma_algos, &luma));
+
+    /* The decoded plane is the gray cache: no second buffer */
+    ASSERT_INT_EQ(1, gray->gray_data == gray->data);
+
+    /* Decoder luma is close to the RGB conversion */
+    ASSERT_INT_EQ(1, ph_hamming_distance(full.ahash, luma.ahash) <= 4);
+    ASSERT_INT_EQ(1, ph_hamming_distance(full.phash, luma.phash) <= 4);
+    ASSERT_INT_EQ(1, ph_hamming_distance(full.dhash, luma.dhash) <= 4);
+    ASSERT_INT_EQ(1, ph_hamming_distance_digest(&full.bmh, &luma.bmh) <= 16);
+
+    ASSERT_INT_EQ(PH_ERR_NO_COLOR, ph_compute_color_hash(gray, &color));
+
+    /* Clearing the flag brings color back */
+    ph_context_set_load_flags(gray, PH_LOAD_DEFAULT);
+    ASSERT_OK(ph_load_from_file(gray, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_color_hash(gray, &color));
+
+    ph_free(rgb);
+    ph_free(gray);
+    printf("test_gray_only_load: PASSED\n");
+}
+
+int main() {
+    test_gray_only_load();
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include "../src/hashd.h"
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define STORE_FILE "test_hashd.tmp"
+#define SOCKET_FILE "test_hashd.sock"
+#define STORE_SIZE 20000
+#define CLIENTS 4
+
+static uint64_t store[STORE_SIZE];
+
+/* Queries are stored hashes with a few bits flipped */
+static uint64_t make_query(uint64_t *state) {
+    uint64_t q = store[next_random(state) % STORE_SIZE];
+    for (int i = 0, flips = (int)(next_random(state) % 6); i < flips; i++)
+        q ^= 1ULL << (next_random(state) % 64);
+    return q;
+}
+
+static void check_radius(uint64_t query, int radius, const ph_match_t *got, size_t max,
+                         size_t count) {
+    size_t expected = 0;
+    for (size_t i = 0; i < STORE_SIZE; i++) {
+        int d = ph_hamming_distance(store[i], query);
+        if (d > radius)
+            continue;
+        if (expected < max) {
+            ASSERT_INT_EQ((int)i, (int)got[expected].index);
+            ASSERT_INT_EQ(d, (int)got[expected].distance);
+        }
+        expected++;
+    }
+    ASSERT_INT_EQ((int)expected, (int)count);
+}
+
+static void check_knn(uint64_t query, size_t k, const ph_match_t *got, size_t count) {
+    ASSERT_INT_EQ((int)k, (int)count);
+    for (size_t j = 0; j < k; j++) {
+        ASSERT_INT_EQ(ph_hamming_distance(store[got[j].index], query), (int)got[j].distance);
+        if (j > 0) {
+            ASSERT_INT_EQ(1, got[j - 1].distance < got[j].distance ||
+                                 (got[j - 1].distance == got[j].distance &&
+                                  got[j - 1].index < got[j].index));
+        }
+    }
+    /* Nothing outside the result is nearer than its last entry */
+    size_t nearer = 0;
+    for (size_t i = 0; i < STORE_SIZE; i++) {
+        if (ph_hamming_distance(store[i], query) < (int)got[k - 1].distance)
+            nearer++;
+    }
+    ASSERT_INT_EQ(1, nearer < k);
+}
+
+static void *serve(void *arg) {
+    ASSERT_OK(ph_hashd_run(arg));
+    return NULL;
+}
+
+static void *client_main(void *arg) {
+    uint64_t state = (uint64_t)(uintptr_t)arg;
+    ph_hashd_client_t *client = NULL;
+    ASSERT_OK(ph_hashd_connect(SOCKET_FILE, &client));
+
+    for (int round = 0; round < 20; round++) {
+        uint64_t queries[8];
+        ph_match_t matches[8 * 16];
+        size_t counts[8];
+        for (int i = 0; i < 8; i++)
+            queries[i] = make_query(&state);
+
+        ASSERT_OK(ph_hashd_radius(client, queries, 8, 8, matches, 16, counts));
+        for (int i = 0; i < 8; i++)
+            check_radius(queries[i], 8, &matches[i * 16], 16, counts[i]);
+
+        ASSERT_OK(ph_hashd_knn(client, queries, 8, 16, matches, counts));
+        for (int i = 0; i < 8; i++)
+            check_knn(queries[i], 16, &matches[i * 16], counts[i]);
+    }
+    ph_hashd_disconnect(client);
+    return NULL;
+}
+
+void test_hashd_concurrent_clients() {
+    uint64_t state = 42;
+    for (size_t i = 0; i < STORE_SIZE; i++)
+        store[i] = next_random(&state);
+    ASSERT_OK(ph_hash_store_write(STORE_FILE, store, STORE_SIZE));
+
+    ph_hashd_t *daemon = NULL;
+    pthread_t server, clients[CLIENTS];
+    ASSERT_OK(ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    ASSERT_INT_EQ(0, pthread_create(&server, NULL, serve, daemon));
+
+    /* A live daemon's socket is not taken over */
+    ph_hashd_t *other = NULL;
+    ASSERT_INT_EQ(PH_ERR_IO, ph_hashd_create(STORE_FILE, SOCKET_FILE, &other));
+
+    for (int i = 0; i < CLIENTS; i++)
+        ASSERT_INT_EQ(0, pthread_create(&clients[i], NULL, client_main,
+                                        (void *)(uintptr_t)(i + 1)));
+    for (int i = 0; i < CLIENTS; i++)
+        pthread_join(clients[i], NULL);
+
+    /* A batch larger than one request is split by the client */
+    ph_hashd_client_t *client = NULL;
+    ASSERT_OK(ph_hashd_connect(SOCKET_FILE, &client));
+    size_t n = 5000;
+    uint64_t *queries = malloc(n * sizeof(uint64_t));
+    ph_match_t *matches = malloc(n * sizeof(ph_match_t));
+    size_t *counts = malloc(n * sizeof(size_t));
+    ASSERT_PTR_NOT_NULL(queries);
+    ASSERT_PTR_NOT_NULL(matches);
+    ASSERT_PTR_NOT_NULL(counts);
+    for (size_t i = 0; i < n; i++)
+        queries[i] = store[(i * 7) % STORE_SIZE];
+    ASSERT_OK(ph_hashd_knn(client, queries, n, 1, matches, counts));
+    for (size_t i = 0; i < n; i++) {
+        ASSERT_INT_EQ(1, (int)counts[i]);
+        ASSERT_INT_EQ(0, (int)matches[i].distance);
+        ASSERT_INT_EQ(1, store[matches[i].index] == queries[i]);
+    }
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_hashd_knn(client, queries, 1, 0, matches, counts));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_hashd_radius(client, queries, 1, -1, matches, 1, counts));
+    ph_hashd_disconnect(client);
+    free(queries);
+    free(matches);
+    free(counts);
+
+    ph_hashd_stop(daemon);
+    pthread_join(server, NULL);
+    ph_hashd_free(daemon);
+    ASSERT_INT_EQ(PH_ERR_IO, ph_hashd_connect(SOCKET_FILE, &client));
+    remove(STORE_FILE);
+    printf("test_hashd_concurrent_clients: PASSED\n");
+}
+
+static void recv_exact(int fd, void *buf, size_t n) {
+    uint8_t *p = buf;
+    while (n > 0) {
+        ssize_t got = recv(fd, p, n, 0);
+        ASSERT_INT_EQ(1, got > 0);
+        p += got;
+        n -= (size_t)got;
+    }
+}
+
+/* One client pipelines more result slots than a pass takes: the daemon
+ * must keep answering from its buffer without another wake-up */
+void test_hashd_pipelined_batches() {
+    enum { REQUESTS = 12, COUNT = 1024 };
+    ASSERT_OK(ph_hash_store_write(STORE_FILE, store, STORE_SIZE));
+    ph_hashd_t *daemon = NULL;
+    pthread_t server;
+    ASSERT_OK(ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    ASSERT_INT_EQ(0, pthread_create(&server, NULL, serve, daemon));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, SOCKET_FILE);
+    ASSERT_INT_EQ(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+    /* Radius 0 around stored hashes: one match each, 1M slots per request */
+    size_t size = sizeof(ph_hashd_request_t) + COUNT * sizeof(uint64_t);
+    uint8_t *out = malloc(REQUESTS * size);
+    ASSERT_PTR_NOT_NULL(out);
+    for (int r = 0; r < REQUESTS; r++) {
+        ph_hashd_request_t req = {PH_HASHD_MAGIC, PH_HASHD_OP_RADIUS, 0, 0, COUNT, COUNT};
+        memcpy(out + r * size, &req, sizeof(req));
+        for (int q = 0; q < COUNT; q++) {
+            uint64_t query = store[(r * COUNT + q) % STORE_SIZE];
+            memcpy(out + r * size + sizeof(req) + q * sizeof(uint64_t), &query, sizeof(query));
+        }
+    }
+    ASSERT_INT_EQ((int)(REQUESTS * size), (int)send(fd, out, REQUESTS * size, 0));
+
+    for (int r = 0; r < REQUESTS; r++) {
+        ph_hashd_response_t resp;
+        uint32_t totals[COUNT], pairs[COUNT][2];
+        recv_exact(fd, &resp, sizeof(resp));
+        ASSERT_OK(resp.status);
+        ASSERT_INT_EQ(COUNT, (int)resp.count);
+        recv_exact(fd, totals, sizeof(totals));
+        recv_exact(fd, pairs, sizeof(pairs));
+        for (int q = 0; q < COUNT; q++) {
+            ASSERT_INT_EQ(1, (int)totals[q]);
+            ASSERT_INT_EQ((r * COUNT + q) % STORE_SIZE, (int)pairs[q][0]);
+        }
+    }
+    close(fd);
+    free(out);
+
+    ph_hashd_stop(daemon);
+    pthread_join(server, NULL);
+    ph_hashd_free(daemon);
+    remove(STORE_FILE);
+    printf("test_hashd_pipelined_batches: PASSED\n");
+}
+
+void test_hashd_socket_path() {
+    ph_hashd_t *daemon = NULL;
+    ASSERT_OK(ph_hash_store_write(STORE_FILE, store, 16));
+
+    /* Some other file is left alone */
+    FILE *f = fopen(SOCKET_FILE, "wb");
+    ASSERT_PTR_NOT_NULL(f);
+    fclose(f);
+    ASSERT_INT_EQ(PH_ERR_IO, ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    ASSERT_INT_EQ(0, access(SOCKET_FILE, F_OK));
+    remove(SOCKET_FILE);
+
+    /* A socket nobody listens on is stale and replaced */
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, SOCKET_FILE);
+    ASSERT_INT_EQ(0, bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+    close(fd);
+    ASSERT_OK(ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    ph_hashd_free(daemon);
+    ASSERT_INT_EQ(-1, access(SOCKET_FILE, F_OK));
+    remove(STORE_FILE);
+    printf("test_hashd_socket_path: PASSED\n");
+}
+
+void test_hashd_bad_store() {
+    ph_hashd_t *daemon = NULL;
+    FILE *f = fopen(STORE_FILE, "wb");
+    ASSERT_PTR_NOT_NULL(f);
+    fputs("not a hash store", f);
+    fclose(f);
+    ASSERT_INT_EQ(PH_ERR_DECODE_FAILED, ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    remove(STORE_FILE);
+    ASSERT_INT_EQ(PH_ERR_IO, ph_hashd_create(STORE_FILE, SOCKET_FILE, &daemon));
+    printf("test_hashd_bad_store: PASSED\n");
+}
+
+int main() {
+    test_hashd_concurrent_clients();
+    test_hashd_pipelined_batches();
+    test_hashd_socket_path();
+    test_hashd_bad_store();
+    return 0;
+}
+
+#else
+
+int main() {
+    printf("test_hashd: SKIPPED (Linux only)\n");
+    return 0;
+}
+
+#endif
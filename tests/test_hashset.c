@@ -0,0 +1,121 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT 200000
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void test_hash_set_membership() {
+    uint64_t *hashes = malloc(COUNT * sizeof(uint64_t));
+    uint64_t *copy = malloc(COUNT * sizeof(uint64_t));
+    ASSERT_PTR_NOT_NULL(hashes);
+    ASSERT_PTR_NOT_NULL(copy);
+    uint64_t state = 3;
+    for (int i = 0; i < COUNT; i++) {
+        /* Duplicates, near-duplicates and a dense run of small values */
+        if (i % 5 == 0 && i > 0)
+            hashes[i] = hashes[i - 1];
+        else if (i % 7 == 0 && i > 0)
+            hashes[i] = flip_bits(hashes[i - 1], 2, &state);
+        else
+            hashes[i] = i < 1000 ? (uint64_t)i * 3 : next_random(&state);
+    }
+    memcpy(copy, hashes, COUNT * sizeof(uint64_t));
+
+    ph_hash_set_t *set = NULL;
+    ASSERT_OK(ph_hash_set_build(hashes, COUNT, &set));
+    qsort(copy, COUNT, sizeof(uint64_t), compare_u64);
+    ASSERT_INT_EQ(0, memcmp(copy, hashes, COUNT * sizeof(uint64_t))); /* Sorted in place */
+
+    size_t distinct = 0;
+    for (int i = 0; i < COUNT; i++)
+        distinct += i == 0 || copy[i] != copy[i - 1];
+    ASSERT_INT_EQ((int)distinct, (int)ph_hash_set_count(set));
+    ASSERT_INT_EQ(1, ph_hash_set_memory_usage(set) < distinct * 8);
+
+    for (int i = 0; i < COUNT; i++) {
+        ASSERT_INT_EQ(1, ph_hash_set_contains(set, copy[i]));
+        uint64_t other = copy[i] + 1;
+        int expected = bsearch(&other, copy, COUNT, sizeof(uint64_t), compare_u64) != NULL;
+        ASSERT_INT_EQ(expected, ph_hash_set_contains(set, other));
+    }
+    ASSERT_INT_EQ(0, ph_hash_set_contains(set, UINT64_MAX));
+
+    ph_hash_set_free(set);
+    free(hashes);
+    free(copy);
+    printf("test_hash_set_membership: PASSED\n");
+}
+
+void test_hash_set_radius() {
+    uint64_t *hashes = malloc(COUNT * sizeof(uint64_t));
+    uint64_t *found = malloc(COUNT * sizeof(uint64_t));
+    ASSERT_PTR_NOT_NULL(hashes);
+    ASSERT_PTR_NOT_NULL(found);
+    uint64_t state = 11;
+    for (int i = 0; i < COUNT; i++)
+        hashes[i] = i % 3 == 1 ? flip_bits(hashes[i - 1], 4, &state) : next_random(&state);
+
+    ph_hash_set_t *set = NULL;
+    ASSERT_OK(ph_hash_set_build(hashes, COUNT, &set));
+    size_t distinct = ph_hash_set_count(set);
+
+    const int radii[] = {0, 4, 10, 24};
+    for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+        for (int q = 0; q < 10; q++) {
+            uint64_t query = flip_bits(hashes[next_random(&state) % COUNT], q % 4, &state);
+            size_t count = 0, expected = 0;
+            ASSERT_OK(ph_hash_set_radius(set, query, radii[r], found, COUNT, &count));
+            /* 'hashes' is now the sorted set, duplicates adjacent */
+            for (size_t i = 0; i < COUNT; i++) {
+                if ((i > 0 && hashes[i] == hashes[i - 1]) ||
+                    ph_hamming_distance(hashes[i], query) > radii[r])
+                    continue;
+                ASSERT_INT_EQ(1, expected < count && found[expected] == hashes[i]);
+                expected++;
+            }
+            ASSERT_INT_EQ((int)expected, (int)count);
+        }
+    }
+
+    size_t count = 0;
+    ASSERT_OK(ph_hash_set_radius(set, 0, 64, NULL, 0, &count));
+    ASSERT_INT_EQ((int)distinct, (int)count);
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_hash_set_radius(set, 0, 65, NULL, 0, &count));
+    ph_hash_set_free(set);
+
+    /* A few spread-out hashes: low parts wider than 56 bits */
+    uint64_t few[5];
+    for (int i = 0; i < 5; i++)
+        few[i] = next_random(&state);
+    ASSERT_OK(ph_hash_set_build(few, 5, &set));
+    for (int i = 0; i < 5; i++) {
+        ASSERT_INT_EQ(1, ph_hash_set_contains(set, few[i]));
+        ASSERT_INT_EQ(0, ph_hash_set_contains(set, few[i] ^ 1));
+    }
+    ASSERT_OK(ph_hash_set_radius(set, few[2], 0, found, COUNT, &count));
+    ASSERT_INT_EQ(1, (int)count);
+    ASSERT_INT_EQ(1, found[0] == few[2]);
+    ph_hash_set_free(set);
+
+    ASSERT_OK(ph_hash_set_build(NULL, 0, &set));
+    ASSERT_INT_EQ(0, ph_hash_set_contains(set, 0));
+    ASSERT_OK(ph_hash_set_radius(set, 0, 64, NULL, 0, &count));
+    ASSERT_INT_EQ(0, (int)count);
+    ph_hash_set_free(set);
+    free(hashes);
+    free(found);
+    printf("test_hash_set_radius: PASSED\n");
+}
+
+int main() {
+    test_hash_set_membership();
+    test_hash_set_radius();
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STORED 50000
+#define CLUSTERS 2000
+#define THREADS 8
+
+void test_index_query_matches_scan() {
+    static uint64_t stored[STORED];
+    ph_hash_index_t *index = NULL;
+    uint64_t state = 7;
+    ASSERT_OK(ph_hash_index_create(&index));
+
+    for (uint32_t i = 0; i < STORED; i++) {
+        /* Some near-duplicates, so small radii have matches */
+        stored[i] = i > 0 && i % 3 == 0 ? flip_bits(stored[i - 1], 3, &state)
+                                       : next_random(&state);
+        uint32_t id = 0;
+        ASSERT_OK(ph_hash_index_insert(index, stored[i], &id));
+        ASSERT_INT_EQ((int)i, (int)id);
+    }
+    ASSERT_INT_EQ(STORED, (int)ph_hash_index_count(index));
+
+    static ph_match_t matches[STORED];
+    static int seen[STORED];
+    /* Radii on both sides of the bucket / full-scan switch */
+    const int radii[] = {0, 3, 7, 12, 20};
+    for (size_t r = 0; r < sizeof(radii) / sizeof(radii[0]); r++) {
+        for (int q = 0; q < 40; q++) {
+            uint64_t query = flip_bits(stored[next_random(&state) % STORED], q % 5, &state);
+            size_t count = 0, expected = 0;
+            ASSERT_OK(ph_hash_index_query(index, query, radii[r], matches, STORED, &count));
+
+            memset(seen, 0, sizeof(seen));
+            for (size_t m = 0; m < count; m++) {
+                uint32_t id = matches[m].index;
+                ASSERT_INT_EQ(0, seen[id]); /* Reported once */
+                seen[id] = 1;
+                ASSERT_INT_EQ(ph_hamming_distance(stored[id], query), (int)matches[m].distance);
+            }
+            for (uint32_t i = 0; i < STORED; i++)
+                expected += ph_hamming_distance(stored[i], query) <= radii[r];
+            ASSERT_INT_EQ((int)expected, (int)count);
+        }
+    }
+
+    size_t count = 0;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_hash_index_query(index, 0, 65, NULL, 0, &count));
+    ph_hash_index_free(index);
+    printf("test_index_query_matches_scan: PASSED\n");
+}
+
+static ph_hash_index_t *g_index;
+static uint64_t g_centers[CLUSTERS];
+static int g_inserted[THREADS];
+
+/* Every thread offers a perturbed copy of every cluster, in its own order */
+static void *ingest(void *arg) {
+    int t = (int)(uintptr_t)arg;
+    uint64_t state = 1000 + (uint64_t)t;
+    for (int i = 0; i < CLUSTERS; i++) {
+        int c = (i * 7 + t * 263) % CLUSTERS;
+        uint64_t h = flip_bits(g_centers[c], 2, &state);
+        uint32_t id = 0;
+        int inserted = 0;
+        ASSERT_OK(ph_hash_index_find_or_insert(g_index, h, 4, &id, &inserted));
+        g_inserted[t] += inserted;
+    }
+    return NULL;
+}
+
+void test_index_find_or_insert_is_atomic() {
+    uint64_t state = 99;
+    /* Random centers are ~32 bits apart; copies of one are at most 4 apart */
+    for (int i = 0; i < CLUSTERS; i++)
+        g_centers[i] = next_random(&state);
+    ASSERT_OK(ph_hash_index_create(&g_index));
+
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++)
+        ASSERT_INT_EQ(0, pthread_create(&threads[t], NULL, ingest, (void *)(uintptr_t)t));
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(threads[t], NULL);
+
+    int total = 0;
+    for (int t = 0; t < THREADS; t++)
+        total += g_inserted[t];
+    ASSERT_INT_EQ(CLUSTERS, total);
+    ASSERT_INT_EQ(CLUSTERS, (int)ph_hash_index_count(g_index));
+
+    /* Known hashes are found, not inserted again */
+    uint32_t id = 0;
+    int inserted = 1;
+    ASSERT_OK(ph_hash_index_find_or_insert(g_index, g_centers[5], 4, &id, &inserted));
+    ASSERT_INT_EQ(0, inserted);
+    ASSERT_INT_EQ(CLUSTERS, (int)ph_hash_index_count(g_index));
+
+    ph_hash_index_free(g_index);
+    printf("test_index_find_or_insert_is_atomic: PASSED\n");
+}
+
+int main() {
+    test_index_query_matches_scan();
+    test_index_find_or_insert_is_atomic();
+    return 0;
+}
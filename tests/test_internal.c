@@ -1,5 +1,7 @@
 #include "../src/internal.h"
+#include "../src/tables.h"
 #include "test_macros.h"
+#include <math.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -29,8 +31,105 @@ void test_digest_hamming() {
     printf("test_digest_hamming: PASSED\n");
 }
 
+void test_pyramid_levels() {
+    ph_context_t *ctx = NULL;
+    int w = 0, h = 0;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+
+    /* Level 0 is the gray plane */
+    const uint8_t *level = ph_get_level(ctx, ctx->width, ctx->height, &w, &h);
+    ASSERT_INT_EQ(1, level == ph_get_gray(ctx));
+
+    /* The smallest level still covering 32x32 */
+    level = ph_get_level(ctx, 32, 32, &w, &h);
+    ASSERT_PTR_NOT_NULL(level);
+    ASSERT_INT_EQ(1, w >= 32 && h >= 32 && (w < 64 || h < 64));
+    int built = ctx->pyramid_levels;
+
+    /* Coarser requests reuse the levels already built */
+    ph_get_level(ctx, 16, 16, &w, &h);
+    ASSERT_INT_EQ(built + 1, ctx->pyramid_levels);
+
+    /* An odd-sized 3x1 image averages its repeated edge */
+    uint8_t px[] = {10, 10, 10, 30, 30, 30, 90, 90, 90};
+    ph_release_image(ctx);
+    ASSERT_INT_EQ(0, ctx->pyramid_levels);
+    ctx->data = px;
+    ctx->width = 3;
+    ctx->height = 1;
+    ctx->channels = 3;
+    level = ph_get_level(ctx, 2, 1, &w, &h);
+    ASSERT_INT_EQ(2, w);
+    ASSERT_INT_EQ(20, level[0]);
+    ASSERT_INT_EQ(ctx->gray_data[2], level[1]);
+    ctx->gray_data = NULL;
+    ctx->data = NULL;
+
+    ph_free(ctx);
+    printf("test_pyramid_levels: PASSED\n");
+}
+
+void test_sample_area() {
+    ph_context_t *ctx = NULL;
+    uint8_t out[64];
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    const uint8_t *gray = ph_get_gray(ctx);
+
+    /* Every output pixel is the rounded mean of its box */
+    int x = 13, y = 7, w = 61, h = 45;
+    ASSERT_INT_EQ(1, ph_sample_area(ctx, x, y, w, h, out, 8, 8));
+    for (int j = 0; j < 8; j++) {
+        for (int i = 0; i < 8; i++) {
+            int x0 = x + i * w / 8, x1 = x + (i + 1) * w / 8;
+            int y0 = y + j * h / 8, y1 = y + (j + 1) * h / 8;
+            uint32_t sum = 0, area = (uint32_t)((x1 - x0) * (y1 - y0));
+            for (int yy = y0; yy < y1; yy++)
+                for (int xx = x0; xx < x1; xx++)
+                    sum += gray[yy * ctx->width + xx];
+            ASSERT_INT_EQ((int)((sum + area / 2) / area), out[j * 8 + i]);
+        }
+    }
+
+    /* Upsampling a 2x2 corner repeats its pixels */
+    ASSERT_INT_EQ(1, ph_sample_area(ctx, 0, 0, 2, 2, out, 4, 4));
+    ASSERT_INT_EQ(gray[0], out[0]);
+    ASSERT_INT_EQ(gray[ctx->width + 1], out[15]);
+
+    /* Dropped with the image */
+    ph_release_image(ctx);
+    ASSERT_INT_EQ(0, ctx->has_sat);
+    ph_free(ctx);
+    printf("test_sample_area: PASSED\n");
+}
+
+void test_generated_tables() {
+    /* The DCT basis is orthonormal */
+    for (int i = 0; i < PH_DCT_SIZE; i++) {
+        for (int j = 0; j < PH_DCT_SIZE; j++) {
+            double dot = 0;
+            for (int k = 0; k < PH_DCT_SIZE; k++)
+                dot += ph_dct_matrix[i][k] * ph_dct_matrix[j][k];
+            ASSERT_INT_EQ(1, fabs(dot - (i == j)) < 1e-12);
+            ASSERT_INT_EQ(1, fabs(ph_dct_matrix_f32[i][j] - ph_dct_matrix[i][j]) < 1e-7);
+        }
+    }
+
+    /* The default LUT is what the runtime formula gives */
+    for (int i = 0; i < 256; i++) {
+        double res = pow(i / 255.0, 1.0 / (double)PH_DEFAULT_GAMMA) * 255.0;
+        ASSERT_INT_EQ((int)(uint8_t)(res > 255.0 ? 255.0 : res), ph_default_gamma_lut[i]);
+    }
+    ASSERT_INT_EQ(1, fabs(ph_radial_cos[10] - cos(M_PI / 4)) < 1e-15);
+    printf("test_generated_tables: PASSED\n");
+}
+
 int main() {
     test_grayscale_conversion();
     test_digest_hamming();
+    test_pyramid_levels();
+    test_sample_area();
+    test_generated_tables();
     return 0;
 }
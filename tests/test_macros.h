@@ -1,6 +1,7 @@
 #ifndef TEST_MACROS_H
 #define TEST_MACROS_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -34,4 +35,32 @@
         }                                                                                          \
     } while (0)
 
+/* Reads a whole test fixture into a malloc'd buffer */
+static inline uint8_t *read_file(const char *path, size_t *out_len) {
+    FILE *f = fopen(path, "rb");
+    ASSERT_PTR_NOT_NULL(f);
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc((size_t)len);
+    ASSERT_PTR_NOT_NULL(buf);
+    ASSERT_INT_EQ((int)len, (int)fread(buf, 1, (size_t)len, f));
+    fclose(f);
+    *out_len = (size_t)len;
+    return buf;
+}
+
+/* Deterministic pseudo-random stream for generated test data */
+static inline uint64_t next_random(uint64_t *state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state ^ (*state >> 29);
+}
+
+/* Flips 'bits' random bits of h (a bit may be flipped back) */
+static inline uint64_t flip_bits(uint64_t h, int bits, uint64_t *state) {
+    for (int i = 0; i < bits; i++)
+        h ^= 1ULL << (next_random(state) % 64);
+    return h;
+}
+
 #endif /* TEST_MACROS_H */
@@ -0,0 +1,148 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+/* Collects reported pairs into an na x nb hit matrix */
+typedef struct {
+    uint8_t *hits;
+    size_t nb;
+    size_t total;
+    size_t stop_after; /* 0: never stop */
+    int bad;
+} collector_t;
+
+static int collect(const ph_pair_t *pairs, size_t count, void *user_data) {
+    collector_t *c = user_data;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *hit = &c->hits[pairs[i].a * c->nb + pairs[i].b];
+        if (*hit)
+            c->bad = 1; // Reported twice
+        *hit = 1;
+    }
+    c->total += count;
+    return c->stop_after && c->total >= c->stop_after;
+}
+
+static void check_hits(const collector_t *c, const uint8_t *expected, size_t na, size_t nb) {
+    ASSERT_INT_EQ(0, c->bad);
+    for (size_t i = 0; i < na * nb; i++) {
+        if (c->hits[i] != expected[i]) {
+            fprintf(stderr, "Pair (%zu, %zu): expected %d\n", i / nb, i % nb, expected[i]);
+            exit(1);
+        }
+    }
+}
+
+void test_pairs_u64() {
+    const size_t na = 700, nb = 900;
+    uint64_t *a = malloc(na * sizeof(uint64_t)), *b = malloc(nb * sizeof(uint64_t));
+    uint8_t *expected = malloc(na * nb);
+    collector_t c = {calloc(na * nb, 1), nb, 0, 0, 0};
+
+    /* B holds perturbed copies of A among noise */
+    for (size_t i = 0; i < na; i++)
+        a[i] = next_random(&rng_state);
+    for (size_t j = 0; j < nb; j++) {
+        b[j] = next_random(&rng_state);
+        if (j % 2 == 0) {
+            b[j] = a[next_random(&rng_state) % na];
+            for (size_t f = 0; f < j % 9; f++)
+                b[j] ^= 1ULL << (next_random(&rng_state) % 64);
+        }
+    }
+
+    for (int threads = 1; threads <= 4; threads += 3) {
+        for (size_t i = 0; i < na; i++)
+            for (size_t j = 0; j < nb; j++)
+                expected[i * nb + j] = ph_hamming_distance(a[i], b[j]) <= 5;
+        memset(c.hits, 0, na * nb);
+        c.total = 0;
+        ASSERT_OK(ph_pairs_within_u64(a, na, b, nb, 5, threads, collect, &c));
+        check_hits(&c, expected, na, nb);
+    }
+
+    /* Self-join: each unordered pair once */
+    collector_t self = {calloc(na * na, 1), na, 0, 0, 0};
+    uint8_t *self_expected = calloc(na * na, 1);
+    for (size_t i = 0; i < na; i += 3)
+        a[i + 1 < na ? i + 1 : i] = a[i] ^ (1ULL << (i % 64));
+    for (size_t i = 0; i < na; i++)
+        for (size_t j = i + 1; j < na; j++)
+            self_expected[i * na + j] = ph_hamming_distance(a[i], a[j]) <= 2;
+    ASSERT_OK(ph_pairs_within_u64(a, na, a, na, 2, 3, collect, &self));
+    check_hits(&self, self_expected, na, na);
+
+    /* Early stop */
+    c.total = 0;
+    c.stop_after = 1;
+    memset(c.hits, 0, na * nb);
+    ASSERT_OK(ph_pairs_within_u64(a, na, b, nb, 64, 2, collect, &c));
+    ASSERT_INT_EQ(1, c.total < na * nb);
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_pairs_within_u64(a, na, b, nb, -1, 1, collect, &c));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_pairs_within_u64(a, na, b, nb, 3, 1, NULL, &c));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_pairs_within_u64(a, na, b, nb, 3, -1, collect, &c));
+
+    free(a);
+    free(b);
+    free(expected);
+    free(c.hits);
+    free(self.hits);
+    free(self_expected);
+    printf("test_pairs_u64: PASSED\n");
+}
+
+void test_pairs_digest() {
+    const size_t na = 300, nb = 260;
+    ph_digest_t *a = calloc(na, sizeof(ph_digest_t)), *b = calloc(nb, sizeof(ph_digest_t));
+    uint8_t *expected = malloc(na * nb);
+    collector_t c = {calloc(na * nb, 1), nb, 0, 0, 0};
+
+    /* 40-byte digests like the radial hash: a tail past the last full word */
+    for (size_t i = 0; i < na; i++) {
+        a[i].size = 40;
+        for (int k = 0; k < 40; k++)
+            a[i].data[k] = (uint8_t)next_random(&rng_state);
+    }
+    for (size_t j = 0; j < nb; j++) {
+        b[j] = a[next_random(&rng_state) % na];
+        for (size_t f = 0; f < j % 12; f++) {
+            int k = (int)(next_random(&rng_state) % 40);
+            b[j].data[k] = (uint8_t)(b[j].data[k] + (next_random(&rng_state) % 7) - 3);
+        }
+    }
+
+    for (size_t i = 0; i < na; i++)
+        for (size_t j = 0; j < nb; j++)
+            expected[i * nb + j] = ph_hamming_distance_digest(&a[i], &b[j]) <= 10;
+    ASSERT_OK(ph_pairs_within_digest(a, na, b, nb, 10, 2, collect, &c));
+    check_hits(&c, expected, na, nb);
+
+    for (size_t i = 0; i < na; i++)
+        for (size_t j = 0; j < nb; j++)
+            expected[i * nb + j] = ph_l2_distance(&a[i], &b[j]) <= 6.0;
+    memset(c.hits, 0, na * nb);
+    ASSERT_OK(ph_pairs_within_l2(a, na, b, nb, 6.0, 2, collect, &c));
+    check_hits(&c, expected, na, nb);
+
+    b[7].size = 32;
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT,
+                  ph_pairs_within_l2(a, na, b, nb, 6.0, 2, collect, &c));
+
+    free(a);
+    free(b);
+    free(expected);
+    free(c.hits);
+    printf("test_pairs_digest: PASSED\n");
+}
+
+int main() {
+    test_pairs_u64();
+    test_pairs_digest();
+    return 0;
+}
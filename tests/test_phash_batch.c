@@ -0,0 +1,68 @@
+#include "../src/internal.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT 3000
+
+/* Noise, smooth gradients, flat planes and two-level patterns: the last
+ * two put coefficients right at the mean and take the double path */
+static void fill_plane(uint8_t *plane, int kind, uint64_t *state) {
+    int a = (int)(next_random(state) % 7), b = (int)(next_random(state) % 5);
+    for (int i = 0; i < 1024; i++) {
+        int x = i % 32, y = i / 32;
+        switch (kind % 4) {
+            case 0:
+                plane[i] = (uint8_t)(next_random(state) >> 56);
+                break;
+            case 1:
+                plane[i] = (uint8_t)(x * a + y * b + (next_random(state) >> 61));
+                break;
+            case 2:
+                plane[i] = (uint8_t)(a * 30);
+                break;
+            default:
+                plane[i] = ((x / (a + 1) + y / (b + 1)) & 1) ? 255 : 0;
+                break;
+        }
+    }
+}
+
+void test_phash_batch_matches_kernel() {
+    uint8_t *planes = malloc((size_t)COUNT * 1024);
+    uint64_t *batch = malloc(COUNT * sizeof(uint64_t));
+    uint64_t *threaded = malloc(COUNT * sizeof(uint64_t));
+    ASSERT_PTR_NOT_NULL(planes);
+    ASSERT_PTR_NOT_NULL(batch);
+    ASSERT_PTR_NOT_NULL(threaded);
+    uint64_t state = 17;
+    for (int i = 0; i < COUNT; i++)
+        fill_plane(planes + (size_t)i * 1024, i, &state);
+
+    ASSERT_OK(ph_phash_batch(planes, COUNT, batch));
+    for (int i = 0; i < COUNT; i++) {
+        if (batch[i] != ph_phash_kernel(planes + (size_t)i * 1024)) {
+            fprintf(stderr, "Plane %d: batch hash differs from the kernel\n", i);
+            exit(1);
+        }
+    }
+
+    ASSERT_OK(ph_phash_batch_threaded(planes, COUNT, 3, threaded));
+    ASSERT_INT_EQ(0, memcmp(batch, threaded, COUNT * sizeof(uint64_t)));
+    ASSERT_OK(ph_phash_batch_threaded(planes, 5, 0, threaded)); /* Partial tile */
+    ASSERT_INT_EQ(0, memcmp(batch, threaded, 5 * sizeof(uint64_t)));
+
+    ASSERT_OK(ph_phash_batch(NULL, 0, NULL));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_phash_batch(NULL, 1, batch));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_phash_batch_threaded(planes, 1, -1, batch));
+    free(planes);
+    free(batch);
+    free(threaded);
+    printf("test_phash_batch_matches_kernel: PASSED\n");
+}
+
+int main() {
+    test_phash_batch_matches_kernel();
+    return 0;
+}
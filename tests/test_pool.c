@@ -0,0 +1,116 @@
+#include "../src/internal.h"
+#include "../src/thread.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <string.h>
+
+#define STRESS_THREADS 4
+#define STRESS_ROUNDS 20000
+
+void test_pool_reuse() {
+    ph_context_pool_t *pool = NULL;
+    ph_context_t *ctx = NULL, *again = NULL, *fresh = NULL;
+    uint64_t first = 0, second = 0;
+
+    ASSERT_OK(ph_context_pool_create(4, &pool));
+    ASSERT_OK(ph_create(&fresh));
+
+    ASSERT_OK(ph_context_pool_acquire(pool, &ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_phash(ctx, &first));
+    ph_context_set_gamma(ctx, 1.2f);
+    ph_context_set_load_flags(ctx, PH_LOAD_GRAY_ONLY);
+    ph_context_pool_release(pool, ctx);
+
+    /* Same thread gets the same context back: reset, but with its buffers */
+    ASSERT_OK(ph_context_pool_acquire(pool, &again));
+    ASSERT_INT_EQ(1, again == ctx);
+    ASSERT_INT_EQ(0, again->is_loaded);
+    ASSERT_INT_EQ(0, (int)again->load_flags);
+    ASSERT_INT_EQ(0, memcmp(again->gamma_lut, fresh->gamma_lut, sizeof(fresh->gamma_lut)));
+    ASSERT_PTR_NOT_NULL(again->gray_buf);
+    ASSERT_PTR_NOT_NULL(again->pyramid);
+
+    ASSERT_OK(ph_load_from_file(again, "tests/photo.jpeg"));
+    ASSERT_OK(ph_compute_phash(again, &second));
+    ASSERT_INT_EQ(1, first == second);
+    ph_context_pool_release(pool, again);
+
+    ph_free(fresh);
+    ph_context_pool_destroy(pool);
+    printf("test_pool_reuse: PASSED\n");
+}
+
+void test_pool_idle_cap() {
+    ph_context_pool_t *pool = NULL;
+    ph_context_t *ctxs[4], *back[2];
+
+    ASSERT_OK(ph_context_pool_create(2, &pool));
+    for (int i = 0; i < 4; i++)
+        ASSERT_OK(ph_context_pool_acquire(pool, &ctxs[i]));
+    /* The first two are kept, the rest freed */
+    for (int i = 0; i < 4; i++)
+        ph_context_pool_release(pool, ctxs[i]);
+
+    ASSERT_OK(ph_context_pool_acquire(pool, &back[0]));
+    ASSERT_OK(ph_context_pool_acquire(pool, &back[1]));
+    ASSERT_INT_EQ(1, back[0] == ctxs[1] || back[0] == ctxs[0]);
+    ASSERT_INT_EQ(1, back[1] == ctxs[1] || back[1] == ctxs[0]);
+    ASSERT_INT_EQ(1, back[0] != back[1]);
+
+    ph_context_pool_release(pool, back[0]);
+    ph_context_pool_release(pool, back[1]);
+    ph_context_pool_destroy(pool);
+    printf("test_pool_idle_cap: PASSED\n");
+}
+
+typedef struct {
+    ph_context_pool_t *pool;
+    int id;
+    int errors;
+} stress_arg_t;
+
+static void stress_worker(void *arg) {
+    stress_arg_t *a = arg;
+    for (int i = 0; i < STRESS_ROUNDS; i++) {
+        ph_context_t *ctx = NULL;
+        if (ph_context_pool_acquire(a->pool, &ctx) != PH_SUCCESS) {
+            a->errors++;
+            continue;
+        }
+        /* A context handed to two threads at once would see the other's mark */
+        if (ctx->min_width != 0)
+            a->errors++;
+        ph_context_set_min_resolution(ctx, a->id + 1, 1);
+        if (ctx->min_width != a->id + 1)
+            a->errors++;
+        ph_context_pool_release(a->pool, ctx);
+    }
+}
+
+void test_pool_concurrent() {
+    ph_context_pool_t *pool = NULL;
+    ph_thread_t threads[STRESS_THREADS];
+    stress_arg_t args[STRESS_THREADS];
+
+    ASSERT_OK(ph_context_pool_create(2, &pool));
+    for (int t = 0; t < STRESS_THREADS; t++) {
+        args[t].pool = pool;
+        args[t].id = t;
+        args[t].errors = 0;
+        ASSERT_INT_EQ(0, ph_thread_create(&threads[t], stress_worker, &args[t]));
+    }
+    for (int t = 0; t < STRESS_THREADS; t++) {
+        ph_thread_join(threads[t]);
+        ASSERT_INT_EQ(0, args[t].errors);
+    }
+    ph_context_pool_destroy(pool);
+    printf("test_pool_concurrent: PASSED\n");
+}
+
+int main() {
+    test_pool_reuse();
+    test_pool_idle_cap();
+    test_pool_concurrent();
+    return 0;
+}
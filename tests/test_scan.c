@@ -0,0 +1,154 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t next_rand(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double reference_l2(const ph_digest_t *a, const ph_digest_t *b) {
+    double sum = 0;
+    for (int i = 0; i < a->size; i++) {
+        double diff = (double)a->data[i] - (double)b->data[i];
+        sum += diff * diff;
+    }
+    return sqrt(sum);
+}
+
+static double reference_sad(const ph_digest_t *a, const ph_digest_t *b) {
+    double sum = 0;
+    for (int i = 0; i < a->size; i++)
+        sum += fabs((double)a->data[i] - (double)b->data[i]);
+    return sum;
+}
+
+/* A base digest plus noisy copies, so thresholds select a real subset */
+static void fill(ph_digest_t *d, size_t n, int size) {
+    for (size_t i = 0; i < n; i++) {
+        memset(&d[i], 0, sizeof(d[i]));
+        d[i].size = (uint8_t)size;
+        for (int k = 0; k < size; k++) {
+            int noise = (int)(next_rand() % (1 + i % 40)) - (int)(i % 40) / 2;
+            int v = 128 + (k * 37) % 100 - 50 + noise;
+            d[i].data[k] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+        }
+    }
+}
+
+static void check_scans(int size) {
+    const size_t n = 1000;
+    ph_digest_t *d = malloc(n * sizeof(ph_digest_t));
+    ph_match_t *matches = malloc(n * sizeof(ph_match_t));
+    ph_digest_set_t *set = NULL;
+    size_t count = 0;
+    fill(d, n, size);
+
+    ASSERT_OK(ph_digest_set_create(size, &set));
+    ASSERT_OK(ph_digest_set_add(set, d, n / 3));
+    ASSERT_OK(ph_digest_set_add(set, d + n / 3, n - n / 3));
+    ASSERT_INT_EQ((int)n, (int)ph_digest_set_count(set));
+
+    const ph_digest_t *q = &d[17];
+    const double l2_max = 40.0, sad_max = 200.0;
+
+    ASSERT_OK(ph_l2_scan(q, set, l2_max, matches, n, &count));
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        double dist = reference_l2(q, &d[i]);
+        ASSERT_INT_EQ(1, fabs(ph_l2_distance(q, &d[i]) - dist) < 1e-9);
+        if (dist <= l2_max) {
+            ASSERT_INT_EQ((int)i, (int)matches[expected].index);
+            ASSERT_INT_EQ(1, fabs(matches[expected].distance - dist) < 1e-3);
+            expected++;
+        }
+    }
+    ASSERT_INT_EQ((int)expected, (int)count);
+    ASSERT_INT_EQ(1, count > 1 && count < n);
+
+    /* A short output array still reports the full count */
+    size_t capped = 0;
+    ASSERT_OK(ph_l2_scan(q, set, l2_max, matches, 1, &capped));
+    ASSERT_INT_EQ((int)count, (int)capped);
+
+    ASSERT_OK(ph_sad_scan(q, set, sad_max, matches, n, &count));
+    expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (reference_sad(q, &d[i]) <= sad_max) {
+            ASSERT_INT_EQ((int)i, (int)matches[expected].index);
+            expected++;
+        }
+    }
+    ASSERT_INT_EQ((int)expected, (int)count);
+
+    /* Top-k is sorted and nothing outside it is nearer */
+    const size_t k = 25;
+    ASSERT_OK(ph_l2_topk(q, set, k, matches, &count));
+    ASSERT_INT_EQ((int)k, (int)count);
+    ASSERT_INT_EQ(17, (int)matches[0].index);
+    for (size_t i = 1; i < k; i++)
+        ASSERT_INT_EQ(1, matches[i - 1].distance <= matches[i].distance);
+    for (size_t i = 0; i < n; i++) {
+        int inside = 0;
+        for (size_t j = 0; j < k; j++)
+            inside |= matches[j].index == i;
+        if (!inside)
+            ASSERT_INT_EQ(1, reference_l2(q, &d[i]) >= matches[k - 1].distance - 1e-3);
+    }
+    ASSERT_OK(ph_sad_topk(q, set, n + 5, matches, &count));
+    ASSERT_INT_EQ((int)n, (int)count);
+    ASSERT_INT_EQ(1, fabs(matches[n - 1].distance - reference_sad(q, &d[matches[n - 1].index])) <
+                         1e-3);
+
+    ph_digest_t back;
+    ASSERT_OK(ph_digest_set_get(set, 500, &back));
+    ASSERT_INT_EQ(0, memcmp(&back, &d[500], sizeof(back)));
+
+    free(d);
+    free(matches);
+    ph_digest_set_free(set);
+}
+
+void test_scan_sizes() {
+    /* Whole vectors, vector plus tail, and tail only */
+    check_scans(64);
+    check_scans(40);
+    check_scans(7);
+    printf("test_scan_sizes: PASSED\n");
+}
+
+void test_scan_errors() {
+    ph_digest_set_t *set = NULL;
+    ph_digest_t wrong = {{0}, 12, {0}};
+    ph_match_t matches[3];
+    size_t count = 0;
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_digest_set_create(0, &set));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_digest_set_create(PH_DIGEST_MAX_BYTES + 1, &set));
+    ASSERT_OK(ph_digest_set_create(40, &set));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_digest_set_add(set, &wrong, 1));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_l2_scan(&wrong, set, 1.0, NULL, 0, &count));
+
+    /* Empty set */
+    wrong.size = 40;
+    ASSERT_OK(ph_l2_scan(&wrong, set, 1.0, NULL, 0, &count));
+    ASSERT_INT_EQ(0, (int)count);
+    ASSERT_OK(ph_l2_topk(&wrong, set, 3, matches, &count));
+    ASSERT_INT_EQ(0, (int)count);
+
+    ph_digest_set_free(set);
+    printf("test_scan_errors: PASSED\n");
+}
+
+int main() {
+    test_scan_sizes();
+    test_scan_errors();
+    return 0;
+}
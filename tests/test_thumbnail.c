@@ -0,0 +1,161 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void put16(uint8_t *p, uint32_t v, int big_endian) {
+    p[big_endian ? 0 : 1] = (uint8_t)(v >> 8);
+    p[big_endian ? 1 : 0] = (uint8_t)v;
+}
+
+static void put32(uint8_t *p, uint32_t v, int big_endian) {
+    for (int i = 0; i < 4; i++)
+        p[big_endian ? 3 - i : i] = (uint8_t)(v >> (8 * i));
+}
+
+/* 'image' with an APP1 Exif segment right after SOI whose IFD1 points at
+ * 'thumb', as cameras write it */
+static uint8_t *with_exif_thumbnail(const uint8_t *image, size_t image_len, const uint8_t *thumb,
+                                    size_t thumb_len, int big_endian, size_t *out_len) {
+    uint8_t tiff[44] = {0};
+    memcpy(tiff, big_endian ? "MM\0*" : "II*\0", 4);
+    put32(tiff + 4, 8, big_endian);   /* IFD0: no entries */
+    put32(tiff + 10, 14, big_endian); /* then IFD1 */
+    put16(tiff + 14, 2, big_endian);
+    put16(tiff + 16, 0x0201, big_endian); /* Thumbnail offset, LONG */
+    put16(tiff + 18, 4, big_endian);
+    put32(tiff + 20, 1, big_endian);
+    put32(tiff + 24, sizeof(tiff), big_endian);
+    put16(tiff + 28, 0x0202, big_endian); /* Thumbnail length, LONG */
+    put16(tiff + 30, 4, big_endian);
+    put32(tiff + 32, 1, big_endian);
+    put32(tiff + 36, (uint32_t)thumb_len, big_endian);
+
+    size_t seg_len = 2 + 6 + sizeof(tiff) + thumb_len;
+    *out_len = image_len + 2 + seg_len;
+    uint8_t *out = malloc(*out_len), *p = out;
+    ASSERT_PTR_NOT_NULL(out);
+    *p++ = 0xFF, *p++ = 0xD8, *p++ = 0xFF, *p++ = 0xE1;
+    *p++ = (uint8_t)(seg_len >> 8), *p++ = (uint8_t)seg_len;
+    memcpy(p, "Exif\0\0", 6), p += 6;
+    memcpy(p, tiff, sizeof(tiff)), p += sizeof(tiff);
+    memcpy(p, thumb, thumb_len), p += thumb_len;
+    memcpy(p, image + 2, image_len - 2);
+    return out;
+}
+
+static uint64_t phash_of(const uint8_t *buf, size_t len, uint32_t flags,
+                         ph_load_source_t expected_source) {
+    ph_context_t *ctx = NULL;
+    uint64_t hash = 0;
+    ASSERT_OK(ph_create(&ctx));
+    ph_context_set_load_flags(ctx, flags);
+    ASSERT_OK(ph_load_from_memory(ctx, buf, len));
+    ASSERT_INT_EQ(expected_source, ph_get_load_source(ctx));
+    ASSERT_OK(ph_compute_phash(ctx, &hash));
+    ph_free(ctx);
+    return hash;
+}
+
+void test_exif_thumbnail_is_used() {
+    size_t main_len, thumb_len, len;
+    uint8_t *main_img = read_file("tests/photo_rotated_90.jpeg", &main_len);
+    uint8_t *thumb = read_file("tests/photo.jpeg", &thumb_len);
+    uint64_t main_hash = phash_of(main_img, main_len, 0, PH_SOURCE_DECODED);
+    uint64_t thumb_hash = phash_of(thumb, thumb_len, 0, PH_SOURCE_DECODED);
+
+    for (int big_endian = 0; big_endian < 2; big_endian++) {
+        uint8_t *jpeg =
+            with_exif_thumbnail(main_img, main_len, thumb, thumb_len, big_endian, &len);
+        ASSERT_INT_EQ(1, thumb_hash ==
+                             phash_of(jpeg, len, PH_LOAD_EXIF_THUMBNAIL, PH_SOURCE_THUMBNAIL));
+        ASSERT_INT_EQ(1, main_hash == phash_of(jpeg, len, 0, PH_SOURCE_DECODED));
+
+        /* Through the file path too */
+        FILE *f = fopen("test_thumbnail.jpeg", "wb");
+        ASSERT_PTR_NOT_NULL(f);
+        fwrite(jpeg, 1, len, f);
+        fclose(f);
+        ph_context_t *ctx = NULL;
+        ASSERT_OK(ph_create(&ctx));
+        ph_context_set_load_flags(ctx, PH_LOAD_EXIF_THUMBNAIL);
+        ASSERT_OK(ph_load_from_file(ctx, "test_thumbnail.jpeg"));
+        ASSERT_INT_EQ(PH_SOURCE_THUMBNAIL, ph_get_load_source(ctx));
+        ph_free(ctx);
+        remove("test_thumbnail.jpeg");
+        free(jpeg);
+    }
+
+    /* A JFXX extension segment works the same way */
+    len = main_len + 4 + 6 + thumb_len;
+    uint8_t *jfxx = malloc(len);
+    ASSERT_PTR_NOT_NULL(jfxx);
+    size_t seg_len = 2 + 6 + thumb_len;
+    memcpy(jfxx, "\xFF\xD8\xFF\xE0", 4);
+    jfxx[4] = (uint8_t)(seg_len >> 8), jfxx[5] = (uint8_t)seg_len;
+    memcpy(jfxx + 6, "JFXX\0\x10", 6);
+    memcpy(jfxx + 12, thumb, thumb_len);
+    memcpy(jfxx + 12 + thumb_len, main_img + 2, main_len - 2);
+    ASSERT_INT_EQ(1, thumb_hash ==
+                         phash_of(jfxx, len, PH_LOAD_EXIF_THUMBNAIL, PH_SOURCE_THUMBNAIL));
+    free(jfxx);
+
+    free(main_img);
+    free(thumb);
+    printf("test_exif_thumbnail_is_used: PASSED\n");
+}
+
+void test_exif_thumbnail_fallbacks() {
+    size_t main_len, thumb_len, len;
+    uint8_t *main_img = read_file("tests/photo_rotated_90.jpeg", &main_len);
+    uint8_t *thumb = read_file("tests/photo.jpeg", &thumb_len);
+    uint64_t main_hash = phash_of(main_img, main_len, 0, PH_SOURCE_DECODED);
+
+    /* No IFD1 in this file's EXIF header */
+    size_t plain_len;
+    uint8_t *plain = read_file("tests/photo_color_changed.jpeg", &plain_len);
+    phash_of(plain, plain_len, PH_LOAD_EXIF_THUMBNAIL, PH_SOURCE_DECODED);
+    free(plain);
+
+    /* Smaller than the minimum resolution */
+    uint8_t *jpeg = with_exif_thumbnail(main_img, main_len, thumb, thumb_len, 0, &len);
+    ph_context_t *ctx = NULL;
+    ASSERT_OK(ph_create(&ctx));
+    ph_context_set_load_flags(ctx, PH_LOAD_EXIF_THUMBNAIL);
+    ph_context_set_min_resolution(ctx, 500, 500);
+    ASSERT_OK(ph_load_from_memory(ctx, jpeg, len));
+    ASSERT_INT_EQ(PH_SOURCE_DECODED, ph_get_load_source(ctx));
+    ph_free(ctx);
+    free(jpeg);
+
+    /* A letterboxed-looking thumbnail: its frame header claims 400x200 */
+    uint8_t *skewed = malloc(thumb_len);
+    ASSERT_PTR_NOT_NULL(skewed);
+    memcpy(skewed, thumb, thumb_len);
+    size_t sof = 2;
+    while (!(skewed[sof] == 0xFF && skewed[sof + 1] == 0xC0))
+        sof += 2 + ((size_t)skewed[sof + 2] << 8 | skewed[sof + 3]);
+    skewed[sof + 5] = 200 >> 8, skewed[sof + 6] = 200 & 0xFF;
+    jpeg = with_exif_thumbnail(main_img, main_len, skewed, thumb_len, 1, &len);
+    ASSERT_INT_EQ(1, main_hash == phash_of(jpeg, len, PH_LOAD_EXIF_THUMBNAIL, PH_SOURCE_DECODED));
+    free(jpeg);
+
+    /* A thumbnail length running past the segment is ignored */
+    jpeg = with_exif_thumbnail(main_img, main_len, thumb, thumb_len, 0, &len);
+    jpeg[4 + 2 + 6 + 36] = 0xFF;
+    jpeg[4 + 2 + 6 + 37] = 0xFF;
+    ASSERT_INT_EQ(1, main_hash == phash_of(jpeg, len, PH_LOAD_EXIF_THUMBNAIL, PH_SOURCE_DECODED));
+    free(jpeg);
+
+    free(skewed);
+    free(main_img);
+    free(thumb);
+    printf("test_exif_thumbnail_fallbacks: PASSED\n");
+}
+
+int main() {
+    test_exif_thumbnail_is_used();
+    test_exif_thumbnail_fallbacks();
+    return 0;
+}
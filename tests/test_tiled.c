@@ -0,0 +1,89 @@
+#include "libphash.h"
+#include "test_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QW 100
+#define QH 70
+
+static uint8_t quadrant_pixel(int q, int x, int y) {
+    switch (q) {
+        case 0:
+            return (uint8_t)(x * 2 + y);
+        case 1:
+            return (uint8_t)((x / 10 + y / 10) % 2 ? 220 : 30);
+        case 2:
+            return (uint8_t)((x * x + y * 3) & 0xFF);
+        default:
+            return (uint8_t)(x > y ? 200 : y * 3);
+    }
+}
+
+/* Builds a gray PPM of one quadrant, or of all four laid out 2x2 (-1) */
+static size_t make_ppm(uint8_t *buf, int quadrant, int w, int h) {
+    int len = sprintf((char *)buf, "P6\n%d %d\n255\n", w, h);
+    uint8_t *px = buf + len;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int q = quadrant >= 0 ? quadrant : (y >= QH) * 2 + (x >= QW);
+            memset(&px[(y * w + x) * 3], quadrant_pixel(q, x % QW, y % QH), 3);
+        }
+    }
+    return (size_t)len + (size_t)w * h * 3;
+}
+
+void test_tiled_matches_crops() {
+    const ph_algo_t algos[] = {PH_ALGO_AHASH, PH_ALGO_DHASH, PH_ALGO_PHASH, PH_ALGO_WHASH,
+                               PH_ALGO_MHASH};
+    uint8_t *buf = malloc(64 + 4 * QW * QH * 3);
+    ph_context_t *whole = NULL, *crop = NULL;
+    ASSERT_OK(ph_create(&whole));
+    ASSERT_OK(ph_create(&crop));
+    ASSERT_OK(ph_load_from_memory(whole, buf, make_ppm(buf, -1, 2 * QW, 2 * QH)));
+
+    /* Without overlap a 2x2 grid hashes exactly the four quadrants */
+    for (size_t a = 0; a < sizeof(algos) / sizeof(algos[0]); a++) {
+        uint64_t tiles[4], single = 0;
+        ASSERT_OK(ph_compute_tiled(whole, algos[a], 2, 0.0f, tiles));
+        for (int q = 0; q < 4; q++) {
+            ASSERT_OK(ph_load_from_memory(crop, buf, make_ppm(buf, q, QW, QH)));
+            ASSERT_OK(ph_compute_tiled(crop, algos[a], 1, 0.0f, &single));
+            ASSERT_INT_EQ(1, tiles[q] == single);
+        }
+    }
+
+    ph_free(whole);
+    ph_free(crop);
+    free(buf);
+    printf("test_tiled_matches_crops: PASSED\n");
+}
+
+void test_tiled_photo() {
+    ph_context_t *ctx = NULL;
+    uint64_t tiles[36], whole = 0, global = 0;
+    ASSERT_OK(ph_create(&ctx));
+    ASSERT_OK(ph_load_from_file(ctx, "tests/photo.jpeg"));
+
+    /* One tile is the whole image, close to the pyramid-based hash */
+    ASSERT_OK(ph_compute_tiled(ctx, PH_ALGO_PHASH, 1, 0.0f, &whole));
+    ASSERT_OK(ph_compute_phash(ctx, &global));
+    ASSERT_INT_EQ(1, ph_hamming_distance(whole, global) <= 8);
+
+    /* Overlapping tiles differ from one another */
+    ASSERT_OK(ph_compute_tiled(ctx, PH_ALGO_PHASH, 6, 0.5f, tiles));
+    ASSERT_INT_EQ(1, tiles[0] != tiles[35]);
+
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_compute_tiled(ctx, PH_ALGO_PHASH, 0, 0.0f, tiles));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_compute_tiled(ctx, PH_ALGO_PHASH, 2, 1.0f, tiles));
+    ASSERT_INT_EQ(PH_ERR_INVALID_ARGUMENT, ph_compute_tiled(ctx, PH_ALGO_BMH, 2, 0.0f, tiles));
+
+    ph_free(ctx);
+    printf("test_tiled_photo: PASSED\n");
+}
+
+int main() {
+    test_tiled_matches_crops();
+    test_tiled_photo();
+    return 0;
+}
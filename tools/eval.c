@@ -0,0 +1,570 @@
+/*
+ * ph_eval: robustness versus throughput of the hash algorithms.
+ *
+ * Every input image is put through a fixed set of deterministic transforms
+ * (rescale, JPEG-style recompression, crop, rotation, brightness, gamma,
+ * flip). For each algorithm the tool then reports precision and recall of
+ * "transformed copy of the same image" against "any variant of a different
+ * image" over a range of thresholds, next to the single-thread hashing cost:
+ * 'cold' from a freshly loaded image (including the shared grayscale
+ * conversion and pyramid), 'hash' with those already built.
+ *
+ * Usage: ph_eval [-n iterations] [DIR|FILE]...   (default: tests)
+ *
+ * Byte-identical inputs count as one image. With the handful of images in
+ * tests/ the numbers are only a smoke test; point it at a real corpus.
+ */
+#include "libphash.h"
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "../vendor/stb_image.h"
+
+#define MAX_IMAGES 4096
+#define THRESHOLD_STEPS 8
+#define PI 3.14159265358979323846
+
+// --- Images and transforms ---
+
+typedef struct {
+    uint8_t *px; /* RGB */
+    int w;
+    int h;
+} image_t;
+
+static int image_alloc(image_t *img, int w, int h) {
+    img->w = w;
+    img->h = h;
+    img->px = malloc((size_t)w * h * 3);
+    return img->px != NULL;
+}
+
+static uint8_t clamp_u8(double v) { return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v + 0.5); }
+
+/* Bilinear sample of channel c at (x, y), clamped to the edges */
+static double sample(const image_t *img, double x, double y, int c) {
+    x = x < 0 ? 0 : x > img->w - 1 ? img->w - 1 : x;
+    y = y < 0 ? 0 : y > img->h - 1 ? img->h - 1 : y;
+    int x0 = (int)x, y0 = (int)y;
+    int x1 = x0 + 1 < img->w ? x0 + 1 : x0, y1 = y0 + 1 < img->h ? y0 + 1 : y0;
+    double fx = x - x0, fy = y - y0;
+    const uint8_t *p = img->px;
+    double top = p[(y0 * img->w + x0) * 3 + c] * (1 - fx) + p[(y0 * img->w + x1) * 3 + c] * fx;
+    double bottom = p[(y1 * img->w + x0) * 3 + c] * (1 - fx) + p[(y1 * img->w + x1) * 3 + c] * fx;
+    return top * (1 - fy) + bottom * fy;
+}
+
+static int t_identity(const image_t *src, image_t *dst) {
+    if (!image_alloc(dst, src->w, src->h))
+        return 0;
+    memcpy(dst->px, src->px, (size_t)src->w * src->h * 3);
+    return 1;
+}
+
+static int t_half(const image_t *src, image_t *dst) {
+    int w = src->w / 2 > 0 ? src->w / 2 : 1, h = src->h / 2 > 0 ? src->h / 2 : 1;
+    if (!image_alloc(dst, w, h))
+        return 0;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            for (int c = 0; c < 3; c++)
+                dst->px[(y * w + x) * 3 + c] = clamp_u8(sample(src, 2 * x + 0.5, 2 * y + 0.5, c));
+    return 1;
+}
+
+static int t_crop(const image_t *src, image_t *dst) {
+    int x0 = src->w / 10, y0 = src->h / 10;
+    int w = src->w - 2 * x0, h = src->h - 2 * y0;
+    if (!image_alloc(dst, w, h))
+        return 0;
+    for (int y = 0; y < h; y++)
+        memcpy(&dst->px[(size_t)y * w * 3], &src->px[((size_t)(y + y0) * src->w + x0) * 3],
+               (size_t)w * 3);
+    return 1;
+}
+
+static int t_rotate(const image_t *src, image_t *dst) {
+    const double a = 5.0 * PI / 180.0, ca = cos(a), sa = sin(a);
+    const double cx = (src->w - 1) / 2.0, cy = (src->h - 1) / 2.0;
+    if (!image_alloc(dst, src->w, src->h))
+        return 0;
+    for (int y = 0; y < src->h; y++) {
+        for (int x = 0; x < src->w; x++) {
+            double sx = ca * (x - cx) + sa * (y - cy) + cx;
+            double sy = -sa * (x - cx) + ca * (y - cy) + cy;
+            for (int c = 0; c < 3; c++)
+                dst->px[(y * src->w + x) * 3 + c] = clamp_u8(sample(src, sx, sy, c));
+        }
+    }
+    return 1;
+}
+
+static int t_brighter(const image_t *src, image_t *dst) {
+    if (!image_alloc(dst, src->w, src->h))
+        return 0;
+    for (size_t i = 0; i < (size_t)src->w * src->h * 3; i++)
+        dst->px[i] = clamp_u8(src->px[i] + 40.0);
+    return 1;
+}
+
+static int t_gamma(const image_t *src, image_t *dst) {
+    if (!image_alloc(dst, src->w, src->h))
+        return 0;
+    for (size_t i = 0; i < (size_t)src->w * src->h * 3; i++)
+        dst->px[i] = clamp_u8(pow(src->px[i] / 255.0, 0.6) * 255.0);
+    return 1;
+}
+
+static int t_flip(const image_t *src, image_t *dst) {
+    if (!image_alloc(dst, src->w, src->h))
+        return 0;
+    for (int y = 0; y < src->h; y++)
+        for (int x = 0; x < src->w; x++)
+            memcpy(&dst->px[(y * src->w + x) * 3], &src->px[(y * src->w + src->w - 1 - x) * 3], 3);
+    return 1;
+}
+
+/*
+ * JPEG recompression without an encoder: the lossy part of baseline JPEG
+ * (YCbCr, 8x8 DCT, quantization with the standard tables at quality 50)
+ * applied and inverted in place. Entropy coding is lossless and skipped.
+ */
+static const uint8_t s_quant_luma[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+static const uint8_t s_quant_chroma[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+static void quantize_block(double block[64], const uint8_t quant[64], const double basis[8][8]) {
+    double tmp[64], coef[64];
+    for (int u = 0; u < 8; u++)
+        for (int x = 0; x < 8; x++) {
+            double s = 0;
+            for (int y = 0; y < 8; y++)
+                s += basis[u][y] * block[y * 8 + x];
+            tmp[u * 8 + x] = s;
+        }
+    for (int u = 0; u < 8; u++)
+        for (int v = 0; v < 8; v++) {
+            double s = 0;
+            for (int x = 0; x < 8; x++)
+                s += basis[v][x] * tmp[u * 8 + x];
+            coef[u * 8 + v] = round(s / quant[u * 8 + v]) * quant[u * 8 + v];
+        }
+    for (int y = 0; y < 8; y++)
+        for (int v = 0; v < 8; v++) {
+            double s = 0;
+            for (int u = 0; u < 8; u++)
+                s += basis[u][y] * coef[u * 8 + v];
+            tmp[y * 8 + v] = s;
+        }
+    for (int y = 0; y < 8; y++)
+        for (int x = 0; x < 8; x++) {
+            double s = 0;
+            for (int v = 0; v < 8; v++)
+                s += basis[v][x] * tmp[y * 8 + v];
+            block[y * 8 + x] = s;
+        }
+}
+
+static int t_jpeg(const image_t *src, image_t *dst) {
+    double basis[8][8];
+    for (int u = 0; u < 8; u++)
+        for (int x = 0; x < 8; x++)
+            basis[u][x] = (u == 0 ? sqrt(1.0 / 8) : sqrt(2.0 / 8)) * cos((2 * x + 1) * u * PI / 16);
+
+    const int w = src->w, h = src->h;
+    double *planes = malloc((size_t)w * h * 3 * sizeof(double));
+    if (!planes || !image_alloc(dst, w, h)) {
+        free(planes);
+        return 0;
+    }
+    double *Y = planes, *Cb = planes + (size_t)w * h, *Cr = planes + 2 * (size_t)w * h;
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        double r = src->px[i * 3], g = src->px[i * 3 + 1], b = src->px[i * 3 + 2];
+        Y[i] = 0.299 * r + 0.587 * g + 0.114 * b - 128;
+        Cb[i] = -0.168736 * r - 0.331264 * g + 0.5 * b;
+        Cr[i] = 0.5 * r - 0.418688 * g - 0.081312 * b;
+    }
+
+    double *plane[3] = {Y, Cb, Cr};
+    for (int p = 0; p < 3; p++) {
+        for (int by = 0; by < h; by += 8) {
+            for (int bx = 0; bx < w; bx += 8) {
+                // Partial edge blocks repeat their last row/column, as encoders do
+                double block[64];
+                for (int y = 0; y < 8; y++)
+                    for (int x = 0; x < 8; x++) {
+                        int sx = bx + x < w ? bx + x : w - 1, sy = by + y < h ? by + y : h - 1;
+                        block[y * 8 + x] = plane[p][(size_t)sy * w + sx];
+                    }
+                quantize_block(block, p == 0 ? s_quant_luma : s_quant_chroma, basis);
+                for (int y = 0; y < 8 && by + y < h; y++)
+                    for (int x = 0; x < 8 && bx + x < w; x++)
+                        plane[p][(size_t)(by + y) * w + bx + x] = block[y * 8 + x];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        double y = Y[i] + 128;
+        dst->px[i * 3] = clamp_u8(y + 1.402 * Cr[i]);
+        dst->px[i * 3 + 1] = clamp_u8(y - 0.344136 * Cb[i] - 0.714136 * Cr[i]);
+        dst->px[i * 3 + 2] = clamp_u8(y + 1.772 * Cb[i]);
+    }
+    free(planes);
+    return 1;
+}
+
+typedef struct {
+    const char *name;
+    int (*apply)(const image_t *src, image_t *dst);
+} transform_t;
+
+/* Variant 0 is the original */
+static const transform_t s_transforms[] = {
+    {"original", t_identity}, {"scale50", t_half},     {"jpeg50", t_jpeg},
+    {"crop80", t_crop},       {"rotate5", t_rotate},   {"bright40", t_brighter},
+    {"gamma0.6", t_gamma},    {"flip", t_flip},
+};
+#define N_VARIANTS (int)(sizeof(s_transforms) / sizeof(s_transforms[0]))
+
+/* Serializes an image as a binary PPM, which every build of the library decodes */
+static uint8_t *to_ppm(const image_t *img, size_t *out_len) {
+    char header[64];
+    int hl = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", img->w, img->h);
+    size_t len = (size_t)hl + (size_t)img->w * img->h * 3;
+    uint8_t *buf = malloc(len);
+    if (buf) {
+        memcpy(buf, header, (size_t)hl);
+        memcpy(buf + hl, img->px, len - (size_t)hl);
+    }
+    *out_len = len;
+    return buf;
+}
+
+// --- Algorithms ---
+
+enum { METRIC_HAMMING64, METRIC_HAMMING_DIGEST, METRIC_L2 };
+
+typedef struct {
+    const char *name;
+    ph_algo_t algo;
+    int metric;
+} algo_t;
+
+static const algo_t s_algos[] = {
+    {"ahash", PH_ALGO_AHASH, METRIC_HAMMING64},  {"dhash", PH_ALGO_DHASH, METRIC_HAMMING64},
+    {"phash", PH_ALGO_PHASH, METRIC_HAMMING64},  {"whash", PH_ALGO_WHASH, METRIC_HAMMING64},
+    {"mhash", PH_ALGO_MHASH, METRIC_HAMMING64},  {"bmh", PH_ALGO_BMH, METRIC_HAMMING_DIGEST},
+    {"radial", PH_ALGO_RADIAL, METRIC_L2},
+};
+#define N_ALGOS (int)(sizeof(s_algos) / sizeof(s_algos[0]))
+
+typedef struct {
+    uint64_t u64;
+    ph_digest_t digest;
+} signature_t;
+
+static ph_error_t compute(ph_context_t *ctx, ph_algo_t algo, signature_t *out) {
+    switch (algo) {
+        case PH_ALGO_AHASH:
+            return ph_compute_ahash(ctx, &out->u64);
+        case PH_ALGO_DHASH:
+            return ph_compute_dhash(ctx, &out->u64);
+        case PH_ALGO_PHASH:
+            return ph_compute_phash(ctx, &out->u64);
+        case PH_ALGO_WHASH:
+            return ph_compute_whash(ctx, &out->u64);
+        case PH_ALGO_MHASH:
+            return ph_compute_mhash(ctx, &out->u64);
+        case PH_ALGO_BMH:
+            return ph_compute_bmh(ctx, &out->digest);
+        case PH_ALGO_RADIAL:
+            return ph_compute_radial_hash(ctx, &out->digest);
+        default:
+            return PH_ERR_INVALID_ARGUMENT;
+    }
+}
+
+static double distance(int metric, const signature_t *a, const signature_t *b) {
+    switch (metric) {
+        case METRIC_HAMMING64:
+            return ph_hamming_distance(a->u64, b->u64);
+        case METRIC_HAMMING_DIGEST:
+            return ph_hamming_distance_digest(&a->digest, &b->digest);
+        default:
+            return ph_l2_distance(&a->digest, &b->digest);
+    }
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// --- Corpus ---
+
+typedef struct {
+    char *path;
+    uint64_t fingerprint; /* Of the file bytes, to merge duplicates */
+} input_t;
+
+static uint64_t fnv1a(const uint8_t *p, size_t n) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+static int is_image_name(const char *name) {
+    static const char *const exts[] = {".jpg", ".jpeg", ".png", ".bmp", ".gif",
+                                       ".tga", ".ppm", ".pgm", ".psd", ".hdr"};
+    const char *dot = strrchr(name, '.');
+    if (!dot)
+        return 0;
+    for (size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+        size_t n = strlen(exts[i]);
+        if (strlen(dot) == n) {
+            size_t k = 0;
+            while (k < n && (dot[k] | 0x20) == exts[i][k])
+                k++;
+            if (k == n)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Adds FILE, or the images directly inside DIR in name order */
+static void collect(const char *arg, char **paths, int *count) {
+    DIR *dir = opendir(arg);
+    if (!dir) {
+        if (*count < MAX_IMAGES)
+            paths[(*count)++] = strdup(arg);
+        return;
+    }
+    int first = *count;
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL && *count < MAX_IMAGES) {
+        if (!is_image_name(e->d_name))
+            continue;
+        size_t len = strlen(arg) + strlen(e->d_name) + 2;
+        char *path = malloc(len);
+        snprintf(path, len, "%s/%s", arg, e->d_name);
+        paths[(*count)++] = path;
+    }
+    closedir(dir);
+    qsort(paths + first, (size_t)(*count - first), sizeof(char *), compare_paths);
+}
+
+// --- Report ---
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static size_t count_within(const double *d, size_t n, double t) {
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++)
+        c += d[i] <= t;
+    return c;
+}
+
+int main(int argc, char **argv) {
+    int iterations = 3;
+    char **paths = calloc(MAX_IMAGES, sizeof(char *));
+    int n_paths = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            iterations = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else
+            collect(argv[i], paths, &n_paths);
+    }
+    if (n_paths == 0)
+        collect("tests", paths, &n_paths);
+
+    // Decode the inputs, merging byte-identical files into one image
+    image_t *images = calloc((size_t)n_paths, sizeof(image_t));
+    uint64_t *prints = calloc((size_t)n_paths, sizeof(uint64_t));
+    int n_images = 0;
+    for (int i = 0; i < n_paths; i++) {
+        FILE *f = fopen(paths[i], "rb");
+        if (!f)
+            continue;
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        uint8_t *bytes = len > 0 ? malloc((size_t)len) : NULL;
+        int ok = bytes && fread(bytes, 1, (size_t)len, f) == (size_t)len;
+        fclose(f);
+        uint64_t fp = ok ? fnv1a(bytes, (size_t)len) : 0;
+        int dup = 0;
+        for (int k = 0; ok && k < n_images; k++)
+            dup |= prints[k] == fp;
+        image_t img = {0};
+        if (ok && !dup)
+            img.px = stbi_load_from_memory(bytes, (int)len, &img.w, &img.h, NULL, 3);
+        free(bytes);
+        if (img.px) {
+            prints[n_images] = fp;
+            images[n_images++] = img;
+        } else if (!dup) {
+            fprintf(stderr, "skipping %s\n", paths[i]);
+        }
+    }
+    if (n_images == 0) {
+        fprintf(stderr, "usage: %s [-n iterations] [DIR|FILE]...\n", argv[0]);
+        return 1;
+    }
+
+    // Hash every variant, timing each algorithm on its own fresh load
+    signature_t *sigs = calloc((size_t)n_images * N_VARIANTS * N_ALGOS, sizeof(signature_t));
+    double cold_ns[N_ALGOS] = {0}, warm_ns[N_ALGOS] = {0};
+    size_t ops = 0;
+    ph_context_t *ctx = NULL;
+    if (ph_create(&ctx) != PH_SUCCESS)
+        return 1;
+    for (int i = 0; i < n_images; i++) {
+        for (int v = 0; v < N_VARIANTS; v++) {
+            image_t variant = {0};
+            size_t len = 0;
+            uint8_t *ppm = NULL;
+            if (s_transforms[v].apply(&images[i], &variant))
+                ppm = to_ppm(&variant, &len);
+            free(variant.px);
+            if (!ppm)
+                return 1;
+            for (int a = 0; a < N_ALGOS; a++) {
+                signature_t *sig = &sigs[((size_t)i * N_VARIANTS + v) * N_ALGOS + a];
+                for (int it = 0; it < iterations; it++) {
+                    if (ph_load_from_memory(ctx, ppm, len) != PH_SUCCESS)
+                        return 1;
+                    double t0 = now_ns();
+                    ph_error_t err = compute(ctx, s_algos[a].algo, sig);
+                    double t1 = now_ns();
+                    if (err == PH_SUCCESS)
+                        err = compute(ctx, s_algos[a].algo, sig);
+                    warm_ns[a] += now_ns() - t1;
+                    cold_ns[a] += t1 - t0;
+                    if (err != PH_SUCCESS)
+                        return 1;
+                }
+            }
+            ops += (size_t)iterations;
+            free(ppm);
+        }
+    }
+    ph_free(ctx);
+
+    // Positives: original vs. its transforms. Negatives: original vs. any
+    // variant of another image.
+    size_t n_pos = (size_t)n_images * (N_VARIANTS - 1);
+    size_t n_neg = (size_t)n_images * (n_images - 1) * N_VARIANTS;
+    double *pos = malloc((n_pos + 1) * sizeof(double));
+    double *neg = malloc((n_neg + 1) * sizeof(double));
+    double *sorted = malloc((n_neg + 1) * sizeof(double));
+
+    printf("corpus: %d images x %d variants, %d iterations, single thread\n\n", n_images,
+           N_VARIANTS, iterations);
+    printf("%-8s %10s %10s %10s %10s %10s %10s\n", "algo", "cold ns", "hash ns", "images/s",
+           "threshold", "precision", "recall");
+    for (int a = 0; a < N_ALGOS; a++) {
+        size_t np = 0, nn = 0;
+        for (int i = 0; i < n_images; i++) {
+            const signature_t *orig = &sigs[(size_t)i * N_VARIANTS * N_ALGOS + a];
+            for (int j = 0; j < n_images; j++) {
+                for (int v = 0; v < N_VARIANTS; v++) {
+                    const signature_t *other = &sigs[((size_t)j * N_VARIANTS + v) * N_ALGOS + a];
+                    if (i == j && v > 0)
+                        pos[np++] = distance(s_algos[a].metric, orig, other);
+                    else if (i != j)
+                        neg[nn++] = distance(s_algos[a].metric, orig, other);
+                }
+            }
+        }
+
+        // Sweep up to the median distance between different images
+        double top;
+        if (nn > 0) {
+            memcpy(sorted, neg, nn * sizeof(double));
+            qsort(sorted, nn, sizeof(double), compare_doubles);
+            top = sorted[nn / 2];
+        } else {
+            top = 0;
+            for (size_t k = 0; k < np; k++)
+                top = pos[k] > top ? pos[k] : top;
+        }
+
+        double cold = cold_ns[a] / (double)ops, warm = warm_ns[a] / (double)ops;
+        double best_f1 = -1, best_t = 0, last_t = -1;
+        for (int s = 0; s <= THRESHOLD_STEPS; s++) {
+            double t = top * s / THRESHOLD_STEPS;
+            if (s_algos[a].metric != METRIC_L2)
+                t = floor(t);
+            if (t == last_t)
+                continue;
+            last_t = t;
+            size_t tp = count_within(pos, np, t), fp = count_within(neg, nn, t);
+            double recall = np ? (double)tp / (double)np : 0;
+            char precision[16] = "-";
+            if (tp + fp > 0)
+                snprintf(precision, sizeof(precision), "%.3f", (double)tp / (double)(tp + fp));
+            if (s == 0)
+                printf("%-8s %10.0f %10.0f %10.0f", s_algos[a].name, cold, warm, 1e9 / cold);
+            else
+                printf("%-8s %10s %10s %10s", "", "", "", "");
+            printf(" %10.1f %10s %10.3f\n", t, precision, recall);
+            if (tp > 0) {
+                double p = (double)tp / (double)(tp + fp);
+                double f1 = 2 * p * recall / (p + recall);
+                if (f1 > best_f1) {
+                    best_f1 = f1;
+                    best_t = t;
+                }
+            }
+        }
+
+        // Which transforms the best threshold still tolerates
+        printf("%-8s recall @%.1f:", "", best_t);
+        for (int v = 1; v < N_VARIANTS; v++) {
+            int hit = 0;
+            for (int i = 0; i < n_images; i++)
+                hit += pos[(size_t)i * (N_VARIANTS - 1) + (v - 1)] <= best_t;
+            printf(" %s %.2f", s_transforms[v].name, (double)hit / n_images);
+        }
+        printf("\n\n");
+    }
+
+    for (int i = 0; i < n_images; i++)
+        stbi_image_free(images[i].px);
+    for (int i = 0; i < n_paths; i++)
+        free(paths[i]);
+    free(paths);
+    free(images);
+    free(prints);
+    free(sigs);
+    free(pos);
+    free(neg);
+    free(sorted);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Writes the constant tables declared in src/tables.h as C source.
+ * Usage: gen_tables <output.c>
+ */
+#include "../src/tables.h"
+#include <math.h>
+#include <stdio.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static void write_doubles(FILE *f, const char *type, const double *v, int n) {
+    for (int i = 0; i < n; i++) {
+        if (type[0] == 'f')
+            fprintf(f, "%s%.9gf,", i % 4 == 0 ? "\n    " : " ", (float)v[i]);
+        else
+            fprintf(f, "%s%.17g,", i % 4 == 0 ? "\n    " : " ", v[i]);
+    }
+    fprintf(f, "\n");
+}
+
+static void write_dct(FILE *f, const char *type, const char *name) {
+    double row[PH_DCT_SIZE];
+    fprintf(f, "const %s %s[PH_DCT_SIZE][PH_DCT_SIZE] = {\n", type, name);
+    for (int i = 0; i < PH_DCT_SIZE; i++) {
+        double c = sqrt((i == 0 ? 1.0 : 2.0) / PH_DCT_SIZE);
+        for (int j = 0; j < PH_DCT_SIZE; j++)
+            row[j] = i == 0 ? c : c * cos(M_PI * i * (j + 0.5) / PH_DCT_SIZE);
+        fprintf(f, "    {");
+        write_doubles(f, type, row, PH_DCT_SIZE);
+        fprintf(f, "    },\n");
+    }
+    fprintf(f, "};\n\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <output.c>\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "w");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fprintf(f, "/* Generated by tools/gen_tables.c. Do not edit. */\n");
+    fprintf(f, "#include \"tables.h\"\n\n");
+
+    write_dct(f, "double", "ph_dct_matrix");
+    write_dct(f, "float", "ph_dct_matrix_f32");
+
+    // Same expression as ph_context_set_gamma()
+    float gamma = PH_DEFAULT_GAMMA;
+    fprintf(f, "const uint8_t ph_default_gamma_lut[256] = {");
+    for (int i = 0; i < 256; i++) {
+        double res = pow(i / 255.0, 1.0 / (double)gamma) * 255.0;
+        fprintf(f, "%s%d,", i % 16 == 0 ? "\n    " : " ",
+                (int)(uint8_t)(res > 255.0 ? 255.0 : res));
+    }
+    fprintf(f, "\n};\n\n");
+
+    double c[PH_RADIAL_PROJECTIONS], s[PH_RADIAL_PROJECTIONS];
+    for (int i = 0; i < PH_RADIAL_PROJECTIONS; i++) {
+        double theta = (i * M_PI) / PH_RADIAL_PROJECTIONS;
+        c[i] = cos(theta);
+        s[i] = sin(theta);
+    }
+    fprintf(f, "const double ph_radial_cos[PH_RADIAL_PROJECTIONS] = {");
+    write_doubles(f, "double", c, PH_RADIAL_PROJECTIONS);
+    fprintf(f, "};\n\nconst double ph_radial_sin[PH_RADIAL_PROJECTIONS] = {");
+    write_doubles(f, "double", s, PH_RADIAL_PROJECTIONS);
+    fprintf(f, "};\n");
+
+    return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * phashd: serves one hash store to every process on the host.
+ *
+ * Usage: phashd STORE SOCKET      serve STORE on the Unix socket SOCKET
+ *        phashd -w STORE          build STORE from hex hashes on stdin,
+ *                                 one per line
+ *
+ * Workers query it with ph_hashd_connect() / ph_hashd_radius() /
+ * ph_hashd_knn(). SIGINT and SIGTERM shut it down cleanly.
+ */
+#include "libphash.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ph_hashd_t *g_daemon;
+
+static void on_signal(int sig) {
+    (void)sig;
+    ph_hashd_stop(g_daemon);
+}
+
+static int write_store(const char *path) {
+    size_t count = 0, cap = 1024;
+    uint64_t *hashes = malloc(cap * sizeof(uint64_t));
+    char line[128];
+    if (!hashes)
+        return 1;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        char *end;
+        unsigned long long h = strtoull(line, &end, 16);
+        if (end == line)
+            continue;
+        if (count == cap) {
+            uint64_t *grown = realloc(hashes, 2 * cap * sizeof(uint64_t));
+            if (!grown) {
+                free(hashes);
+                return 1;
+            }
+            hashes = grown;
+            cap *= 2;
+        }
+        hashes[count++] = (uint64_t)h;
+    }
+
+    ph_error_t err = ph_hash_store_write(path, hashes, count);
+    free(hashes);
+    if (err != PH_SUCCESS) {
+        fprintf(stderr, "phashd: cannot write %s (error %d)\n", path, err);
+        return 1;
+    }
+    fprintf(stderr, "phashd: wrote %zu hashes to %s\n", count, path);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "-w") == 0)
+        return write_store(argv[2]);
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s STORE SOCKET\n       %s -w STORE < hashes.txt\n", argv[0],
+                argv[0]);
+        return 2;
+    }
+
+    ph_error_t err = ph_hashd_create(argv[1], argv[2], &g_daemon);
+    if (err != PH_SUCCESS) {
+        fprintf(stderr, "phashd: cannot serve %s on %s (error %d)\n", argv[1], argv[2], err);
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    err = ph_hashd_run(g_daemon);
+    ph_hashd_free(g_daemon);
+    if (err != PH_SUCCESS) {
+        fprintf(stderr, "phashd: stopped on error %d\n", err);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,709 @@
+/*
+ * phash-scan: walks directory trees and hashes every image in them.
+ *
+ * Usage: phash-scan [-j threads] [-a algos] [-o out] [-m manifest] [-d dist] [-q] DIR...
+ *
+ *   -j  worker threads (default: CPU count)
+ *   -a  comma-separated uint64_t algorithms: ahash,dhash,phash,whash,mhash
+ *       (default: phash,dhash)
+ *   -o  output file (default: phash-scan.out)
+ *   -m  manifest: an earlier output. Files whose device, inode, size and
+ *       mtime are unchanged reuse its hashes instead of being decoded. May
+ *       be the same path as -o.
+ *   -d  print groups of near-duplicates within this Hamming distance, on
+ *       pHash when it was computed, else on the first algorithm
+ *   -q  no progress lines
+ *
+ * The worker threads both walk directories and hash files. Files found by
+ * a walker go through a bounded queue; when it is full the walker hashes
+ * the file itself, so the number of files in flight stays bounded.
+ *
+ * Memory that does grow with the number of files: a manifest is held whole
+ * for lookups by inode, about 90-170 bytes per file (an 80-byte record_t,
+ * up to half of it unused capacity, plus 8-16 bytes of hash table); -d
+ * keeps 16 bytes per hashed file (hash column, then label and group
+ * size) on top of what ph_cluster_u64() needs.
+ *
+ * Output format (native byte order): the header "PHSCAN01", uint32_t
+ * algorithm mask, uint32_t reserved; then row groups of up to GROUP_ROWS
+ * rows, each a uint32_t row count and uint32_t path bytes followed by the
+ * columns dev, ino, size (uint64_t), mtime in ns (int64_t), error
+ * (int32_t, a ph_error_t), one uint64_t column per selected algorithm in
+ * PH_ALGO_* bit order, path end offsets (uint32_t) and the path bytes.
+ */
+#include "libphash.h"
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAGIC "PHSCAN01"
+#define GROUP_ROWS 65536
+#define QUEUE_CAP 1024
+#define N_ALGOS 5
+
+static const struct {
+    const char *name;
+    ph_algo_t algo;
+} s_algos[N_ALGOS] = {{"ahash", PH_ALGO_AHASH},
+                      {"dhash", PH_ALGO_DHASH},
+                      {"phash", PH_ALGO_PHASH},
+                      {"whash", PH_ALGO_WHASH},
+                      {"mhash", PH_ALGO_MHASH}};
+
+static const char *s_extensions[] = {".jpg", ".jpeg", ".png", ".gif", ".bmp", ".tga",
+                                     ".psd", ".hdr",  ".pic", ".ppm", ".pgm", ".pnm"};
+
+// --- Row groups ---
+
+typedef struct {
+    uint64_t dev, ino, size;
+    int64_t mtime;
+    int32_t error;
+    uint64_t hashes[N_ALGOS];
+} record_t;
+
+typedef struct {
+    uint32_t rows;
+    uint64_t *dev, *ino, *size;
+    int64_t *mtime;
+    int32_t *error;
+    uint64_t *hash[N_ALGOS];
+    uint32_t *path_end;
+    char *paths;
+    size_t path_bytes, path_cap;
+} group_t;
+
+static int group_init(group_t *g) {
+    memset(g, 0, sizeof(*g));
+    g->dev = malloc(GROUP_ROWS * sizeof(uint64_t));
+    g->ino = malloc(GROUP_ROWS * sizeof(uint64_t));
+    g->size = malloc(GROUP_ROWS * sizeof(uint64_t));
+    g->mtime = malloc(GROUP_ROWS * sizeof(int64_t));
+    g->error = malloc(GROUP_ROWS * sizeof(int32_t));
+    g->path_end = malloc(GROUP_ROWS * sizeof(uint32_t));
+    int ok = g->dev && g->ino && g->size && g->mtime && g->error && g->path_end;
+    for (int a = 0; a < N_ALGOS; a++) {
+        g->hash[a] = malloc(GROUP_ROWS * sizeof(uint64_t));
+        ok = ok && g->hash[a];
+    }
+    return ok;
+}
+
+static void group_free(group_t *g) {
+    free(g->dev);
+    free(g->ino);
+    free(g->size);
+    free(g->mtime);
+    free(g->error);
+    free(g->path_end);
+    free(g->paths);
+    for (int a = 0; a < N_ALGOS; a++)
+        free(g->hash[a]);
+}
+
+static int group_add(group_t *g, const char *path, const record_t *r) {
+    size_t len = strlen(path);
+    if (g->path_bytes + len > UINT32_MAX)
+        return 0;
+    if (g->path_bytes + len > g->path_cap) {
+        size_t cap = g->path_cap ? g->path_cap : 1 << 20;
+        while (cap < g->path_bytes + len)
+            cap *= 2;
+        char *p = realloc(g->paths, cap);
+        if (!p)
+            return 0;
+        g->paths = p;
+        g->path_cap = cap;
+    }
+    uint32_t i = g->rows++;
+    g->dev[i] = r->dev;
+    g->ino[i] = r->ino;
+    g->size[i] = r->size;
+    g->mtime[i] = r->mtime;
+    g->error[i] = r->error;
+    for (int a = 0; a < N_ALGOS; a++)
+        g->hash[a][i] = r->hashes[a];
+    memcpy(g->paths + g->path_bytes, path, len);
+    g->path_bytes += len;
+    g->path_end[i] = (uint32_t)g->path_bytes;
+    return 1;
+}
+
+static int group_write(FILE *f, const group_t *g, uint32_t mask) {
+    uint32_t head[2] = {g->rows, (uint32_t)g->path_bytes};
+    size_t n = g->rows;
+    int ok = fwrite(head, sizeof(head), 1, f) == 1 && fwrite(g->dev, 8, n, f) == n &&
+             fwrite(g->ino, 8, n, f) == n && fwrite(g->size, 8, n, f) == n &&
+             fwrite(g->mtime, 8, n, f) == n && fwrite(g->error, 4, n, f) == n;
+    for (int a = 0; a < N_ALGOS; a++) {
+        if (mask & s_algos[a].algo)
+            ok = ok && fwrite(g->hash[a], 8, n, f) == n;
+    }
+    return ok && fwrite(g->path_end, 4, n, f) == n &&
+           fwrite(g->paths, 1, g->path_bytes, f) == g->path_bytes;
+}
+
+/* Returns 1 with a group read, 0 at the end of the file, -1 on errors */
+static int group_read(FILE *f, group_t *g, uint32_t mask) {
+    uint32_t head[2];
+    if (fread(head, sizeof(head), 1, f) != 1)
+        return 0;
+    size_t n = head[0];
+    if (n > GROUP_ROWS)
+        return -1;
+    if (head[1] > g->path_cap) {
+        char *p = realloc(g->paths, head[1]);
+        if (!p)
+            return -1;
+        g->paths = p;
+        g->path_cap = head[1];
+    }
+    int ok = fread(g->dev, 8, n, f) == n && fread(g->ino, 8, n, f) == n &&
+             fread(g->size, 8, n, f) == n && fread(g->mtime, 8, n, f) == n &&
+             fread(g->error, 4, n, f) == n;
+    for (int a = 0; a < N_ALGOS; a++) {
+        if (mask & s_algos[a].algo)
+            ok = ok && fread(g->hash[a], 8, n, f) == n;
+        else
+            memset(g->hash[a], 0, n * 8);
+    }
+    ok = ok && fread(g->path_end, 4, n, f) == n && fread(g->paths, 1, head[1], f) == head[1];
+    g->rows = (uint32_t)n;
+    g->path_bytes = head[1];
+    return ok ? 1 : -1;
+}
+
+static FILE *open_output(const char *path, uint32_t *mask, const char *mode) {
+    FILE *f = fopen(path, mode);
+    if (!f)
+        return NULL;
+    char magic[8];
+    uint32_t head[2] = {*mask, 0};
+    int ok = mode[0] == 'w'
+                 ? fwrite(MAGIC, 8, 1, f) == 1 && fwrite(head, sizeof(head), 1, f) == 1
+                 : fread(magic, 8, 1, f) == 1 && memcmp(magic, MAGIC, 8) == 0 &&
+                       fread(head, sizeof(head), 1, f) == 1;
+    if (!ok) {
+        fclose(f);
+        return NULL;
+    }
+    *mask = head[0];
+    return f;
+}
+
+// --- Manifest: previous results by (dev, ino) ---
+
+/* Walk order differs between runs, so lookups are random and the previous
+ * run is loaded whole rather than streamed by row group. */
+
+typedef struct {
+    record_t *records;
+    uint32_t *slots; /* record index + 1, 0 when empty */
+    size_t count, cap, slot_mask;
+    uint32_t algo_mask;
+} manifest_t;
+
+static size_t key_hash(uint64_t dev, uint64_t ino) {
+    uint64_t h = (dev * 0x9E3779B97F4A7C15ULL) ^ ino;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    return (size_t)(h ^ (h >> 33));
+}
+
+static int manifest_add(manifest_t *m, const record_t *r) {
+    if (m->count == m->cap) {
+        size_t cap = m->cap ? m->cap * 2 : 4096;
+        record_t *records = cap <= UINT32_MAX ? realloc(m->records, cap * sizeof(record_t)) : NULL;
+        if (!records)
+            return 0;
+        m->records = records;
+        m->cap = cap;
+    }
+    m->records[m->count++] = *r;
+    return 1;
+}
+
+static int manifest_load(manifest_t *m, const char *path, uint32_t want) {
+    memset(m, 0, sizeof(*m));
+    uint32_t mask = 0;
+    FILE *f = open_output(path, &mask, "rb");
+    if (!f)
+        return errno == ENOENT ? 1 : 0;
+    /* Results for fewer algorithms than requested cannot be reused */
+    if ((mask & want) != want) {
+        fclose(f);
+        return 1;
+    }
+    m->algo_mask = mask;
+
+    group_t g;
+    int status = group_init(&g) ? 1 : -1;
+    while (status == 1 && (status = group_read(f, &g, mask)) == 1) {
+        for (uint32_t i = 0; i < g.rows && status == 1; i++) {
+            record_t r = {g.dev[i], g.ino[i], g.size[i], g.mtime[i], g.error[i], {0}};
+            for (int a = 0; a < N_ALGOS; a++)
+                r.hashes[a] = g.hash[a][i];
+            if (!manifest_add(m, &r))
+                status = -1;
+        }
+    }
+    group_free(&g);
+    fclose(f);
+    if (status < 0)
+        return 0;
+
+    size_t slots = 16;
+    while (slots < m->count * 2)
+        slots *= 2;
+    m->slots = calloc(slots, sizeof(uint32_t));
+    if (!m->slots)
+        return 0;
+    m->slot_mask = slots - 1;
+    for (size_t i = 0; i < m->count; i++) {
+        size_t s = key_hash(m->records[i].dev, m->records[i].ino) & m->slot_mask;
+        while (m->slots[s])
+            s = (s + 1) & m->slot_mask;
+        m->slots[s] = (uint32_t)i + 1;
+    }
+    return 1;
+}
+
+static const record_t *manifest_find(const manifest_t *m, uint64_t dev, uint64_t ino) {
+    if (!m->slots)
+        return NULL;
+    for (size_t s = key_hash(dev, ino) & m->slot_mask; m->slots[s]; s = (s + 1) & m->slot_mask) {
+        const record_t *r = &m->records[m->slots[s] - 1];
+        if (r->dev == dev && r->ino == ino)
+            return r;
+    }
+    return NULL;
+}
+
+// --- Shared scan state ---
+
+typedef struct {
+    char *path;
+    record_t record;
+} file_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+
+    char **dirs; /* directories still to walk (a stack: depth first) */
+    size_t n_dirs, dirs_cap;
+    int walking;
+
+    file_t queue[QUEUE_CAP];
+    size_t q_head, q_len;
+
+    pthread_mutex_t out_lock;
+    FILE *out;
+    group_t group;
+    int write_failed;
+
+    uint32_t algo_mask;
+    manifest_t manifest;
+
+    atomic_ulong found, hashed, unchanged, failed;
+    atomic_ullong bytes;
+    atomic_int done;
+} scan_t;
+
+static void emit(scan_t *s, const char *path, const record_t *r) {
+    pthread_mutex_lock(&s->out_lock);
+    if (s->group.rows == GROUP_ROWS || !group_add(&s->group, path, r)) {
+        if (!group_write(s->out, &s->group, s->algo_mask))
+            s->write_failed = 1;
+        s->group.rows = 0;
+        s->group.path_bytes = 0;
+        if (!group_add(&s->group, path, r))
+            s->write_failed = 1;
+    }
+    pthread_mutex_unlock(&s->out_lock);
+}
+
+static void hash_file(scan_t *s, ph_context_t *ctx, file_t *file) {
+    ph_hashes_t h;
+    ph_error_t err = ph_load_from_file(ctx, file->path);
+    if (err == PH_SUCCESS)
+        err = ph_compute_hashes(ctx, s->algo_mask, &h);
+    if (err != PH_SUCCESS)
+        memset(&h, 0, sizeof(h));
+    file->record.error = err;
+    file->record.hashes[0] = h.ahash;
+    file->record.hashes[1] = h.dhash;
+    file->record.hashes[2] = h.phash;
+    file->record.hashes[3] = h.whash;
+    file->record.hashes[4] = h.mhash;
+    atomic_fetch_add(err == PH_SUCCESS ? &s->hashed : &s->failed, 1);
+    atomic_fetch_add(&s->bytes, file->record.size);
+    emit(s, file->path, &file->record);
+    free(file->path);
+}
+
+static int is_image(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot)
+        return 0;
+    for (size_t i = 0; i < sizeof(s_extensions) / sizeof(s_extensions[0]); i++) {
+        if (strcasecmp(dot, s_extensions[i]) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int64_t mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+static void push_dir(scan_t *s, char *path) {
+    pthread_mutex_lock(&s->lock);
+    if (s->n_dirs == s->dirs_cap) {
+        size_t cap = s->dirs_cap ? s->dirs_cap * 2 : 256;
+        char **dirs = realloc(s->dirs, cap * sizeof(char *));
+        if (!dirs) {
+            pthread_mutex_unlock(&s->lock);
+            fprintf(stderr, "phash-scan: out of memory, skipping %s\n", path);
+            free(path);
+            return;
+        }
+        s->dirs = dirs;
+        s->dirs_cap = cap;
+    }
+    s->dirs[s->n_dirs++] = path;
+    pthread_cond_signal(&s->cv);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* Queues the file, or hashes it here when the queue is full */
+static void offer_file(scan_t *s, ph_context_t *ctx, char *path, const struct stat *st) {
+    file_t file = {path, {(uint64_t)st->st_dev, (uint64_t)st->st_ino, (uint64_t)st->st_size,
+                          mtime_ns(st), 0, {0}}};
+    atomic_fetch_add(&s->found, 1);
+
+    const record_t *old = manifest_find(&s->manifest, file.record.dev, file.record.ino);
+    if (old && old->size == file.record.size && old->mtime == file.record.mtime) {
+        atomic_fetch_add(&s->unchanged, 1);
+        emit(s, path, old);
+        free(path);
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (s->q_len < QUEUE_CAP) {
+        s->queue[(s->q_head + s->q_len++) % QUEUE_CAP] = file;
+        pthread_cond_signal(&s->cv);
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+    pthread_mutex_unlock(&s->lock);
+    hash_file(s, ctx, &file);
+}
+
+static void walk(scan_t *s, ph_context_t *ctx, char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "phash-scan: cannot open %s: %s\n", dir, strerror(errno));
+        free(dir);
+        return;
+    }
+    size_t dir_len = strlen(dir);
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+            continue;
+        size_t len = dir_len + 1 + strlen(e->d_name);
+        char *path = malloc(len + 1);
+        if (!path)
+            break;
+        snprintf(path, len + 1, "%s/%s", dir, e->d_name);
+
+        struct stat st;
+        if (lstat(path, &st) != 0) {
+            free(path);
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+            push_dir(s, path);
+        else if (S_ISREG(st.st_mode) && is_image(e->d_name))
+            offer_file(s, ctx, path, &st);
+        else
+            free(path);
+    }
+    closedir(d);
+    free(dir);
+}
+
+static void *worker_main(void *arg) {
+    scan_t *s = arg;
+    ph_context_t *ctx = NULL;
+    if (ph_create(&ctx) != PH_SUCCESS)
+        return NULL;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        if (s->q_len > 0) {
+            file_t file = s->queue[s->q_head];
+            s->q_head = (s->q_head + 1) % QUEUE_CAP;
+            s->q_len--;
+            pthread_mutex_unlock(&s->lock);
+            hash_file(s, ctx, &file);
+            pthread_mutex_lock(&s->lock);
+        } else if (s->n_dirs > 0) {
+            char *dir = s->dirs[--s->n_dirs];
+            s->walking++;
+            pthread_mutex_unlock(&s->lock);
+            walk(s, ctx, dir);
+            pthread_mutex_lock(&s->lock);
+            s->walking--;
+            pthread_cond_broadcast(&s->cv);
+        } else if (s->walking == 0) {
+            break;
+        } else {
+            pthread_cond_wait(&s->cv, &s->lock);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    ph_free(ctx);
+    return NULL;
+}
+
+// --- Duplicate groups ---
+
+static int print_duplicates(const char *path, int max_dist, int threads) {
+    uint32_t mask = 0;
+    FILE *f = open_output(path, &mask, "rb");
+    group_t g;
+    if (!f || !group_init(&g))
+        return 0;
+    int column = 0;
+    for (int a = 0; a < N_ALGOS; a++) {
+        if ((mask & s_algos[a].algo) && (!(mask & s_algos[column].algo) ||
+                                         s_algos[a].algo == PH_ALGO_PHASH))
+            column = a;
+    }
+
+    /* Only the hash column (and labels) of successfully hashed rows stay in memory */
+    uint64_t *hashes = NULL;
+    size_t n = 0, cap = 0;
+    int status;
+    while ((status = group_read(f, &g, mask)) == 1) {
+        for (uint32_t i = 0; i < g.rows; i++) {
+            if (g.error[i] != PH_SUCCESS)
+                continue;
+            if (n == cap) {
+                cap = cap ? cap * 2 : 65536;
+                uint64_t *grown = realloc(hashes, cap * sizeof(uint64_t));
+                if (!grown) {
+                    status = -1;
+                    break;
+                }
+                hashes = grown;
+            }
+            hashes[n++] = g.hash[column][i];
+        }
+        if (status < 0)
+            break;
+    }
+
+    uint32_t *labels = n ? malloc(n * sizeof(uint32_t)) : NULL;
+    uint32_t *sizes = n ? calloc(n, sizeof(uint32_t)) : NULL;
+    int ok = status == 0 && (n == 0 || (labels && sizes &&
+                                        ph_cluster_u64(hashes, n, max_dist, threads, labels) ==
+                                            PH_SUCCESS));
+    free(hashes);
+    for (size_t i = 0; ok && i < n; i++)
+        sizes[labels[i]]++;
+
+    /* Second pass: print the paths of every group with more than one member */
+    size_t row = 0, groups = 0;
+    for (size_t i = 0; ok && i < n; i++)
+        groups += sizes[i] > 1;
+    if (ok) {
+        fseek(f, 16, SEEK_SET);
+        while (group_read(f, &g, mask) == 1) {
+            for (uint32_t i = 0; i < g.rows; i++) {
+                if (g.error[i] != PH_SUCCESS)
+                    continue;
+                uint32_t label = labels[row++];
+                if (sizes[label] < 2)
+                    continue;
+                uint32_t start = i ? g.path_end[i - 1] : 0;
+                printf("%u\t%.*s\n", label, (int)(g.path_end[i] - start), g.paths + start);
+            }
+        }
+        fprintf(stderr, "phash-scan: %zu duplicate groups within distance %d on %s\n", groups,
+                max_dist, s_algos[column].name);
+    }
+    free(labels);
+    free(sizes);
+    group_free(&g);
+    fclose(f);
+    return ok;
+}
+
+// --- Main ---
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void report(scan_t *s, double elapsed, const char *prefix) {
+    unsigned long found = atomic_load(&s->found), hashed = atomic_load(&s->hashed);
+    double secs = elapsed > 0.0 ? elapsed : 1e-9;
+    fprintf(stderr,
+            "%s%lu files: %lu hashed, %lu unchanged, %lu failed | %.1f files/s, %.1f hashed/s, "
+            "%.1f MB/s read\n",
+            prefix, found, hashed, atomic_load(&s->unchanged), atomic_load(&s->failed),
+            (double)found / secs, (double)hashed / secs,
+            (double)atomic_load(&s->bytes) / secs / 1e6);
+}
+
+static uint32_t parse_algos(char *list) {
+    uint32_t mask = 0;
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        int a = 0;
+        while (a < N_ALGOS && strcmp(name, s_algos[a].name) != 0)
+            a++;
+        if (a == N_ALGOS)
+            return 0;
+        mask |= s_algos[a].algo;
+    }
+    return mask;
+}
+
+static int usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-j threads] [-a algos] [-o out] [-m manifest] [-d dist] [-q] DIR...\n",
+            argv0);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = "phash-scan.out", *manifest_path = NULL;
+    int threads = 0, max_dist = -1, quiet = 0, opt;
+    char default_algos[] = "phash,dhash";
+    uint32_t algo_mask = 0;
+
+    while ((opt = getopt(argc, argv, "j:a:o:m:d:q")) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'a':
+                algo_mask = parse_algos(optarg);
+                if (!algo_mask)
+                    return usage(argv[0]);
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'm':
+                manifest_path = optarg;
+                break;
+            case 'd':
+                max_dist = atoi(optarg);
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+        return usage(argv[0]);
+    if (!algo_mask)
+        algo_mask = parse_algos(default_algos);
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN) > 0 ? (int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+    static scan_t s;
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_mutex_init(&s.out_lock, NULL);
+    pthread_cond_init(&s.cv, NULL);
+    s.algo_mask = algo_mask;
+    if (manifest_path && !manifest_load(&s.manifest, manifest_path, algo_mask)) {
+        fprintf(stderr, "phash-scan: cannot read manifest %s\n", manifest_path);
+        return 1;
+    }
+
+    /* Written next to the target and renamed, so -m and -o may be the same file */
+    size_t tmp_len = strlen(out_path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    uint32_t mask = algo_mask;
+    if (!tmp_path || !group_init(&s.group))
+        return 1;
+    snprintf(tmp_path, tmp_len, "%s.tmp", out_path);
+    s.out = open_output(tmp_path, &mask, "wb");
+    if (!s.out) {
+        fprintf(stderr, "phash-scan: cannot write %s\n", tmp_path);
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        char *root = strdup(argv[i]);
+        size_t len = root ? strlen(root) : 0;
+        while (len > 1 && root[len - 1] == '/')
+            root[--len] = '\0';
+        if (root)
+            push_dir(&s, root);
+    }
+
+    pthread_t *workers = calloc((size_t)threads, sizeof(pthread_t));
+    if (!workers)
+        return 1;
+    double start = now_s(), last = start;
+    for (int t = 0; t < threads; t++)
+        pthread_create(&workers[t], NULL, worker_main, &s);
+
+    /* Progress while the workers run */
+    for (;;) {
+        pthread_mutex_lock(&s.lock);
+        int finished = s.n_dirs == 0 && s.q_len == 0 && s.walking == 0;
+        pthread_mutex_unlock(&s.lock);
+        if (finished)
+            break;
+        struct timespec pause = {0, 100 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+        double t = now_s();
+        if (!quiet && t - last >= 1.0) {
+            report(&s, t - start, "phash-scan: ");
+            last = t;
+        }
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(workers[t], NULL);
+    free(workers);
+
+    if (s.group.rows > 0 && !group_write(s.out, &s.group, algo_mask))
+        s.write_failed = 1;
+    if (fclose(s.out) != 0 || s.write_failed || rename(tmp_path, out_path) != 0) {
+        fprintf(stderr, "phash-scan: failed writing %s\n", out_path);
+        remove(tmp_path);
+        return 1;
+    }
+    report(&s, now_s() - start, "phash-scan: done, ");
+
+    int ok = max_dist < 0 || print_duplicates(out_path, max_dist, threads);
+    group_free(&s.group);
+    free(s.manifest.records);
+    free(s.manifest.slots);
+    free(tmp_path);
+    return ok ? 0 : 1;
+}